@@ -21,6 +21,7 @@
 #include <vw/Camera/CameraModel.h>
 
 #include <sstream>
+#include <vector>
 #include <iostream>
 
 
@@ -45,6 +46,19 @@ CameraModel::camera_pose(Vector2 const& pix) const {
   return Quaternion<double>();
 }
 
+void CameraModel::pixels_to_rays(const Vector2* pixels, size_t count,
+                                 Vector3* centers, Vector3* directions) const {
+  for (size_t i = 0; i < count; ++i) {
+    try {
+      directions[i] = this->pixel_to_vector(pixels[i]);
+      centers   [i] = this->camera_center  (pixels[i]);
+    } catch (const PixelToRayErr& /*e*/) {
+      directions[i] = Vector3();
+      centers   [i] = Vector3();
+    }
+  }
+}
+
 AdjustedCameraModel::AdjustedCameraModel(boost::shared_ptr<CameraModel> camera_model,
                                          Vector3 const& translation, Quat const& rotation,
                                          Vector2 const& pixel_offset, double scale) :
@@ -124,6 +138,22 @@ Quat AdjustedCameraModel::camera_pose(Vector2 const& pix) const {
   return m_rotation*m_camera->camera_pose(m_scale*pix + m_pixel_offset);
 }
 
+void AdjustedCameraModel::pixels_to_rays(const Vector2* pixels, size_t count,
+                                         Vector3* centers, Vector3* directions) const {
+  // Let the unadjusted model compute the rays in one batch, then adjust them.
+  std::vector<Vector2> raw_pixels(count);
+  for (size_t i = 0; i < count; ++i)
+    raw_pixels[i] = m_scale*pixels[i] + m_pixel_offset;
+  if (count > 0)
+    m_camera->pixels_to_rays(&raw_pixels[0], count, centers, directions);
+  for (size_t i = 0; i < count; ++i) {
+    if (directions[i] == Vector3())
+      continue;
+    directions[i] = m_rotation.rotate(directions[i]);
+    centers   [i] = m_rotation.rotate(centers[i] - m_rotation_center) + m_rotation_center + m_translation;
+  }
+}
+
 // Modify the adjustments by applying on top of them a scale*rotation + translation
 // transform with the origin at the center of the planet (such as output
 // by pc_align's forward or inverse computed alignment transform). 
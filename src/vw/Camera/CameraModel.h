@@ -96,6 +96,16 @@ namespace camera {
     /// - Generally the input pixel is only used for linescane cameras.
     virtual Quaternion<double> camera_pose(Vector2 const& /*pix*/) const;
 
+    /// Computes camera_center() and pixel_to_vector() for count pixels
+    /// at once, writing centers[i] and directions[i] for pixels[i].
+    /// - Pixels whose ray can not be computed get a zero direction
+    ///   instead of throwing a PixelToRayErr.
+    /// - The default implementation calls the single pixel methods.
+    ///   Camera models override it to avoid per-pixel virtual calls,
+    ///   but must still honor overrides of those methods in derived classes.
+    virtual void pixels_to_rays(const Vector2* pixels, size_t count,
+                                Vector3* centers, Vector3* directions) const;
+
     // This should be a value which can never occur in normal
     // circumstances, but it most not be made up of NaN values, as those
     // are hard to compare.
@@ -184,6 +194,8 @@ namespace camera {
     virtual Vector3 pixel_to_vector(Vector2 const&) const;
     virtual Vector3 camera_center  (Vector2 const&) const;
     virtual Quat    camera_pose    (Vector2 const&) const;
+    virtual void    pixels_to_rays (const Vector2* pixels, size_t count,
+                                    Vector3* centers, Vector3* directions) const;
 
     Vector3 adjusted_point(Vector3 const& point) const;
     
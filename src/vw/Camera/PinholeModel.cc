@@ -29,6 +29,7 @@
 #endif
 
 #include <algorithm>
+#include <typeinfo>
 #include <sstream>
 #include <iomanip>
 #include <string>
@@ -442,6 +443,36 @@ Vector3 PinholeModel::camera_center(Vector2 const& /*pix*/ ) const {
   return m_camera_center;
 };
 
+void PinholeModel::pixels_to_rays(const Vector2* pixels, size_t count,
+                                  Vector3* centers, Vector3* directions) const {
+  // The same computation as pixel_to_vector(), but the distortion model
+  // is only called if there is one and the transform is applied inline.
+  // - A derived model may override pixel_to_vector() or camera_center(),
+  //   so it gets the generic version which calls them.
+  if (typeid(*this) != typeid(PinholeModel)) {
+    CameraModel::pixels_to_rays(pixels, count, centers, directions);
+    return;
+  }
+  const bool has_distortion = (m_distortion->name() != NullLensDistortion::class_name());
+  const Matrix<double,3,3> &M = m_inv_camera_transform;
+  for (size_t i = 0; i < count; ++i) {
+    centers[i] = m_camera_center;
+    Vector2 pix = pixels[i]*m_pixel_pitch;
+    if (has_distortion) {
+      try {
+        pix = m_distortion->undistorted_coordinates(*this, pix);
+      } catch (const PixelToRayErr& /*e*/) {
+        directions[i] = Vector3();
+        continue;
+      }
+    }
+    Vector3 dir(M(0,0)*pix[0] + M(0,1)*pix[1] + M(0,2),
+                M(1,0)*pix[0] + M(1,1)*pix[1] + M(1,2),
+                M(2,0)*pix[0] + M(2,1)*pix[1] + M(2,2));
+    directions[i] = normalize(dir);
+  }
+}
+
 void PinholeModel::set_camera_center(Vector3 const& position) {
   m_camera_center = position; 
   rebuild_camera_matrix();
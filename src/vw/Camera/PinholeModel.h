@@ -232,6 +232,11 @@ namespace camera {
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const;
     void set_camera_center(Vector3 const& position);
 
+    // Batch version of pixel_to_vector() and camera_center().
+    // - Only PinholeModel itself uses the inline fast path.
+    virtual void pixels_to_rays(const Vector2* pixels, size_t count,
+                                Vector3* centers, Vector3* directions) const;
+
     // Pose is a rotation which moves a vector in camera coordinates
     // into world coordinates.
     // - The pinhole camera position does not vary by pixel so the input pixel is ignored.
@@ -36,6 +36,7 @@
 #include <vw/FileIO/DiskImageResourcePDS.h>
 #include <vw/FileIO/DiskImageResourcePBM.h>
 #include <vw/FileIO/DiskImageResourceRaw.h>
+#include <vw/FileIO/DiskImageResourceDisparity.h>
 
 #if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
 #include <vw/FileIO/DiskImageResourcePNG.h>
@@ -214,6 +215,7 @@ static void register_default_file_types_impl() {
   REGISTER(".bil", Raw)
   REGISTER(".bip", Raw)
   REGISTER(".bsq", Raw)
+  REGISTER(".vwd", Disparity)
 #undef REGISTER
 }
 
@@ -117,6 +117,25 @@ namespace vw {
     // TODO: This has always been the default, but it probably shouldn't be.
     virtual void flush() {}
 
+    /// Returns the number of reduced-resolution overviews stored with
+    /// the image.  Level 0 is the finest overview (not the full-resolution
+    /// image itself).  Most file formats do not support overviews.
+    virtual int32 num_overviews() const { return 0; }
+
+    /// Returns the size in pixels of the given overview level.
+    virtual Vector2i overview_size( int32 /*level*/ ) const {
+      vw_throw( NoImplErr() << "DiskImageResource: This resource type does not support overviews." );
+      return Vector2i(); // never reached
+    }
+
+    /// Open a new read-only resource that reads from the given overview
+    /// level as if it were a standalone image.  Don't forget to delete
+    /// the returned object when you're finished with it!
+    virtual DiskImageResource* open_overview( int32 /*level*/ ) const {
+      vw_throw( NoImplErr() << "DiskImageResource: This resource type does not support overviews." );
+      return 0; // never reached
+    }
+
   protected:
     DiskImageResource( std::string const& filename ) : m_filename(filename), m_rescale(default_rescale) {}
     ImageFormat m_format;
@@ -0,0 +1,696 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceDisparity.cc
+///
+/// Provides support for the compressed disparity file format.
+///
+/// File layout, all values little-endian:
+/// - Header: "VWDM", version, cols, rows, block cols, block rows (uint32),
+///   channel type (uint8, 0 = float32, 1 = int32), precision bits (uint8),
+///   two reserved bytes.
+/// - Block index: (offset, size) as uint64 for each block in row-major order.
+///   An offset of zero marks a block that was never written.
+/// - Block data: a flag byte (all invalid, all valid, or mixed), the packed
+///   validity bitmask for mixed blocks, then the zigzag varint residuals of
+///   the x and y disparity of each valid pixel.
+///
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/BBox.h>
+#include <vw/FileIO/DiskImageResourceDisparity.h>
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include <boost/integer_traits.hpp>
+#include <boost/shared_ptr.hpp>
+
+using namespace vw;
+
+namespace {
+
+const char   DISPARITY_MAGIC[4] = {'V','W','D','M'};
+const uint32 DISPARITY_VERSION  = 1;
+const uint64 HEADER_BYTES       = 28;
+const uint64 INDEX_ENTRY_BYTES  = 16;
+const int32  DEFAULT_BLOCK_SIZE = 256;
+const int    MAX_PRECISION_BITS = 20;
+
+// Writes span up to this many blocks across, enough to keep the threads busy.
+const int32  BLOCKS_PER_WRITE   = 16;
+
+// The validity channel of a valid PixelMask<Vector2i>.
+const int32  VALID_INT32        = boost::integer_traits<int32>::const_max;
+
+// Quantized values are kept below 2^29 so the predictor can not overflow an int32.
+const double MAX_QUANTIZED = 536870912.0;
+
+enum BlockFlag { BLOCK_ALL_INVALID = 0, BLOCK_ALL_VALID = 1, BLOCK_MIXED = 2 };
+
+void put_uint(std::vector<uint8> &out, uint64 value, int bytes) {
+  for (int i=0; i<bytes; ++i)
+    out.push_back(uint8(value >> (8*i)));
+}
+
+uint64 get_uint(const uint8* data, int bytes) {
+  uint64 value = 0;
+  for (int i=0; i<bytes; ++i)
+    value |= uint64(data[i]) << (8*i);
+  return value;
+}
+
+inline void put_varint(uint8* &out, int64 value) {
+  uint64 z = (uint64(value) << 1) ^ uint64(value >> 63);
+  while (z >= 0x80) {
+    *out++ = uint8(z | 0x80);
+    z >>= 7;
+  }
+  *out++ = uint8(z);
+}
+
+inline bool get_varint(const uint8* &data, const uint8* end, int64 &value) {
+  // Most residuals fit in one byte.
+  if (data != end && *data < 0x80) {
+    const uint64 z = *data++;
+    value = int64(z >> 1) ^ -int64(z & 1);
+    return true;
+  }
+  uint64 z = 0;
+  for (int shift=0; ; shift+=7) {
+    if (data == end || shift > 63)
+      return false;
+    uint8 byte = *data++;
+    z |= uint64(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      break;
+  }
+  value = int64(z >> 1) ^ -int64(z & 1);
+  return true;
+}
+
+/// Predict channel ch of pixel i of a block from the pixels decoded before it.
+/// - With the left, upper and upper left pixels valid this is the median edge
+///   detector of LOCO-I, which is exact on planar disparity surfaces.
+/// - Otherwise the upper or left pixel is used, or the last value in the block.
+inline int32 predict(const int32* q, const uint8* valid, int32 col, int32 row,
+                     int32 width, int ch, int32 last) {
+  const int32 i = row*width + col;
+  const bool has_left = col > 0 && valid[i-1];
+  const bool has_up   = row > 0 && valid[i-width];
+  if (has_left && has_up && valid[i-width-1]) {
+    // Clamping the planar estimate is the same as the median edge test.
+    const int32 a = q[2*(i-1)+ch], b = q[2*(i-width)+ch], c = q[2*(i-width-1)+ch];
+    return std::min(std::max(a + b - c, std::min(a,b)), std::max(a,b));
+  }
+  if (has_up)
+    return q[2*(i-width)+ch];
+  if (has_left)
+    return q[2*(i-1)+ch];
+  return last;
+}
+
+/// The same as predict() for blocks where every pixel is valid.
+inline int32 predict_all_valid(const int32* q, int32 col, int32 row,
+                               int32 width, int ch, int32 last) {
+  const int32 i = row*width + col;
+  if (row == 0)
+    return col == 0 ? last : q[2*(i-1)+ch];
+  if (col == 0)
+    return q[2*(i-width)+ch];
+  const int32 a = q[2*(i-1)+ch], b = q[2*(i-width)+ch], c = q[2*(i-width-1)+ch];
+  return std::min(std::max(a + b - c, std::min(a,b)), std::max(a,b));
+}
+
+template <bool AllValid>
+inline int32 predict(const int32* q, const uint8* valid, int32 col, int32 row,
+                     int32 width, int ch, int32 last) {
+  return AllValid ? predict_all_valid(q, col, row, width, ch, last)
+                  : predict(q, valid, col, row, width, ch, last);
+}
+
+/// Write the residuals of the valid pixels of a block, returning the new end of out.
+template <bool AllValid>
+uint8* encode_residuals(const int32* q, const uint8* valid, int32 width, int32 height, uint8* out) {
+  int32 last[2] = {0, 0};
+  for (int32 row=0; row<height; ++row) {
+    for (int32 col=0; col<width; ++col) {
+      const int32 i = row*width + col;
+      if (!AllValid && !valid[i])
+        continue;
+      for (int ch=0; ch<2; ++ch) {
+        put_varint(out, int64(q[2*i+ch]) - predict<AllValid>(q, valid, col, row, width, ch, last[ch]));
+        last[ch] = q[2*i+ch];
+      }
+    }
+  }
+  return out;
+}
+
+/// Read back what encode_residuals() wrote.  Returns false if the data is corrupt.
+template <bool AllValid>
+bool decode_residuals(const uint8* &ptr, const uint8* end, const uint8* valid,
+                      int32 width, int32 height, int32* q) {
+  int32 last[2] = {0, 0};
+  for (int32 row=0; row<height; ++row) {
+    for (int32 col=0; col<width; ++col) {
+      const int32 i = row*width + col;
+      if (!AllValid && !valid[i])
+        continue;
+      for (int ch=0; ch<2; ++ch) {
+        int64 residual;
+        if (!get_varint(ptr, end, residual))
+          return false;
+        const int64 value = residual + predict<AllValid>(q, valid, col, row, width, ch, last[ch]);
+        if (value < -int64(MAX_QUANTIZED) || value > int64(MAX_QUANTIZED))
+          return false;
+        q[2*i+ch] = last[ch] = int32(value);
+      }
+    }
+  }
+  return true;
+}
+
+/// Encode a block of quantized disparities (x,y interleaved) and validity flags.
+void encode_block(std::vector<int32> const& q, std::vector<uint8> const& valid,
+                  int32 width, int32 height, std::vector<uint8> &out) {
+  const int32 num_pixels = width*height;
+  int32 num_valid = 0;
+  for (int32 i=0; i<num_pixels; ++i)
+    num_valid += valid[i];
+
+  if (num_valid == 0) {
+    out.assign(1, BLOCK_ALL_INVALID);
+    return;
+  }
+
+  // Residuals are at most 31 bits after zigzag coding, so five bytes each.
+  out.resize(1 + (num_pixels+7)/8 + 2*5*size_t(num_valid));
+  uint8* ptr = &out[0];
+  if (num_valid == num_pixels) {
+    *ptr++ = BLOCK_ALL_VALID;
+    ptr = encode_residuals<true>(&q[0], &valid[0], width, height, ptr);
+  } else {
+    *ptr++ = BLOCK_MIXED;
+    for (int32 i=0; i<num_pixels; i+=8) {
+      uint8 bits = 0;
+      for (int32 j=0; j<8 && i+j<num_pixels; ++j)
+        bits |= valid[i+j] << j;
+      *ptr++ = bits;
+    }
+    ptr = encode_residuals<false>(&q[0], &valid[0], width, height, ptr);
+  }
+  out.resize(ptr - &out[0]);
+}
+
+/// Decode a block written by encode_block().  Returns false if the data is corrupt.
+bool decode_block(std::vector<uint8> const& data, int32 width, int32 height,
+                  std::vector<int32> &q, std::vector<uint8> &valid) {
+  const int32 num_pixels = width*height;
+  q.assign(2*num_pixels, 0);
+  valid.assign(num_pixels, 0);
+  if (data.empty())
+    return false;
+
+  const uint8* ptr = &data[0];
+  const uint8* end = ptr + data.size();
+  const uint8 flag = *ptr++;
+  bool ok = true;
+  if (flag == BLOCK_ALL_INVALID) {
+    // Nothing else is stored.
+  } else if (flag == BLOCK_ALL_VALID) {
+    std::fill(valid.begin(), valid.end(), 1);
+    ok = decode_residuals<true>(ptr, end, &valid[0], width, height, &q[0]);
+  } else if (flag == BLOCK_MIXED) {
+    if (end - ptr < (num_pixels+7)/8)
+      return false;
+    for (int32 i=0; i<num_pixels; ++i)
+      valid[i] = (ptr[i/8] >> (i%8)) & 1;
+    ptr += (num_pixels+7)/8;
+    ok = decode_residuals<false>(ptr, end, &valid[0], width, height, &q[0]);
+  } else {
+    return false;
+  }
+  return ok && ptr == end;
+}
+
+/// The layout of a buffer of 3-channel float32 or int32 pixels.
+struct BlockBuffer {
+  ssize_t rstride;
+  bool    is_float;
+  double  scale;   ///< 2^precision_bits
+};
+
+/// Quantize and encode one block of a buffer.
+class EncodeBlockTask : public Task {
+  const uint8* m_origin;
+  BlockBuffer  m_buffer;
+  int32        m_width, m_height;
+public:
+  std::vector<uint8> result;
+  bool               overflow;
+  bool               not_mask; ///< The third channel is not a validity mask.
+
+  EncodeBlockTask(const uint8* origin, BlockBuffer const& buffer, int32 width, int32 height)
+    : m_origin(origin), m_buffer(buffer), m_width(width), m_height(height),
+      overflow(false), not_mask(false) {}
+
+  virtual void operator()() {
+    std::vector<int32> q(2*m_width*m_height);
+    std::vector<uint8> valid(m_width*m_height);
+    const double valid_value = m_buffer.is_float ? 1.0 : double(VALID_INT32);
+    for (int32 row=0; row<m_height; ++row) {
+      const uint8* pixel = m_origin + row*m_buffer.rstride;
+      for (int32 col=0; col<m_width; ++col, pixel+=12) {
+        const int32 i = row*m_width + col;
+        double value[3];
+        if (m_buffer.is_float) {
+          const float32* p = reinterpret_cast<const float32*>(pixel);
+          value[0] = p[0]*m_buffer.scale;  value[1] = p[1]*m_buffer.scale;  value[2] = p[2];
+        } else {
+          const int32* p = reinterpret_cast<const int32*>(pixel);
+          value[0] = p[0];  value[1] = p[1];  value[2] = p[2];
+        }
+        if (value[2] != 0 && value[2] != valid_value) {
+          not_mask = true;
+          return;
+        }
+        valid[i] = (value[2] != 0);
+        if (!valid[i])
+          continue;
+        // The comparison is false for NaN as well.
+        if (!(fabs(value[0]) < MAX_QUANTIZED && fabs(value[1]) < MAX_QUANTIZED)) {
+          overflow = true;
+          return;
+        }
+        q[2*i  ] = int32(floor(value[0] + 0.5));
+        q[2*i+1] = int32(floor(value[1] + 0.5));
+      }
+    }
+    encode_block(q, valid, m_width, m_height, result);
+  }
+};
+
+/// Decode one block and copy the part of it inside the read region to a buffer.
+class DecodeBlockTask : public Task {
+  std::vector<uint8> m_data;
+  int32              m_width, m_height;
+  BBox2i             m_copy;   ///< Region to copy, relative to the block.
+  uint8*             m_origin; ///< Destination of the first pixel of m_copy.
+  BlockBuffer        m_buffer;
+public:
+  bool corrupt;
+
+  DecodeBlockTask(int32 width, int32 height, BBox2i const& copy,
+                  uint8* origin, BlockBuffer const& buffer)
+    : m_width(width), m_height(height), m_copy(copy), m_origin(origin), m_buffer(buffer),
+      corrupt(false) {}
+
+  std::vector<uint8>& data() { return m_data; }
+
+  virtual void operator()() {
+    std::vector<int32> q;
+    std::vector<uint8> valid;
+    if (!decode_block(m_data, m_width, m_height, q, valid)) {
+      corrupt = true;
+      return;
+    }
+    const double inv_scale = 1.0/m_buffer.scale;
+    for (int32 row=m_copy.min().y(); row<m_copy.max().y(); ++row) {
+      uint8* pixel = m_origin + (row-m_copy.min().y())*m_buffer.rstride;
+      for (int32 col=m_copy.min().x(); col<m_copy.max().x(); ++col, pixel+=12) {
+        const int32 i = row*m_width + col;
+        if (m_buffer.is_float) {
+          float32* p = reinterpret_cast<float32*>(pixel);
+          p[0] = float32(q[2*i  ]*inv_scale);
+          p[1] = float32(q[2*i+1]*inv_scale);
+          p[2] = valid[i];
+        } else {
+          int32* p = reinterpret_cast<int32*>(pixel);
+          p[0] = q[2*i];  p[1] = q[2*i+1];  p[2] = valid[i] ? VALID_INT32 : 0;
+        }
+      }
+    }
+  }
+};
+
+/// Whether a buffer holds the pixels as they are stored, so no conversion is needed.
+bool is_native(ImageBuffer const& buffer, ChannelTypeEnum channel_type) {
+  return buffer.format.pixel_format == VW_PIXEL_GENERIC_3_CHANNEL &&
+         buffer.format.channel_type == channel_type &&
+         buffer.format.planes == 1 && buffer.cstride == 12;
+}
+
+/// Run the tasks in a thread pool, or in this thread if there is only one.
+template <class TaskT>
+void run_tasks(std::vector<boost::shared_ptr<TaskT> > const& tasks) {
+  if (tasks.size() == 1) {
+    (*tasks[0])();
+    return;
+  }
+  FifoWorkQueue queue(std::min<int>(tasks.size(), vw_settings().default_num_threads()));
+  for (size_t i=0; i<tasks.size(); ++i)
+    queue.add_task(tasks[i]);
+  queue.join_all();
+}
+
+} // end anonymous
+
+// Constructors
+DiskImageResourceDisparity::DiskImageResourceDisparity( std::string const& filename )
+  : DiskImageResource( filename ), m_writable(false), m_data_started(false), m_data_end(0) {
+  open( filename );
+}
+
+DiskImageResourceDisparity::DiskImageResourceDisparity( std::string const& filename,
+                                                        ImageFormat const& format,
+                                                        int precision_bits )
+  : DiskImageResource( filename ), m_writable(false), m_data_started(false), m_data_end(0) {
+  create( filename, format, precision_bits );
+}
+
+DiskImageResourceDisparity::~DiskImageResourceDisparity() {
+  if (!m_writable || !m_stream.is_open())
+    return;
+  // Exceptions must not escape a destructor.
+  try {
+    flush();
+  } catch (const std::exception& e) {
+    VW_OUT(ErrorMessage) << "DiskImageResourceDisparity: failed to finish " << m_filename
+                         << ": " << e.what() << std::endl;
+  }
+}
+
+Vector2i DiskImageResourceDisparity::num_blocks() const {
+  return Vector2i((cols()-1)/m_block_size.x() + 1, (rows()-1)/m_block_size.y() + 1);
+}
+
+// Bind the resource to a file for reading.
+void DiskImageResourceDisparity::open( std::string const& filename ) {
+
+  std::ifstream input(filename.c_str(), std::ios::in|std::ios::binary);
+  if (!input.is_open())
+    vw_throw( ArgumentErr() << "DiskImageResourceDisparity: Failed to open \"" << filename << "\"." );
+
+  uint8 header[HEADER_BYTES];
+  input.read(reinterpret_cast<char*>(header), HEADER_BYTES);
+  if (!input || memcmp(header, DISPARITY_MAGIC, 4) != 0)
+    vw_throw( ArgumentErr() << "DiskImageResourceDisparity: \"" << filename
+                            << "\" is not a disparity file." );
+  if (get_uint(header+4, 4) != DISPARITY_VERSION)
+    vw_throw( IOErr() << "DiskImageResourceDisparity: unsupported version "
+                      << get_uint(header+4, 4) << " in \"" << filename << "\"." );
+
+  m_format.cols         = uint32(get_uint(header+8,  4));
+  m_format.rows         = uint32(get_uint(header+12, 4));
+  m_format.planes       = 1;
+  m_format.pixel_format = VW_PIXEL_GENERIC_3_CHANNEL;
+  m_format.channel_type = header[24] == 0 ? VW_CHANNEL_FLOAT32 : VW_CHANNEL_INT32;
+  m_block_size          = Vector2i(int32(get_uint(header+16, 4)), int32(get_uint(header+20, 4)));
+  m_precision_bits      = header[25];
+  if (m_format.cols == 0 || m_format.rows == 0 || m_block_size.x() <= 0 || m_block_size.y() <= 0 ||
+      header[24] > 1 || m_precision_bits > MAX_PRECISION_BITS)
+    vw_throw( IOErr() << "DiskImageResourceDisparity: badly-formed file: " << filename );
+
+  const Vector2i blocks = num_blocks();
+  const size_t total_blocks = size_t(blocks.x())*blocks.y();
+  std::vector<uint8> index(total_blocks*INDEX_ENTRY_BYTES);
+  input.read(reinterpret_cast<char*>(&index[0]), index.size());
+  if (!input)
+    vw_throw( IOErr() << "DiskImageResourceDisparity: truncated block index in " << filename );
+
+  m_block_offset.resize(total_blocks);
+  m_block_bytes.resize(total_blocks);
+  for (size_t i=0; i<total_blocks; ++i) {
+    m_block_offset[i] = get_uint(&index[i*INDEX_ENTRY_BYTES],   8);
+    m_block_bytes [i] = get_uint(&index[i*INDEX_ENTRY_BYTES+8], 8);
+  }
+  m_writable     = false;
+  m_data_started = true;
+}
+
+// Bind the resource to a file for writing.
+void DiskImageResourceDisparity::create( std::string const& filename,
+                                         ImageFormat const& format,
+                                         int precision_bits ) {
+
+  if ( format.planes != 1 )
+    vw_throw( NoImplErr() << "DiskImageResourceDisparity doesn't support multi-plane images." );
+  if ( format.pixel_format != VW_PIXEL_GENERIC_3_CHANNEL )
+    vw_throw( NoImplErr() << "DiskImageResourceDisparity only supports disparity images." );
+
+  m_filename     = filename;
+  m_format       = format;
+  m_data_started = false;
+  switch (format.channel_type) {
+  case VW_CHANNEL_FLOAT32:
+  case VW_CHANNEL_FLOAT64:
+    m_format.channel_type = VW_CHANNEL_FLOAT32;
+    break;
+  case VW_CHANNEL_INT32:
+    m_format.channel_type = VW_CHANNEL_INT32;
+    break;
+  default:
+    vw_throw( NoImplErr() << "DiskImageResourceDisparity: unsupported channel type "
+                          << format.channel_type << "." );
+  }
+  set_precision_bits(precision_bits);
+
+  m_block_size = Vector2i(DEFAULT_BLOCK_SIZE, DEFAULT_BLOCK_SIZE);
+
+  m_stream.open(filename.c_str(), std::ios::in|std::ios::out|std::ios::trunc|std::ios::binary);
+  if (!m_stream.is_open())
+    vw_throw( ArgumentErr() << "DiskImageResourceDisparity: Failed to create \"" << filename << "\"." );
+  m_writable = true;
+}
+
+void DiskImageResourceDisparity::set_precision_bits(int bits) {
+  if (m_data_started)
+    vw_throw( LogicErr() << "DiskImageResourceDisparity: the precision can not be changed "
+                         << "once blocks have been written." );
+  if (bits < 0 || bits > MAX_PRECISION_BITS)
+    vw_throw( ArgumentErr() << "DiskImageResourceDisparity: precision bits must be between 0 and "
+                            << MAX_PRECISION_BITS << "." );
+  if (m_format.channel_type != VW_CHANNEL_FLOAT32)
+    bits = 0; // Integer disparities are stored exactly.
+  m_precision_bits = bits;
+}
+
+Vector2i DiskImageResourceDisparity::block_write_size() const {
+  return Vector2i(m_block_size.x()*std::min(num_blocks().x(), BLOCKS_PER_WRITE), m_block_size.y());
+}
+
+void DiskImageResourceDisparity::set_block_write_size(const Vector2i& block_size) {
+  if (m_data_started)
+    vw_throw( LogicErr() << "DiskImageResourceDisparity: the block size can not be changed "
+                         << "once blocks have been written." );
+  if ( (block_size[0] <= 0) || (block_size[1] <= 0) ) // Use a default size
+    m_block_size = Vector2i(DEFAULT_BLOCK_SIZE, DEFAULT_BLOCK_SIZE);
+  else
+    m_block_size = block_size;
+}
+
+void DiskImageResourceDisparity::start_data() {
+  if (m_data_started)
+    return;
+  const Vector2i blocks = num_blocks();
+  const size_t total_blocks = size_t(blocks.x())*blocks.y();
+  m_block_offset.assign(total_blocks, 0);
+  m_block_bytes.assign (total_blocks, 0);
+  m_data_end     = HEADER_BYTES + total_blocks*INDEX_ENTRY_BYTES;
+  m_data_started = true;
+}
+
+// Write the header and block index at the front of the file.
+void DiskImageResourceDisparity::flush() {
+  if (!m_writable)
+    return;
+  start_data();
+
+  std::vector<uint8> header;
+  header.reserve(m_data_end);
+  header.insert(header.end(), DISPARITY_MAGIC, DISPARITY_MAGIC+4);
+  put_uint(header, DISPARITY_VERSION, 4);
+  put_uint(header, m_format.cols,     4);
+  put_uint(header, m_format.rows,     4);
+  put_uint(header, m_block_size.x(),  4);
+  put_uint(header, m_block_size.y(),  4);
+  put_uint(header, m_format.channel_type == VW_CHANNEL_FLOAT32 ? 0 : 1, 1);
+  put_uint(header, m_precision_bits,  1);
+  put_uint(header, 0,                 2);
+  for (size_t i=0; i<m_block_offset.size(); ++i) {
+    put_uint(header, m_block_offset[i], 8);
+    put_uint(header, m_block_bytes [i], 8);
+  }
+
+  m_stream.seekp(0);
+  m_stream.write(reinterpret_cast<const char*>(&header[0]), header.size());
+  m_stream.flush();
+  if (!m_stream)
+    vw_throw( IOErr() << "DiskImageResourceDisparity: failed to write " << m_filename );
+}
+
+// Read the disk image into the given buffer.
+void DiskImageResourceDisparity::read( ImageBuffer const& dest, BBox2i const& bbox ) const {
+
+  VW_ASSERT( !m_writable,
+             NoImplErr() << "DiskImageResourceDisparity does not support reading a file being written." );
+  VW_ASSERT( dest.format.cols==uint32(bbox.width()) && dest.format.rows==uint32(bbox.height()),
+             IOErr() << "Buffer has wrong dimensions in disparity read." );
+  VW_ASSERT( BBox2i(0,0,cols(),rows()).contains(bbox),
+             ArgumentErr() << "DiskImageResourceDisparity: read outside of the image: " << bbox );
+  if (bbox.empty())
+    return;
+
+  std::ifstream input(m_filename.c_str(), std::ios::in|std::ios::binary);
+  if (!input.is_open())
+    vw_throw( IOErr() << "DiskImageResourceDisparity: Failed to open \"" << m_filename << "\"." );
+
+  // Decode straight into the destination if it has the stored pixel type,
+  // otherwise into a temporary which is converted.  Blocks which were never
+  // written stay invalid.
+  ImageFormat format = m_format;
+  format.cols = bbox.width();
+  format.rows = bbox.height();
+  const bool direct = is_native(dest, m_format.channel_type);
+  std::vector<uint8> storage(direct ? 0 : format.byte_size(), 0);
+  ImageBuffer src = direct ? dest : ImageBuffer(format, &storage[0]);
+  if (direct)
+    for (int32 row=0; row<bbox.height(); ++row)
+      memset(static_cast<uint8*>(src.data) + row*src.rstride, 0, bbox.width()*src.cstride);
+
+  BlockBuffer buffer;
+  buffer.rstride  = src.rstride;
+  buffer.is_float = (m_format.channel_type == VW_CHANNEL_FLOAT32);
+  buffer.scale    = double(int64(1) << m_precision_bits);
+
+  // Read the compressed blocks in file order, then decode them in parallel.
+  const Vector2i blocks = num_blocks();
+  std::vector<boost::shared_ptr<DecodeBlockTask> > tasks;
+  for (int32 by = bbox.min().y()/m_block_size.y(); by*m_block_size.y() < bbox.max().y(); ++by) {
+    for (int32 bx = bbox.min().x()/m_block_size.x(); bx*m_block_size.x() < bbox.max().x(); ++bx) {
+      const size_t index = size_t(by)*blocks.x() + bx;
+      if (m_block_offset[index] == 0)
+        continue;
+      BBox2i block_bbox(bx*m_block_size.x(), by*m_block_size.y(), m_block_size.x(), m_block_size.y());
+      block_bbox.crop(BBox2i(0,0,cols(),rows()));
+      BBox2i copy = block_bbox;
+      copy.crop(bbox);
+
+      uint8* origin = static_cast<uint8*>(src.data) + (copy.min().y()-bbox.min().y())*src.rstride
+                                                    + (copy.min().x()-bbox.min().x())*src.cstride;
+      boost::shared_ptr<DecodeBlockTask> task(new DecodeBlockTask(block_bbox.width(), block_bbox.height(),
+                                                                  copy - block_bbox.min(), origin, buffer));
+      task->data().resize(m_block_bytes[index]);
+      input.seekg(m_block_offset[index]);
+      input.read(reinterpret_cast<char*>(&task->data()[0]), m_block_bytes[index]);
+      if (!input)
+        vw_throw( IOErr() << "DiskImageResourceDisparity: truncated block in " << m_filename );
+      tasks.push_back(task);
+    }
+  }
+  if (!tasks.empty())
+    run_tasks(tasks);
+  for (size_t i=0; i<tasks.size(); ++i)
+    if (tasks[i]->corrupt)
+      vw_throw( IOErr() << "DiskImageResourceDisparity: corrupt block in " << m_filename );
+
+  if (!direct)
+    convert( dest, src, m_rescale );
+}
+
+// Write the given buffer into the disk image.
+void DiskImageResourceDisparity::write( ImageBuffer const& source, BBox2i const& bbox ) {
+
+  VW_ASSERT( m_writable,
+             IOErr() << "DiskImageResourceDisparity: \"" << m_filename << "\" is not open for writing." );
+  VW_ASSERT( source.format.cols==uint32(bbox.width()) && source.format.rows==uint32(bbox.height()),
+             IOErr() << "Buffer has wrong dimensions in disparity write." );
+  VW_ASSERT( BBox2i(0,0,cols(),rows()).contains(bbox),
+             ArgumentErr() << "DiskImageResourceDisparity: write outside of the image: " << bbox );
+
+  // Each block is coded on its own, so only whole blocks can be written.
+  const bool aligned =
+    bbox.min().x() % m_block_size.x() == 0 && bbox.min().y() % m_block_size.y() == 0 &&
+    (bbox.max().x() % m_block_size.x() == 0 || bbox.max().x() == cols()) &&
+    (bbox.max().y() % m_block_size.y() == 0 || bbox.max().y() == rows());
+  if (!aligned)
+    vw_throw( ArgumentErr() << "DiskImageResourceDisparity: writes must cover whole "
+                            << m_block_size << " blocks, not " << bbox << "." );
+  if (bbox.empty())
+    return;
+  start_data();
+
+  // Encode straight from the source if it has the stored pixel type.
+  ImageFormat format = m_format;
+  format.cols = bbox.width();
+  format.rows = bbox.height();
+  const bool direct = is_native(source, m_format.channel_type);
+  std::vector<uint8> storage(direct ? 0 : format.byte_size());
+  ImageBuffer src = direct ? source : ImageBuffer(format, &storage[0]);
+  if (!direct)
+    convert( src, source, m_rescale );
+
+  BlockBuffer buffer;
+  buffer.rstride  = src.rstride;
+  buffer.is_float = (m_format.channel_type == VW_CHANNEL_FLOAT32);
+  buffer.scale    = double(int64(1) << m_precision_bits);
+
+  const Vector2i blocks = num_blocks();
+  std::vector<boost::shared_ptr<EncodeBlockTask> > tasks;
+  std::vector<size_t> indices;
+  for (int32 y = bbox.min().y(); y < bbox.max().y(); y += m_block_size.y()) {
+    for (int32 x = bbox.min().x(); x < bbox.max().x(); x += m_block_size.x()) {
+      const uint8* origin = static_cast<const uint8*>(src.data) + (y-bbox.min().y())*src.rstride
+                                                                + (x-bbox.min().x())*src.cstride;
+      tasks.push_back(boost::shared_ptr<EncodeBlockTask>(
+        new EncodeBlockTask(origin, buffer, std::min(m_block_size.x(), bbox.max().x()-x),
+                                            std::min(m_block_size.y(), bbox.max().y()-y))));
+      indices.push_back(size_t(y/m_block_size.y())*blocks.x() + x/m_block_size.x());
+    }
+  }
+  run_tasks(tasks);
+
+  for (size_t i=0; i<tasks.size(); ++i)
+    if (tasks[i]->not_mask)
+      vw_throw( ArgumentErr() << "DiskImageResourceDisparity: the third channel of \"" << m_filename
+                              << "\" is not a validity mask.  Only PixelMask<Vector2> disparity "
+                              << "images can be written." );
+  for (size_t i=0; i<tasks.size(); ++i)
+    if (tasks[i]->overflow)
+      vw_throw( ArgumentErr() << "DiskImageResourceDisparity: disparity too large to store with "
+                              << m_precision_bits << " fractional bits." );
+
+  // Blocks are appended in the order they are written.  The index is
+  // written out by flush().
+  m_stream.seekp(m_data_end);
+  for (size_t i=0; i<tasks.size(); ++i) {
+    std::vector<uint8> const& data = tasks[i]->result;
+    m_stream.write(reinterpret_cast<const char*>(&data[0]), data.size());
+    m_block_offset[indices[i]] = m_data_end;
+    m_block_bytes [indices[i]] = data.size();
+    m_data_end += data.size();
+  }
+  if (!m_stream)
+    vw_throw( IOErr() << "DiskImageResourceDisparity: failed to write " << m_filename );
+}
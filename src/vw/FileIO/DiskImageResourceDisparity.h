@@ -0,0 +1,143 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceDisparity.h
+///
+/// Provides support for a compressed file format for disparity maps.
+///
+/// Disparity images (PixelMask<Vector2f> or PixelMask<Vector2i>) are
+/// otherwise written as three channel TIFFs at 12 bytes per pixel.  This
+/// format stores them much more compactly:
+/// - The disparities are quantized to a fixed number of fractional bits.
+/// - The validity channel is stored as a bitmask, and nothing else is
+///   stored for invalid pixels.  Invalid pixels read back as zero.
+/// - Each disparity is predicted from its neighbors in the row above and to
+///   the left, and only the varint-coded residual is stored.
+/// - The image is split into independently coded blocks which are encoded
+///   and decoded in parallel.  Any region can be read, but writes must
+///   cover whole blocks (clipped to the image), as write_image() does.
+/// - Only PixelMask<Vector2f> or PixelMask<Vector2i> data can be stored.
+///   Their format can not be told apart from other three channel images,
+///   so a write whose third channel is not a validity mask is rejected.
+///
+#ifndef __VW_FILEIO_DISKIMAGERESOURCEDISPARITY_H__
+#define __VW_FILEIO_DISKIMAGERESOURCEDISPARITY_H__
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include <vw/FileIO/DiskImageResource.h>
+
+namespace vw {
+
+  /// Provides support for the compressed disparity format (.vwd).
+  class DiskImageResourceDisparity : public DiskImageResource {
+  public:
+
+    DiskImageResourceDisparity( std::string const& filename ); // Reading
+
+    DiskImageResourceDisparity( std::string const& filename,
+                                ImageFormat const& format,
+                                int precision_bits = 8 ); // Writing
+
+    virtual ~DiskImageResourceDisparity();
+
+    // Returns the type of disk image resource.
+    static std::string type_static(){ return "Disparity"; }
+
+    // Returns the type of disk image resource.
+    virtual std::string type() { return type_static(); }
+
+    /// Read the image resource at the given location into the given buffer.
+    virtual void read (ImageBuffer const& buf,  BBox2i const& bbox) const;
+
+    /// Write the given buffer to the image resource at the given location.
+    /// - The bbox must be made of whole blocks of block_write_size().
+    virtual void write(ImageBuffer const& dest, BBox2i const& bbox);
+
+    /// Write out the block index so that the file can be read.
+    /// - This is also done when the resource is destroyed, where a failure
+    ///   is only logged.  Call flush() first to have it thrown.
+    virtual void flush();
+
+    /// Bind the resource to a file for reading.
+    void open( std::string const& filename );
+
+    /// Bind the resource to a file for writing.
+    /// - Only images with two channels plus a validity channel are supported.
+    /// - Floating point disparities keep precision_bits fractional bits
+    ///   (1/256 pixel by default).  Integer disparities are stored exactly.
+    void create( std::string const& filename,
+                 ImageFormat const& format,
+                 int precision_bits = 8 );
+
+    // Factory functions
+    static DiskImageResource* construct_open( std::string const& filename ) {
+      return new DiskImageResourceDisparity( filename );
+    }
+    static DiskImageResource* construct_create( std::string const& filename,
+                                                ImageFormat const& format ) {
+      return new DiskImageResourceDisparity( filename, format );
+    }
+
+    /// The number of fractional bits kept in this file.
+    int precision_bits() const { return m_precision_bits; }
+
+    /// Set the number of fractional bits kept for floating point disparities.
+    /// - This can only be changed before the first block is written.
+    void set_precision_bits(int bits);
+
+    virtual bool has_block_write () const {return true; }
+    virtual bool has_nodata_write() const {return false;}
+    virtual bool has_block_read  () const {return true; }
+    virtual bool has_nodata_read () const {return false;}
+
+    /// Returns the preferred block size/alignment for partial reads.
+    virtual Vector2i block_read_size() const { return m_block_size; }
+
+    /// Gets the preferred block size/alignment for partial writes.
+    /// - This is a strip of several coding blocks, so that each write()
+    ///   has many blocks to encode in parallel.
+    virtual Vector2i block_write_size() const;
+
+    /// Sets the size of the coding blocks, to which writes must be aligned.
+    /// - This can only be changed before the first block is written.
+    virtual void set_block_write_size(const Vector2i& block_size);
+
+  private:
+
+    /// Number of blocks in each direction.
+    Vector2i num_blocks() const;
+
+    /// Fix the block layout and work out where the block data starts.
+    void start_data();
+
+    Vector2i             m_block_size;
+    int                  m_precision_bits;
+    bool                 m_writable;
+    bool                 m_data_started;
+    uint64               m_data_end;     ///< Where the next block is appended.
+    std::vector<uint64>  m_block_offset; ///< Zero for blocks not yet written.
+    std::vector<uint64>  m_block_bytes;
+    std::fstream         m_stream;       ///< Only open when writing.
+  };
+
+} // namespace VW
+
+#endif//__VW_FILEIO_DISKIMAGERESOURCEDISPARITY_H__
@@ -259,10 +259,28 @@ namespace vw {
 
   /// Bind the resource to a file for reading.  Confirm that we can
   /// open the file and that it has a sane pixel format.
-  void DiskImageResourceGDAL::open( std::string const& filename )
+  void DiskImageResourceGDAL::open( std::string const& filename, int32 overview_level )
   {
     Mutex::Lock lock(d::gdal());
-    m_read_dataset_ptr.reset((GDALDataset*)GDALOpen(filename.c_str(), GA_ReadOnly), GDALCloseNullOk);
+    m_overview_level = overview_level;
+    if ( overview_level < 0 ) {
+      m_read_dataset_ptr.reset((GDALDataset*)GDALOpen(filename.c_str(), GA_ReadOnly), GDALCloseNullOk);
+    } else {
+#if GDAL_VERSION_NUM >= 2020000
+      // The generic OVERVIEW_LEVEL open option makes GDAL present the
+      // overview as an ordinary dataset, so the rest of this class
+      // does not need to know about it.
+      std::ostringstream level_str;
+      level_str << "OVERVIEW_LEVEL=" << overview_level;
+      std::string level_opt = level_str.str();
+      const char* open_options[] = { level_opt.c_str(), NULL };
+      m_read_dataset_ptr.reset((GDALDataset*)GDALOpenEx(filename.c_str(), GDAL_OF_RASTER | GDAL_OF_READONLY,
+                                                        NULL, open_options, NULL),
+                               GDALCloseNullOk);
+#else
+      vw_throw( NoImplErr() << "DiskImageResourceGDAL: Reading overviews requires GDAL 2.2 or newer." );
+#endif
+    }
 
     if( !m_read_dataset_ptr )
       vw_throw( ArgumentErr() << "GDAL: Failed to open " << filename << "." );
@@ -360,6 +378,7 @@ namespace vw {
     m_blocksize = block_size;
 
     m_options = user_options;
+    m_overview_level = -1;
 
     if (m_options["PREDICTOR"].empty()){
       // Unless predictor was explicitly set, use predictor 3 for
@@ -582,6 +601,40 @@ namespace vw {
     }
   }
 
+  int32 DiskImageResourceGDAL::num_overviews() const {
+#if GDAL_VERSION_NUM >= 2020000
+    if ( !m_read_dataset_ptr || m_write_dataset_ptr )
+      return 0; // Overviews of a file being written are not meaningful.
+    Mutex::Lock lock(d::gdal());
+    return m_read_dataset_ptr->GetRasterBand(1)->GetOverviewCount();
+#else
+    return 0;
+#endif
+  }
+
+  Vector2i DiskImageResourceGDAL::overview_size( int32 level ) const {
+    VW_ASSERT( level >= 0 && level < num_overviews(),
+               ArgumentErr() << "DiskImageResourceGDAL: No overview level " << level
+                             << " in " << m_filename << "." );
+    Mutex::Lock lock(d::gdal());
+    GDALRasterBand *overview = m_read_dataset_ptr->GetRasterBand(1)->GetOverview(level);
+    if ( !overview )
+      vw_throw( IOErr() << "DiskImageResourceGDAL: Failed to read overview " << level
+                        << " of " << m_filename << "." );
+    return Vector2i( overview->GetXSize(), overview->GetYSize() );
+  }
+
+  DiskImageResource* DiskImageResourceGDAL::open_overview( int32 level ) const {
+    VW_ASSERT( level >= 0 && level < num_overviews(),
+               ArgumentErr() << "DiskImageResourceGDAL: No overview level " << level
+                             << " in " << m_filename << "." );
+    // Overview levels are always counted from the full-resolution file.
+    DiskImageResourceGDAL* rsrc =
+      new DiskImageResourceGDAL( m_filename, std::max(m_overview_level, -1) + 1 + level );
+    rsrc->set_rescale( m_rescale );
+    return rsrc;
+  }
+
   // Provide read access to the file's metadata
   char **DiskImageResourceGDAL::get_metadata() const {
     boost::shared_ptr<GDALDataset> dataset = get_dataset_ptr();
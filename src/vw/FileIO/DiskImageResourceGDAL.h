@@ -67,6 +67,13 @@ namespace vw {
       open( filename );
     }
 
+    /// Open one of the overview levels of a file as if it were the
+    /// full-resolution image.  Requires GDAL 2.2 or newer.
+    DiskImageResourceGDAL( std::string const& filename, int32 overview_level )
+      : DiskImageResource( filename ) {
+      open( filename, overview_level );
+    }
+
     DiskImageResourceGDAL( std::string const& filename,
                            ImageFormat const& format,
                            Vector2i           block_size = Vector2i(-1,-1) )
@@ -108,10 +115,17 @@ namespace vw {
 
     virtual void flush();
 
+    /// Overviews are reported from the first band of the file.  If this
+    /// resource was itself opened on an overview level, only the
+    /// coarser levels are reported.
+    virtual int32              num_overviews() const;
+    virtual Vector2i           overview_size( int32 level ) const;
+    virtual DiskImageResource* open_overview( int32 level ) const;
+
     // Ask GDAL if it's compiled with support for this file
     static bool gdal_has_support(std::string const& filename);
 
-    void open  ( std::string const& filename );
+    void open  ( std::string const& filename, int32 overview_level = -1 );
     void create( std::string const& filename,
                  ImageFormat const& format,
                  Vector2i           block_size,
@@ -161,6 +175,8 @@ namespace vw {
     std::vector<PixelRGBA<uint8> > m_palette;
     Vector2i m_blocksize;
     Options  m_options;
+    int32    m_overview_level; ///< -1 when reading the full-resolution image
+
     boost::shared_ptr<GDALDataset> m_read_dataset_ptr;
   };
 
@@ -33,6 +33,8 @@
 #pragma warning(disable:4996)
 #endif
 
+#include <map>
+
 #include <mfhdf.h>
 
 #ifndef H4_MAX_VAR_DIMS
@@ -45,6 +47,9 @@
 
 #include <vw/Core/Exception.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/RunOnce.h>
+#include <vw/Core/Thread.h>
 
 #include <vw/FileIO/DiskImageResourceHDF.h>
 
@@ -52,6 +57,30 @@
 // The HDF library interface class
 // *******************************************************************
 
+namespace {
+
+  // The HDF4 library is not thread-safe, so we hold this mutex
+  // anytime we call into the library itself.
+  vw::RunOnce _hdf_init_once = VW_RUNONCE_INIT;
+  vw::Mutex* _hdf_mutex;
+
+  void init_hdf() {
+    _hdf_mutex = new vw::Mutex();
+  }
+
+  vw::Mutex& hdf_mutex() {
+    _hdf_init_once.run( init_hdf );
+    return *_hdf_mutex;
+  }
+
+  // Pick a block dimension that is a whole number of chunks close to
+  // the requested size, clamped to the image dimension.
+  vw::int32 chunk_aligned_size( vw::int32 chunk, vw::int32 requested, vw::int32 image_size ) {
+    vw::int32 num_chunks = std::max( 1, (requested + chunk/2) / chunk );
+    return std::min( num_chunks * chunk, image_size );
+  }
+}
+
 namespace vw {
   static ChannelTypeEnum hdf_to_vw_type( ::int32 data_type ) {
     switch( data_type ) {
@@ -94,6 +123,10 @@ public:
   ::int32 sd_id;
   std::vector<SDSInfo> sds_info;
   std::vector<PlaneInfo> plane_info;
+  // SDS access ids of the selected planes, kept open between reads so
+  // that the HDF chunk cache survives from one block to the next.
+  std::map< ::int32, ::int32> open_sds;
+  Vector2i block_size;
 
   DiskImageResourceInfoHDF( std::string const& filename, DiskImageResourceHDF& resource  ) : resource(resource), sd_id(FAIL) {
 
@@ -160,9 +193,54 @@ public:
   }
 
   ~DiskImageResourceInfoHDF() {
+    close_selected_sds();
     if( sd_id != FAIL ) SDend( sd_id );
   }
 
+  void close_selected_sds() {
+    for( std::map< ::int32, ::int32>::const_iterator i=open_sds.begin(); i!=open_sds.end(); ++i )
+      SDendaccess( i->second );
+    open_sds.clear();
+  }
+
+  /// Open the SDSs backing the selected planes and choose a block size
+  /// that is a whole number of HDF chunks, so that each block read
+  /// decompresses every chunk it touches exactly once.
+  void open_selected_sds( ::int32 cols, ::int32 rows ) {
+    close_selected_sds();
+    const ::int32 tile_size = vw_settings().default_tile_size();
+    // Contiguous storage is row-major, so default to full-width strips.
+    block_size = Vector2i( cols, std::min( rows, tile_size ) );
+    bool chunked = false;
+    for( unsigned p=0; p<plane_info.size(); ++p ) {
+      ::int32 sds = plane_info[p].sds;
+      if( open_sds.count( sds ) ) continue;
+      ::int32 sds_id = SDselect( sd_id, sds );
+      if( sds_id == FAIL ) vw_throw( IOErr() << "Unable to select SDS in HDF file \"" << resource.filename() << "\"!" );
+      open_sds[sds] = sds_id;
+
+      HDF_CHUNK_DEF chunk_def;
+      ::int32 chunk_flags;
+      if( SDgetchunkinfo( sds_id, &chunk_def, &chunk_flags ) == FAIL || !(chunk_flags & HDF_CHUNK) )
+        continue;
+      // The chunk lengths come first in every member of the union.
+      ::int32 rank = sds_info[sds].rank;
+      ::int32 chunk_cols = chunk_def.chunk_lengths[rank-1];
+      ::int32 chunk_rows = chunk_def.chunk_lengths[rank-2];
+      if( !chunked ) {
+        block_size = Vector2i( chunk_aligned_size( chunk_cols, tile_size, cols ),
+                               chunk_aligned_size( chunk_rows, tile_size, rows ) );
+        chunked = true;
+      }
+      // Cache one block row worth of chunks for this SDS.
+      ::int32 max_cache = (block_size.x() + chunk_cols - 1) / chunk_cols;
+      SDsetchunkcache( sds_id, max_cache, 0 );
+    }
+    VW_OUT(DebugMessage, "fileio") << "HDF file \"" << resource.filename() << "\": "
+                                   << (chunked ? "chunked" : "contiguous")
+                                   << " storage, reading blocks of " << block_size << std::endl;
+  }
+
   vw::DiskImageResourceHDF::sds_iterator sds_begin() const {
     return sds_info.begin();
   }
@@ -224,6 +302,7 @@ public:
     new_format.planes = sds_planes.size();
     new_format.pixel_format = VW_PIXEL_SCALAR;
     plane_info = new_plane_info;
+    open_selected_sds( cols, rows );
     VW_OUT(VerboseDebugMessage, "fileio") << "Configured resource: " << new_format.cols << "x" << new_format.rows << "x" << new_format.planes << std::endl;
     return new_format;
   }
@@ -248,8 +327,10 @@ public:
     return ImageFormat();
   }
 
-  void read( ImageBuffer &dstbuf, BBox2i const& bbox ) const {
-    boost::scoped_array<uint8> buffer( new uint8[ bbox.width() * bbox.height() * resource.planes() * channel_size( resource.channel_type() ) ] );
+  /// Read all selected planes into buffer, which the caller owns.
+  /// The caller must hold the HDF mutex.
+  void read( ImageBuffer &dstbuf, boost::scoped_array<uint8>& buffer, BBox2i const& bbox ) const {
+    buffer.reset( new uint8[ bbox.width() * bbox.height() * resource.planes() * channel_size( resource.channel_type() ) ] );
     dstbuf.data = buffer.get();
     dstbuf.format.cols = bbox.width();
     dstbuf.format.rows = bbox.height();
@@ -261,9 +342,10 @@ public:
     dstbuf.pstride = dstbuf.rstride * bbox.height();
     // For each requested plane...
     for( uint32 p=0; p<uint32(dstbuf.format.planes); ++p ) {
-      // Select the SDS
-      ::int32 sds_id = SDselect( sd_id, plane_info[p].sds );
-      if( sds_id == FAIL ) vw_throw( IOErr() << "Unable to select SDS in HDF file \"" << resource.filename() << "\"!" );
+      // Find the already-selected SDS
+      std::map< ::int32, ::int32>::const_iterator sds_iter = open_sds.find( plane_info[p].sds );
+      if( sds_iter == open_sds.end() ) vw_throw( LogicErr() << "No SDS selected in HDF file \"" << resource.filename() << "\"!" );
+      ::int32 sds_id = sds_iter->second;
 
       if( sds_info[plane_info[p].sds].rank == 2 ) {
         ::int32 start[2] = { bbox.min().y(), bbox.min().x() };
@@ -278,8 +360,6 @@ public:
           vw_throw( IOErr() << "Unable to read data from HDF file \"" << resource.filename() << "\"!" );
       }
       else vw_throw( IOErr() << "Invalid SDS rank in HDF file \"" << resource.filename() << "\"!" );
-
-      SDendaccess( sds_id );
     }
   }
 
@@ -554,13 +634,19 @@ public:
 // *********************************************************************
 
 vw::DiskImageResourceHDF::DiskImageResourceHDF( std::string const& filename )
-  : DiskImageResource( filename ),
-    m_info( new DiskImageResourceInfoHDF( filename, *this ) )
-{}
+  : DiskImageResource( filename )
+{
+  Mutex::Lock lock( hdf_mutex() );
+  m_info.reset( new DiskImageResourceInfoHDF( filename, *this ) );
+}
 
-vw::DiskImageResourceHDF::~DiskImageResourceHDF() {}
+vw::DiskImageResourceHDF::~DiskImageResourceHDF() {
+  Mutex::Lock lock( hdf_mutex() );
+  m_info.reset();
+}
 
 void vw::DiskImageResourceHDF::open( std::string const& filename ) {
+  Mutex::Lock lock( hdf_mutex() );
   boost::shared_ptr<DiskImageResourceInfoHDF> new_info( new DiskImageResourceInfoHDF( filename, *this ) );
   m_info = new_info;
 }
@@ -571,10 +657,22 @@ vw::DiskImageResource* vw::DiskImageResourceHDF::construct_open( std::string con
 
 void vw::DiskImageResourceHDF::read( ImageBuffer const& dstbuf, BBox2i const& bbox ) const {
   ImageBuffer srcbuf;
-  m_info->read( srcbuf, bbox );
+  boost::scoped_array<uint8> buffer;
+  {
+    Mutex::Lock lock( hdf_mutex() );
+    m_info->read( srcbuf, buffer, bbox );
+  }
+  // The conversion does not touch the HDF library, so concurrent
+  // block reads can overlap here.
   convert( dstbuf, srcbuf, m_rescale );
 }
 
+vw::Vector2i vw::DiskImageResourceHDF::block_read_size() const {
+  if( m_info->plane_info.empty() )
+    return Vector2i( cols(), rows() );
+  return m_info->block_size;
+}
+
 vw::DiskImageResourceHDF::sds_iterator vw::DiskImageResourceHDF::sds_begin() const {
   return m_info->sds_begin();
 }
@@ -584,86 +682,107 @@ vw::DiskImageResourceHDF::sds_iterator vw::DiskImageResourceHDF::sds_end() const
 }
 
 void vw::DiskImageResourceHDF::select_sds_planes( std::vector<vw::DiskImageResourceHDF::SDSBand> const& sds_planes ) {
+  Mutex::Lock lock( hdf_mutex() );
   m_format = m_info->select_sds_planes( sds_planes );
 }
 
 vw::DiskImageResourceHDF& vw::DiskImageResourceHDF::select_sds( std::string const& name ) {
+  Mutex::Lock lock( hdf_mutex() );
   m_format = m_info->select_sds( name );
   return *this;
 }
 
 void vw::DiskImageResourceHDF::get_sds_fillvalue( std::string const& sds_name, float32& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_fillvalue( sds_name, result );
 }
 
 std::vector<vw::DiskImageResourceHDF::AttrInfo> vw::DiskImageResourceHDF::get_sds_attrs( std::string const& sds_name ) const {
+  Mutex::Lock lock( hdf_mutex() );
   return m_info->get_sds_attrs( sds_name );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<int8>& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, int8& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<uint8>& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, uint8& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<int16>& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, int16& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<uint16>& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, uint16& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<int32>& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, int32& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<uint32>& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, uint32& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<float32>& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, float32& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<float64>& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, float64& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::string& result ) const {
+  Mutex::Lock lock( hdf_mutex() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
@@ -67,9 +67,13 @@ namespace vw {
 
     virtual bool has_block_write () const {return false;}
     virtual bool has_nodata_write() const {return false;}
-    virtual bool has_block_read  () const {return false;}
+    virtual bool has_block_read  () const {return true; }
     virtual bool has_nodata_read () const {return false;}
 
+    /// Blocks are aligned to the HDF chunks of the selected SDS, or are
+    /// full-width strips if the SDS is stored contiguously.
+    virtual Vector2i block_read_size() const;
+
     // The HDF-specific interface:
 
     struct SDSInfo {
@@ -39,8 +39,12 @@
 #include <ImfArray.h>
 #include <ImfLineOrder.h>
 #include <ImfChannelList.h>
+#include <ImfCompression.h>
+#include <ImfThreading.h>
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/RunOnce.h>
+#include <vw/Core/Settings.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/Statistics.h>
 #include <vw/FileIO/DiskImageResourceOpenEXR.h>
@@ -77,6 +81,36 @@ namespace {
 
   }
 
+  // Number of scanlines that OpenEXR compresses together for each
+  // compression type.  Reading a multiple of this avoids decoding the
+  // same line buffer twice for neighboring blocks.
+  int openexr_scanlines_per_buffer(Imf::Compression compression) {
+    switch (compression) {
+    case Imf::ZIP_COMPRESSION:   return 16;
+    case Imf::PXR24_COMPRESSION: return 16;
+    case Imf::PIZ_COMPRESSION:   return 32;
+    case Imf::B44_COMPRESSION:   return 32;
+    case Imf::B44A_COMPRESSION:  return 32;
+    default:                     return 1;
+    }
+  }
+
+  // The OpenEXR library decodes line buffers and tiles on its own global
+  // thread pool.  It is empty by default, so size it once from the VW
+  // settings.  The number of threads passed to each file below only sets
+  // how many line buffers or tiles can be in flight at once.
+  vw::RunOnce openexr_threading_once = VW_RUNONCE_INIT;
+
+  void init_openexr_threading() {
+    if (Imf::globalThreadCount() < int(vw::vw_settings().default_num_threads()))
+      Imf::setGlobalThreadCount(vw::vw_settings().default_num_threads());
+  }
+
+  int openexr_num_threads() {
+    openexr_threading_once.run(init_openexr_threading);
+    return Imf::globalThreadCount();
+  }
+
 }
 
 
@@ -119,12 +153,12 @@ void vw::DiskImageResourceOpenEXR::open( std::string const& filename )
     if (m_input_file_ptr)
       vw_throw( IOErr() << "Disk image resources do not yet support reuse." );
 
-    m_input_file_ptr = new Imf::InputFile(filename.c_str());
+    m_input_file_ptr = new Imf::InputFile(filename.c_str(), openexr_num_threads());
 
     // Check to see if the file is tiled.  If it does, close the descriptor and reopen as a tiled file.
     if (reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->header().hasTileDescription()) {
       delete reinterpret_cast<Imf::InputFile*>(m_input_file_ptr);
-      m_input_file_ptr = new Imf::TiledInputFile(filename.c_str());
+      m_input_file_ptr = new Imf::TiledInputFile(filename.c_str(), openexr_num_threads());
       m_tiled = true;
     } else {
       m_tiled = false;
@@ -153,7 +187,13 @@ void vw::DiskImageResourceOpenEXR::open( std::string const& filename )
       Imf::TileDescription desc = reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->header().tileDescription();
       m_block_size = Vector2i(desc.xSize, desc.ySize);
     } else {
-      m_block_size = Vector2i(m_format.cols,m_openexr_rows_per_block);
+      // Read whole compressed line buffers, and enough of them that
+      // the thread pool has several to decode at once.
+      Imf::Compression compression = reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->header().compression();
+      int32 lines_per_buffer = openexr_scanlines_per_buffer(compression);
+      int32 buffers_per_block = std::max(1, int32(vw_settings().default_tile_size()) / lines_per_buffer);
+      m_block_size = Vector2i(m_format.cols,
+                              std::min(m_format.rows, lines_per_buffer * buffers_per_block));
     }
   } catch (const Iex::ErrnoExc& e) { // Catches non existant files
     vw_throw( vw::ArgumentErr() << "DiskImageResourceOpenEXR: could not open " << filename << ":\n\t" << e.what() );
@@ -195,7 +235,7 @@ void vw::DiskImageResourceOpenEXR::set_tiled_write(int32 tile_width, int32 tile_
     if (random_tile_order)
       header.lineOrder() = Imf::RANDOM_Y;
 
-    m_output_file_ptr = new Imf::TiledOutputFile(m_filename.c_str(), header);
+    m_output_file_ptr = new Imf::TiledOutputFile(m_filename.c_str(), header, openexr_num_threads());
   } catch (const Iex::BaseExc& e) {
     vw_throw( vw::IOErr() << "DiskImageResourceOpenEXR: Failed to create " << m_filename << ".\n\t" << e.what() );
   }
@@ -231,7 +271,7 @@ void vw::DiskImageResourceOpenEXR::set_scanline_write(int32 scanlines_per_block)
     header.lineOrder() = Imf::INCREASING_Y;
 
     m_block_size = Vector2i(m_format.cols,m_openexr_rows_per_block);
-    m_output_file_ptr = new Imf::OutputFile(m_filename.c_str(), header);
+    m_output_file_ptr = new Imf::OutputFile(m_filename.c_str(), header, openexr_num_threads());
 
   } catch (const Iex::BaseExc& e) {
     vw_throw( vw::IOErr() << "DiskImageResourceOpenEXR: Failed to create " << m_filename << ".\n\t" << e.what() );
@@ -324,6 +364,9 @@ void vw::DiskImageResourceOpenEXR::read( ImageBuffer const& dest, BBox2i const&
                      src.cstride, src.rstride, 1, 1, 0.0));
 
     }
+    // Setting the frame buffer and reading from it must happen as one
+    // step when several threads read blocks from the same resource.
+    Mutex::Lock lock(m_read_mutex);
     if (m_tiled) {
       VW_ASSERT(bbox.min().x() % m_block_size[0] == 0 && bbox.min().y() % m_block_size[1] == 0,
                 ArgumentErr() << "DiskImageResourceOpenEXR: bbox corner must fall on tile boundary for read of tiled images.");
@@ -338,6 +381,7 @@ void vw::DiskImageResourceOpenEXR::read( ImageBuffer const& dest, BBox2i const&
       reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->setFrameBuffer (frameBuffer);
       reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->readPixels (bbox.min().y(), std::min<int32>(bbox.min().y() + (height-1), m_format.rows));
     }
+    lock.unlock();
 
     convert( dest, src_image.buffer(), m_rescale );
 
@@ -25,6 +25,7 @@
 
 #include <string>
 
+#include <vw/Core/Thread.h>
 #include <vw/FileIO/DiskImageResource.h>
 
 namespace vw {
@@ -32,6 +33,8 @@ namespace vw {
   /// DiskImageResource implementation for the OpenEXR file format.
   /// - OpenEXR is a high dynamic range image file format developed by
   ///   Industrial Light and Magic (ILM).
+  /// - Compressed line buffers and tiles are decoded in parallel on the
+  ///   OpenEXR thread pool, which is sized from default_num_threads().
   class DiskImageResourceOpenEXR : public DiskImageResource {
   protected:
 
@@ -94,6 +97,7 @@ namespace vw {
     std::string m_filename;
     Vector2i    m_block_size;
     std::vector<std::string> m_labels;
+    mutable Mutex m_read_mutex; ///< The frame buffer is shared state in the OpenEXR reader
     void* m_input_file_ptr;
     void* m_output_file_ptr;
     bool  m_tiled;
@@ -21,6 +21,11 @@
 /// A read-only disk image view.  This is now just a thin
 /// wrapper around the more general ImageResourceView.
 ///
+/// If the file on disk carries reduced-resolution overviews (as many
+/// GDAL formats do), subsample() and resample() of a DiskImageView
+/// read from the closest suitable overview instead of reading every
+/// full-resolution pixel.
+///
 #ifndef __VW_FILEIO_DISKIMAGEVIEW_H__
 #define __VW_FILEIO_DISKIMAGEVIEW_H__
 
@@ -28,6 +33,8 @@
 #include <vw/FileIO/TemporaryFile.h>
 #include <vw/Image/ImageResourceView.h>
 #include <vw/Image/BlockRasterize.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/Transform.h>
 #include <vw/Core/Cache.h>
 
 #include <boost/filesystem/operations.hpp>
@@ -46,6 +53,7 @@ namespace vw {
     // to the underlying resource.
     boost::shared_ptr<DiskImageResource> m_rsrc;
     impl_type m_impl;
+    Cache*    m_cache; ///< Kept so that overview views share the same cache.
 
   public:
     typedef typename impl_type::pixel_type     pixel_type;
@@ -57,7 +65,8 @@ namespace vw {
     DiskImageView( std::string const& filename, Cache* cache = &vw_system_cache() )
       : m_rsrc( DiskImageResource::open( filename ) ),       // Init file interface
         m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), // Init memory storage
-                m_rsrc->block_read_size(), 1, cache ) {
+                m_rsrc->block_read_size(), 1, cache ),
+        m_cache( cache ) {
         // Check for type errors now instead of running into them when we access the image
         try {
           check_convertability(m_impl.child().format(), m_rsrc->format());
@@ -75,21 +84,24 @@ namespace vw {
     /// Constructs a DiskImageView of the given resource using the
     /// specified cache area.
     DiskImageView( boost::shared_ptr<DiskImageResource> resource, Cache* cache = &vw_system_cache())
-      : m_rsrc( resource ), m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {}
+      : m_rsrc( resource ), m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ),
+        m_cache( cache ) {}
 
     /// Constructs a DiskImageView of the given resource using the
     /// specified cache area.  Takes ownership of the resource object
     /// (i.e. deletes it when it's done using it).
     DiskImageView( DiskImageResource *resource, Cache* cache = &vw_system_cache() )
       : m_rsrc( resource ), 
-        m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {}
+        m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ),
+        m_cache( cache ) {}
 
     /// Constructs a DiskImageView of the given resource using the specified
     /// cache area. Does not take ownership, you must ensure resource stays
     /// valid for the lifetime of DiskImageView
     DiskImageView( DiskImageResource &resource, Cache* cache = &vw_system_cache() )
       : m_rsrc( &resource, NOP() ), 
-        m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {}
+        m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ),
+        m_cache( cache ) {}
 
     ~DiskImageView() {}
 
@@ -106,8 +118,224 @@ namespace vw {
 
     std::string filename() const { return m_rsrc->filename(); }
 
+    /// Returns the underlying disk image resource.
+    boost::shared_ptr<DiskImageResource> resource() const { return m_rsrc; }
+
+    /// Returns the number of reduced-resolution overviews in the file.
+    int32 num_overviews() const { return m_rsrc->num_overviews(); }
+
+    /// Returns a view of one of the overviews of this image, using the
+    /// same cache as this view.
+    DiskImageView overview( int32 level ) const {
+      return DiskImageView( m_rsrc->open_overview( level ), m_cache );
+    }
+
   };
 
+  namespace detail {
+
+    /// Returns true if an overview of size ov_size could have been made
+    /// from an image of size full_size by decimating by factor.
+    inline bool is_overview_factor( int32 full_size, int32 ov_size, int32 factor ) {
+      return (full_size + factor - 1) / factor == ov_size;
+    }
+
+    /// Returns the largest decimation factor that is consistent with
+    /// the overview size and that satisfies factor <= max_factor.  If
+    /// must_divide is set the factor must also evenly divide max_factor.
+    /// Returns 1 if there is no such factor.
+    inline int32 overview_factor( int32 full_size, int32 ov_size, int32 max_factor, bool must_divide ) {
+      for ( int32 factor = max_factor; factor > 1; --factor ) {
+        if ( must_divide && max_factor % factor != 0 )
+          continue;
+        if ( is_overview_factor( full_size, ov_size, factor ) )
+          return factor;
+      }
+      return 1;
+    }
+
+    /// Find the coarsest overview of rsrc whose decimation factors are
+    /// no larger than (max_xfactor,max_yfactor).  Returns the overview
+    /// level and sets ov_factor, or returns -1 if no overview helps.
+    inline int32 find_overview( DiskImageResource const& rsrc,
+                                int32 max_xfactor, int32 max_yfactor, bool must_divide,
+                                Vector2i& ov_factor ) {
+      int32 best_level = -1;
+      ov_factor = Vector2i(1,1);
+      if ( max_xfactor < 2 && max_yfactor < 2 )
+        return best_level;
+      const int32 num_overviews = rsrc.num_overviews();
+      for ( int32 level = 0; level < num_overviews; ++level ) {
+        Vector2i ov_size = rsrc.overview_size( level );
+        Vector2i factor( overview_factor( rsrc.cols(), ov_size.x(), max_xfactor, must_divide ),
+                         overview_factor( rsrc.rows(), ov_size.y(), max_yfactor, must_divide ) );
+        // An overview that is only reduced in one direction is not
+        // consistent with the factors we were asked for, so skip it.
+        if ( !is_overview_factor( rsrc.cols(), ov_size.x(), factor.x() ) ||
+             !is_overview_factor( rsrc.rows(), ov_size.y(), factor.y() ) )
+          continue;
+        if ( factor.x() * factor.y() > ov_factor.x() * ov_factor.y() ) {
+          best_level = level;
+          ov_factor  = factor;
+        }
+      }
+      return best_level;
+    }
+
+  } // namespace detail
+
+  // *******************************************************************
+  // Overview-aware subsample() and resample()
+  // *******************************************************************
+
+  /// Subsample a DiskImageView by integer factors in x and y.  If the
+  /// file has an overview whose decimation factors evenly divide the
+  /// requested factors, the pixels are read from that overview instead
+  /// of the full-resolution image.  Each output pixel then comes from
+  /// the overview block starting at the pixel the plain subsample()
+  /// would have picked.  If the overview was built with averaging, its
+  /// pixels are centered (factor-1)/2 pixels into the block, so the
+  /// result is shifted by that much relative to the plain subsample().
+  /// resample() corrects for this shift; subsample() can not, as it
+  /// only picks whole pixels.
+  template <class PixelT>
+  inline SubsampleView<DiskImageView<PixelT> >
+  subsample( DiskImageView<PixelT> const& v, int32 xfactor, int32 yfactor ) {
+    Vector2i ov_factor;
+    int32 level = detail::find_overview( *v.resource(), xfactor, yfactor, true, ov_factor );
+    if ( level < 0 )
+      return SubsampleView<DiskImageView<PixelT> >( v, xfactor, yfactor );
+    VW_OUT(DebugMessage, "fileio") << "Subsampling " << v.filename() << " from overview "
+                                   << level << " with factor " << ov_factor << "\n";
+    return SubsampleView<DiskImageView<PixelT> >( v.overview( level ),
+                                                  xfactor / ov_factor.x(),
+                                                  yfactor / ov_factor.y() );
+  }
+
+  /// Subsample a DiskImageView by an integer factor, reading from an
+  /// overview if possible.
+  template <class PixelT>
+  inline SubsampleView<DiskImageView<PixelT> >
+  subsample( DiskImageView<PixelT> const& v, int32 subsampling_factor ) {
+    return subsample( v, subsampling_factor, subsampling_factor );
+  }
+
+  namespace detail {
+
+    /// Resample v to a width x height image, interpolating from the
+    /// coarsest overview that is still at least as fine as the output.
+    /// - An overview pixel covers a block of factor full resolution
+    ///   pixels, so its center lies (factor-1)/2 pixels into the block.
+    ///   The transform is offset by that much so that the output is
+    ///   aligned with the full resolution result.
+    template <class PixelT, class EdgeT, class InterpT>
+    TransformView<InterpolationView<EdgeExtensionView<DiskImageView<PixelT>, EdgeT>, InterpT>, ResampleTransform>
+    inline resample_overview( DiskImageView<PixelT> const& v,
+                              double x_scale_factor, double y_scale_factor,
+                              int32 width, int32 height,
+                              EdgeT const& edge_func, InterpT const& interp_func ) {
+      Vector2i ov_factor;
+      int32 level = -1;
+      if ( x_scale_factor > 0 && y_scale_factor > 0 )
+        level = find_overview( *v.resource(),
+                               int32(1.0/x_scale_factor + 1e-6), int32(1.0/y_scale_factor + 1e-6),
+                               false, ov_factor );
+      if ( level < 0 )
+        return transform( v, ResampleTransform(x_scale_factor, y_scale_factor),
+                          width, height, edge_func, interp_func );
+      VW_OUT(DebugMessage, "fileio") << "Resampling " << v.filename() << " from overview "
+                                     << level << " with factor " << ov_factor << "\n";
+      Vector2 offset( -(ov_factor.x()-1) / (2.0*ov_factor.x()),
+                      -(ov_factor.y()-1) / (2.0*ov_factor.y()) );
+      return transform( v.overview( level ),
+                        ResampleTransform(x_scale_factor*ov_factor.x(), y_scale_factor*ov_factor.y(), offset),
+                        width, height, edge_func, interp_func );
+    }
+
+  } // namespace detail
+
+  /// Resample a DiskImageView.  When the scale factors are 1/2 or less
+  /// the pixels are interpolated from the coarsest overview that is
+  /// still at least as fine as the output.  The output size is always
+  /// the same as resampling the full-resolution image.
+  template <class PixelT, class EdgeT, class InterpT>
+  typename boost::disable_if<IsScalar<InterpT>, TransformView<InterpolationView<EdgeExtensionView<DiskImageView<PixelT>, EdgeT>, InterpT>, ResampleTransform> >::type
+  inline resample( DiskImageView<PixelT> const& v,
+                   double x_scale_factor,
+                   double y_scale_factor,
+                   EdgeT   const& edge_func,
+                   InterpT const& interp_func ) {
+    return detail::resample_overview( v, x_scale_factor, y_scale_factor,
+                                      int(.5+(v.cols()*x_scale_factor)), int(.5+(v.rows()*y_scale_factor)),
+                                      edge_func, interp_func );
+  }
+
+  /// Resample a DiskImageView with bilinear interpolation, reading from
+  /// an overview if possible.
+  template <class PixelT, class EdgeT>
+  TransformView<InterpolationView<EdgeExtensionView<DiskImageView<PixelT>, EdgeT>, BilinearInterpolation>, ResampleTransform>
+  inline resample( DiskImageView<PixelT> const& v,
+                   double x_scale_factor,
+                   double y_scale_factor,
+                   EdgeT const& edge_func ) {
+    return resample( v, x_scale_factor, y_scale_factor, edge_func, vw::BilinearInterpolation() );
+  }
+
+  /// Resample a DiskImageView with bilinear interpolation, reading from
+  /// an overview if possible.
+  template <class PixelT>
+  TransformView<InterpolationView<EdgeExtensionView<DiskImageView<PixelT>, ConstantEdgeExtension>, BilinearInterpolation>, ResampleTransform>
+  inline resample( DiskImageView<PixelT> const& v,
+                   double x_scale_factor,
+                   double y_scale_factor ) {
+    return resample( v, x_scale_factor, y_scale_factor,
+                     vw::ConstantEdgeExtension(), vw::BilinearInterpolation() );
+  }
+
+  /// Resample a DiskImageView to the given output size, reading from
+  /// an overview if possible.
+  template <class PixelT, class EdgeT, class InterpT>
+  typename boost::disable_if<IsScalar<InterpT>, TransformView<InterpolationView<EdgeExtensionView<DiskImageView<PixelT>, EdgeT>, InterpT>, ResampleTransform> >::type
+  inline resample( DiskImageView<PixelT> const& v,
+                   double scale_factor,
+                   int32 output_width,
+                   int32 output_height,
+                   EdgeT   const& edge_func,
+                   InterpT const& interp_func ) {
+    return detail::resample_overview( v, scale_factor, scale_factor, output_width, output_height,
+                                      edge_func, interp_func );
+  }
+
+  /// Resample a DiskImageView, reading from an overview if possible.
+  template <class PixelT, class EdgeT, class InterpT>
+  typename boost::disable_if<IsScalar<InterpT>, TransformView<InterpolationView<EdgeExtensionView<DiskImageView<PixelT>, EdgeT>, InterpT>, ResampleTransform> >::type
+  inline resample( DiskImageView<PixelT> const& v,
+                   double scale_factor,
+                   EdgeT   const& edge_func,
+                   InterpT const& interp_func ) {
+    return resample( v, scale_factor, scale_factor, edge_func, interp_func );
+  }
+
+  /// Resample a DiskImageView with bilinear interpolation, reading from
+  /// an overview if possible.
+  template <class PixelT, class EdgeT>
+  typename boost::disable_if<IsScalar<EdgeT>, TransformView<InterpolationView<EdgeExtensionView<DiskImageView<PixelT>, EdgeT>, BilinearInterpolation>, ResampleTransform> >::type
+  inline resample( DiskImageView<PixelT> const& v,
+                   double scale_factor,
+                   EdgeT const& edge_func ) {
+    return resample( v, scale_factor, scale_factor, edge_func, vw::BilinearInterpolation() );
+  }
+
+  /// Resample a DiskImageView with bilinear interpolation, reading from
+  /// an overview if possible.
+  template <class PixelT>
+  TransformView<InterpolationView<EdgeExtensionView<DiskImageView<PixelT>, ConstantEdgeExtension>, BilinearInterpolation>, ResampleTransform>
+  inline resample( DiskImageView<PixelT> const& v,
+                   double scale_factor ) {
+    return resample( v, scale_factor, scale_factor,
+                     vw::ConstantEdgeExtension(), vw::BilinearInterpolation() );
+  }
+
 
   template <class PixelT>
     class DiskCacheHandle : private boost::noncopyable {
@@ -25,6 +25,7 @@
 #include <vw/Image/PixelMath.h>
 #include <vw/Image/PixelTypeInfo.h>
 #include <vw/FileIO/DiskImageResource.h>
+#include <vw/FileIO/DiskImageResourceDisparity.h>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
 #include <vw/FileIO/DiskImageResourceJPEG.h>
 #include <vw/FileIO/DiskImageResourceOpenEXR.h>
@@ -35,6 +36,7 @@
 #include <vw/FileIO/DiskImageResource_internal.h>
 
 #include <ostream>
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -440,3 +442,87 @@ TEST( DiskImageResource, PNGComments ) {
 
 
 
+
+TEST( DiskImageResource, Disparity ) {
+  // A sloping subpixel disparity with a hole and an invalid border.
+  ImageView<PixelMask<Vector2f> > disparity(300,200);
+  for (int r=0; r<disparity.rows(); ++r) {
+    for (int c=0; c<disparity.cols(); ++c) {
+      disparity(c,r) = PixelMask<Vector2f>(Vector2f(12.3 + 0.037*c + 0.011*r + 0.2*sin(0.05*r),
+                                                    -4.1 + 0.003*c));
+      if (c < 5 || (c > 100 && c < 140 && r > 60 && r < 90))
+        invalidate(disparity(c,r));
+    }
+  }
+
+  UnlinkName filename("disparity.vwd");
+  {
+    DiskImageResourceDisparity resource(filename, disparity.format());
+    resource.set_block_write_size(Vector2i(64,64));
+    // Writes are strips of coding blocks, so each one encodes several at once.
+    EXPECT_EQ(Vector2i(320,64), resource.block_write_size());
+    write_image(resource, disparity);
+    ImageView<PixelMask<Vector2f> > unaligned = crop(disparity, BBox2i(10,0,64,64));
+    EXPECT_THROW(resource.write(unaligned.buffer(), BBox2i(10,0,64,64)), ArgumentErr);
+    EXPECT_THROW(resource.set_block_write_size(Vector2i(32,32)), LogicErr);
+    EXPECT_THROW(resource.set_precision_bits(4), LogicErr);
+  }
+
+  // Much smaller than the 12 bytes per pixel of an uncompressed image.
+  std::ifstream file(filename.c_str(), std::ios::binary|std::ios::ate);
+  EXPECT_LT(double(file.tellg()), 300*200*12/4.0);
+
+  boost::shared_ptr<DiskImageResource> resource(DiskImageResourcePtr(filename));
+  EXPECT_EQ(DiskImageResourceDisparity::type_static(), resource->type());
+  EXPECT_EQ(Vector2i(64,64), resource->block_read_size());
+  ImageView<PixelMask<Vector2f> > loaded;
+  read_image(loaded, *resource);
+  ASSERT_EQ(disparity.cols(), loaded.cols());
+  ASSERT_EQ(disparity.rows(), loaded.rows());
+  for (int r=0; r<disparity.rows(); ++r) {
+    for (int c=0; c<disparity.cols(); ++c) {
+      ASSERT_EQ(is_valid(disparity(c,r)), is_valid(loaded(c,r))) << c << " " << r;
+      if (is_valid(disparity(c,r)))
+        EXPECT_VECTOR_NEAR(disparity(c,r).child(), loaded(c,r).child(), 1.0/512);
+    }
+  }
+
+  // Partial reads only decode the blocks they need.
+  ImageView<PixelMask<Vector2f> > region;
+  read_image(region, *resource, BBox2i(50,30,100,90));
+  EXPECT_VECTOR_NEAR(loaded(50,30).child(),  region(0,0).child(),   1e-6);
+  EXPECT_VECTOR_NEAR(loaded(149,119).child(), region(99,89).child(), 1e-6);
+  EXPECT_FALSE(is_valid(region(60,40)));
+
+  // Integer disparities are stored exactly, and other images are rejected.
+  ImageView<PixelMask<Vector2i> > integer(20,10);
+  for (int r=0; r<integer.rows(); ++r)
+    for (int c=0; c<integer.cols(); ++c)
+      integer(c,r) = PixelMask<Vector2i>(Vector2i(c*c - 50, -r));
+  invalidate(integer(3,4));
+  write_image(filename, integer);
+  ImageView<PixelMask<Vector2i> > integer_loaded;
+  read_image(integer_loaded, filename);
+  EXPECT_FALSE(is_valid(integer_loaded(3,4)));
+  EXPECT_VECTOR_EQ(integer(19,9).child(), integer_loaded(19,9).child());
+  EXPECT_VECTOR_EQ(integer(7,2).child(),  integer_loaded(7,2).child());
+
+  EXPECT_THROW(DiskImageResourceDisparity(filename, ImageView<PixelRGB<float> >(4,4).format()),
+               NoImplErr);
+
+  // A three channel image which is not a disparity has the same format, so
+  // it is caught by its third channel not being a validity mask.
+  ImageView<Vector3f> points(8,8);
+  fill(points, Vector3f(1,2,3));
+  EXPECT_THROW(write_image(filename, points), ArgumentErr);
+
+  // The precision is set per file.
+  {
+    DiskImageResourceDisparity coarse(filename, disparity.format(), 2);
+    EXPECT_EQ(2, coarse.precision_bits());
+    write_image(coarse, disparity);
+  }
+  read_image(loaded, filename);
+  EXPECT_VECTOR_NEAR(disparity(150,100).child(), loaded(150,100).child(), 0.13);
+  EXPECT_EQ(8, DiskImageResourceDisparity(filename, disparity.format()).precision_bits());
+}
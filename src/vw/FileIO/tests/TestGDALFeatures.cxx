@@ -20,6 +20,8 @@
 #include <vw/Image/ImageIO.h>
 #include <vw/Image/ImageView.h>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
+#include <vw/FileIO/DiskImageView.h>
+#include <vw/Core/Thread.h>
 #include <test/Helpers.h>
 #include <vw/config.h>
 
@@ -29,6 +31,7 @@ using namespace vw::test;
 #if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
 
 #include <vw/FileIO/DiskImageResourceGDAL.h>
+#include <gdal_priv.h>
 
 
 TEST( GDALFeatures, NoDataValue ) {
@@ -55,4 +58,72 @@ TEST( GDALFeatures, NoDataValue ) {
   EXPECT_EQ( -1, r_rsrc.nodata_read() );
 }
 
+TEST( GDALFeatures, Overviews ) {
+  UnlinkName overview("overview.tif");
+
+  // A linear gradient, so that an averaged overview pixel equals the
+  // full resolution value at the center of its block.
+  ImageView<float> image(64,48);
+  for ( int32 j = 0; j < image.rows(); ++j )
+    for ( int32 i = 0; i < image.cols(); ++i )
+      image(i,j) = float(i + 100*j);
+
+  {
+    DiskImageResourceGDAL w_rsrc( overview, image.format() );
+    write_image( w_rsrc, image );
+  }
+  {
+    DiskImageResourceGDAL rsrc( overview );
+    EXPECT_EQ( 0, rsrc.num_overviews() );
+    Mutex::Lock lock( DiskImageResourceGDAL::global_lock() );
+    int factors[] = { 2, 4 };
+    GDALDataset* dataset = (GDALDataset*)GDALOpen( overview.c_str(), GA_Update );
+    ASSERT_TRUE( dataset != NULL );
+    EXPECT_EQ( CE_None, dataset->BuildOverviews( "AVERAGE", 2, factors, 0, NULL, NULL, NULL ) );
+    GDALClose( dataset );
+  }
+
+  DiskImageView<float> view( overview );
+  ASSERT_EQ( 2, view.num_overviews() );
+  EXPECT_VECTOR_EQ( Vector2i(32,24), view.resource()->overview_size(0) );
+  EXPECT_VECTOR_EQ( Vector2i(16,12), view.resource()->overview_size(1) );
+  DiskImageView<float> coarse = view.overview(1);
+  EXPECT_EQ( 16, coarse.cols() );
+  EXPECT_EQ( 12, coarse.rows() );
+
+  // Subsampling picks the 4x overview and subsamples it by 2.  Each
+  // pixel is the average of the 4x4 block, which is centered 1.5
+  // pixels past the pixel picked at full resolution.
+  SubsampleView<DiskImageView<float> > sub = subsample( view, 8 );
+  EXPECT_EQ( 16, sub.child().cols() );
+  ImageView<float> from_overview = sub;
+  ImageView<float> from_memory   = subsample( image, 8 );
+  ASSERT_EQ( from_memory.cols(), from_overview.cols() );
+  ASSERT_EQ( from_memory.rows(), from_overview.rows() );
+  for ( int32 j = 0; j < from_memory.rows(); ++j )
+    for ( int32 i = 0; i < from_memory.cols(); ++i )
+      EXPECT_NEAR( from_memory(i,j) + 1.5*(1 + 100), from_overview(i,j), 1e-2 );
+
+  // A factor the overviews do not divide falls back to full resolution
+  EXPECT_EQ( 64, subsample( view, 3 ).child().cols() );
+
+  // Resampling keeps the full resolution output size and, away from
+  // the edges, matches resampling the full resolution image.
+  ImageView<float> resampled = resample( view, 0.25 );
+  ImageView<float> expected  = resample( image, 0.25 );
+  EXPECT_EQ( 16, resampled.cols() );
+  EXPECT_EQ( 12, resampled.rows() );
+  for ( int32 j = 1; j < expected.rows(); ++j )
+    for ( int32 i = 1; i < expected.cols(); ++i )
+      EXPECT_NEAR( expected(i,j), resampled(i,j), 1e-2 );
+
+  // All the resample overloads read from the overview
+  EXPECT_EQ( 16, resample( view, 0.25, 0.25, ConstantEdgeExtension() ).child().child().child().cols() );
+  EXPECT_EQ( 16, resample( view, 0.25, ConstantEdgeExtension() ).child().child().child().cols() );
+  EXPECT_EQ( 16, resample( view, 0.25, ConstantEdgeExtension(), BilinearInterpolation() ).child().child().child().cols() );
+  EXPECT_EQ( 16, resample( view, 0.25, 16, 12, ConstantEdgeExtension(), BilinearInterpolation() ).child().child().child().cols() );
+  ImageView<float> resampled_edge = resample( view, 0.25, 0.25, ZeroEdgeExtension() );
+  EXPECT_NEAR( expected(8,4), resampled_edge(8,4), 1e-2 );
+}
+
 #endif
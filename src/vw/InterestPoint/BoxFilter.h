@@ -25,6 +25,7 @@
 #ifndef __VW_INTERESTPOINT_BOX_FILTER_H__
 #define __VW_INTERESTPOINT_BOX_FILTER_H__
 
+#include <algorithm>
 #include <vector>
 
 #include <vw/Image/ImageView.h>
@@ -67,6 +68,128 @@ namespace ip {
     return result;
   }
 
+  // Evaluating a Box Filter across rows
+  // _____________________________________________________________
+
+  /// Evaluate a box filter at the integral image positions x_begin to
+  ///  x_end-1 of row y, the positions apply_box_filter_at_point() is given.
+  /// - Each box is summed across the whole span from two rows of the
+  ///   integral image, in loops over contiguous memory that the compiler
+  ///   vectorizes, rather than one pixel at a time.
+  /// - Every box must fall inside the integral image over the span.
+  template <class PixelT, class OutT>
+  void box_filter_row( ImageView<PixelT> const& integral, BoxFilter const& box,
+                       int32 y, int32 x_begin, int32 x_end, OutT* out ) {
+    const int32 count = x_end - x_begin;
+    std::fill( out, out + count, OutT(0) );
+    for ( size_t b = 0; b < box.size(); b++ ) {
+      VW_DEBUG_ASSERT( x_begin + box[b].start[0] >= 0 && y + box[b].start[1] >= 0 &&
+                       x_end + box[b].start[0] + box[b].size[0] <= integral.cols() &&
+                       y + box[b].start[1] + box[b].size[1] < integral.rows(),
+                       vw::ArgumentErr() << "box_filter_row: box " << b << " leaves the integral image.\n" );
+      const int32 width = box[b].size[0];
+      const float weight = box[b].weight;
+      PixelT const* top    = &integral( x_begin + box[b].start[0], y + box[b].start[1] );
+      PixelT const* bottom = top + ptrdiff_t(box[b].size[1]) * integral.cols();
+      for ( int32 i = 0; i < count; i++ ) {
+        PixelT box_sum = top[i] - top[i+width] - bottom[i] + bottom[i+width];
+        out[i] += weight * box_sum;
+      }
+    }
+  }
+
+  /// Rasterize box_filter( integral, box ) a row at a time with box_filter_row().
+  template <class PixelT>
+  ImageView<PixelT> apply_box_filter( ImageView<PixelT> const& integral, BoxFilter const& box ) {
+    ImageView<PixelT> result( integral.cols()-1, integral.rows()-1 );
+    fill( result, PixelT() );
+
+    // The positions BoxFilterView evaluates, limited to where every box fits.
+    int32 buffer = 0;
+    for ( size_t b = 0; b < box.size(); b++ )
+      buffer = std::max( buffer, std::max( box[b].size[0], box[b].size[1] ) >> 1 );
+    int32 x_begin = buffer, x_end = integral.cols() - buffer - 1;
+    int32 y_begin = buffer, y_end = integral.rows() - buffer - 1;
+    for ( size_t b = 0; b < box.size(); b++ ) {
+      x_begin = std::max( x_begin, -box[b].start[0] );
+      y_begin = std::max( y_begin, -box[b].start[1] );
+      x_end   = std::min( x_end, integral.cols() - box[b].start[0] - box[b].size[0] );
+      y_end   = std::min( y_end, integral.rows() - box[b].start[1] - box[b].size[1] );
+    }
+    if ( x_begin >= x_end )
+      return result;
+    for ( int32 y = y_begin; y < y_end; y++ )
+      box_filter_row( integral, box, y, x_begin, x_end, &result( x_begin, y ) );
+    return result;
+  }
+
+  /// Any other integral image view is rasterized through BoxFilterView.
+  template <class ImageT>
+  ImageView<typename ImageT::pixel_type>
+  apply_box_filter( ImageViewBase<ImageT> const& integral, BoxFilter const& box );
+
+  // Box Filters for the functions in IntegralImage.h
+  // _____________________________________________________________
+
+  /// The box filter evaluating XSecondDerivative( integral, x, y, filter_size ).
+  inline BoxFilter x_second_derivative_filter( unsigned filter_size ) {
+    const int lobe = filter_size / 3, half_lobe = lobe / 2;
+    const float norm = 1.0f / float(filter_size*filter_size);
+    BoxFilter filter(3);
+    filter[0].start = Vector2i( -lobe-half_lobe, -lobe+1 ); filter[0].size = Vector2i( lobe, 2*lobe-1 );
+    filter[1].start = Vector2i( -half_lobe,      -lobe+1 ); filter[1].size = Vector2i( 2*half_lobe+1, 2*lobe-1 );
+    filter[2].start = Vector2i( half_lobe+1,     -lobe+1 ); filter[2].size = Vector2i( lobe, 2*lobe-1 );
+    filter[0].weight = norm; filter[1].weight = -2*norm; filter[2].weight = norm;
+    return filter;
+  }
+
+  /// The box filter evaluating YSecondDerivative( integral, x, y, filter_size ).
+  inline BoxFilter y_second_derivative_filter( unsigned filter_size ) {
+    BoxFilter filter = x_second_derivative_filter( filter_size );
+    for ( size_t b = 0; b < filter.size(); b++ ) {
+      std::swap( filter[b].start[0], filter[b].start[1] );
+      std::swap( filter[b].size[0],  filter[b].size[1]  );
+    }
+    return filter;
+  }
+
+  /// The box filter evaluating XYDerivative( integral, x, y, filter_size ).
+  inline BoxFilter xy_derivative_filter( unsigned filter_size ) {
+    const int lobe = filter_size / 3;
+    const float norm = 1.0f / float(filter_size*filter_size);
+    BoxFilter filter(4);
+    filter[0].start = Vector2i( -lobe, -lobe ); filter[0].weight =  norm;
+    filter[1].start = Vector2i(     1, -lobe ); filter[1].weight = -norm;
+    filter[2].start = Vector2i( -lobe,     1 ); filter[2].weight = -norm;
+    filter[3].start = Vector2i(     1,     1 ); filter[3].weight =  norm;
+    for ( size_t b = 0; b < filter.size(); b++ )
+      filter[b].size = Vector2i( lobe, lobe );
+    return filter;
+  }
+
+  /// The box filter evaluating HHaarWavelet( integral, x, y, size ) at
+  ///  integer positions where the wavelet lies inside the integral image.
+  inline BoxFilter h_haar_wavelet_filter( float size ) {
+    const int half_size = int(round( size / 2.0 ));
+    const int offset    = int(floor( 0.5 - size/2 ));
+    BoxFilter filter(2);
+    filter[0].start = Vector2i( offset,           offset ); filter[0].weight = -1;
+    filter[1].start = Vector2i( offset+half_size, offset ); filter[1].weight =  1;
+    filter[0].size = filter[1].size = Vector2i( half_size, 2*half_size );
+    return filter;
+  }
+
+  /// The box filter evaluating VHaarWavelet( integral, x, y, size ) at
+  ///  integer positions where the wavelet lies inside the integral image.
+  inline BoxFilter v_haar_wavelet_filter( float size ) {
+    BoxFilter filter = h_haar_wavelet_filter( size );
+    for ( size_t b = 0; b < filter.size(); b++ ) {
+      std::swap( filter[b].start[0], filter[b].start[1] );
+      std::swap( filter[b].size[0],  filter[b].size[1]  );
+    }
+    return filter;
+  }
+
   // BoxFilterView
   // _____________________________________________________________
   template <class IntegralT>
@@ -131,6 +254,12 @@ namespace ip {
     return BoxFilterView<ImageT>( integral.impl(), box );
   }
 
+  template <class ImageT>
+  ImageView<typename ImageT::pixel_type>
+  apply_box_filter( ImageViewBase<ImageT> const& integral, BoxFilter const& box ) {
+    return box_filter( integral, box );
+  }
+
 }}
 
 #endif//__VW_INTERESTPOINT_BOX_FILTER_H__
@@ -0,0 +1,522 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file BruteForceMatcher.cc
+///
+/// Blocked exhaustive k nearest neighbor search.
+///
+/// The reference descriptors are packed element major in blocks of
+/// REF_BLOCK references, so a kernel can compare a group of queries with many
+/// references using whole vector loads.  Each task takes a tile of queries and
+/// runs it over every block; a block is small enough to stay in cache while
+/// all the queries of the tile visit it.
+///
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/RunOnce.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/InterestPoint/BruteForceMatcher.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+// The SIMD kernels are built with target attributes and are only selected
+//  if the CPU running the code supports them.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (__GNUC__ >= 8))
+  #define VW_BRUTE_FORCE_SIMD_KERNELS 1
+  #include <immintrin.h>
+#endif
+
+namespace vw {
+namespace ip {
+
+namespace {
+
+  const size_t REF_BLOCK   = 256; ///< References packed together
+  const size_t QUERY_GROUP = 4;   ///< Queries compared by one kernel call
+  const size_t QUERY_TILE  = 256; ///< Queries handled by one task
+
+  /// Squared distances from a group of queries to every reference of a block.
+  /// - Writes QUERY_GROUP rows of REF_BLOCK dot products with the references.
+  typedef void (*L2Kernel)( float const* const* query, float const* block, size_t length,
+                            float* dots );
+  /// Bit differences from a group of queries to every reference of a block.
+  /// - query holds QUERY_GROUP rows of words, each row words long.
+  typedef void (*HammingKernel)( uint64 const* query, uint64 const* block, size_t words,
+                                 uint32* counts );
+
+  void l2_dots_scalar( float const* const* query, float const* block, size_t length,
+                       float* dots ) {
+    std::fill( dots, dots + QUERY_GROUP*REF_BLOCK, 0.0f );
+    for ( size_t d = 0; d < length; ++d ) {
+      float const* ref = block + d*REF_BLOCK;
+      for ( size_t g = 0; g < QUERY_GROUP; ++g ) {
+        const float value = query[g][d];
+        float* out = dots + g*REF_BLOCK;
+        for ( size_t r = 0; r < REF_BLOCK; ++r )
+          out[r] += value * ref[r];
+      }
+    }
+  }
+
+  inline uint32 popcount64( uint64 value ) {
+#if defined(__GNUC__)
+    return __builtin_popcountll( value );
+#else
+    uint32 count = 0;
+    for ( ; value; value &= value - 1 )
+      ++count;
+    return count;
+#endif
+  }
+
+  inline void hamming_counts_generic( uint64 const* query, uint64 const* block, size_t words,
+                                      uint32* counts ) {
+    std::fill( counts, counts + QUERY_GROUP*REF_BLOCK, 0u );
+    for ( size_t w = 0; w < words; ++w ) {
+      uint64 const* ref = block + w*REF_BLOCK;
+      for ( size_t g = 0; g < QUERY_GROUP; ++g ) {
+        const uint64 value = query[g*words + w];
+        uint32* out = counts + g*REF_BLOCK;
+        for ( size_t r = 0; r < REF_BLOCK; ++r )
+          out[r] += popcount64( value ^ ref[r] );
+      }
+    }
+  }
+
+  void hamming_counts_scalar( uint64 const* query, uint64 const* block, size_t words,
+                              uint32* counts ) {
+    hamming_counts_generic( query, block, words, counts );
+  }
+
+#if defined(VW_BRUTE_FORCE_SIMD_KERNELS)
+
+  // Register blocked: QUERY_GROUP queries by 16 references, 8 accumulators.
+  __attribute__((target("avx2,fma")))
+  void l2_dots_avx2( float const* const* query, float const* block, size_t length,
+                     float* dots ) {
+    for ( size_t r = 0; r < REF_BLOCK; r += 16 ) {
+      __m256 a00 = _mm256_setzero_ps(), a01 = _mm256_setzero_ps();
+      __m256 a10 = _mm256_setzero_ps(), a11 = _mm256_setzero_ps();
+      __m256 a20 = _mm256_setzero_ps(), a21 = _mm256_setzero_ps();
+      __m256 a30 = _mm256_setzero_ps(), a31 = _mm256_setzero_ps();
+      for ( size_t d = 0; d < length; ++d ) {
+        float const* ref = block + d*REF_BLOCK + r;
+        const __m256 b0 = _mm256_loadu_ps( ref     );
+        const __m256 b1 = _mm256_loadu_ps( ref + 8 );
+        __m256 q = _mm256_broadcast_ss( query[0] + d );
+        a00 = _mm256_fmadd_ps( q, b0, a00 );  a01 = _mm256_fmadd_ps( q, b1, a01 );
+        q = _mm256_broadcast_ss( query[1] + d );
+        a10 = _mm256_fmadd_ps( q, b0, a10 );  a11 = _mm256_fmadd_ps( q, b1, a11 );
+        q = _mm256_broadcast_ss( query[2] + d );
+        a20 = _mm256_fmadd_ps( q, b0, a20 );  a21 = _mm256_fmadd_ps( q, b1, a21 );
+        q = _mm256_broadcast_ss( query[3] + d );
+        a30 = _mm256_fmadd_ps( q, b0, a30 );  a31 = _mm256_fmadd_ps( q, b1, a31 );
+      }
+      _mm256_storeu_ps( dots + 0*REF_BLOCK + r, a00 );  _mm256_storeu_ps( dots + 0*REF_BLOCK + r + 8, a01 );
+      _mm256_storeu_ps( dots + 1*REF_BLOCK + r, a10 );  _mm256_storeu_ps( dots + 1*REF_BLOCK + r + 8, a11 );
+      _mm256_storeu_ps( dots + 2*REF_BLOCK + r, a20 );  _mm256_storeu_ps( dots + 2*REF_BLOCK + r + 8, a21 );
+      _mm256_storeu_ps( dots + 3*REF_BLOCK + r, a30 );  _mm256_storeu_ps( dots + 3*REF_BLOCK + r + 8, a31 );
+    }
+    _mm256_zeroupper();
+  }
+
+  // The same with 32 references per step.
+  __attribute__((target("avx512f")))
+  void l2_dots_avx512( float const* const* query, float const* block, size_t length,
+                       float* dots ) {
+    for ( size_t r = 0; r < REF_BLOCK; r += 32 ) {
+      __m512 a00 = _mm512_setzero_ps(), a01 = _mm512_setzero_ps();
+      __m512 a10 = _mm512_setzero_ps(), a11 = _mm512_setzero_ps();
+      __m512 a20 = _mm512_setzero_ps(), a21 = _mm512_setzero_ps();
+      __m512 a30 = _mm512_setzero_ps(), a31 = _mm512_setzero_ps();
+      for ( size_t d = 0; d < length; ++d ) {
+        float const* ref = block + d*REF_BLOCK + r;
+        const __m512 b0 = _mm512_loadu_ps( ref      );
+        const __m512 b1 = _mm512_loadu_ps( ref + 16 );
+        __m512 q = _mm512_set1_ps( query[0][d] );
+        a00 = _mm512_fmadd_ps( q, b0, a00 );  a01 = _mm512_fmadd_ps( q, b1, a01 );
+        q = _mm512_set1_ps( query[1][d] );
+        a10 = _mm512_fmadd_ps( q, b0, a10 );  a11 = _mm512_fmadd_ps( q, b1, a11 );
+        q = _mm512_set1_ps( query[2][d] );
+        a20 = _mm512_fmadd_ps( q, b0, a20 );  a21 = _mm512_fmadd_ps( q, b1, a21 );
+        q = _mm512_set1_ps( query[3][d] );
+        a30 = _mm512_fmadd_ps( q, b0, a30 );  a31 = _mm512_fmadd_ps( q, b1, a31 );
+      }
+      _mm512_storeu_ps( dots + 0*REF_BLOCK + r, a00 );  _mm512_storeu_ps( dots + 0*REF_BLOCK + r + 16, a01 );
+      _mm512_storeu_ps( dots + 1*REF_BLOCK + r, a10 );  _mm512_storeu_ps( dots + 1*REF_BLOCK + r + 16, a11 );
+      _mm512_storeu_ps( dots + 2*REF_BLOCK + r, a20 );  _mm512_storeu_ps( dots + 2*REF_BLOCK + r + 16, a21 );
+      _mm512_storeu_ps( dots + 3*REF_BLOCK + r, a30 );  _mm512_storeu_ps( dots + 3*REF_BLOCK + r + 16, a31 );
+    }
+    _mm256_zeroupper();
+  }
+
+  __attribute__((target("popcnt")))
+  void hamming_counts_popcnt( uint64 const* query, uint64 const* block, size_t words,
+                              uint32* counts ) {
+    hamming_counts_generic( query, block, words, counts );
+  }
+
+  // QUERY_GROUP queries by 16 references, with one popcount per 64 bit lane.
+  __attribute__((target("avx512f,avx512vpopcntdq")))
+  void hamming_counts_avx512( uint64 const* query, uint64 const* block, size_t words,
+                              uint32* counts ) {
+    for ( size_t r = 0; r < REF_BLOCK; r += 16 ) {
+      __m512i a00 = _mm512_setzero_si512(), a01 = _mm512_setzero_si512();
+      __m512i a10 = _mm512_setzero_si512(), a11 = _mm512_setzero_si512();
+      __m512i a20 = _mm512_setzero_si512(), a21 = _mm512_setzero_si512();
+      __m512i a30 = _mm512_setzero_si512(), a31 = _mm512_setzero_si512();
+      for ( size_t w = 0; w < words; ++w ) {
+        uint64 const* ref = block + w*REF_BLOCK + r;
+        const __m512i b0 = _mm512_loadu_si512( ref     );
+        const __m512i b1 = _mm512_loadu_si512( ref + 8 );
+        __m512i q = _mm512_set1_epi64( (long long)query[0*words + w] );
+        a00 = _mm512_add_epi64( a00, _mm512_popcnt_epi64( _mm512_xor_si512( q, b0 ) ) );
+        a01 = _mm512_add_epi64( a01, _mm512_popcnt_epi64( _mm512_xor_si512( q, b1 ) ) );
+        q = _mm512_set1_epi64( (long long)query[1*words + w] );
+        a10 = _mm512_add_epi64( a10, _mm512_popcnt_epi64( _mm512_xor_si512( q, b0 ) ) );
+        a11 = _mm512_add_epi64( a11, _mm512_popcnt_epi64( _mm512_xor_si512( q, b1 ) ) );
+        q = _mm512_set1_epi64( (long long)query[2*words + w] );
+        a20 = _mm512_add_epi64( a20, _mm512_popcnt_epi64( _mm512_xor_si512( q, b0 ) ) );
+        a21 = _mm512_add_epi64( a21, _mm512_popcnt_epi64( _mm512_xor_si512( q, b1 ) ) );
+        q = _mm512_set1_epi64( (long long)query[3*words + w] );
+        a30 = _mm512_add_epi64( a30, _mm512_popcnt_epi64( _mm512_xor_si512( q, b0 ) ) );
+        a31 = _mm512_add_epi64( a31, _mm512_popcnt_epi64( _mm512_xor_si512( q, b1 ) ) );
+      }
+      _mm256_storeu_si256( (__m256i*)(counts + 0*REF_BLOCK + r    ), _mm512_cvtepi64_epi32( a00 ) );
+      _mm256_storeu_si256( (__m256i*)(counts + 0*REF_BLOCK + r + 8), _mm512_cvtepi64_epi32( a01 ) );
+      _mm256_storeu_si256( (__m256i*)(counts + 1*REF_BLOCK + r    ), _mm512_cvtepi64_epi32( a10 ) );
+      _mm256_storeu_si256( (__m256i*)(counts + 1*REF_BLOCK + r + 8), _mm512_cvtepi64_epi32( a11 ) );
+      _mm256_storeu_si256( (__m256i*)(counts + 2*REF_BLOCK + r    ), _mm512_cvtepi64_epi32( a20 ) );
+      _mm256_storeu_si256( (__m256i*)(counts + 2*REF_BLOCK + r + 8), _mm512_cvtepi64_epi32( a21 ) );
+      _mm256_storeu_si256( (__m256i*)(counts + 3*REF_BLOCK + r    ), _mm512_cvtepi64_epi32( a30 ) );
+      _mm256_storeu_si256( (__m256i*)(counts + 3*REF_BLOCK + r + 8), _mm512_cvtepi64_epi32( a31 ) );
+    }
+    _mm256_zeroupper();
+  }
+
+#endif // VW_BRUTE_FORCE_SIMD_KERNELS
+
+  L2Kernel      l2_kernel      = l2_dots_scalar;
+  HammingKernel hamming_kernel = hamming_counts_scalar;
+  vw::RunOnce   brute_force_kernel_once = VW_RUNONCE_INIT;
+
+  /// Pick the fastest kernels that the current CPU supports.
+  void select_brute_force_kernels() {
+    std::string l2_name = "scalar", hamming_name = "scalar";
+#if defined(VW_BRUTE_FORCE_SIMD_KERNELS)
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ) {
+      l2_kernel = l2_dots_avx2;
+      l2_name   = "AVX2";
+    }
+    if ( __builtin_cpu_supports("avx512f") ) {
+      l2_kernel = l2_dots_avx512;
+      l2_name   = "AVX-512";
+    }
+    if ( __builtin_cpu_supports("popcnt") ) {
+      hamming_kernel = hamming_counts_popcnt;
+      hamming_name   = "POPCNT";
+    }
+    if ( __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq") ) {
+      hamming_kernel = hamming_counts_avx512;
+      hamming_name   = "AVX-512";
+    }
+#endif
+    vw_out(DebugMessage, "interest_point") << "Brute force matching: Using " << l2_name
+                                           << " L2 and " << hamming_name << " Hamming kernels.\n";
+  }
+
+  /// Insert a candidate into a sorted list of the knn nearest references.
+  /// - Equal distances keep the earlier candidate first.
+  inline void insert_neighbor( int32* indices, float* distances, size_t knn,
+                               int32 index, float distance ) {
+    if ( !(distance < distances[knn-1]) )
+      return;
+    size_t j = knn-1;
+    for ( ; j > 0 && distance < distances[j-1]; --j ) {
+      distances[j] = distances[j-1];
+      indices  [j] = indices  [j-1];
+    }
+    distances[j] = distance;
+    indices  [j] = index;
+  }
+
+  void clear_neighbors( int32* indices, float* distances, size_t count ) {
+    std::fill( indices,   indices   + count, int32(-1) );
+    std::fill( distances, distances + count, std::numeric_limits<float>::max() );
+  }
+
+  /// Copy rows of length elements into element major blocks of REF_BLOCK
+  ///  rows, padding to words elements per row and to whole blocks with zeros.
+  template <class InT, class OutT>
+  void pack_reference( InT const* data, size_t rows, size_t length, size_t words,
+                       std::vector<OutT> & packed ) {
+    const size_t num_blocks = (rows + REF_BLOCK - 1) / REF_BLOCK;
+    packed.assign( num_blocks * words * REF_BLOCK, OutT(0) );
+    for ( size_t i = 0; i < rows; ++i ) {
+      OutT* out = &packed[(i / REF_BLOCK) * words * REF_BLOCK + (i % REF_BLOCK)];
+      for ( size_t d = 0; d < length; ++d )
+        out[d*REF_BLOCK] = data[i*length + d];
+    }
+  }
+
+  /// Packs binary descriptors of length bytes into zero padded 64 bit words.
+  void pack_binary_row( uint8 const* row, size_t length, uint64* words ) {
+    const size_t num_words = (length + 7) / 8;
+    std::fill( words, words + num_words, uint64(0) );
+    std::memcpy( words, row, length );
+  }
+
+  /// Runs one tile of L2 queries over all reference blocks.
+  class L2TileTask : public Task, private boost::noncopyable {
+    float const* m_query;
+    size_t m_query_begin, m_query_end;
+    float const* m_reference;
+    size_t m_num_reference, m_length, m_knn;
+    std::vector<float> const& m_packed;
+    std::vector<float> const& m_reference_norms;
+    int32* m_indices;
+    float* m_distances;
+    SubProgressCallback m_progress;
+
+  public:
+    L2TileTask( float const* query, size_t query_begin, size_t query_end,
+                float const* reference, size_t num_reference, size_t length, size_t knn,
+                std::vector<float> const& packed, std::vector<float> const& reference_norms,
+                int32* indices, float* distances,
+                ProgressCallback const& progress, double progress_step ) :
+      m_query(query), m_query_begin(query_begin), m_query_end(query_end),
+      m_reference(reference), m_num_reference(num_reference), m_length(length), m_knn(knn),
+      m_packed(packed), m_reference_norms(reference_norms),
+      m_indices(indices), m_distances(distances), m_progress(progress, 0.0, progress_step) {}
+
+    void operator()() {
+      // Tiles which have not started when an abort is requested are skipped.
+      if ( m_progress.abort_requested() )
+        return;
+      std::vector<float> dots( QUERY_GROUP*REF_BLOCK );
+      const size_t num_blocks = (m_num_reference + REF_BLOCK - 1) / REF_BLOCK;
+
+      for ( size_t q0 = m_query_begin; q0 < m_query_end; q0 += QUERY_GROUP ) {
+        // A short last group repeats its last query, the copies are ignored.
+        const size_t group = std::min( QUERY_GROUP, m_query_end - q0 );
+        float const* rows[QUERY_GROUP];
+        float norms[QUERY_GROUP];
+        for ( size_t g = 0; g < QUERY_GROUP; ++g ) {
+          rows[g] = m_query + (q0 + std::min(g, group-1)) * m_length;
+          norms[g] = 0;
+          for ( size_t d = 0; d < m_length; ++d )
+            norms[g] += rows[g][d] * rows[g][d];
+        }
+        clear_neighbors( m_indices + q0*m_knn, m_distances + q0*m_knn, group*m_knn );
+
+        for ( size_t b = 0; b < num_blocks; ++b ) {
+          l2_kernel( rows, &m_packed[b * m_length * REF_BLOCK], m_length, &dots[0] );
+          const size_t first = b * REF_BLOCK;
+          const size_t count = std::min( REF_BLOCK, m_num_reference - first );
+          for ( size_t g = 0; g < group; ++g ) {
+            int32* indices   = m_indices   + (q0+g)*m_knn;
+            float* distances = m_distances + (q0+g)*m_knn;
+            float const* row_dots = &dots[g*REF_BLOCK];
+            for ( size_t r = 0; r < count; ++r ) {
+              const float distance = norms[g] + m_reference_norms[first+r] - 2*row_dots[r];
+              insert_neighbor( indices, distances, m_knn, int32(first+r),
+                               std::max( distance, 0.0f ) );
+            }
+          }
+        }
+
+        // The expanded form loses precision for close pairs, so recompute
+        //  the distances of the neighbors that were found.
+        for ( size_t g = 0; g < group; ++g ) {
+          int32* indices   = m_indices   + (q0+g)*m_knn;
+          float* distances = m_distances + (q0+g)*m_knn;
+          std::vector<std::pair<float,int32> > found;
+          for ( size_t k = 0; k < m_knn && indices[k] >= 0; ++k ) {
+            float const* ref = m_reference + size_t(indices[k]) * m_length;
+            float sum = 0;
+            for ( size_t d = 0; d < m_length; ++d ) {
+              const float diff = rows[g][d] - ref[d];
+              sum += diff * diff;
+            }
+            found.push_back( std::make_pair( sum, indices[k] ) );
+          }
+          std::sort( found.begin(), found.end() );
+          for ( size_t k = 0; k < found.size(); ++k ) {
+            distances[k] = found[k].first;
+            indices  [k] = found[k].second;
+          }
+        }
+      }
+      m_progress.report_incremental_progress( 1.0 );
+    }
+  }; // End class L2TileTask
+
+  /// Runs one tile of Hamming queries over all reference blocks.
+  class HammingTileTask : public Task, private boost::noncopyable {
+    uint8 const* m_query;
+    size_t m_query_begin, m_query_end;
+    size_t m_num_reference, m_length, m_knn;
+    std::vector<uint64> const& m_packed;
+    int32* m_indices;
+    float* m_distances;
+    SubProgressCallback m_progress;
+
+  public:
+    HammingTileTask( uint8 const* query, size_t query_begin, size_t query_end,
+                     size_t num_reference, size_t length, size_t knn,
+                     std::vector<uint64> const& packed, int32* indices, float* distances,
+                     ProgressCallback const& progress, double progress_step ) :
+      m_query(query), m_query_begin(query_begin), m_query_end(query_end),
+      m_num_reference(num_reference), m_length(length), m_knn(knn),
+      m_packed(packed), m_indices(indices), m_distances(distances),
+      m_progress(progress, 0.0, progress_step) {}
+
+    void operator()() {
+      if ( m_progress.abort_requested() )
+        return;
+      const size_t words = (m_length + 7) / 8;
+      std::vector<uint32> counts( QUERY_GROUP*REF_BLOCK );
+      std::vector<uint64> rows( QUERY_GROUP*words );
+      const size_t num_blocks = (m_num_reference + REF_BLOCK - 1) / REF_BLOCK;
+
+      for ( size_t q0 = m_query_begin; q0 < m_query_end; q0 += QUERY_GROUP ) {
+        const size_t group = std::min( QUERY_GROUP, m_query_end - q0 );
+        for ( size_t g = 0; g < QUERY_GROUP; ++g )
+          pack_binary_row( m_query + (q0 + std::min(g, group-1)) * m_length, m_length,
+                           &rows[g*words] );
+        clear_neighbors( m_indices + q0*m_knn, m_distances + q0*m_knn, group*m_knn );
+
+        for ( size_t b = 0; b < num_blocks; ++b ) {
+          hamming_kernel( &rows[0], &m_packed[b * words * REF_BLOCK], words, &counts[0] );
+          const size_t first = b * REF_BLOCK;
+          const size_t count = std::min( REF_BLOCK, m_num_reference - first );
+          for ( size_t g = 0; g < group; ++g ) {
+            int32* indices   = m_indices   + (q0+g)*m_knn;
+            float* distances = m_distances + (q0+g)*m_knn;
+            uint32 const* row_counts = &counts[g*REF_BLOCK];
+            for ( size_t r = 0; r < count; ++r )
+              insert_neighbor( indices, distances, m_knn, int32(first+r), float(row_counts[r]) );
+          }
+        }
+      }
+      m_progress.report_incremental_progress( 1.0 );
+    }
+  }; // End class HammingTileTask
+
+  /// Fraction of the progress that one query tile accounts for.
+  double tile_progress_step( size_t num_query ) {
+    const size_t num_tiles = (num_query + QUERY_TILE - 1) / QUERY_TILE;
+    return num_tiles ? 1.0 / double(num_tiles) : 1.0;
+  }
+
+  /// Throws if the search was aborted, as some tiles were then skipped.
+  void check_aborted( ProgressCallback const& progress ) {
+    if ( progress.abort_requested() )
+      vw_throw( Aborted() << "Aborted by ProgressCallback" );
+  }
+
+  void check_knn_arguments( size_t num_reference, size_t knn ) {
+    if ( knn == 0 )
+      vw_throw( ArgumentErr() << "Brute force matching: knn must be at least one.\n" );
+    if ( num_reference >= size_t(std::numeric_limits<int32>::max()) )
+      vw_throw( ArgumentErr() << "Brute force matching: Too many reference descriptors.\n" );
+  }
+
+} // end anonymous namespace
+
+  void brute_force_knn_l2( float const* query, size_t num_query,
+                           float const* reference, size_t num_reference,
+                           size_t length, size_t knn,
+                           int32* indices, float* distances,
+                           ProgressCallback const& progress ) {
+    check_knn_arguments( num_reference, knn );
+    brute_force_kernel_once.run( select_brute_force_kernels );
+
+    std::vector<float> packed, reference_norms( num_reference );
+    pack_reference( reference, num_reference, length, length, packed );
+    for ( size_t i = 0; i < num_reference; ++i ) {
+      float sum = 0;
+      for ( size_t d = 0; d < length; ++d )
+        sum += reference[i*length + d] * reference[i*length + d];
+      reference_norms[i] = sum;
+    }
+
+    FifoWorkQueue queue;
+    for ( size_t q = 0; q < num_query; q += QUERY_TILE ) {
+      boost::shared_ptr<L2TileTask> task(
+        new L2TileTask( query, q, std::min( q + QUERY_TILE, num_query ), reference, num_reference,
+                        length, knn, packed, reference_norms, indices, distances,
+                        progress, tile_progress_step( num_query ) ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+    check_aborted( progress );
+  }
+
+  void brute_force_knn_hamming( uint8 const* query, size_t num_query,
+                                uint8 const* reference, size_t num_reference,
+                                size_t length, size_t knn,
+                                int32* indices, float* distances,
+                                ProgressCallback const& progress ) {
+    check_knn_arguments( num_reference, knn );
+    brute_force_kernel_once.run( select_brute_force_kernels );
+
+    // Pack whole 64 bit words, in the byte order of the query words.
+    const size_t words = (length + 7) / 8;
+    std::vector<uint64> reference_words( num_reference * words );
+    for ( size_t i = 0; i < num_reference; ++i )
+      pack_binary_row( reference + i*length, length, &reference_words[i*words] );
+    std::vector<uint64> packed;
+    pack_reference( reference_words.empty() ? (uint64 const*)0 : &reference_words[0],
+                    num_reference, words, words, packed );
+
+    FifoWorkQueue queue;
+    for ( size_t q = 0; q < num_query; q += QUERY_TILE ) {
+      boost::shared_ptr<HammingTileTask> task(
+        new HammingTileTask( query, q, std::min( q + QUERY_TILE, num_query ), num_reference,
+                             length, knn, packed, indices, distances,
+                             progress, tile_progress_step( num_query ) ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+    check_aborted( progress );
+  }
+
+  bool prefer_brute_force_knn( bool hamming, size_t num_query, size_t num_reference,
+                               size_t length ) {
+    // Rough costs in descriptor elements.  FLANN builds four trees and then
+    //  checks a fixed number of leaves per query, while a kernel step covers
+    //  eight floats or 64 bytes.  Binary FLANN trees are also approximate,
+    //  so those searches are allowed to cost more.
+    const double nq = double(num_query), nr = double(num_reference);
+    const double len = double(std::max<size_t>(length, 1));
+    const double flann_cost = (4.0 * nr * std::log(nr + 1) / std::log(2.0) + 256.0 * nq) * len;
+    const double brute_cost = nq * nr * len / (hamming ? 64.0 : 8.0);
+    return brute_cost <= (hamming ? 4.0 : 1.0) * flann_cost;
+  }
+
+}} // namespace vw::ip
@@ -0,0 +1,84 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file BruteForceMatcher.h
+///
+/// Exact k nearest neighbor search between two sets of descriptors by
+/// comparing every pair.
+///
+/// For binary descriptors and for moderate numbers of points this is both
+/// faster and more accurate than searching an approximate FLANN tree.  The
+/// reference descriptors are packed into blocks which stay in cache while a
+/// tile of queries is compared against them, with SIMD kernels picked for the
+/// CPU at run time, and the query tiles are spread over the thread pool.
+///
+#ifndef __VW_INTERESTPOINT_BRUTE_FORCE_MATCHER_H__
+#define __VW_INTERESTPOINT_BRUTE_FORCE_MATCHER_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/ProgressCallback.h>
+
+namespace vw {
+namespace ip {
+
+  /// Find the knn nearest reference descriptors of each query descriptor.
+  /// - Descriptors are stored one after the other, length elements each.
+  /// - indices[i*knn+j] and distances[i*knn+j] receive the j'th nearest
+  ///   reference of query i, nearest first.  Ties go to the lower index.
+  ///   Entries past the number of references have index -1.
+  /// - Distances are squared Euclidean, as with L2NormMetric and FLANN.
+  /// - Progress is reported as each tile of queries finishes.  If an abort
+  ///   is requested the remaining tiles are skipped and vw::Aborted is thrown.
+  void brute_force_knn_l2( float const* query, size_t num_query,
+                           float const* reference, size_t num_reference,
+                           size_t length, size_t knn,
+                           int32* indices, float* distances,
+                           ProgressCallback const& progress = ProgressCallback::dummy_instance() );
+
+  /// As brute_force_knn_l2(), for binary descriptors of length bytes
+  ///  compared by the number of differing bits.
+  void brute_force_knn_hamming( uint8 const* query, size_t num_query,
+                                uint8 const* reference, size_t num_reference,
+                                size_t length, size_t knn,
+                                int32* indices, float* distances,
+                                ProgressCallback const& progress = ProgressCallback::dummy_instance() );
+
+  /// Overloads picking the distance from the descriptor type.
+  inline void brute_force_knn( float const* query, size_t num_query,
+                               float const* reference, size_t num_reference,
+                               size_t length, size_t knn, int32* indices, float* distances,
+                               ProgressCallback const& progress = ProgressCallback::dummy_instance() ) {
+    brute_force_knn_l2( query, num_query, reference, num_reference, length, knn,
+                        indices, distances, progress );
+  }
+  inline void brute_force_knn( uint8 const* query, size_t num_query,
+                               uint8 const* reference, size_t num_reference,
+                               size_t length, size_t knn, int32* indices, float* distances,
+                               ProgressCallback const& progress = ProgressCallback::dummy_instance() ) {
+    brute_force_knn_hamming( query, num_query, reference, num_reference, length, knn,
+                             indices, distances, progress );
+  }
+
+  /// Returns true if an exhaustive search is expected to beat building and
+  ///  searching a FLANN tree for the reference descriptors.
+  bool prefer_brute_force_knn( bool hamming, size_t num_query, size_t num_reference,
+                               size_t length );
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_BRUTE_FORCE_MATCHER_H__
@@ -29,6 +29,7 @@
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/FileIO/DiskImageUtils.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
 #include <vw/InterestPoint/MatrixIO.h>
 #include <vw/InterestPoint/IntegralImage.h>
 #include <vw/InterestPoint/Detector.h>
@@ -286,6 +287,33 @@ namespace ip {
   void describe_interest_points( ImageViewBase<ViewT> const& view, DescriptorT& descriptor,
 				 InterestPointList& list );
 
+  /// Describes the points of an InterestPointSet in one image block.
+  /// - Each task writes only the descriptor rows of its own points.
+  template <class ViewT, class DescriptorT, class ElemT>
+  class InterestPointSetDescriptionTask : public Task, private boost::noncopyable {
+    ViewT                     m_view;       ///< Source image
+    DescriptorT             & m_descriptor; ///< Description class instance
+    InterestPointSetT<ElemT>& m_points;
+    std::vector<size_t>       m_indices;    ///< Points of m_points in this block
+    int                       m_id, m_max_id;
+
+  public:
+    InterestPointSetDescriptionTask( ImageViewBase<ViewT> const& view, DescriptorT& descriptor,
+                                     InterestPointSetT<ElemT>& points,
+                                     std::vector<size_t> const& indices, int id, int max_id ) :
+      m_view( view.impl() ), m_descriptor( descriptor ), m_points( points ),
+      m_indices( indices ), m_id( id ), m_max_id( max_id ) {}
+
+    void operator()();
+  }; // End class InterestPointSetDescriptionTask
+
+  /// Same as the InterestPointList version, but the descriptors are written
+  ///  straight into the descriptor block of the set.
+  /// - The set descriptor length is changed to descriptor.descriptor_size().
+  template <class ViewT, class DescriptorT, class ElemT>
+  void describe_interest_points( ImageViewBase<ViewT> const& view, DescriptorT& descriptor,
+                                 InterestPointSetT<ElemT>& points );
+
 
 
 // TODO: Seperate the definitions!
@@ -452,6 +480,106 @@ void describe_interest_points( ImageViewBase<ViewT> const& view, DescriptorT& de
   return;
 }
 
+//-----------------------------------------------------
+// InterestPointSet description
+
+/// Compute one descriptor into a row of a float set.
+template <class DescriptorT, class ViewT>
+void compute_descriptor_row( DescriptorT& descriptor, ImageViewBase<ViewT> const& support,
+                             float* row, size_t length, Vector<float> & /*buffer*/ ) {
+  descriptor.compute_descriptor( support, row, row+length );
+}
+
+/// Compute one descriptor into a row of any other set, which needs a float buffer
+///  because the descriptor generators normalize in place.
+template <class DescriptorT, class ViewT, class ElemT>
+void compute_descriptor_row( DescriptorT& descriptor, ImageViewBase<ViewT> const& support,
+                             ElemT* row, size_t length, Vector<float> & buffer ) {
+  buffer.set_size( length );
+  descriptor.compute_descriptor( support, buffer.begin(), buffer.end() );
+  for ( size_t k = 0; k < length; ++k )
+    row[k] = static_cast<ElemT>( buffer[k] );
+}
+
+template <class ViewT, class DescriptorT, class ElemT>
+void InterestPointSetDescriptionTask<ViewT, DescriptorT, ElemT>::operator()() {
+  BBox2i image_crop_bounds;
+  const float half_size = ((float)( m_descriptor.support_size() - 1)) / 2.0f;
+  BBox2i support_size( 0, 0, m_descriptor.support_size(),
+                       m_descriptor.support_size() );
+  for ( size_t i = 0; i < m_indices.size(); ++i ) {
+    const size_t p = m_indices[i];
+    float  scaling = 1.0f / m_points.scale(p);
+    double c       = cos(-m_points.orientation(p)), s=sin(-m_points.orientation(p));
+
+    AffineTransform tx( Matrix2x2(scaling*c, -scaling*s,
+                                  scaling*s, scaling*c),
+                        Vector2(scaling*(s * m_points.y(p) - c * m_points.x(p)) + half_size,
+                                -scaling*(s * m_points.x(p) + c * m_points.y(p)) + half_size) );
+    image_crop_bounds.grow( tx.reverse_bbox( support_size ) );
+  }
+  image_crop_bounds.expand( 1 );
+  vw_out(InfoMessage, "interest_point") << "Describing interest points in block "
+                                        << m_id + 1 << "/" << m_max_id << "   [ "
+                                        << image_crop_bounds << " ]\n";
+
+  ImageView<PixelGray<float> > image =
+    crop( edge_extend(m_view.impl(), ZeroEdgeExtension()), image_crop_bounds );
+
+  // Describe each point from the crop, with its location relative to the crop.
+  const size_t length = m_points.descriptor_length();
+  Vector<float> buffer;
+  for ( size_t i = 0; i < m_indices.size(); ++i ) {
+    const size_t p = m_indices[i];
+    InterestPoint pt = m_points.point( p, false );
+    pt.x -= image_crop_bounds.min().x();
+    pt.y -= image_crop_bounds.min().y();
+    ImageView<PixelGray<float> > support =
+      m_descriptor.get_support( pt, pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image)) );
+    compute_descriptor_row( m_descriptor, support, m_points.descriptor(p), length, buffer );
+  }
+}
+
+template <class ViewT, class DescriptorT, class ElemT>
+void describe_interest_points( ImageViewBase<ViewT> const& view, DescriptorT& descriptor,
+                               InterestPointSetT<ElemT>& points ) {
+
+  VW_OUT(DebugMessage, "interest_point")
+    << "Running MT interest point set descriptor.  Input image: [ "
+    << view.impl().cols() << " x " << view.impl().rows() << " ]\n";
+
+  points.set_descriptor_length( descriptor.descriptor_size() );
+
+  // Bin the points into the same 1024x1024 or larger blocks as the list version.
+  int tile_size = vw_settings().default_tile_size();
+  if (tile_size < 1024)
+    tile_size = 1024;
+  const int tiles_x = (view.impl().cols() + tile_size - 1) / tile_size;
+  const int tiles_y = (view.impl().rows() + tile_size - 1) / tile_size;
+  std::vector<std::vector<size_t> > tile_points( tiles_x * tiles_y );
+  for ( size_t i = 0; i < points.size(); ++i ) {
+    Vector2i loc( points.x(i), points.y(i) );
+    if ( loc.x() < 0 || loc.y() < 0 || loc.x() >= view.impl().cols() || loc.y() >= view.impl().rows() )
+      continue; // Points off the image are not described, as in the list version.
+    tile_points[ (loc.y()/tile_size)*tiles_x + loc.x()/tile_size ].push_back( i );
+  }
+
+  typedef InterestPointSetDescriptionTask<ViewT, DescriptorT, ElemT> task_type;
+  FifoWorkQueue queue;
+  for ( size_t t = 0; t < tile_points.size(); ++t ) {
+    if ( tile_points[t].empty() )
+      continue;
+    boost::shared_ptr<task_type> task( new task_type( view, descriptor, points, tile_points[t],
+                                                      t, tile_points.size() ) );
+    queue.add_task( task );
+  }
+
+  VW_OUT(DebugMessage, "interest_point") << "Waiting for threads to terminate.\n";
+  queue.join_all();
+
+  VW_OUT(DebugMessage, "interest_point") << "MT interest point set description complete.\n";
+}
+
 //-----------------------------------------------------
 // PatchDescriptorGenerator
 
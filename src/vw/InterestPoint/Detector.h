@@ -26,6 +26,10 @@
 #ifndef __VW_INTERESTPOINT_DETECTOR_H__
 #define __VW_INTERESTPOINT_DETECTOR_H__
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 #include <vw/Core/Debugging.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/ThreadPool.h>
@@ -77,8 +81,21 @@ namespace ip {
     template <class ViewT>
     InterestPointList operator() (vw::ImageViewBase<ViewT> const& image,
                                   int desired_num_ip=0);
+
+    /// The number of pixels around a region which the detector reads in
+    ///  order to find the points inside it, or zero if this is not known.
+    /// - Used by detect_interest_points_tiled() to size the tile halo.
+    int support_radius() const { return 0; }
+
+    /// The desired_num_ip to request from each tile so that keeping the
+    ///  max_points most interesting of the merged points gives the same
+    ///  result as if no tile had been culled.
+    int tile_num_ip(int max_points) const { return max_points; }
   };
 
+  /// The size, in pixels, of the image patch used to compute the orientation.
+  static const int IP_ORIENTATION_WIDTH = 10;
+
   /// Get the orientation of the point at (i0,j0,k0).  This is done by
   /// computing a gaussian weighted average orientations in a region
   /// around the detected point.  This is not the most sophisticated
@@ -173,6 +190,14 @@ namespace ip {
     template <class ViewT>
     InterestPointList process_image(ImageViewBase<ViewT> const& image, int desired_num_ip=0) const;
 
+    /// Follows the filters of each octave out to the coarsest one.  The
+    ///  result is a multiple of the coarsest octave's base scale, so tiles
+    ///  expanded by it still subsample onto the whole image's pixel grid.
+    int support_radius() const;
+
+    /// Culling is done per octave, so each tile needs max_points per octave.
+    int tile_num_ip(int max_points) const { return max_points * m_octaves; }
+
   protected:
     InterestT m_interest;
     int m_scales, m_octaves, m_max_points;
@@ -371,6 +396,97 @@ namespace ip {
     virtual boost::shared_ptr<Task> get_next_task();
   };
 
+  /// Gathers the points found by detect_interest_points_tiled().
+  /// - Each tile adds the points inside its core.  Points close enough to a
+  ///   seam with another tile to have been found by it too are held back and
+  ///   merged with their duplicates once all tiles are in.
+  /// - With max_points > 0 only the most interesting points are kept, in a
+  ///   heap that never grows past max_points.  Ties in interest go to the
+  ///   earlier tile so the result does not depend on thread timing.
+  class TiledInterestPointCollector : private boost::noncopyable {
+  public:
+    TiledInterestPointCollector(BBox2i const& image_bbox, int max_points)
+      : m_image_bbox(image_bbox), m_max_points(max_points) {}
+
+    /// Add the points found by tile number tile, in whole image coordinates.
+    void add(int tile, BBox2i const& core, InterestPointList const& points);
+
+    /// Merge the seams and return the points in tile order.
+    InterestPointList result();
+
+  private:
+    struct Entry {
+      InterestPoint point;
+      int tile, seq;
+    };
+
+    /// Points of similar scale closer than this are taken to be one point.
+    static float merge_radius(InterestPoint const& pt) { return std::max(1.0f, 0.5f*pt.scale); }
+    static bool  is_duplicate(Entry const& a, Entry const& b);
+    static bool  ranks_before(Entry const& a, Entry const& b);
+    static bool  tile_order  (Entry const& a, Entry const& b);
+
+    /// Add a point to the result, dropping the weakest point if full.
+    void insert(Entry const& entry);
+
+    BBox2i             m_image_bbox;
+    int                m_max_points;
+    std::vector<Entry> m_points, m_seam_points;
+    Mutex              m_mutex;
+  };
+
+  /// Task for detect_interest_points_tiled(), processing one tile plus its halo.
+  template <class ViewT, class DetectorT>
+  class TiledInterestPointDetectionTask : public Task, private boost::noncopyable {
+
+    ViewT                         m_view;
+    DetectorT                   & m_detector;
+    BBox2i                        m_core;     ///< Region of the image this tile owns
+    BBox2i                        m_bbox;     ///< The core plus the halo, inside the image
+    int                           m_desired_num_ip;
+    int                           m_id, m_max_id;
+    TiledInterestPointCollector & m_collector;
+
+  public:
+    TiledInterestPointDetectionTask(ImageViewBase<ViewT> const& view, DetectorT& detector,
+                                    BBox2i const& core, BBox2i const& bbox,
+                                    int desired_num_ip, int id, int max_id,
+                                    TiledInterestPointCollector& collector) :
+      m_view(view.impl()), m_detector(detector), m_core(core), m_bbox(bbox),
+      m_desired_num_ip(desired_num_ip), m_id(id), m_max_id(max_id), m_collector(collector) {}
+
+    virtual ~TiledInterestPointDetectionTask(){}
+
+    /// Find the IPs in the expanded tile and pass those in the core to the collector.
+    void operator()();
+  };
+
+  /// A thread pool creating the TiledInterestPointDetectionTask objects on
+  ///  demand, as InterestDetectionQueue does.
+  template <class ViewT, class DetectorT>
+  class TiledInterestDetectionQueue : public WorkQueue {
+    ViewT                         m_view;
+    DetectorT                   & m_detector;
+    TiledInterestPointCollector & m_collector;
+    std::vector<BBox2i>           m_bboxes;
+    int                           m_halo;
+    int                           m_desired_num_ip;
+    Mutex                         m_mutex;
+    size_t                        m_index;
+
+    typedef TiledInterestPointDetectionTask<ViewT, DetectorT> task_type;
+
+  public:
+
+    TiledInterestDetectionQueue( ImageViewBase<ViewT> const& view, DetectorT& detector,
+                                 TiledInterestPointCollector& collector,
+                                 int tile_size, int halo, int desired_num_ip );
+
+    size_t size() { return m_bboxes.size(); }
+
+    virtual boost::shared_ptr<Task> get_next_task();
+  };
+
   // End thread pool class declarations.
   // -----------------------------------------------------------------------------
 
@@ -385,6 +501,23 @@ namespace ip {
   InterestPointList detect_interest_points(ImageViewBase<ViewT> const& view, DetectorT& detector,
                                            int desired_num_ip=0);
 
+  /// Multithreaded interest point detection for images too large to be
+  /// processed at once, giving the same points as a single pass.
+  /// - The image is split into tiles of tile_size pixels (zero picks the
+  ///   size used by detect_interest_points()), read one at a time by each
+  ///   thread together with a halo of halo pixels around them.  A negative
+  ///   halo uses detector.support_radius(), or 32 pixels if that is unknown.
+  ///   For scale space detectors tile_size should be a multiple of the
+  ///   coarsest octave's base scale, as the default size is.
+  /// - Each point is kept by the tile whose core contains it, and points
+  ///   found twice along a seam are merged, keeping the more interesting.
+  /// - max_points limits the whole result to the most interesting points.
+  ///   When zero each tile uses the limit of the detector instead.
+  /// - Points are returned in tile order.
+  template <class ViewT, class DetectorT>
+  InterestPointList detect_interest_points_tiled(ImageViewBase<ViewT> const& view, DetectorT& detector,
+                                                 int max_points=0, int tile_size=0, int halo=-1);
+
 
 // Include all the function definitions
 #include <vw/InterestPoint/Detector.tcc>
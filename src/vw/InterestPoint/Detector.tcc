@@ -149,6 +149,225 @@ InterestPointList detect_interest_points (ImageViewBase<ViewT> const& view, Dete
   return ip_list;
 }
 
+//-------------------------------------------------------------------
+// TiledInterestPointCollector
+
+inline bool TiledInterestPointCollector::is_duplicate(Entry const& a, Entry const& b) {
+  if (a.tile == b.tile)
+    return false;
+  const float SCALE_TOLERANCE = 1.2f;
+  if (std::max(a.point.scale, b.point.scale) > SCALE_TOLERANCE*std::min(a.point.scale, b.point.scale))
+    return false;
+  const float radius = std::max(merge_radius(a.point), merge_radius(b.point));
+  const float dx = a.point.x - b.point.x, dy = a.point.y - b.point.y;
+  return dx*dx + dy*dy < radius*radius;
+}
+
+inline bool TiledInterestPointCollector::ranks_before(Entry const& a, Entry const& b) {
+  if (a.point < b.point)
+    return true;
+  if (b.point < a.point)
+    return false;
+  return tile_order(a, b);
+}
+
+inline bool TiledInterestPointCollector::tile_order(Entry const& a, Entry const& b) {
+  if (a.tile != b.tile)
+    return a.tile < b.tile;
+  return a.seq < b.seq;
+}
+
+inline void TiledInterestPointCollector::insert(Entry const& entry) {
+  if (m_max_points <= 0) {
+    m_points.push_back(entry);
+    return;
+  }
+  // m_points is a heap with the weakest point kept at the front.
+  if (int(m_points.size()) >= m_max_points) {
+    if (!ranks_before(entry, m_points.front()))
+      return;
+    std::pop_heap(m_points.begin(), m_points.end(), ranks_before);
+    m_points.back() = entry;
+  } else {
+    m_points.push_back(entry);
+  }
+  std::push_heap(m_points.begin(), m_points.end(), ranks_before);
+}
+
+inline void TiledInterestPointCollector::add(int tile, BBox2i const& core,
+                                             InterestPointList const& points) {
+  // Only the core edges inside the image border another tile.
+  const bool left   = core.min().x() > m_image_bbox.min().x();
+  const bool top    = core.min().y() > m_image_bbox.min().y();
+  const bool right  = core.max().x() < m_image_bbox.max().x();
+  const bool bottom = core.max().y() < m_image_bbox.max().y();
+
+  Mutex::Lock lock(m_mutex);
+  int seq = 0;
+  for (InterestPointList::const_iterator pt = points.begin(); pt != points.end(); ++pt) {
+    // Points in the halo belong to a neighboring tile.
+    if (pt->x < core.min().x() || pt->x >= core.max().x() ||
+        pt->y < core.min().y() || pt->y >= core.max().y())
+      continue;
+
+    Entry entry;
+    entry.point = *pt;
+    entry.tile  = tile;
+    entry.seq   = seq++;
+
+    const float radius = merge_radius(*pt);
+    if ((left   && pt->x - core.min().x() < radius) ||
+        (top    && pt->y - core.min().y() < radius) ||
+        (right  && core.max().x() - pt->x < radius) ||
+        (bottom && core.max().y() - pt->y < radius))
+      m_seam_points.push_back(entry);
+    else
+      insert(entry);
+  }
+}
+
+inline InterestPointList TiledInterestPointCollector::result() {
+  Mutex::Lock lock(m_mutex);
+
+  // Merge the seam points, strongest first, checking each against the
+  // points already kept in the neighboring cells of a grid at least as
+  // coarse as the merge radius.
+  std::sort(m_seam_points.begin(), m_seam_points.end(), ranks_before);
+  float cell_size = 1.0f;
+  for (size_t i = 0; i < m_seam_points.size(); ++i)
+    cell_size = std::max(cell_size, merge_radius(m_seam_points[i].point));
+
+  typedef std::map<std::pair<int,int>, std::vector<size_t> > GridT;
+  GridT grid;
+  std::vector<Entry> kept;
+  for (size_t i = 0; i < m_seam_points.size(); ++i) {
+    Entry const& entry = m_seam_points[i];
+    const int col = int(floor(entry.point.x / cell_size));
+    const int row = int(floor(entry.point.y / cell_size));
+    bool duplicate = false;
+    for (int r = row-1; r <= row+1 && !duplicate; ++r) {
+      for (int c = col-1; c <= col+1 && !duplicate; ++c) {
+        GridT::const_iterator cell = grid.find(std::make_pair(c, r));
+        if (cell == grid.end())
+          continue;
+        for (size_t j = 0; j < cell->second.size() && !duplicate; ++j)
+          duplicate = is_duplicate(kept[cell->second[j]], entry);
+      }
+    }
+    if (duplicate)
+      continue;
+    grid[std::make_pair(col, row)].push_back(kept.size());
+    kept.push_back(entry);
+  }
+  m_seam_points.clear();
+  for (size_t i = 0; i < kept.size(); ++i)
+    insert(kept[i]);
+
+  std::sort(m_points.begin(), m_points.end(), tile_order);
+  InterestPointList points;
+  for (size_t i = 0; i < m_points.size(); ++i)
+    points.push_back(m_points[i].point);
+  return points;
+}
+
+//-------------------------------------------------------------------
+// TiledInterestPointDetectionTask
+
+template <class ViewT, class DetectorT>
+void TiledInterestPointDetectionTask<ViewT, DetectorT>::operator()() {
+
+  vw_out(InfoMessage, "interest_point") << "Locating interest points in block "
+                                        << m_id + 1 << "/" << m_max_id << "   [ " << m_core
+                                        << " ] read as [ " << m_bbox << " ] with "
+                                        << m_desired_num_ip << " ip.\n";
+
+  InterestPointList new_ip_list = m_detector(crop(m_view.impl(), m_bbox), m_desired_num_ip);
+
+  for (InterestPointList::iterator pt = new_ip_list.begin(); pt != new_ip_list.end(); ++pt) {
+    (*pt).x  += m_bbox.min().x();
+    (*pt).ix += m_bbox.min().x();
+    (*pt).y  += m_bbox.min().y();
+    (*pt).iy += m_bbox.min().y();
+  }
+
+  m_collector.add(m_id, m_core, new_ip_list);
+
+  vw_out(InfoMessage, "interest_point") << "Finished block " << m_id + 1 << "/" << m_max_id << std::endl;
+}
+
+//-------------------------------------------------------------------
+// TiledInterestDetectionQueue
+
+template <class ViewT, class DetectorT>
+TiledInterestDetectionQueue<ViewT, DetectorT>::
+TiledInterestDetectionQueue( ImageViewBase<ViewT> const& view, DetectorT& detector,
+                             TiledInterestPointCollector& collector,
+                             int tile_size, int halo, int desired_num_ip ) :
+     m_view(view.impl()), m_detector(detector), m_collector(collector),
+     m_halo(halo), m_desired_num_ip(desired_num_ip), m_index(0) {
+
+  m_bboxes = subdivide_bbox( m_view, tile_size, tile_size );
+  this->notify();
+}
+
+template <class ViewT, class DetectorT>
+boost::shared_ptr<Task>
+TiledInterestDetectionQueue<ViewT, DetectorT>::get_next_task() {
+  Mutex::Lock lock(m_mutex);
+  if ( m_index == m_bboxes.size() )
+    return boost::shared_ptr<Task>();
+
+  BBox2i const& core = m_bboxes[m_index];
+  BBox2i bbox = core;
+  bbox.expand(m_halo);
+  bbox.crop(bounding_box(m_view));
+
+  m_index++;
+  return boost::shared_ptr<Task>( new task_type( m_view, m_detector, core, bbox,
+                                                 m_desired_num_ip, m_index-1,
+                                                 m_bboxes.size(), m_collector ) );
+}
+
+//-------------------------------------------------------------------
+
+template <class ViewT, class DetectorT>
+InterestPointList detect_interest_points_tiled(ImageViewBase<ViewT> const& view, DetectorT& detector,
+                                               int max_points, int tile_size, int halo) {
+
+  if (tile_size <= 0) {
+    tile_size = vw_settings().default_tile_size();
+    if (tile_size < 1024)
+      tile_size = 1024;
+  }
+  if (halo < 0) {
+    const int DEFAULT_HALO = 32;
+    halo = detector.support_radius();
+    if (halo <= 0)
+      halo = DEFAULT_HALO;
+  }
+  // Each tile must keep enough points that none of the global top
+  //  max_points are lost to the culling inside the detector.
+  int desired_num_ip = 0;
+  if (max_points > 0)
+    desired_num_ip = detector.tile_num_ip(max_points);
+
+  VW_OUT(DebugMessage, "interest_point") << "Running tiled interest point detector with "
+                                         << tile_size << " pixel tiles, a " << halo
+                                         << " pixel halo and max_points = " << max_points
+                                         << ".  Input image: [ " << view.impl().cols() << " x "
+                                         << view.impl().rows() << " ]\n";
+
+  TiledInterestPointCollector collector(bounding_box(view.impl()), max_points);
+  TiledInterestDetectionQueue<ViewT, DetectorT> detect_queue( view, detector, collector,
+                                                              tile_size, halo, desired_num_ip );
+  VW_OUT(DebugMessage, "interest_point") << "Waiting for threads to terminate.\n";
+  detect_queue.join_all();
+  InterestPointList ip_list = collector.result();
+  VW_OUT(DebugMessage, "interest_point") << "Tiled interest point detection complete.  "
+                                         << ip_list.size() << " interest point detected.\n";
+  return ip_list;
+}
+
 //-------------------------------------------------------------------
 
 // Get the orientation of the point at (i0,j0,k0).  This is done by
@@ -164,9 +383,6 @@ float get_orientation( ImageViewBase<OriT> const& x_grad,
                        ImageViewBase<MagT> const& y_grad,
                        float i0, float j0, float sigma_ratio) {
 
-  // The size, in pixels, of the image patch used to compute the orientation.
-  static const int IP_ORIENTATION_WIDTH = 10;
-
   // Nominal feature support patch is WxW at the base scale, with
   // W = IP_ORIENTATION_HALF_WIDTH * 2 + 1, and
   // we multiply by sigma[k]/sigma[1] for other planes.
@@ -464,6 +680,61 @@ process_image(ImageViewBase<ViewT> const& image, int desired_num_ip) const {
   return points;
 }
 
+template <class InterestT>
+int ScaledInterestPointDetector<InterestT>::support_radius() const {
+  if (m_scales < 1 || m_octaves < 1)
+    return 0;
+
+  // The plane sigmas, as set up by ImageOctave.
+  const int   num_planes  = m_scales + 2;
+  const float sigma_ratio = pow(2.0, 1.0/((float)m_scales));
+  std::vector<float> sigma(num_planes);
+  sigma[0] = INITIAL_SIGMA / sigma_ratio;
+  for (int k = 1; k < num_planes; ++k)
+    sigma[k] = sigma[k-1] * sigma_ratio;
+
+  // How far each plane reaches into the input image, in pixels of the
+  // current octave.  process_image() blurs the input before the octave.
+  std::vector<int> reach(num_planes);
+  reach[0] = compute_kernel_size(0.5)/2;
+  if (sigma[0] > CAMERA_SIGMA)
+    reach[0] += compute_kernel_size(sqrt(sigma[0]*sigma[0] - CAMERA_SIGMA*CAMERA_SIGMA))/2;
+
+  int radius = 0;
+  for (int o = 0; o < m_octaves; ++o) {
+    const int base_scale = 1 << o;
+    int first_blurred = 1;
+    if (o > 0) {
+      // The first two planes are the last two of the previous octave, subsampled.
+      const int reach_0 = (reach[num_planes-2] + 1) / 2;
+      const int reach_1 = (reach[num_planes-1] + 1) / 2;
+      reach[0] = reach_0;
+      reach[1] = reach_1;
+      first_blurred = 2;
+    }
+    for (int k = first_blurred; k < num_planes; ++k)
+      reach[k] = reach[k-1] + compute_kernel_size(sqrt(sigma[k]*sigma[k] - sigma[k-1]*sigma[k-1]))/2;
+
+    // On top of the planes a point needs the gradients, then either the
+    // interest window (the Harris window is the widest) plus the
+    // neighbors for the extrema and the peak fit, or the orientation
+    // window.  One more pixel allows for the peak fit moving the point.
+    int need = 0;
+    for (int k = 0; k < num_planes; ++k) {
+      int planes = reach[k];
+      if (k > 0)            planes = std::max(planes, reach[k-1]);
+      if (k < num_planes-1) planes = std::max(planes, reach[k+1]);
+      const int window      = compute_kernel_size(base_scale*pow(2.0f, k/(float)m_scales))/2;
+      const int orientation = int(IP_ORIENTATION_WIDTH/2*sigma[k]/sigma[1] + 0.5) + 1;
+      need = std::max(need, planes + 1 + std::max(window + 2, orientation) + 1);
+    }
+    radius = std::max(radius, base_scale * need);
+  }
+
+  const int coarsest = 1 << (m_octaves-1);
+  return (radius + coarsest - 1) / coarsest * coarsest;
+}
+
 // By default, uses fit_peak in Localize.h
 template <class InterestT>
 template <class DataT, class ViewT>
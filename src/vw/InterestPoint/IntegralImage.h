@@ -24,67 +24,206 @@
 #ifndef __VW_INTERESTPOINT_INTEGRALIMAGE_H__
 #define __VW_INTERESTPOINT_INTEGRALIMAGE_H__
 
+#include <algorithm>
+#include <vector>
+
+#include <boost/mpl/if.hpp>
+#include <boost/type_traits/is_integral.hpp>
 #include <boost/utility/enable_if.hpp>
 #include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypes.h>
 
 // TODO: Change the function names to meet the standard convention!
 
 namespace vw {
 namespace ip {
 
-  /// Function to create an integral image of an input image.
-  /// - Despite the caps, this is a function and IntegralImage is not a type!
-  /// - An integral image can be used to quickly find regional sums using the function below.
-  template <class ViewT>
-  inline ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type>
-  IntegralImage( ImageViewBase<ViewT> const& source ) {
-
-    typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
-
-    // Allocating space
-    ImageView<channel_type> integral( source.impl().cols()+1, source.impl().rows()+1 );
-
-    typedef typename ImageView<channel_type>::pixel_accessor dst_accessor;
-    typedef typename ViewT::pixel_accessor src_accessor;
+  /// The type integral images are accumulated in before being stored:
+  ///  int64 for integer channels and double otherwise.
+  template <class ChannelT>
+  struct IntegralAccumType {
+    typedef typename boost::mpl::if_<boost::is_integral<ChannelT>, int64, double>::type type;
+  };
+
+  namespace detail {
+
+    /// Sums the columns of a strip of source rows, for the carry into the
+    ///  strips below it.
+    template <class ViewT, class AccumT>
+    class IntegralColumnSumTask : public Task, private boost::noncopyable {
+      ViewT const& m_source;
+      int32 m_row_begin, m_row_end;
+      std::vector<AccumT> & m_column_sums;
+
+    public:
+      IntegralColumnSumTask( ViewT const& source, int32 row_begin, int32 row_end,
+                             std::vector<AccumT> & column_sums ) :
+        m_source(source), m_row_begin(row_begin), m_row_end(row_end),
+        m_column_sums(column_sums) {}
+
+      virtual void operator()() {
+        typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
+        typedef typename ViewT::pixel_accessor src_accessor;
+        const int32 cols = m_source.cols();
+        m_column_sums.assign( cols, AccumT(0) );
+        src_accessor src_row = m_source.origin().advance( 0, m_row_begin );
+        for ( int32 iy = m_row_begin; iy < m_row_end; iy++ ) {
+          src_accessor src_col = src_row;
+          for ( int32 ix = 0; ix < cols; ix++ ) {
+            m_column_sums[ix] += AccumT( pixel_cast<PixelGray<channel_type> >(*src_col).v() );
+            src_col.next_col();
+          }
+          src_row.next_row();
+        }
+      }
+    };
+
+    /// Writes the integral image rows of a strip of source rows, starting
+    ///  from the sums of all the rows above the strip.
+    template <class ViewT, class ChannelT, class AccumT>
+    class IntegralStripTask : public Task, private boost::noncopyable {
+      ViewT const& m_source;
+      ImageView<ChannelT> & m_integral;
+      int32 m_row_begin, m_row_end;
+      std::vector<AccumT> m_sums; // Integral image row above the current one, less the zero column
+
+    public:
+      IntegralStripTask( ViewT const& source, ImageView<ChannelT> & integral,
+                         int32 row_begin, int32 row_end, std::vector<AccumT> const& sums_above ) :
+        m_source(source), m_integral(integral), m_row_begin(row_begin), m_row_end(row_end),
+        m_sums(sums_above) {}
+
+      virtual void operator()() {
+        typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
+        typedef typename ViewT::pixel_accessor src_accessor;
+        const int32 cols = m_source.cols();
+        AccumT* sums = &m_sums[0];
+        src_accessor src_row = m_source.origin().advance( 0, m_row_begin );
+        for ( int32 iy = m_row_begin; iy < m_row_end; iy++ ) {
+          ChannelT* dest = &m_integral( 1, iy+1 );
+          AccumT run = 0;
+          src_accessor src_col = src_row;
+          for ( int32 ix = 0; ix < cols; ix++ ) {
+            run += AccumT( pixel_cast<PixelGray<channel_type> >(*src_col).v() );
+            sums[ix] += run;
+            dest[ix] = ChannelT( sums[ix] );
+            src_col.next_col();
+          }
+          src_row.next_row();
+        }
+      }
+    };
+
+    /// Writes the integral image of src in num_strips strips of rows.  The
+    ///  column sums of each strip are found in parallel, carried down, and
+    ///  then each strip writes its rows in parallel from the carried sums.
+    template <class PixelT, class ChannelT>
+    void integral_image_strips( ImageView<PixelT> const& src, ImageView<ChannelT> & integral,
+                                int32 num_strips ) {
+      typedef ImageView<PixelT> ViewT;
+      typedef typename IntegralAccumType<ChannelT>::type AccumT;
+      const int32 cols = src.cols(), rows = src.rows();
+
+      std::vector<int32> strip_begin( num_strips+1 );
+      for ( int32 s = 0; s <= num_strips; s++ )
+        strip_begin[s] = int32( int64(rows) * s / num_strips );
+
+      // Column sums of each strip but the last, which nothing is below.
+      std::vector<std::vector<AccumT> > column_sums( num_strips-1 );
+      {
+        FifoWorkQueue queue( num_strips-1 );
+        for ( int32 s = 0; s < num_strips-1; s++ ) {
+          boost::shared_ptr<Task> task(
+            new IntegralColumnSumTask<ViewT, AccumT>( src, strip_begin[s], strip_begin[s+1],
+                                                      column_sums[s] ) );
+          queue.add_task( task );
+        }
+        queue.join_all();
+      }
 
-    // Zero-ing the first row and col
-    dst_accessor dest_row = integral.origin();
-    *dest_row = 0;
-    for ( int i = 1; i < integral.cols(); i++ ) {
-      dest_row.next_col();
-      *dest_row = 0;
+      // Carry the column sums down and write the strips.
+      FifoWorkQueue queue( num_strips );
+      std::vector<AccumT> columns_above( cols, AccumT(0) ), sums_above( cols );
+      for ( int32 s = 0; s < num_strips; s++ ) {
+        if ( s > 0 ) {
+          AccumT run = 0;
+          for ( int32 ix = 0; ix < cols; ix++ ) {
+            columns_above[ix] += column_sums[s-1][ix];
+            run += columns_above[ix];
+            sums_above[ix] = run;
+          }
+        } else {
+          std::fill( sums_above.begin(), sums_above.end(), AccumT(0) );
+        }
+        boost::shared_ptr<Task> task(
+          new IntegralStripTask<ViewT, ChannelT, AccumT>( src, integral, strip_begin[s],
+                                                          strip_begin[s+1], sums_above ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
     }
-    dest_row = integral.origin();
-    for ( int i = 1; i < integral.rows(); i++ ) {
-      dest_row.next_row();
-      *dest_row = 0;
+
+    /// Both passes over the strips read the source, so a lazy view is
+    ///  rasterized first rather than evaluated twice.
+    template <class ViewT, class ChannelT>
+    void integral_image_strips( ImageViewBase<ViewT> const& src, ImageView<ChannelT> & integral,
+                                int32 num_strips ) {
+      integral_image_strips( ImageView<typename ViewT::pixel_type>( src.impl() ), integral,
+                             num_strips );
     }
 
-    // Pointer and pointer offset
-    int offset = integral.cols();
-    channel_type* p;
-
-    // Now filling in integral image
-    dest_row = integral.origin();
-    dest_row.advance(1,1);
-    src_accessor src_row = source.impl().origin();
-    for ( int iy = 0; iy < source.impl().rows(); iy++ ) {
-      dst_accessor dest_col = dest_row;
-      src_accessor src_col = src_row;
-      for ( int ix = 0; ix < source.impl().cols(); ix++ ) {
-        p = &(*dest_col);
-
-        // Summing
-        *dest_col = pixel_cast<PixelGray<channel_type> >(*src_col).v() + *(p-1) + *(p-offset) - *(p-offset-1);
-
-        dest_col.next_col();
-      src_col.next_col();
-      }
-      dest_row.next_row();
-      src_row.next_row();
+  } // namespace detail
+
+  /// Compute the integral image of source into integral, which is resized
+  ///  to (cols+1) x (rows+1) with a zero first row and column.
+  /// - Sums are accumulated in IntegralAccumType of the integral's channel
+  ///   type and only rounded when stored, so a float integral of a large
+  ///   image is as accurate as float allows.  Use a double integral when
+  ///   box sums over a large image need more than that.
+  /// - With num_threads above one, large images are split into strips of
+  ///   rows which are summed in parallel.  Zero uses the default thread
+  ///   count.  The detectors already run per tile in a thread pool, so
+  ///   they leave this at one.
+  template <class ViewT, class ChannelT>
+  void integral_image( ImageViewBase<ViewT> const& source, ImageView<ChannelT> & integral,
+                       int32 num_threads = 1 ) {
+    typedef typename IntegralAccumType<ChannelT>::type AccumT;
+    ViewT const& src = source.impl();
+    const int32 cols = src.cols(), rows = src.rows();
+
+    integral.set_size( cols+1, rows+1 );
+    std::fill( &integral(0,0), &integral(0,0) + (cols+1), ChannelT(0) );
+    for ( int32 iy = 1; iy <= rows; iy++ )
+      integral( 0, iy ) = 0;
+    if ( cols == 0 || rows == 0 )
+      return;
+
+    // Strips below this many rows are not worth the extra pass.
+    const int32 MIN_STRIP_ROWS = 256;
+    if ( num_threads < 1 )
+      num_threads = vw_settings().default_num_threads();
+    int32 num_strips = std::min( num_threads, rows / MIN_STRIP_ROWS );
+    if ( num_strips > 1 ) {
+      detail::integral_image_strips( src, integral, num_strips );
+      return;
     }
+    detail::IntegralStripTask<ViewT, ChannelT, AccumT>
+      task( src, integral, 0, rows, std::vector<AccumT>( cols, AccumT(0) ) );
+    task();
+  }
 
+  /// Function to create an integral image of an input image.
+  /// - Despite the caps, this is a function and IntegralImage is not a type!
+  /// - An integral image can be used to quickly find regional sums using the function below.
+  /// - The integral has the channel type of the input, see integral_image().
+  template <class ViewT>
+  inline ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type>
+  IntegralImage( ImageViewBase<ViewT> const& source, int32 num_threads = 1 ) {
+    ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type> integral;
+    integral_image( source, integral, num_threads );
     return integral;
   } // End IntegralImage function
 
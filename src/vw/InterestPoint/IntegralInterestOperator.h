@@ -109,8 +109,8 @@ namespace ip {
         bfilter.push_back(instance);
       }
 
-      // 2.) Apply Filter ( DataT performs actual render )
-      data.set_interest(ImageViewRef<typename DataT::integral_type::pixel_type>( abs(box_filter(data.integral(), bfilter))));
+      // 2.) Apply Filter a row at a time
+      data.set_interest( abs(apply_box_filter(data.integral(), bfilter)) );
     }
 
     // Threshold will reassign the interest with the harris corner detector
@@ -22,6 +22,7 @@
 ///
 #include <fstream>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointFile.h>
 
 namespace vw {
 namespace ip {
@@ -100,8 +101,21 @@ namespace ip {
     f.close();
   }
 
+  /// Load the single set of a mapped interest point file.
+  template <class ListT>
+  void read_mapped_ip_file(std::string const& ip_file, ListT & result) {
+    MappedInterestPointFile file(ip_file);
+    if (file.num_sets() != 1)
+      vw_throw( IOErr() << ip_file << " does not contain a single set of interest points." );
+    file[0].to_list(result);
+  }
+
   std::vector<InterestPoint> read_binary_ip_file(std::string ip_file) {
     std::vector<InterestPoint> result;
+    if (is_mapped_ip_file(ip_file)) {
+      read_mapped_ip_file(ip_file, result);
+      return result;
+    }
 
     std::ifstream f;
     f.open(ip_file.c_str(), std::ios::binary | std::ios::in);
@@ -117,6 +131,10 @@ namespace ip {
   }
   InterestPointList read_binary_ip_file_list(std::string ip_file) {
     InterestPointList result;
+    if (is_mapped_ip_file(ip_file)) {
+      read_mapped_ip_file(ip_file, result);
+      return result;
+    }
 
     std::ifstream f;
     f.open(ip_file.c_str(), std::ios::binary | std::ios::in);
@@ -152,6 +170,15 @@ namespace ip {
     ip1.clear();
     ip2.clear();
 
+    if (is_mapped_ip_file(match_file)) {
+      MappedInterestPointFile file(match_file);
+      if (file.num_sets() != 2)
+        vw_throw( IOErr() << match_file << " does not contain a pair of interest point sets." );
+      file[0].to_list(ip1);
+      file[1].to_list(ip2);
+      return;
+    }
+
     std::ifstream f;
     f.open(match_file.c_str(), std::ios::binary | std::ios::in);
 
@@ -0,0 +1,493 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file InterestPointFile.cc
+///
+/// Reading and writing memory mapped interest point files.
+///
+#include <vw/config.h>
+#include <vw/InterestPoint/InterestPointFile.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include <boost/type_traits/is_same.hpp>
+
+#if VW_HAVE_PKG_BOOST_IOSTREAMS
+#include <boost/iostreams/device/mapped_file.hpp>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+namespace vw {
+namespace ip {
+
+namespace detail {
+
+  /// Owns the mapping of one file.
+  struct InterestPointMapping {
+    std::string  filename;
+    uint8 const* data;
+    size_t       size;
+
+#if VW_HAVE_PKG_BOOST_IOSTREAMS
+    boost::iostreams::mapped_file_source file;
+
+    explicit InterestPointMapping(std::string const& name) : filename(name), data(0), size(0) {
+      try {
+        file.open(name);
+      } catch (std::exception const& e) {
+        vw_throw( IOErr() << "Failed to map interest point file " << name << ": " << e.what() );
+      }
+      data = reinterpret_cast<uint8 const*>(file.data());
+      size = file.size();
+    }
+#else
+    explicit InterestPointMapping(std::string const& name) : filename(name), data(0), size(0) {
+      int fd = open(name.c_str(), O_RDONLY);
+      if (fd < 0)
+        vw_throw( IOErr() << "Failed to open interest point file: " << name );
+      struct stat info;
+      if (fstat(fd, &info) != 0) {
+        close(fd);
+        vw_throw( IOErr() << "Failed to read the size of interest point file: " << name );
+      }
+      size = info.st_size;
+      if (size > 0) {
+        void* ptr = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+          close(fd);
+          vw_throw( IOErr() << "Failed to map interest point file: " << name );
+        }
+        data = reinterpret_cast<uint8 const*>(ptr);
+      }
+      close(fd);
+    }
+    ~InterestPointMapping() {
+      if (data)
+        munmap(const_cast<uint8*>(data), size);
+    }
+#endif
+  };
+
+} // namespace detail
+
+namespace {
+
+  const char   MAPPED_MAGIC[8]   = {'V','W','I','P','M','A','P','\0'};
+  const uint32 MAPPED_BYTE_ORDER = 0x01020304;
+  const uint32 MAPPED_VERSION    = 1;
+  const size_t MAPPED_ALIGNMENT  = 64;
+
+  /// Aim for about this many points in each cell of the spatial index.
+  const size_t POINTS_PER_CELL = 16;
+  const int32  MAX_GRID_SIZE   = 4096;
+
+  struct FileHeader {
+    char   magic[8];
+    uint32 byte_order;
+    uint32 version;
+    uint64 num_sets;
+    // Followed by num_sets uint64 set header offsets.
+  };
+
+  // The columns of a set, in file order.
+  enum Column { COL_X = 0, COL_Y, COL_IX, COL_IY, COL_SCALE, COL_ORIENTATION,
+                COL_INTEREST, COL_POLARITY, COL_OCTAVE, COL_SCALE_LVL,
+                COL_DESCRIPTORS, COL_CELL_START, COL_CELL_POINTS, NUM_COLUMNS };
+
+  struct SetHeader {
+    uint64 num_points;
+    uint64 descriptor_length;
+    uint32 descriptor_type;
+    uint32 grid_cols, grid_rows;
+    uint32 reserved;
+    float  grid_min_x, grid_min_y, cell_width, cell_height;
+    uint64 offsets[NUM_COLUMNS]; // Relative to the start of the file
+  };
+
+  size_t align_offset(size_t offset) {
+    return (offset + MAPPED_ALIGNMENT - 1) / MAPPED_ALIGNMENT * MAPPED_ALIGNMENT;
+  }
+
+  size_t descriptor_element_size(uint32 type) {
+    return (type == MAPPED_DESCRIPTOR_UINT8) ? sizeof(uint8) : sizeof(float);
+  }
+
+  /// Grid cell of a coordinate, clamped to [0,count).
+  int32 grid_cell(float value, float grid_min, float cell_size, int32 count) {
+    const double cell = std::floor((double(value) - grid_min) / cell_size);
+    if (!(cell >= 0)) // Also catches NaN
+      return 0;
+    if (cell >= count)
+      return count-1;
+    return int32(cell);
+  }
+
+  /// The spatial index of one set.
+  struct SetIndex {
+    float  grid_min_x, grid_min_y, cell_width, cell_height;
+    int32  grid_cols, grid_rows;
+    std::vector<uint32> cell_start, cell_points;
+  };
+
+  /// Bin the points into a grid over their bounds.
+  template <class ElemT>
+  void build_index(InterestPointSetT<ElemT> const& ip, SetIndex & index) {
+    const size_t num_points = ip.size();
+    float min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+    bool  found = false;
+    for (size_t i = 0; i < num_points; ++i) {
+      const float x = ip.x(i), y = ip.y(i);
+      if (!std::isfinite(x) || !std::isfinite(y))
+        continue;
+      if (!found) {
+        min_x = max_x = x;
+        min_y = max_y = y;
+        found = true;
+        continue;
+      }
+      min_x = std::min(min_x, x);  max_x = std::max(max_x, x);
+      min_y = std::min(min_y, y);  max_y = std::max(max_y, y);
+    }
+
+    // Pick the grid shape from the aspect ratio of the bounds.
+    const double width  = std::max(double(max_x) - min_x, 1e-3);
+    const double height = std::max(double(max_y) - min_y, 1e-3);
+    const double num_cells = std::max(1.0, double(num_points) / POINTS_PER_CELL);
+    index.grid_cols = int32(std::ceil(std::sqrt(num_cells * width / height)));
+    index.grid_cols = std::max(1, std::min(MAX_GRID_SIZE, index.grid_cols));
+    index.grid_rows = int32(std::ceil(num_cells / index.grid_cols));
+    index.grid_rows = std::max(1, std::min(MAX_GRID_SIZE, index.grid_rows));
+    index.grid_min_x  = min_x;
+    index.grid_min_y  = min_y;
+    index.cell_width  = float(width  / index.grid_cols);
+    index.cell_height = float(height / index.grid_rows);
+
+    // Counting sort of the points by cell.
+    const size_t total_cells = size_t(index.grid_cols) * index.grid_rows;
+    std::vector<uint32> cells(num_points);
+    index.cell_start.assign(total_cells+1, 0);
+    for (size_t i = 0; i < num_points; ++i) {
+      const int32 col = grid_cell(ip.x(i), index.grid_min_x, index.cell_width,  index.grid_cols);
+      const int32 row = grid_cell(ip.y(i), index.grid_min_y, index.cell_height, index.grid_rows);
+      cells[i] = uint32(row)*index.grid_cols + col;
+      ++index.cell_start[cells[i]+1];
+    }
+    for (size_t c = 0; c < total_cells; ++c)
+      index.cell_start[c+1] += index.cell_start[c];
+    std::vector<uint32> next(index.cell_start.begin(), index.cell_start.end()-1);
+    index.cell_points.resize(num_points);
+    for (size_t i = 0; i < num_points; ++i)
+      index.cell_points[next[cells[i]]++] = uint32(i);
+  }
+
+  /// Sizes in bytes of the columns of a set.
+  void column_sizes(uint64 num_points, uint64 descriptor_length, uint32 descriptor_type,
+                    uint64 total_cells, uint64 sizes[NUM_COLUMNS]) {
+    sizes[COL_X          ] = num_points * sizeof(float );
+    sizes[COL_Y          ] = num_points * sizeof(float );
+    sizes[COL_IX         ] = num_points * sizeof(int32 );
+    sizes[COL_IY         ] = num_points * sizeof(int32 );
+    sizes[COL_SCALE      ] = num_points * sizeof(float );
+    sizes[COL_ORIENTATION] = num_points * sizeof(float );
+    sizes[COL_INTEREST   ] = num_points * sizeof(float );
+    sizes[COL_POLARITY   ] = num_points * sizeof(uint8 );
+    sizes[COL_OCTAVE     ] = num_points * sizeof(uint32);
+    sizes[COL_SCALE_LVL  ] = num_points * sizeof(uint32);
+    sizes[COL_DESCRIPTORS] = num_points * descriptor_length * descriptor_element_size(descriptor_type);
+    sizes[COL_CELL_START ] = (total_cells+1) * sizeof(uint32);
+    sizes[COL_CELL_POINTS] = num_points * sizeof(uint32);
+  }
+
+  /// Writes data at the given offset, padding with zeros from the current position.
+  void write_at(std::ofstream & f, uint64 offset, const void* data, size_t size) {
+    static const char zeros[MAPPED_ALIGNMENT] = {0};
+    uint64 position = f.tellp();
+    VW_ASSERT(position <= offset, LogicErr() << "Mapped interest point file layout is out of order.");
+    for ( ; position < offset; position += MAPPED_ALIGNMENT)
+      f.write(zeros, std::min(uint64(MAPPED_ALIGNMENT), offset - position));
+    if (size > 0)
+      f.write(reinterpret_cast<const char*>(data), size);
+  }
+
+  /// Lay out and write one set starting at the aligned offset.
+  /// - Returns the offset just past the end of the set.
+  template <class ElemT>
+  uint64 write_set(std::ofstream & f, uint64 offset, InterestPointSetT<ElemT> const& ip) {
+    if (ip.size() >= std::numeric_limits<uint32>::max())
+      vw_throw( ArgumentErr() << "Too many interest points for a mapped interest point file." );
+
+    SetIndex index;
+    build_index(ip, index);
+
+    SetHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.num_points        = ip.size();
+    header.descriptor_length = ip.descriptor_length();
+    header.descriptor_type   = boost::is_same<ElemT, uint8>::value ? MAPPED_DESCRIPTOR_UINT8
+                                                                   : MAPPED_DESCRIPTOR_FLOAT32;
+    header.grid_cols   = index.grid_cols;
+    header.grid_rows   = index.grid_rows;
+    header.grid_min_x  = index.grid_min_x;
+    header.grid_min_y  = index.grid_min_y;
+    header.cell_width  = index.cell_width;
+    header.cell_height = index.cell_height;
+
+    uint64 sizes[NUM_COLUMNS];
+    column_sizes(header.num_points, header.descriptor_length, header.descriptor_type,
+                 index.cell_start.size()-1, sizes);
+    uint64 next = align_offset(offset + sizeof(SetHeader));
+    for (size_t c = 0; c < NUM_COLUMNS; ++c) {
+      header.offsets[c] = next;
+      next = align_offset(next + sizes[c]);
+    }
+
+    const void* columns[NUM_COLUMNS] = {
+      ip.x_data(), ip.y_data(), ip.ix_data(), ip.iy_data(), ip.scale_data(),
+      ip.orientation_data(), ip.interest_data(), ip.polarity_data(), ip.octave_data(),
+      ip.scale_lvl_data(), ip.descriptor_data(), &index.cell_start[0],
+      index.cell_points.empty() ? 0 : &index.cell_points[0] };
+
+    write_at(f, offset, &header, sizeof(header));
+    for (size_t c = 0; c < NUM_COLUMNS; ++c)
+      write_at(f, header.offsets[c], columns[c], sizes[c]);
+    return next;
+  }
+
+  template <class ElemT>
+  void write_mapped_sets(std::string const& filename,
+                         std::vector<InterestPointSetT<ElemT> const*> const& sets) {
+    std::ofstream f(filename.c_str(), std::ios::binary | std::ios::out);
+    if (!f.is_open())
+      vw_throw( IOErr() << "Failed to open \"" << filename << "\" for writing." );
+
+    FileHeader header;
+    std::memcpy(header.magic, MAPPED_MAGIC, sizeof(header.magic));
+    header.byte_order = MAPPED_BYTE_ORDER;
+    header.version    = MAPPED_VERSION;
+    header.num_sets   = sets.size();
+    f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Write the offset table last, once the set sizes are known.
+    std::vector<uint64> offsets(sets.size());
+    uint64 next = align_offset(sizeof(FileHeader) + offsets.size()*sizeof(uint64));
+    for (size_t s = 0; s < sets.size(); ++s) {
+      offsets[s] = next;
+      next = write_set(f, next, *sets[s]);
+    }
+    write_at(f, next, 0, 0); // Pad the last column
+    f.seekp(sizeof(FileHeader));
+    f.write(reinterpret_cast<const char*>(&offsets[0]), offsets.size()*sizeof(uint64));
+    if (!f)
+      vw_throw( IOErr() << "Failed to write mapped interest point file: " << filename );
+  }
+
+  /// Returns true if [offset, offset+size) lies within the file.
+  bool in_file(uint64 offset, uint64 size, uint64 file_size) {
+    return offset <= file_size && size <= file_size - offset;
+  }
+
+} // end anonymous namespace
+
+  //------------------------------------------------------------------------
+  // MappedInterestPointSet
+
+  MappedInterestPointSet::MappedInterestPointSet()
+    : m_size(0), m_descriptor_length(0), m_descriptor_type(MAPPED_DESCRIPTOR_FLOAT32),
+      m_x(0), m_y(0), m_ix(0), m_iy(0), m_scale(0), m_orientation(0), m_interest(0),
+      m_polarity(0), m_octave(0), m_scale_lvl(0), m_descriptors(0),
+      m_grid_min_x(0), m_grid_min_y(0), m_cell_width(1), m_cell_height(1),
+      m_grid_cols(0), m_grid_rows(0), m_cell_start(0), m_cell_points(0) {}
+
+  void MappedInterestPointSet::check_descriptor_type(MappedDescriptorType type) const {
+    if (type != m_descriptor_type)
+      vw_throw( ArgumentErr() << "MappedInterestPointSet: The descriptors are stored as "
+                              << (m_descriptor_type == MAPPED_DESCRIPTOR_UINT8 ? "uint8" : "float")
+                              << " values.\n" );
+  }
+
+  float MappedInterestPointSet::descriptor_value(size_t i, size_t k) const {
+    const size_t index = i*m_descriptor_length + k;
+    if (m_descriptor_type == MAPPED_DESCRIPTOR_UINT8)
+      return m_descriptors[index];
+    return reinterpret_cast<float const*>(m_descriptors)[index];
+  }
+
+  InterestPoint MappedInterestPointSet::point(size_t i, bool with_descriptor) const {
+    InterestPoint result(m_x[i], m_y[i], m_scale[i], m_interest[i], m_orientation[i],
+                         m_polarity[i] != 0, m_octave[i], m_scale_lvl[i]);
+    result.ix = m_ix[i];
+    result.iy = m_iy[i];
+    if (with_descriptor) {
+      result.descriptor.set_size(m_descriptor_length);
+      for (size_t k = 0; k < m_descriptor_length; ++k)
+        result.descriptor[k] = descriptor_value(i, k);
+    }
+    return result;
+  }
+
+  bool MappedInterestPointSet::cell_range(double min_x, double min_y, double max_x, double max_y,
+                                          int32 & col_begin, int32 & row_begin,
+                                          int32 & col_end,   int32 & row_end) const {
+    // Cells are widened by one on each side so points which were binned
+    //  in single precision are never missed.
+    double c0 = std::floor((min_x - m_grid_min_x) / m_cell_width ) - 1;
+    double c1 = std::floor((max_x - m_grid_min_x) / m_cell_width ) + 1;
+    double r0 = std::floor((min_y - m_grid_min_y) / m_cell_height) - 1;
+    double r1 = std::floor((max_y - m_grid_min_y) / m_cell_height) + 1;
+    if (!(c1 >= 0 && r1 >= 0 && c0 < m_grid_cols && r0 < m_grid_rows))
+      return false; // Also catches NaN
+    col_begin = int32(std::max(c0, 0.0));
+    row_begin = int32(std::max(r0, 0.0));
+    col_end   = int32(std::min(c1, double(m_grid_cols-1)));
+    row_end   = int32(std::min(r1, double(m_grid_rows-1)));
+    return true;
+  }
+
+  //------------------------------------------------------------------------
+  // MappedInterestPointFile
+
+  MappedInterestPointFile::MappedInterestPointFile(std::string const& filename)
+    : m_mapping(new detail::InterestPointMapping(filename)) {
+    uint8 const* data      = m_mapping->data;
+    const uint64 file_size = m_mapping->size;
+
+    FileHeader header;
+    if (file_size < sizeof(header))
+      vw_throw( IOErr() << filename << " is not a mapped interest point file." );
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAPPED_MAGIC, sizeof(MAPPED_MAGIC)) != 0)
+      vw_throw( IOErr() << filename << " is not a mapped interest point file." );
+    if (header.byte_order != MAPPED_BYTE_ORDER)
+      vw_throw( IOErr() << filename << " was written on a machine with a different byte order." );
+    if (header.version != MAPPED_VERSION)
+      vw_throw( IOErr() << filename << " has unsupported version " << header.version
+                        << ", this build reads version " << MAPPED_VERSION << "." );
+    if (header.num_sets > file_size ||
+        !in_file(sizeof(header), header.num_sets*sizeof(uint64), file_size))
+      vw_throw( IOErr() << "Mapped interest point file " << filename << " is truncated." );
+
+    std::vector<uint64> offsets(header.num_sets);
+    if (!offsets.empty())
+      std::memcpy(&offsets[0], data + sizeof(header), offsets.size()*sizeof(uint64));
+
+    m_sets.resize(header.num_sets);
+    for (size_t s = 0; s < offsets.size(); ++s) {
+      if (offsets[s] % MAPPED_ALIGNMENT != 0 || !in_file(offsets[s], sizeof(SetHeader), file_size))
+        vw_throw( IOErr() << "Mapped interest point file " << filename << " is corrupt." );
+      SetHeader const& sh = *reinterpret_cast<SetHeader const*>(data + offsets[s]);
+
+      const uint64 total_cells = uint64(sh.grid_cols) * sh.grid_rows;
+      if (sh.descriptor_type > MAPPED_DESCRIPTOR_UINT8 ||
+          sh.num_points >= std::numeric_limits<uint32>::max() ||
+          (sh.num_points > 0 && sh.descriptor_length > file_size / sh.num_points) ||
+          sh.grid_cols == 0 || sh.grid_rows == 0 ||
+          sh.grid_cols > uint32(MAX_GRID_SIZE) || sh.grid_rows > uint32(MAX_GRID_SIZE) ||
+          !(sh.cell_width > 0) || !(sh.cell_height > 0))
+        vw_throw( IOErr() << "Mapped interest point file " << filename << " is corrupt." );
+
+      uint64 sizes[NUM_COLUMNS];
+      column_sizes(sh.num_points, sh.descriptor_length, sh.descriptor_type, total_cells, sizes);
+      for (size_t c = 0; c < NUM_COLUMNS; ++c) {
+        if (sh.offsets[c] % MAPPED_ALIGNMENT != 0 || !in_file(sh.offsets[c], sizes[c], file_size))
+          vw_throw( IOErr() << "Mapped interest point file " << filename << " is truncated." );
+      }
+
+      MappedInterestPointSet & set = m_sets[s];
+      set.m_mapping           = m_mapping;
+      set.m_size              = sh.num_points;
+      set.m_descriptor_length = sh.descriptor_length;
+      set.m_descriptor_type   = MappedDescriptorType(sh.descriptor_type);
+      set.m_x           = reinterpret_cast<float  const*>(data + sh.offsets[COL_X          ]);
+      set.m_y           = reinterpret_cast<float  const*>(data + sh.offsets[COL_Y          ]);
+      set.m_ix          = reinterpret_cast<int32  const*>(data + sh.offsets[COL_IX         ]);
+      set.m_iy          = reinterpret_cast<int32  const*>(data + sh.offsets[COL_IY         ]);
+      set.m_scale       = reinterpret_cast<float  const*>(data + sh.offsets[COL_SCALE      ]);
+      set.m_orientation = reinterpret_cast<float  const*>(data + sh.offsets[COL_ORIENTATION]);
+      set.m_interest    = reinterpret_cast<float  const*>(data + sh.offsets[COL_INTEREST   ]);
+      set.m_polarity    = reinterpret_cast<uint8  const*>(data + sh.offsets[COL_POLARITY   ]);
+      set.m_octave      = reinterpret_cast<uint32 const*>(data + sh.offsets[COL_OCTAVE     ]);
+      set.m_scale_lvl   = reinterpret_cast<uint32 const*>(data + sh.offsets[COL_SCALE_LVL  ]);
+      set.m_descriptors = data + sh.offsets[COL_DESCRIPTORS];
+      set.m_grid_min_x  = sh.grid_min_x;
+      set.m_grid_min_y  = sh.grid_min_y;
+      set.m_cell_width  = sh.cell_width;
+      set.m_cell_height = sh.cell_height;
+      set.m_grid_cols   = sh.grid_cols;
+      set.m_grid_rows   = sh.grid_rows;
+      set.m_cell_start  = reinterpret_cast<uint32 const*>(data + sh.offsets[COL_CELL_START ]);
+      set.m_cell_points = reinterpret_cast<uint32 const*>(data + sh.offsets[COL_CELL_POINTS]);
+
+      // The cell table is small, check it here so queries stay in bounds.
+      // The point indices of the cells are checked as queries read them.
+      if (set.m_cell_start[0] != 0 || set.m_cell_start[total_cells] != sh.num_points)
+        vw_throw( IOErr() << "Mapped interest point file " << filename << " is corrupt." );
+      for (size_t c = 0; c < total_cells; ++c)
+        if (set.m_cell_start[c] > set.m_cell_start[c+1])
+          vw_throw( IOErr() << "Mapped interest point file " << filename << " is corrupt." );
+    }
+  }
+
+  std::string const& MappedInterestPointFile::filename() const {
+    return m_mapping->filename;
+  }
+
+  MappedInterestPointSet const& MappedInterestPointFile::set(size_t i) const {
+    VW_ASSERT(i < m_sets.size(),
+              ArgumentErr() << "MappedInterestPointFile: " << filename() << " has only "
+                            << m_sets.size() << " interest point sets.\n");
+    return m_sets[i];
+  }
+
+  bool is_mapped_ip_file(std::string const& filename) {
+    std::ifstream f(filename.c_str(), std::ios::binary | std::ios::in);
+    char magic[sizeof(MAPPED_MAGIC)];
+    if (!f.read(magic, sizeof(magic)))
+      return false;
+    return std::memcmp(magic, MAPPED_MAGIC, sizeof(MAPPED_MAGIC)) == 0;
+  }
+
+  template <class ElemT>
+  void write_mapped_ip_file(std::string ip_file, InterestPointSetT<ElemT> const& ip) {
+    std::vector<InterestPointSetT<ElemT> const*> sets(1, &ip);
+    write_mapped_sets(ip_file, sets);
+  }
+
+  template <class ElemT>
+  void write_mapped_match_file(std::string match_file, InterestPointSetT<ElemT> const& ip1,
+                               InterestPointSetT<ElemT> const& ip2) {
+    std::vector<InterestPointSetT<ElemT> const*> sets;
+    sets.push_back(&ip1);
+    sets.push_back(&ip2);
+    write_mapped_sets(match_file, sets);
+  }
+
+  template void write_mapped_ip_file   (std::string, InterestPointSetT<float> const&);
+  template void write_mapped_ip_file   (std::string, InterestPointSetT<uint8> const&);
+  template void write_mapped_match_file(std::string, InterestPointSetT<float> const&,
+                                        InterestPointSetT<float> const&);
+  template void write_mapped_match_file(std::string, InterestPointSetT<uint8> const&,
+                                        InterestPointSetT<uint8> const&);
+
+}} // namespace vw::ip
@@ -0,0 +1,262 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file InterestPointFile.h
+///
+/// A memory mapped file format for interest points and matches.
+///
+/// The original .vwip and .match files store one variable length record per
+/// point, so they must be parsed point by point.  Files in this format hold
+/// one or more interest point sets (one for a .vwip file, two for a .match
+/// file) laid out so they can be used straight from a memory mapping:
+///
+///   File header   magic "VWIPMAP", byte order tag, version, set count and
+///                 the offset of each set.
+///   Set header    point count, descriptor length and type, the offset of
+///                 each column and the spatial index grid.
+///   Columns       x, y, ix, iy, scale, orientation, interest, polarity,
+///                 octave, scale_lvl and the row major descriptor block.
+///   Index         a grid over the point bounds, storing per cell the
+///                 indices of the points inside it.
+///
+/// Every column starts on a 64 byte boundary.  Values are stored in the byte
+/// order of the writing machine and files of the other byte order are
+/// rejected.  The readers for the original formats in InterestData.h also
+/// accept these files.
+///
+#ifndef __VW_INTERESTPOINT_INTEREST_POINT_FILE_H__
+#define __VW_INTERESTPOINT_INTEREST_POINT_FILE_H__
+
+#include <algorithm>
+#include <vector>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Math/BBox.h>
+#include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+
+namespace vw {
+namespace ip {
+
+  /// The element type of the descriptors in a mapped set.
+  enum MappedDescriptorType {
+    MAPPED_DESCRIPTOR_FLOAT32 = 0,
+    MAPPED_DESCRIPTOR_UINT8   = 1
+  };
+
+  namespace detail { struct InterestPointMapping; }
+
+  /// A read only view of one interest point set in a mapped file.
+  /// - The view keeps the mapping open, so it stays valid after the
+  ///   MappedInterestPointFile it came from is destroyed.
+  class MappedInterestPointSet {
+  public:
+    MappedInterestPointSet();
+
+    size_t size() const { return m_size; }
+    bool   empty() const { return m_size == 0; }
+    size_t descriptor_length() const { return m_descriptor_length; }
+    MappedDescriptorType descriptor_type() const { return m_descriptor_type; }
+
+    // Whole columns, pointing into the mapping.
+    float  const* x_data          () const { return m_x;           }
+    float  const* y_data          () const { return m_y;           }
+    int32  const* ix_data         () const { return m_ix;          }
+    int32  const* iy_data         () const { return m_iy;          }
+    float  const* scale_data      () const { return m_scale;       }
+    float  const* orientation_data() const { return m_orientation; }
+    float  const* interest_data   () const { return m_interest;    }
+    uint8  const* polarity_data   () const { return m_polarity;    }
+    uint32 const* octave_data     () const { return m_octave;      }
+    uint32 const* scale_lvl_data  () const { return m_scale_lvl;   }
+
+    /// The descriptor block, size() rows of descriptor_length() elements.
+    /// - ElemT must match descriptor_type().
+    template <class ElemT>
+    ElemT const* descriptor_data() const {
+      check_descriptor_type(descriptor_type_of((ElemT*)0));
+      return reinterpret_cast<ElemT const*>(m_descriptors);
+    }
+
+    /// Return point i as an InterestPoint, optionally leaving out the descriptor.
+    InterestPoint point(size_t i, bool with_descriptor = true) const;
+
+    /// Copy all points into an in memory set, converting the descriptors
+    ///  to ElemT if needed.
+    template <class ElemT>
+    void copy_to(InterestPointSetT<ElemT> & set) const;
+
+    /// Copy all points into a list or vector of InterestPoints.
+    template <class ListT>
+    void to_list(ListT & points) const {
+      points.clear();
+      for (size_t i = 0; i < size(); ++i)
+        points.push_back(point(i));
+    }
+
+    /// Find the points which fall within bbox, with the same semantics as
+    ///  ip::crop().  The indices are returned in increasing order.
+    /// - Only the grid cells touching bbox are visited.
+    template <class RealT>
+    void crop_indices(BBox<RealT,2> const& bbox, std::vector<size_t> & indices) const;
+
+    /// Copy the points which fall within bbox into an in memory set, in file order.
+    template <class ElemT, class RealT>
+    void crop(BBox<RealT,2> const& bbox, InterestPointSetT<ElemT> & set) const;
+
+  private:
+    friend class MappedInterestPointFile;
+
+    static MappedDescriptorType descriptor_type_of(float*) { return MAPPED_DESCRIPTOR_FLOAT32; }
+    static MappedDescriptorType descriptor_type_of(uint8*) { return MAPPED_DESCRIPTOR_UINT8;   }
+    void check_descriptor_type(MappedDescriptorType type) const;
+
+    /// Descriptor element k of point i as a float.
+    float descriptor_value(size_t i, size_t k) const;
+
+    /// Convert a query range to an inclusive range of grid cells,
+    ///  returning false if it misses the grid.
+    bool cell_range(double min_x, double min_y, double max_x, double max_y,
+                    int32 & col_begin, int32 & row_begin,
+                    int32 & col_end,   int32 & row_end) const;
+
+    boost::shared_ptr<detail::InterestPointMapping const> m_mapping;
+    size_t m_size, m_descriptor_length;
+    MappedDescriptorType m_descriptor_type;
+    float  const *m_x, *m_y;
+    int32  const *m_ix, *m_iy;
+    float  const *m_scale, *m_orientation, *m_interest;
+    uint8  const *m_polarity;
+    uint32 const *m_octave, *m_scale_lvl;
+    uint8  const *m_descriptors;
+
+    // Spatial index: the points of cell (col,row) are
+    //  m_cell_points[m_cell_start[row*m_grid_cols+col] .. m_cell_start[row*m_grid_cols+col+1]).
+    float  m_grid_min_x, m_grid_min_y, m_cell_width, m_cell_height;
+    int32  m_grid_cols, m_grid_rows;
+    uint32 const *m_cell_start, *m_cell_points;
+  }; // End class MappedInterestPointSet
+
+  /// A memory mapped interest point file.
+  /// - Opening the file only maps it and checks the headers.
+  class MappedInterestPointFile {
+  public:
+    explicit MappedInterestPointFile(std::string const& filename);
+
+    std::string const& filename() const;
+
+    /// One for an interest point file, two for a match file.
+    size_t num_sets() const { return m_sets.size(); }
+    MappedInterestPointSet const& set(size_t i) const;
+    MappedInterestPointSet const& operator[](size_t i) const { return set(i); }
+
+  private:
+    boost::shared_ptr<detail::InterestPointMapping const> m_mapping;
+    std::vector<MappedInterestPointSet> m_sets;
+  }; // End class MappedInterestPointFile
+
+  /// Returns true if the file starts with the mapped file magic.
+  bool is_mapped_ip_file(std::string const& filename);
+
+  // Routines for writing mapped interest point and match files.
+  template <class ElemT>
+  void write_mapped_ip_file   (std::string ip_file, InterestPointSetT<ElemT> const& ip);
+  template <class ElemT>
+  void write_mapped_match_file(std::string match_file, InterestPointSetT<ElemT> const& ip1,
+                               InterestPointSetT<ElemT> const& ip2);
+
+//==========================================================================
+// Function definitions
+
+template <class ElemT>
+void MappedInterestPointSet::copy_to(InterestPointSetT<ElemT> & set) const {
+  set = InterestPointSetT<ElemT>(m_descriptor_length);
+  set.resize(m_size);
+  for (size_t i = 0; i < m_size; ++i) {
+    set.x(i)           = m_x[i];
+    set.y(i)           = m_y[i];
+    set.ix(i)          = m_ix[i];
+    set.iy(i)          = m_iy[i];
+    set.scale(i)       = m_scale[i];
+    set.orientation(i) = m_orientation[i];
+    set.interest(i)    = m_interest[i];
+    set.polarity(i)    = m_polarity[i];
+    set.octave(i)      = m_octave[i];
+    set.scale_lvl(i)   = m_scale_lvl[i];
+  }
+  if (m_size == 0 || m_descriptor_length == 0)
+    return;
+  if (m_descriptor_type == descriptor_type_of((ElemT*)0)) {
+    std::copy(reinterpret_cast<ElemT const*>(m_descriptors),
+              reinterpret_cast<ElemT const*>(m_descriptors) + m_size*m_descriptor_length,
+              set.descriptor_data());
+    return;
+  }
+  for (size_t i = 0; i < m_size; ++i) {
+    ElemT* out = set.descriptor(i);
+    for (size_t k = 0; k < m_descriptor_length; ++k)
+      out[k] = static_cast<ElemT>(descriptor_value(i, k));
+  }
+}
+
+template <class RealT>
+void MappedInterestPointSet::crop_indices(BBox<RealT,2> const& bbox,
+                                          std::vector<size_t> & indices) const {
+  indices.clear();
+  if (m_size == 0 || bbox.empty())
+    return;
+  int32 col_begin, row_begin, col_end, row_end;
+  if (!cell_range(bbox.min()[0], bbox.min()[1], bbox.max()[0], bbox.max()[1],
+                  col_begin, row_begin, col_end, row_end))
+    return;
+  for (int32 row = row_begin; row <= row_end; ++row) {
+    for (int32 col = col_begin; col <= col_end; ++col) {
+      const size_t cell = size_t(row)*m_grid_cols + col;
+      for (uint32 k = m_cell_start[cell]; k < m_cell_start[cell+1]; ++k) {
+        const uint32 i = m_cell_points[k];
+        if (i >= m_size)
+          vw_throw( IOErr() << "Corrupt spatial index in mapped interest point file." );
+        if (bbox.contains(Vector<RealT,2>(RealT(m_x[i]), RealT(m_y[i]))))
+          indices.push_back(i);
+      }
+    }
+  }
+  std::sort(indices.begin(), indices.end());
+}
+
+template <class ElemT, class RealT>
+void MappedInterestPointSet::crop(BBox<RealT,2> const& bbox, InterestPointSetT<ElemT> & set) const {
+  std::vector<size_t> indices;
+  crop_indices(bbox, indices);
+  set = InterestPointSetT<ElemT>(m_descriptor_length);
+  set.reserve(indices.size());
+  for (size_t j = 0; j < indices.size(); ++j) {
+    set.push_back(point(indices[j], false));
+    if (m_descriptor_length == 0)
+      continue;
+    ElemT* out = set.descriptor(j);
+    for (size_t k = 0; k < m_descriptor_length; ++k)
+      out[k] = static_cast<ElemT>(descriptor_value(indices[j], k));
+  }
+}
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_INTEREST_POINT_FILE_H__
@@ -0,0 +1,200 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file InterestPointSet.cc
+///
+/// File I/O for interest point sets.
+///
+#include <fstream>
+#include <vw/InterestPoint/InterestPointSet.h>
+#include <vw/InterestPoint/InterestPointFile.h>
+
+namespace vw {
+namespace ip {
+
+namespace {
+
+  /// Write the points as the same records that write_ip_record() produces.
+  template <class ElemT>
+  void write_set_records(std::ofstream &f, InterestPointSetT<ElemT> const& ip) {
+    const uint64 size = ip.descriptor_length();
+    std::vector<float> descriptor(size);
+    for (size_t i = 0; i < ip.size(); ++i) {
+      const bool polarity = ip.polarity(i) != 0;
+      f.write((char*)&(ip.x_data          ()[i]), sizeof(float ));
+      f.write((char*)&(ip.y_data          ()[i]), sizeof(float ));
+      f.write((char*)&(ip.ix_data         ()[i]), sizeof(int32 ));
+      f.write((char*)&(ip.iy_data         ()[i]), sizeof(int32 ));
+      f.write((char*)&(ip.orientation_data()[i]), sizeof(float ));
+      f.write((char*)&(ip.scale_data      ()[i]), sizeof(float ));
+      f.write((char*)&(ip.interest_data   ()[i]), sizeof(float ));
+      f.write((char*)&polarity,                   sizeof(bool  ));
+      f.write((char*)&(ip.octave_data     ()[i]), sizeof(uint32));
+      f.write((char*)&(ip.scale_lvl_data  ()[i]), sizeof(uint32));
+      f.write((char*)&size, sizeof(uint64));
+      if (size == 0)
+        continue;
+      std::copy(ip.descriptor(i), ip.descriptor(i)+size, descriptor.begin());
+      f.write((char*)&descriptor[0], size*sizeof(float));
+    }
+  }
+
+  /// Read count records written by write_ip_record() into ip.
+  /// - All records must have the same descriptor length.
+  template <class ElemT>
+  void read_set_records(std::ifstream &f, uint64 count, InterestPointSetT<ElemT> & ip,
+                        std::string const& file) {
+    ip.set_descriptor_length(0);
+    ip.clear();
+    std::vector<float> descriptor;
+    for (size_t i = 0; i < count; ++i) {
+      float  x, y, orientation, scale, interest;
+      int32  ix, iy;
+      bool   polarity;
+      uint32 octave, scale_lvl;
+      uint64 size;
+      f.read((char*)&x,           sizeof(x));
+      f.read((char*)&y,           sizeof(y));
+      f.read((char*)&ix,          sizeof(ix));
+      f.read((char*)&iy,          sizeof(iy));
+      f.read((char*)&orientation, sizeof(orientation));
+      f.read((char*)&scale,       sizeof(scale));
+      f.read((char*)&interest,    sizeof(interest));
+      f.read((char*)&polarity,    sizeof(polarity));
+      f.read((char*)&octave,      sizeof(octave));
+      f.read((char*)&scale_lvl,   sizeof(scale_lvl));
+      f.read((char*)&size,        sizeof(size));
+      if (!f)
+        vw_throw( IOErr() << "Unexpected end of interest point file: " << file );
+
+      if (i == 0) { // Now the size of the set is known
+        ip.set_descriptor_length(size);
+        ip.resize(count);
+        descriptor.resize(size);
+      }
+      if (size != ip.descriptor_length())
+        vw_throw( IOErr() << "Interest points in " << file
+                          << " have different descriptor lengths, load them as a list instead." );
+
+      ip.x(i)           = x;
+      ip.y(i)           = y;
+      ip.ix(i)          = ix;
+      ip.iy(i)          = iy;
+      ip.orientation(i) = orientation;
+      ip.scale(i)       = scale;
+      ip.interest(i)    = interest;
+      ip.polarity(i)    = polarity;
+      ip.octave(i)      = octave;
+      ip.scale_lvl(i)   = scale_lvl;
+      if (size == 0)
+        continue;
+      f.read((char*)&descriptor[0], size*sizeof(float));
+      ElemT* out = ip.descriptor(i);
+      for (size_t k = 0; k < size; ++k)
+        out[k] = static_cast<ElemT>(descriptor[k]);
+    }
+    if (!f)
+      vw_throw( IOErr() << "Unexpected end of interest point file: " << file );
+  }
+
+} // end anonymous namespace
+
+  template <class ElemT>
+  void write_binary_ip_file(std::string ip_file, InterestPointSetT<ElemT> const& ip) {
+    std::ofstream f;
+    f.open(ip_file.c_str(), std::ios::binary | std::ios::out);
+    uint64 size = ip.size();
+    f.write((char*)&size, sizeof(uint64));
+    write_set_records(f, ip);
+    f.close();
+  }
+
+  template <class ElemT>
+  void read_binary_ip_file(std::string ip_file, InterestPointSetT<ElemT> & ip) {
+    if (is_mapped_ip_file(ip_file)) {
+      MappedInterestPointFile file(ip_file);
+      if (file.num_sets() != 1)
+        vw_throw( IOErr() << ip_file << " does not contain a single set of interest points." );
+      file[0].copy_to(ip);
+      return;
+    }
+
+    std::ifstream f;
+    f.open(ip_file.c_str(), std::ios::binary | std::ios::in);
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << ip_file << "\" as VWIP file." );
+
+    uint64 size;
+    f.read((char*)&size, sizeof(uint64));
+    read_set_records(f, size, ip, ip_file);
+    f.close();
+  }
+
+  template <class ElemT>
+  void write_binary_match_file(std::string match_file, InterestPointSetT<ElemT> const& ip1,
+                               InterestPointSetT<ElemT> const& ip2) {
+    std::ofstream f;
+    f.open(match_file.c_str(), std::ios::binary | std::ios::out);
+    uint64 size1 = ip1.size();
+    uint64 size2 = ip2.size();
+    f.write((char*)&size1, sizeof(uint64));
+    f.write((char*)&size2, sizeof(uint64));
+    write_set_records(f, ip1);
+    write_set_records(f, ip2);
+    f.close();
+  }
+
+  template <class ElemT>
+  void read_binary_match_file(std::string match_file, InterestPointSetT<ElemT> & ip1,
+                              InterestPointSetT<ElemT> & ip2) {
+    if (is_mapped_ip_file(match_file)) {
+      MappedInterestPointFile file(match_file);
+      if (file.num_sets() != 2)
+        vw_throw( IOErr() << match_file << " does not contain a pair of interest point sets." );
+      file[0].copy_to(ip1);
+      file[1].copy_to(ip2);
+      return;
+    }
+
+    std::ifstream f;
+    f.open(match_file.c_str(), std::ios::binary | std::ios::in);
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open match file: " << match_file );
+
+    uint64 size1, size2;
+    f.read((char*)&size1, sizeof(uint64));
+    f.read((char*)&size2, sizeof(uint64));
+    read_set_records(f, size1, ip1, match_file);
+    read_set_records(f, size2, ip2, match_file);
+    f.close();
+  }
+
+#define VW_INSTANTIATE_IP_SET_IO(ElemT)                                                    \
+  template void write_binary_ip_file   (std::string, InterestPointSetT<ElemT> const&);     \
+  template void read_binary_ip_file    (std::string, InterestPointSetT<ElemT> &);          \
+  template void write_binary_match_file(std::string, InterestPointSetT<ElemT> const&,      \
+                                        InterestPointSetT<ElemT> const&);                  \
+  template void read_binary_match_file (std::string, InterestPointSetT<ElemT> &,           \
+                                        InterestPointSetT<ElemT> &);
+
+  VW_INSTANTIATE_IP_SET_IO(float)
+  VW_INSTANTIATE_IP_SET_IO(uint8)
+
+#undef VW_INSTANTIATE_IP_SET_IO
+
+}} // namespace vw::ip
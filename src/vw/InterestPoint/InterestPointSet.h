@@ -0,0 +1,301 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file InterestPointSet.h
+///
+/// Column oriented storage for large numbers of interest points.
+///
+#ifndef __VW_INTERESTPOINT_INTEREST_POINT_SET_H__
+#define __VW_INTERESTPOINT_INTEREST_POINT_SET_H__
+
+#include <vector>
+#include <string>
+
+#include <vw/Core/Exception.h>
+#include <vw/InterestPoint/InterestData.h>
+
+#include <boost/align/aligned_allocator.hpp>
+
+namespace vw {
+namespace ip {
+
+  /// A set of interest points stored as one array per field.
+  /// - All the descriptors are in one contiguous, row major block with
+  ///   descriptor_length() elements per point, so it can be handed to a
+  ///   matcher without being repacked.
+  /// - ElemT is float for floating point descriptors and uint8 for binary
+  ///   descriptors, which InterestPoint stores as one byte value per float.
+  /// - Use the list and vector conversions to work with code which still
+  ///   expects InterestPoint objects.
+  template <class ElemT>
+  class InterestPointSetT {
+  public:
+    typedef ElemT descriptor_element_type;
+
+    /// The descriptor block starts on a boundary of this many bytes.
+    static const size_t DESCRIPTOR_ALIGNMENT = 64;
+    typedef std::vector<ElemT, boost::alignment::aligned_allocator<ElemT, DESCRIPTOR_ALIGNMENT> >
+      descriptor_storage_type;
+
+    explicit InterestPointSetT(size_t descriptor_length = 0) : m_descriptor_length(descriptor_length) {}
+
+    /// Copy a list or vector of InterestPoint objects.
+    /// - All points must have the same descriptor length.
+    explicit InterestPointSetT(InterestPointList const& points) : m_descriptor_length(0) {
+      assign(points.begin(), points.end());
+    }
+    explicit InterestPointSetT(std::vector<InterestPoint> const& points) : m_descriptor_length(0) {
+      assign(points.begin(), points.end());
+    }
+
+    size_t size () const { return m_x.size(); }
+    bool   empty() const { return m_x.empty(); }
+    size_t descriptor_length() const { return m_descriptor_length; }
+
+    void reserve(size_t num_points);
+
+    /// Change the number of points, new points are default InterestPoints
+    ///  with a zero descriptor.
+    void resize(size_t num_points);
+
+    /// Remove all points, the descriptor length is kept.
+    void clear() { resize(0); }
+
+    /// Change the descriptor length, clearing all descriptors to zero.
+    void set_descriptor_length(size_t descriptor_length);
+
+    /// Append a point, its descriptor must be empty or have descriptor_length() elements.
+    /// - The descriptor length of an empty set is taken from the first point.
+    void push_back(InterestPoint const& point);
+
+    /// Append point i of another set with the same descriptor length.
+    void push_back(InterestPointSetT const& other, size_t i);
+
+    /// Replace all points with those in [begin, end).
+    template <class IterT>
+    void assign(IterT begin, IterT end) {
+      m_descriptor_length = (begin == end) ? 0 : begin->descriptor.size();
+      resize(0);
+      for (IterT iter = begin; iter != end; ++iter)
+        push_back(*iter);
+    }
+
+    /// Return point i as an InterestPoint, optionally leaving out the descriptor.
+    InterestPoint point(size_t i, bool with_descriptor = true) const;
+
+    /// Overwrite point i, including its descriptor which is zeroed if point has none.
+    void set_point(size_t i, InterestPoint const& point);
+
+    /// Convert to a list or vector of InterestPoints.
+    template <class ListT>
+    void to_list(ListT & points) const {
+      points.clear();
+      for (size_t i = 0; i < size(); ++i)
+        points.push_back(point(i));
+    }
+
+    // Per point fields, as in InterestPoint.
+    float  & x          (size_t i)       { return m_x[i]; }
+    float    x          (size_t i) const { return m_x[i]; }
+    float  & y          (size_t i)       { return m_y[i]; }
+    float    y          (size_t i) const { return m_y[i]; }
+    int32  & ix         (size_t i)       { return m_ix[i]; }
+    int32    ix         (size_t i) const { return m_ix[i]; }
+    int32  & iy         (size_t i)       { return m_iy[i]; }
+    int32    iy         (size_t i) const { return m_iy[i]; }
+    float  & scale      (size_t i)       { return m_scale[i]; }
+    float    scale      (size_t i) const { return m_scale[i]; }
+    float  & orientation(size_t i)       { return m_orientation[i]; }
+    float    orientation(size_t i) const { return m_orientation[i]; }
+    float  & interest   (size_t i)       { return m_interest[i]; }
+    float    interest   (size_t i) const { return m_interest[i]; }
+    uint8  & polarity   (size_t i)       { return m_polarity[i]; }
+    uint8    polarity   (size_t i) const { return m_polarity[i]; }
+    uint32 & octave     (size_t i)       { return m_octave[i]; }
+    uint32   octave     (size_t i) const { return m_octave[i]; }
+    uint32 & scale_lvl  (size_t i)       { return m_scale_lvl[i]; }
+    uint32   scale_lvl  (size_t i) const { return m_scale_lvl[i]; }
+
+    /// Whole columns, for passes over all points.
+    /// - These are invalidated by anything that changes size().
+    float  const* x_data          () const { return m_x.empty()           ? 0 : &m_x[0];           }
+    float  const* y_data          () const { return m_y.empty()           ? 0 : &m_y[0];           }
+    int32  const* ix_data         () const { return m_ix.empty()          ? 0 : &m_ix[0];          }
+    int32  const* iy_data         () const { return m_iy.empty()          ? 0 : &m_iy[0];          }
+    float  const* scale_data      () const { return m_scale.empty()       ? 0 : &m_scale[0];       }
+    float  const* orientation_data() const { return m_orientation.empty() ? 0 : &m_orientation[0]; }
+    float  const* interest_data   () const { return m_interest.empty()    ? 0 : &m_interest[0];    }
+    uint8  const* polarity_data   () const { return m_polarity.empty()    ? 0 : &m_polarity[0];    }
+    uint32 const* octave_data     () const { return m_octave.empty()      ? 0 : &m_octave[0];      }
+    uint32 const* scale_lvl_data  () const { return m_scale_lvl.empty()   ? 0 : &m_scale_lvl[0];   }
+
+    /// The descriptor of point i, descriptor_length() elements.
+    ElemT      * descriptor(size_t i)       { return descriptor_data() + i*m_descriptor_length; }
+    ElemT const* descriptor(size_t i) const { return descriptor_data() + i*m_descriptor_length; }
+
+    /// The descriptor block, size() rows of descriptor_length() elements.
+    ElemT      * descriptor_data()       { return m_descriptors.empty() ? 0 : &m_descriptors[0]; }
+    ElemT const* descriptor_data() const { return m_descriptors.empty() ? 0 : &m_descriptors[0]; }
+
+  private:
+    size_t m_descriptor_length;
+    std::vector<float > m_x, m_y;
+    std::vector<int32 > m_ix, m_iy;
+    std::vector<float > m_scale, m_orientation, m_interest;
+    std::vector<uint8 > m_polarity;
+    std::vector<uint32> m_octave, m_scale_lvl;
+    descriptor_storage_type m_descriptors;
+  }; // End class InterestPointSetT
+
+  /// Points with floating point descriptors, such as SIFT or SGrad.
+  typedef InterestPointSetT<float> InterestPointSet;
+  /// Points with binary descriptors, such as ORB or BRISK.
+  typedef InterestPointSetT<uint8> BinaryInterestPointSet;
+
+  /// Select only the interest points that fall within the specified bounding box.
+  template <class ElemT, class RealT>
+  InterestPointSetT<ElemT> crop(InterestPointSetT<ElemT> const& interest_points, BBox<RealT,2> const& bbox) {
+    InterestPointSetT<ElemT> return_val(interest_points.descriptor_length());
+    for (size_t i = 0; i < interest_points.size(); ++i) {
+      if (bbox.contains(Vector<RealT,2>(RealT(interest_points.x(i)), RealT(interest_points.y(i)))))
+        return_val.push_back(interest_points, i);
+    }
+    return return_val;
+  }
+
+  // Routines for reading & writing interest point sets.
+  // - These use the same file formats as the InterestPoint versions.
+  template <class ElemT>
+  void write_binary_ip_file(std::string ip_file, InterestPointSetT<ElemT> const& ip);
+  template <class ElemT>
+  void read_binary_ip_file (std::string ip_file, InterestPointSetT<ElemT> & ip);
+  template <class ElemT>
+  void write_binary_match_file(std::string match_file, InterestPointSetT<ElemT> const& ip1,
+                               InterestPointSetT<ElemT> const& ip2);
+  template <class ElemT>
+  void read_binary_match_file (std::string match_file, InterestPointSetT<ElemT> & ip1,
+                               InterestPointSetT<ElemT> & ip2);
+
+//==========================================================================
+// Function definitions
+
+template <class ElemT>
+void InterestPointSetT<ElemT>::reserve(size_t num_points) {
+  m_x.reserve(num_points);
+  m_y.reserve(num_points);
+  m_ix.reserve(num_points);
+  m_iy.reserve(num_points);
+  m_scale.reserve(num_points);
+  m_orientation.reserve(num_points);
+  m_interest.reserve(num_points);
+  m_polarity.reserve(num_points);
+  m_octave.reserve(num_points);
+  m_scale_lvl.reserve(num_points);
+  m_descriptors.reserve(num_points*m_descriptor_length);
+}
+
+template <class ElemT>
+void InterestPointSetT<ElemT>::resize(size_t num_points) {
+  m_x.resize(num_points, 0);
+  m_y.resize(num_points, 0);
+  m_ix.resize(num_points, 0);
+  m_iy.resize(num_points, 0);
+  m_scale.resize(num_points, 1.0);
+  m_orientation.resize(num_points, 0);
+  m_interest.resize(num_points, 0);
+  m_polarity.resize(num_points, 0);
+  m_octave.resize(num_points, 0);
+  m_scale_lvl.resize(num_points, 0);
+  m_descriptors.resize(num_points*m_descriptor_length, ElemT(0));
+}
+
+template <class ElemT>
+void InterestPointSetT<ElemT>::set_descriptor_length(size_t descriptor_length) {
+  m_descriptor_length = descriptor_length;
+  m_descriptors.assign(size()*m_descriptor_length, ElemT(0));
+}
+
+template <class ElemT>
+void InterestPointSetT<ElemT>::push_back(InterestPoint const& point) {
+  if (empty() && m_descriptor_length == 0)
+    m_descriptor_length = point.descriptor.size();
+  resize(size()+1);
+  set_point(size()-1, point);
+}
+
+template <class ElemT>
+void InterestPointSetT<ElemT>::push_back(InterestPointSetT const& other, size_t i) {
+  if (empty() && m_descriptor_length == 0)
+    m_descriptor_length = other.descriptor_length();
+  VW_ASSERT(other.descriptor_length() == m_descriptor_length,
+            ArgumentErr() << "InterestPointSet: Descriptor length " << other.descriptor_length()
+                          << " does not match the set length " << m_descriptor_length << ".\n");
+  m_x.push_back          (other.m_x[i]);
+  m_y.push_back          (other.m_y[i]);
+  m_ix.push_back         (other.m_ix[i]);
+  m_iy.push_back         (other.m_iy[i]);
+  m_scale.push_back      (other.m_scale[i]);
+  m_orientation.push_back(other.m_orientation[i]);
+  m_interest.push_back   (other.m_interest[i]);
+  m_polarity.push_back   (other.m_polarity[i]);
+  m_octave.push_back     (other.m_octave[i]);
+  m_scale_lvl.push_back  (other.m_scale_lvl[i]);
+  m_descriptors.insert(m_descriptors.end(), other.descriptor(i),
+                       other.descriptor(i) + m_descriptor_length);
+}
+
+template <class ElemT>
+InterestPoint InterestPointSetT<ElemT>::point(size_t i, bool with_descriptor) const {
+  InterestPoint result(m_x[i], m_y[i], m_scale[i], m_interest[i], m_orientation[i],
+                       m_polarity[i] != 0, m_octave[i], m_scale_lvl[i]);
+  result.ix = m_ix[i];
+  result.iy = m_iy[i];
+  if (with_descriptor) {
+    result.descriptor.set_size(m_descriptor_length);
+    ElemT const* desc = descriptor(i);
+    for (size_t k = 0; k < m_descriptor_length; ++k)
+      result.descriptor[k] = static_cast<float>(desc[k]);
+  }
+  return result;
+}
+
+template <class ElemT>
+void InterestPointSetT<ElemT>::set_point(size_t i, InterestPoint const& point) {
+  VW_ASSERT(point.descriptor.size() == 0 || point.descriptor.size() == m_descriptor_length,
+            ArgumentErr() << "InterestPointSet: Descriptor length " << point.descriptor.size()
+                          << " does not match the set length " << m_descriptor_length << ".\n");
+  m_x[i]           = point.x;
+  m_y[i]           = point.y;
+  m_ix[i]          = point.ix;
+  m_iy[i]          = point.iy;
+  m_scale[i]       = point.scale;
+  m_orientation[i] = point.orientation;
+  m_interest[i]    = point.interest;
+  m_polarity[i]    = point.polarity;
+  m_octave[i]      = point.octave;
+  m_scale_lvl[i]   = point.scale_lvl;
+  ElemT* desc = descriptor(i);
+  if (point.descriptor.size() == 0)
+    std::fill(desc, desc+m_descriptor_length, ElemT(0));
+  for (size_t k = 0; k < point.descriptor.size(); ++k)
+    desc[k] = static_cast<ElemT>(point.descriptor[k]);
+}
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_INTEREST_POINT_SET_H__
@@ -144,15 +144,181 @@ namespace ip {
   }
 
 
+//==================================================================================
+// Guided matching
+
+  InterestPointGrid::InterestPointGrid(std::vector<float> const& x, std::vector<float> const& y,
+                                       double points_per_cell)
+    : m_x(x), m_y(y), m_min_x(0), m_min_y(0), m_cell_width(1), m_cell_height(1),
+      m_cols(0), m_rows(0) {
+    VW_ASSERT( x.size() == y.size(),
+               ArgumentErr() << "InterestPointGrid: Coordinate vectors are not the same size." );
+    const size_t num_points = m_x.size();
+    if (num_points == 0)
+      return;
+
+    double max_x = m_x[0], max_y = m_y[0];
+    m_min_x = max_x;
+    m_min_y = max_y;
+    for (size_t i = 1; i < num_points; ++i) {
+      m_min_x = std::min(m_min_x, double(m_x[i]));  max_x = std::max(max_x, double(m_x[i]));
+      m_min_y = std::min(m_min_y, double(m_y[i]));  max_y = std::max(max_y, double(m_y[i]));
+    }
+
+    // Square cells sized for the requested density, in at most MAX_CELLS
+    // columns and rows which exactly cover the point bounds.
+    const int32  MAX_CELLS = 4096;
+    const double width  = std::max(max_x - m_min_x, 1.0);
+    const double height = std::max(max_y - m_min_y, 1.0);
+    const double cell_size = sqrt(width*height*std::max(points_per_cell, 1.0)/double(num_points));
+    m_cols = int32(std::min(ceil(width /cell_size), double(MAX_CELLS)));
+    m_rows = int32(std::min(ceil(height/cell_size), double(MAX_CELLS)));
+    m_cols = std::max(m_cols, int32(1));
+    m_rows = std::max(m_rows, int32(1));
+    m_cell_width  = width /m_cols;
+    m_cell_height = height/m_rows;
+
+    // Counting sort of the points by cell.
+    std::vector<uint32> cells(num_points);
+    m_cell_start.assign(size_t(m_cols)*m_rows + 1, 0);
+    for (size_t i = 0; i < num_points; ++i) {
+      const int32 col = std::min(int32((m_x[i] - m_min_x)/m_cell_width ), m_cols-1);
+      const int32 row = std::min(int32((m_y[i] - m_min_y)/m_cell_height), m_rows-1);
+      cells[i] = uint32(row)*m_cols + col;
+      ++m_cell_start[cells[i]+1];
+    }
+    for (size_t c = 1; c < m_cell_start.size(); ++c)
+      m_cell_start[c] += m_cell_start[c-1];
+    m_cell_points.resize(num_points);
+    std::vector<uint32> next(m_cell_start.begin(), m_cell_start.end()-1);
+    for (size_t i = 0; i < num_points; ++i)
+      m_cell_points[next[cells[i]]++] = uint32(i);
+  }
+
+  bool InterestPointGrid::cell_range(double min_x, double min_y, double max_x, double max_y,
+                                     int32 & col_begin, int32 & row_begin,
+                                     int32 & col_end,   int32 & row_end) const {
+    if (m_cols == 0 || !(min_x <= max_x) || !(min_y <= max_y))
+      return false;
+    // Clamp in floating point first, the range may be far outside the grid.
+    const double c0 = floor((min_x - m_min_x)/m_cell_width );
+    const double c1 = floor((max_x - m_min_x)/m_cell_width );
+    const double r0 = floor((min_y - m_min_y)/m_cell_height);
+    const double r1 = floor((max_y - m_min_y)/m_cell_height);
+    if (c1 < 0 || r1 < 0 || c0 >= m_cols || r0 >= m_rows)
+      return false;
+    col_begin = int32(std::max(c0, 0.0));
+    row_begin = int32(std::max(r0, 0.0));
+    col_end   = int32(std::min(c1, double(m_cols-1)));
+    row_end   = int32(std::min(r1, double(m_rows-1)));
+    return true;
+  }
+
+  void InterestPointGrid::find_in_box(BBox2 const& box, std::vector<uint32>& indices) const {
+    int32 col_begin, row_begin, col_end, row_end;
+    if (!cell_range(box.min()[0], box.min()[1], box.max()[0], box.max()[1],
+                    col_begin, row_begin, col_end, row_end))
+      return;
+    for (int32 row = row_begin; row <= row_end; ++row) {
+      for (int32 col = col_begin; col <= col_end; ++col) {
+        const size_t cell = size_t(row)*m_cols + col;
+        for (uint32 k = m_cell_start[cell]; k < m_cell_start[cell+1]; ++k) {
+          const uint32 i = m_cell_points[k];
+          if (m_x[i] >= box.min()[0] && m_x[i] <= box.max()[0] &&
+              m_y[i] >= box.min()[1] && m_y[i] <= box.max()[1])
+            indices.push_back(i);
+        }
+      }
+    }
+  }
+
+  void InterestPointGrid::find_near_line(Vector3 const& line, double distance,
+                                         std::vector<uint32>& indices) const {
+    const double norm = sqrt(line[0]*line[0] + line[1]*line[1]);
+    if (m_cols == 0 || !(norm > 0) || !(distance >= 0))
+      return;
+    const double a = line[0]/norm, b = line[1]/norm, c = line[2]/norm;
+
+    // Walk along the line one strip of cells at a time, across the axis
+    // the line is closer to, visiting only the cells the band overlaps.
+    const bool by_column = fabs(b) >= fabs(a);
+    const int32 num_strips = by_column ? m_cols : m_rows;
+    for (int32 strip = 0; strip < num_strips; ++strip) {
+      int32 col_begin, row_begin, col_end, row_end;
+      if (by_column) {
+        const double x0 = m_min_x + strip*m_cell_width, x1 = x0 + m_cell_width;
+        const double y0 = -(a*x0 + c)/b, y1 = -(a*x1 + c)/b;
+        const double margin = distance/fabs(b);
+        if (!cell_range(x0, std::min(y0, y1) - margin, x0, std::max(y0, y1) + margin,
+                        col_begin, row_begin, col_end, row_end))
+          continue;
+        col_begin = col_end = strip;
+      } else {
+        const double y0 = m_min_y + strip*m_cell_height, y1 = y0 + m_cell_height;
+        const double x0 = -(b*y0 + c)/a, x1 = -(b*y1 + c)/a;
+        const double margin = distance/fabs(a);
+        if (!cell_range(std::min(x0, x1) - margin, y0, std::max(x0, x1) + margin, y0,
+                        col_begin, row_begin, col_end, row_end))
+          continue;
+        row_begin = row_end = strip;
+      }
+      for (int32 row = row_begin; row <= row_end; ++row) {
+        for (int32 col = col_begin; col <= col_end; ++col) {
+          const size_t cell = size_t(row)*m_cols + col;
+          for (uint32 k = m_cell_start[cell]; k < m_cell_start[cell+1]; ++k) {
+            const uint32 i = m_cell_points[k];
+            if (fabs(a*m_x[i] + b*m_y[i] + c) <= distance)
+              indices.push_back(i);
+          }
+        }
+      }
+    }
+  }
+
+  void HomographyMatchPrior::find_candidates(InterestPointGrid const& grid, InterestPoint const& ip,
+                                             std::vector<uint32>& candidates) const {
+    const Vector3 p = m_homography*Vector3(ip.x, ip.y, 1);
+    if (p[2] == 0)
+      return;
+    const double x = p[0]/p[2], y = p[1]/p[2];
+    const size_t first = candidates.size();
+    grid.find_in_box(BBox2(Vector2(x - m_radius, y - m_radius), Vector2(x + m_radius, y + m_radius)),
+                     candidates);
+
+    // Keep only the points of the box within the circle.
+    const double radius_sq = m_radius*m_radius;
+    size_t kept = first;
+    for (size_t k = first; k < candidates.size(); ++k) {
+      const double dx = grid.x(candidates[k]) - x, dy = grid.y(candidates[k]) - y;
+      if (dx*dx + dy*dy <= radius_sq)
+        candidates[kept++] = candidates[k];
+    }
+    candidates.resize(kept);
+  }
+
+  void EpipolarMatchPrior::find_candidates(InterestPointGrid const& grid, InterestPoint const& ip,
+                                           std::vector<uint32>& candidates) const {
+    grid.find_near_line(m_fundamental*Vector3(ip.x, ip.y, 1), m_distance, candidates);
+  }
+
 //==================================================================================
 
   void remove_duplicates(std::vector<InterestPoint>& ip1,
                          std::vector<InterestPoint>& ip2) {
-    VW_ASSERT( ip1.size() == ip2.size(),
+    std::vector<double> match_quality(ip1.size());
+    remove_duplicates(ip1, ip2, match_quality);
+  }
+
+  void remove_duplicates(std::vector<InterestPoint>& ip1,
+                         std::vector<InterestPoint>& ip2,
+                         std::vector<double>& match_quality) {
+    VW_ASSERT( ip1.size() == ip2.size() && ip1.size() == match_quality.size(),
                ArgumentErr() << "Input vectors are not the same size.");
     std::vector<InterestPoint> ip1_fltr, ip2_fltr;
+    std::vector<double> quality_fltr;
     ip1_fltr.reserve( ip1.size() );
     ip2_fltr.reserve( ip2.size() );
+    quality_fltr.reserve( match_quality.size() );
 
     for ( size_t i = 0; i < ip1.size(); ++i ) {
       bool bad_entry = false;
@@ -166,10 +332,12 @@ namespace ip {
       if (!bad_entry) {
         ip1_fltr.push_back( ip1[i] );
         ip2_fltr.push_back( ip2[i] );
+        quality_fltr.push_back( match_quality[i] );
       }
     }
     ip1 = ip1_fltr;
     ip2 = ip2_fltr;
+    match_quality = quality_fltr;
   }
 
   std::string strip_path(std::string out_prefix, std::string filename){
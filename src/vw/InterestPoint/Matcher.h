@@ -24,10 +24,15 @@
 #define _INTERESTPOINT_MATCHER_H_
 
 #include <algorithm>
+#include <limits>
 
 #include <vw/Core/Log.h>
+#include <vw/Math/BBox.h>
+#include <vw/Math/Matrix.h>
 #include <vw/InterestPoint/Descriptor.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+#include <vw/InterestPoint/BruteForceMatcher.h>
 #include <vector>
 #include <boost/foreach.hpp>
 
@@ -173,6 +178,13 @@ namespace ip {
       return true;
     }
 
+    // The index list version of operator(), also appending to ratios, if
+    // not null, the distance ratio of each match found.
+    template <class ListT, class IndexListT >
+    void find_matches( ListT const& ip1, ListT const& ip2,
+                       IndexListT& index_list, std::vector<double>* ratios,
+                       const ProgressCallback &progress_callback ) const;
+
   public:
 
     InterestPointMatcher(double threshold = 0.5, MetricT metric = MetricT(), ConstraintT constraint = ConstraintT(), bool bidirectional = false)
@@ -182,6 +194,8 @@ namespace ip {
     /// the corresponding matching index in ip2. index_list is the
     /// same length as ip1. index_list will be filled with max value
     /// of size_t in the event that a match was not found.
+    /// - The nearest points are found by brute force or with a FLANN tree,
+    ///   whichever prefer_brute_force_knn() expects to be faster.
     template <class ListT, class IndexListT >
     void operator()( ListT const& ip1, ListT const& ip2,
                      IndexListT& index_list,
@@ -193,6 +207,29 @@ namespace ip {
     void operator()( ListT const& ip1, ListT const& ip2,
                      MatchListT& matched_ip1, MatchListT& matched_ip2,
                      const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+    /// As above, also returning a quality for each match: one minus the ratio
+    /// of the distances to the nearest and second nearest points of ip2.
+    /// This is the ranking ProgressiveSampleConsensus expects.
+    template <class ListT, class MatchListT>
+    void operator()( ListT const& ip1, ListT const& ip2,
+                     MatchListT& matched_ip1, MatchListT& matched_ip2,
+                     std::vector<double>& match_quality,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+    /// Versions of the above for InterestPointSets, which are matched straight
+    ///  from their descriptor blocks.
+    /// - Float sets are matched with L2NormMetric and uint8 sets with HammingMetric.
+    /// - Points which fail the constraint get no match.
+    template <class ElemT, class IndexListT>
+    void operator()( InterestPointSetT<ElemT> const& ip1, InterestPointSetT<ElemT> const& ip2,
+                     IndexListT& index_list,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+    template <class ElemT>
+    void operator()( InterestPointSetT<ElemT> const& ip1, InterestPointSetT<ElemT> const& ip2,
+                     InterestPointSetT<ElemT>& matched_ip1, InterestPointSetT<ElemT>& matched_ip2,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
   };
 
 
@@ -218,6 +255,116 @@ namespace ip {
   };
 
 
+  // ---------------------------------------------------------------------------
+  //                         Guided Matching
+  // ---------------------------------------------------------------------------
+
+  /// A uniform grid over the positions of a set of interest points, for
+  /// finding the points near a position or a line without visiting the rest.
+  class InterestPointGrid {
+  public:
+    InterestPointGrid() : m_min_x(0), m_min_y(0), m_cell_width(1), m_cell_height(1),
+                          m_cols(0), m_rows(0) {}
+
+    /// Bin the points so that a cell holds about points_per_cell of them.
+    InterestPointGrid(std::vector<float> const& x, std::vector<float> const& y,
+                      double points_per_cell = 4.0);
+
+    size_t size() const { return m_x.size(); }
+    float x(size_t i) const { return m_x[i]; }
+    float y(size_t i) const { return m_y[i]; }
+
+    /// Append the indices of the points inside box, edges included.
+    void find_in_box(BBox2 const& box, std::vector<uint32>& indices) const;
+
+    /// Append the indices of the points within distance of the line
+    ///  line[0]*x + line[1]*y + line[2] = 0.
+    void find_near_line(Vector3 const& line, double distance,
+                        std::vector<uint32>& indices) const;
+
+  private:
+    /// Convert a range of positions to an inclusive range of cells,
+    ///  returning false if it misses the grid.
+    bool cell_range(double min_x, double min_y, double max_x, double max_y,
+                    int32 & col_begin, int32 & row_begin,
+                    int32 & col_end,   int32 & row_end) const;
+
+    std::vector<float> m_x, m_y;
+    double m_min_x, m_min_y, m_cell_width, m_cell_height;
+    int32  m_cols, m_rows;
+    // The points of cell (col,row) are
+    //  m_cell_points[m_cell_start[row*m_cols+col] .. m_cell_start[row*m_cols+col+1]).
+    std::vector<uint32> m_cell_start, m_cell_points;
+  };
+
+  /// Guidance for GuidedInterestPointMatcher from a homography taking points
+  /// of the first image to the second, such as one from an earlier alignment.
+  /// Only the points within radius pixels of the predicted position are compared.
+  class HomographyMatchPrior {
+    Matrix3x3 m_homography;
+    double    m_radius;
+  public:
+    HomographyMatchPrior(Matrix3x3 const& homography, double radius)
+      : m_homography(homography), m_radius(radius) {}
+
+    void find_candidates(InterestPointGrid const& grid, InterestPoint const& ip,
+                         std::vector<uint32>& candidates) const;
+  };
+
+  /// Guidance for GuidedInterestPointMatcher from a fundamental matrix F with
+  /// x2^T F x1 = 0, such as one fit with camera::FundamentalMatrix8PFittingFunctor.
+  /// Only the points within distance pixels of the epipolar line are compared.
+  class EpipolarMatchPrior {
+    Matrix3x3 m_fundamental;
+    double    m_distance;
+  public:
+    EpipolarMatchPrior(Matrix3x3 const& fundamental, double distance)
+      : m_fundamental(fundamental), m_distance(distance) {}
+
+    void find_candidates(InterestPointGrid const& grid, InterestPoint const& ip,
+                         std::vector<uint32>& candidates) const;
+  };
+
+  /// Interest point matcher for when the geometry between the images is
+  /// roughly known.  The points of ip2 are binned into an InterestPointGrid
+  /// and each point of ip1 is only compared with the points the prior allows,
+  /// so the work grows with the number of points rather than its square.
+  /// - PriorT must provide find_candidates() like HomographyMatchPrior.
+  /// - The two nearest allowed points must pass the same ratio test as in
+  ///   InterestPointMatcher.  A small window often holds a single point,
+  ///   which nothing competes with, so it is matched if its descriptor
+  ///   distance is below max_distance.
+  template < class MetricT, class PriorT, class ConstraintT = NullConstraint >
+  class GuidedInterestPointMatcher {
+    PriorT      m_prior;
+    ConstraintT m_constraint;
+    MetricT     m_distance_metric;
+    double      m_threshold;
+    double      m_max_distance;
+
+  public:
+
+    GuidedInterestPointMatcher(PriorT const& prior, double threshold = 0.5,
+                               MetricT metric = MetricT(), ConstraintT constraint = ConstraintT(),
+                               double max_distance = std::numeric_limits<double>::max())
+      : m_prior(prior), m_constraint(constraint), m_distance_metric(metric), m_threshold(threshold),
+        m_max_distance(max_distance) { }
+
+    /// As the InterestPointMatcher version, writes the index in ip2 of the
+    ///  match of each point of ip1, or the max value of size_t if none.
+    template <class ListT, class IndexListT >
+    void operator()( ListT const& ip1, ListT const& ip2,
+                     IndexListT& index_list,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+    /// Returns the two lists of matching interest points.
+    template <class ListT, class MatchListT>
+    void operator()( ListT const& ip1, ListT const& ip2,
+                     MatchListT& matched_ip1, MatchListT& matched_ip2,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+  };
+
+
   //////////////////////////////////////////////////////////////////////////////
   // Convenience Typedefs
   typedef InterestPointMatcher< L2NormMetric, NullConstraint             > DefaultMatcher;
@@ -228,6 +375,11 @@ namespace ip {
   void remove_duplicates(std::vector<InterestPoint>& ip1,
                          std::vector<InterestPoint>& ip2);
 
+  /// As above, also dropping the quality of each removed match.
+  void remove_duplicates(std::vector<InterestPoint>& ip1,
+                         std::vector<InterestPoint>& ip2,
+                         std::vector<double>& match_quality);
+
   /// The name of the match file.
   std::string match_filename(std::string const& out_prefix,
                              std::string const& input_file1,
@@ -292,6 +444,15 @@ template <class ListT, class IndexListT >
 void InterestPointMatcher<MetricT, ConstraintT>::operator()( ListT const& ip1, ListT const& ip2,
                                                              IndexListT& index_list,
                                                              const ProgressCallback &progress_callback) const {
+  find_matches(ip1, ip2, index_list, 0, progress_callback);
+}
+
+template <class MetricT, class ConstraintT>
+template <class ListT, class IndexListT >
+void InterestPointMatcher<MetricT, ConstraintT>::find_matches( ListT const& ip1, ListT const& ip2,
+                                                               IndexListT& index_list,
+                                                               std::vector<double>* ratios,
+                                                               const ProgressCallback &progress_callback) const {
 
   Timer total_time("Total elapsed time", DebugMessage, "interest_point");
   size_t ip1_size = ip1.size(), ip2_size = ip2.size();
@@ -303,80 +464,122 @@ void InterestPointMatcher<MetricT, ConstraintT>::operator()( ListT const& ip1, L
     return;
   }
 
-  float inc_amt = 1.0f/float(ip1_size);
-
-  // Set up FLANNTree objects of all the different types we may need.
-  math::FLANNTree<float        > kd_float;
-  math::FLANNTree<unsigned char> kd_uchar;
+  const size_t KNN = 2; // Find this many matches
+  const bool use_uchar_FLANN = (MetricT::flann_type == math::FLANN_DistType_Hamming);
+  const size_t descriptor_length = ip1.begin()->size();
 
-  Matrix<float        > ip2_matrix_float;
-  Matrix<unsigned char> ip2_matrix_uchar;
+  // The KNN nearest points of ip2 for each point of ip1, -1 if not found.
+  std::vector<int32> knn_indices(ip1_size*KNN, -1);
+  progress_callback.report_progress(0);
 
-  // Pack the IP descriptors into a matrix and feed it to the chosen FLANNTree object
-  const bool use_uchar_FLANN = (MetricT::flann_type == math::FLANN_DistType_Hamming);
-  if (use_uchar_FLANN) {
-    ip_list_to_matrix(ip2, ip2_matrix_uchar);
-    kd_uchar.load_match_data( ip2_matrix_uchar, MetricT::flann_type );
-  }else {
-    ip_list_to_matrix(ip2, ip2_matrix_float);
-    kd_float.load_match_data( ip2_matrix_float,  MetricT::flann_type );
-  }
+  if (prefer_brute_force_knn(use_uchar_FLANN, ip1_size, ip2_size, descriptor_length)) {
+    if (ip2.begin()->size() != descriptor_length)
+      vw_throw( ArgumentErr() << "InterestPointMatcher: Descriptor lengths do not match.\n" );
 
-  vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
+    // Compare all the pairs at once, this is exact.
+    vw_out(InfoMessage,"interest_point") << "Matching by brute force...\n";
+    std::vector<float> knn_distances(ip1_size*KNN);
+    if (use_uchar_FLANN) {
+      Matrix<unsigned char> ip1_matrix, ip2_matrix;
+      ip_list_to_matrix(ip1, ip1_matrix);
+      ip_list_to_matrix(ip2, ip2_matrix);
+      brute_force_knn_hamming( ip1_matrix.data(), ip1_size, ip2_matrix.data(), ip2_size,
+                               descriptor_length, KNN, &knn_indices[0], &knn_distances[0],
+                               progress_callback );
+    } else {
+      Matrix<float> ip1_matrix, ip2_matrix;
+      ip_list_to_matrix(ip1, ip1_matrix);
+      ip_list_to_matrix(ip2, ip2_matrix);
+      brute_force_knn_l2( ip1_matrix.data(), ip1_size, ip2_matrix.data(), ip2_size,
+                          descriptor_length, KNN, &knn_indices[0], &knn_distances[0],
+                          progress_callback );
+    }
+  } else {
+    float inc_amt = 1.0f/float(ip1_size);
 
-  const size_t KNN = 2; // Find this many matches
-  Vector<int   > indices(KNN);
-  Vector<double> distances(KNN);
-  progress_callback.report_progress(0);
+    // Set up FLANNTree objects of all the different types we may need.
+    math::FLANNTree<float        > kd_float;
+    math::FLANNTree<unsigned char> kd_uchar;
 
-  BOOST_FOREACH( InterestPoint ip, ip1 ) {
-    if (progress_callback.abort_requested())
-      vw_throw( Aborted() << "Aborted by ProgressCallback" );
-    progress_callback.report_incremental_progress(inc_amt);
+    Matrix<float        > ip2_matrix_float;
+    Matrix<unsigned char> ip2_matrix_uchar;
 
-    size_t num_matches_found = 0;
+    // Pack the IP descriptors into a matrix and feed it to the chosen FLANNTree object
     if (use_uchar_FLANN) {
-      // Convert the descriptor to unsigned chars, then call FLANN
-      vw::Vector<unsigned char> uchar_descriptor(ip.descriptor.size());
-      for (size_t i=0; i<ip.descriptor.size(); ++i)
-	uchar_descriptor[i] = static_cast<unsigned char>(ip.descriptor[i]);
-      num_matches_found = kd_uchar.knn_search( uchar_descriptor, indices, distances, KNN );
+      ip_list_to_matrix(ip2, ip2_matrix_uchar);
+      kd_uchar.load_match_data( ip2_matrix_uchar, MetricT::flann_type );
+    }else {
+      ip_list_to_matrix(ip2, ip2_matrix_float);
+      kd_float.load_match_data( ip2_matrix_float,  MetricT::flann_type );
     }
-    else // Use float
-      num_matches_found = kd_float.knn_search( ip.descriptor, indices, distances, KNN );
 
-    //vw_out() << "KNN matches "<< num_matches_found <<": indices = " << indices << ",    distances = " << distances << std::endl;
+    vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
+
+    Vector<int   > indices(KNN);
+    Vector<double> distances(KNN);
 
-    if (num_matches_found < KNN) {
-      // If we did not get two nearest neighbors, return no match for this point.
-      vw_out() << "Bad descriptor = " << ip.descriptor << std::endl;
+    size_t i = 0;
+    BOOST_FOREACH( InterestPoint const& ip, ip1 ) {
+      if (progress_callback.abort_requested())
+        vw_throw( Aborted() << "Aborted by ProgressCallback" );
+      progress_callback.report_incremental_progress(inc_amt);
+
+      size_t num_matches_found = 0;
+      if (use_uchar_FLANN) {
+        // Convert the descriptor to unsigned chars, then call FLANN
+        vw::Vector<unsigned char> uchar_descriptor(ip.descriptor.size());
+        for (size_t j=0; j<ip.descriptor.size(); ++j)
+          uchar_descriptor[j] = static_cast<unsigned char>(ip.descriptor[j]);
+        num_matches_found = kd_uchar.knn_search( uchar_descriptor, indices, distances, KNN );
+      }
+      else // Use float
+        num_matches_found = kd_float.knn_search( ip.descriptor, indices, distances, KNN );
+
+      if (num_matches_found < KNN) {
+        // If we did not get two nearest neighbors, return no match for this point.
+        vw_out() << "Bad descriptor = " << ip.descriptor << std::endl;
+      } else {
+        for (size_t k = 0; k < KNN; ++k)
+          knn_indices[i*KNN+k] = indices[k];
+      }
+      ++i;
+    }
+  }
+
+  // Random access to ip2, which may be a list.
+  std::vector<typename ListT::const_iterator> ip2_iters;
+  ip2_iters.reserve(ip2_size);
+  for (typename ListT::const_iterator iter = ip2.begin(); iter != ip2.end(); ++iter)
+    ip2_iters.push_back(iter);
+
+  size_t i = 0;
+  BOOST_FOREACH( InterestPoint const& ip, ip1 ) {
+    int32 const* nearest = &knn_indices[KNN*i++];
+    if (nearest[KNN-1] < 0) {
       index_list.push_back( (size_t)(-1) ); // Last value of size_t
-    } else {
+      continue;
+    }
+
+    // The two nearest matches
+    InterestPoint const& record0 = *ip2_iters[nearest[0]];
+    InterestPoint const& record1 = *ip2_iters[nearest[1]];
+
+    // Check the user constraint on the record
+    if ( check_constraint<ConstraintT>( record0, ip ) ) {
+      double dist0 = m_distance_metric(record0, ip);
+      double dist1 = m_distance_metric(record1, ip);
 
-      // Copy the two nearest matches
-      std::vector<InterestPoint> nearest_records(KNN);
-      typename ListT::const_iterator iterator = ip2.begin();
-      std::advance( iterator, indices[0] );
-      nearest_records[0] = *iterator;
-      iterator = ip2.begin();
-      std::advance( iterator, indices[1] );
-      nearest_records[1] = *iterator;
-
-      // Check the user constraint on the record
-      if ( check_constraint<ConstraintT>( nearest_records[0], ip ) ) {
-        double dist0 = m_distance_metric(nearest_records[0], ip);
-        double dist1 = m_distance_metric(nearest_records[1], ip);
-
-        // As a final check, make sure the nearest record is significantly closer than the next one.
-        if (dist0 < m_threshold * dist1) {
-          index_list.push_back( indices[0] );
-        } else {
-          index_list.push_back( (size_t)(-1) ); // Last value of size_t
-        }
-      } // End check constraint
-    } // End both valid case
+      // As a final check, make sure the nearest record is significantly closer than the next one.
+      if (dist0 < m_threshold * dist1) {
+        index_list.push_back( nearest[0] );
+        if (ratios)
+          ratios->push_back( dist1 > 0 ? dist0 / dist1 : 1.0 );
+        continue;
+      }
+    } // End check constraint
+    index_list.push_back( (size_t)(-1) ); // Last value of size_t
   }
-} // End InterestPointMatcher::operator()
+} // End InterestPointMatcher::find_matches()
 
 // Given two lists of interest points, this routine returns the two lists
 // of matching interest points based on the Metric and Constraints
@@ -386,14 +589,27 @@ template <class ListT, class MatchListT>
 void InterestPointMatcher<MetricT, ConstraintT>::operator()( ListT const& ip1, ListT const& ip2,
                                                              MatchListT& matched_ip1, MatchListT& matched_ip2,
                                                              const ProgressCallback &progress_callback) const {
+  std::vector<double> match_quality;
+  this->operator()(ip1, ip2, matched_ip1, matched_ip2, match_quality, progress_callback);
+}
+
+template <class MetricT, class ConstraintT>
+template <class ListT, class MatchListT>
+void InterestPointMatcher<MetricT, ConstraintT>::operator()( ListT const& ip1, ListT const& ip2,
+                                                             MatchListT& matched_ip1, MatchListT& matched_ip2,
+                                                             std::vector<double>& match_quality,
+                                                             const ProgressCallback &progress_callback) const {
 
   // Clear output lists
   matched_ip1.clear();
   matched_ip2.clear();
+  match_quality.clear();
 
-  // Redirect to the other version of this function, getting the results in an index list.
+  // Redirect to the index list version, which also gives the distance ratios.
   std::list<size_t> index_list;
-  this->operator()(ip1, ip2, index_list, progress_callback);
+  find_matches(ip1, ip2, index_list, &match_quality, progress_callback);
+  for (size_t i = 0; i < match_quality.size(); ++i)
+    match_quality[i] = 1.0 - match_quality[i];
 
   // Now convert from the index output to the pairs output
 
@@ -419,6 +635,102 @@ void InterestPointMatcher<MetricT, ConstraintT>::operator()( ListT const& ip1, L
 
 
 
+template <class MetricT, class ConstraintT>
+template <class ElemT, class IndexListT>
+void InterestPointMatcher<MetricT, ConstraintT>::operator()( InterestPointSetT<ElemT> const& ip1,
+                                                             InterestPointSetT<ElemT> const& ip2,
+                                                             IndexListT& index_list,
+                                                             const ProgressCallback &progress_callback) const {
+
+  const bool use_hamming = (MetricT::flann_type == math::FLANN_DistType_Hamming);
+  if (use_hamming != boost::is_same<ElemT, uint8>::value)
+    vw_throw( ArgumentErr() << "InterestPointMatcher: Binary descriptor sets must be matched with "
+                            << "HammingMetric and float descriptor sets with L2NormMetric.\n" );
+  if (ip1.descriptor_length() != ip2.descriptor_length())
+    vw_throw( ArgumentErr() << "InterestPointMatcher: Descriptor lengths do not match.\n" );
+
+  Timer total_time("Total elapsed time", DebugMessage, "interest_point");
+  size_t ip1_size = ip1.size(), ip2_size = ip2.size();
+
+  index_list.clear();
+  if (!ip1_size || !ip2_size) {
+    vw_out(InfoMessage,"interest_point") << "KD-Tree: no points to match, exiting\n";
+    progress_callback.report_finished();
+    return;
+  }
+
+  const size_t KNN = 2; // Find this many matches
+  const size_t length = ip1.descriptor_length();
+
+  // The KNN nearest points of ip2 for each point of ip1, -1 if not found.
+  std::vector<int32> knn_indices  (ip1_size*KNN, -1);
+  std::vector<float> knn_distances(ip1_size*KNN);
+  progress_callback.report_progress(0);
+
+  if (prefer_brute_force_knn(use_hamming, ip1_size, ip2_size, length)) {
+    vw_out(InfoMessage,"interest_point") << "Matching by brute force...\n";
+    brute_force_knn( ip1.descriptor_data(), ip1_size, ip2.descriptor_data(), ip2_size,
+                     length, KNN, &knn_indices[0], &knn_distances[0], progress_callback );
+  } else {
+    float inc_amt = 1.0f/float(ip1_size);
+
+    // The tree indexes the descriptor block of ip2 in place.
+    math::FLANNTree<ElemT> tree;
+    tree.load_match_data( ip2.descriptor_data(), ip2_size, length, MetricT::flann_type );
+
+    vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
+
+    Vector<int   > indices(KNN);
+    Vector<double> distances(KNN);
+    for (size_t i = 0; i < ip1_size; ++i) {
+      if (progress_callback.abort_requested())
+        vw_throw( Aborted() << "Aborted by ProgressCallback" );
+      progress_callback.report_incremental_progress(inc_amt);
+
+      if (tree.knn_search( ip1.descriptor(i), length, indices, distances, KNN ) < KNN)
+        continue;
+      for (size_t k = 0; k < KNN; ++k) {
+        knn_indices  [i*KNN+k] = indices[k];
+        knn_distances[i*KNN+k] = distances[k];
+      }
+    }
+  }
+
+  // Both searches return the same distances as the metric: squared L2 or the bit count.
+  for (size_t i = 0; i < ip1_size; ++i) {
+    int32 const* nearest   = &knn_indices  [i*KNN];
+    float const* distances = &knn_distances[i*KNN];
+    if ( nearest[KNN-1] >= 0 &&
+         check_constraint<ConstraintT>( ip2.point(nearest[0], false), ip1.point(i, false) ) &&
+         distances[0] < m_threshold * distances[1] )
+      index_list.push_back( nearest[0] );
+    else
+      index_list.push_back( (size_t)(-1) );
+  }
+  progress_callback.report_finished();
+} // End InterestPointMatcher::operator() for sets
+
+template <class MetricT, class ConstraintT>
+template <class ElemT>
+void InterestPointMatcher<MetricT, ConstraintT>::operator()( InterestPointSetT<ElemT> const& ip1,
+                                                             InterestPointSetT<ElemT> const& ip2,
+                                                             InterestPointSetT<ElemT>& matched_ip1,
+                                                             InterestPointSetT<ElemT>& matched_ip2,
+                                                             const ProgressCallback &progress_callback) const {
+  matched_ip1 = InterestPointSetT<ElemT>(ip1.descriptor_length());
+  matched_ip2 = InterestPointSetT<ElemT>(ip2.descriptor_length());
+
+  std::vector<size_t> index_list;
+  this->operator()(ip1, ip2, index_list, progress_callback);
+  for (size_t i = 0; i < index_list.size(); ++i) {
+    if (index_list[i] >= ip2.size())
+      continue; // Skip points without a match
+    matched_ip1.push_back(ip1, i);
+    matched_ip2.push_back(ip2, index_list[i]);
+  }
+}
+
+
 //-----------------------------------------------------------
 // InterestPointMatcherSimple
 
@@ -489,6 +801,115 @@ void InterestPointMatcherSimple<MetricT, ConstraintT>::operator()( ListT const&
   }
 }
 
+//---------------------------------------------------------------------------
+// GuidedInterestPointMatcher
+
+template <class MetricT, class PriorT, class ConstraintT>
+template <class ListT, class IndexListT >
+void GuidedInterestPointMatcher<MetricT, PriorT, ConstraintT>::operator()( ListT const& ip1, ListT const& ip2,
+                                                                           IndexListT& index_list,
+                                                                           const ProgressCallback &progress_callback) const {
+
+  Timer total_time("Total elapsed time", DebugMessage, "interest_point");
+  size_t ip1_size = ip1.size(), ip2_size = ip2.size();
+
+  index_list.clear();
+  if (!ip1_size || !ip2_size) {
+    vw_out(InfoMessage,"interest_point") << "No points to match, exiting\n";
+    progress_callback.report_finished();
+    return;
+  }
+
+  // Random access to ip2, which may be a list, and the grid over its positions.
+  std::vector<typename ListT::const_iterator> ip2_iters;
+  std::vector<float> ip2_x, ip2_y;
+  ip2_iters.reserve(ip2_size);
+  ip2_x.reserve(ip2_size);
+  ip2_y.reserve(ip2_size);
+  for (typename ListT::const_iterator iter = ip2.begin(); iter != ip2.end(); ++iter) {
+    ip2_iters.push_back(iter);
+    ip2_x.push_back(iter->x);
+    ip2_y.push_back(iter->y);
+  }
+  InterestPointGrid grid(ip2_x, ip2_y);
+
+  float inc_amt = 1.0f/float(ip1_size);
+  progress_callback.report_progress(0);
+
+  std::vector<uint32> candidates;
+  size_t num_compared = 0;
+  BOOST_FOREACH( InterestPoint const& ip, ip1 ) {
+    if (progress_callback.abort_requested())
+      vw_throw( Aborted() << "Aborted by ProgressCallback" );
+    progress_callback.report_incremental_progress(inc_amt);
+
+    // Visit the candidates in index order so that ties go to the lower index.
+    candidates.clear();
+    m_prior.find_candidates(grid, ip, candidates);
+    std::sort(candidates.begin(), candidates.end());
+    num_compared += candidates.size();
+
+    // The two nearest allowed points
+    int32 nearest0 = -1, nearest1 = -1;
+    float dist0 = std::numeric_limits<float>::max(), dist1 = dist0;
+    for (size_t k = 0; k < candidates.size(); ++k) {
+      float dist = m_distance_metric(*ip2_iters[candidates[k]], ip, dist1);
+      if (dist < dist0) {
+        nearest1 = nearest0;  dist1 = dist0;
+        nearest0 = candidates[k]; dist0 = dist;
+      } else if (dist < dist1) {
+        nearest1 = candidates[k]; dist1 = dist;
+      }
+    }
+
+    // Check the user constraint, then make sure the nearest point is
+    // significantly closer than the next one, if there is one.
+    bool matched = false;
+    if (nearest0 >= 0 && m_constraint(*ip2_iters[nearest0], ip)) {
+      if (nearest1 >= 0)
+        matched = double(dist0) < m_threshold * double(dist1);
+      else
+        matched = double(dist0) < m_max_distance;
+    }
+    if (matched)
+      index_list.push_back( nearest0 );
+    else
+      index_list.push_back( (size_t)(-1) ); // Last value of size_t
+  }
+  progress_callback.report_finished();
+
+  vw_out(DebugMessage,"interest_point") << "Guided matching compared " << num_compared
+                                        << " of " << ip1_size*ip2_size << " descriptor pairs.\n";
+} // End GuidedInterestPointMatcher::operator()
+
+template <class MetricT, class PriorT, class ConstraintT>
+template <class ListT, class MatchListT>
+void GuidedInterestPointMatcher<MetricT, PriorT, ConstraintT>::operator()( ListT const& ip1, ListT const& ip2,
+                                                                           MatchListT& matched_ip1, MatchListT& matched_ip2,
+                                                                           const ProgressCallback &progress_callback) const {
+  matched_ip1.clear();
+  matched_ip2.clear();
+
+  std::vector<size_t> index_list;
+  this->operator()(ip1, ip2, index_list, progress_callback);
+  if (index_list.empty())
+    return;
+
+  std::vector<typename ListT::const_iterator> ip2_iters;
+  ip2_iters.reserve(ip2.size());
+  for (typename ListT::const_iterator iter = ip2.begin(); iter != ip2.end(); ++iter)
+    ip2_iters.push_back(iter);
+
+  size_t i = 0;
+  BOOST_FOREACH( InterestPoint const& ip, ip1 ) {
+    size_t list_position = index_list[i++];
+    if (list_position < ip2_iters.size()) {
+      matched_ip1.push_back(ip);
+      matched_ip2.push_back(*ip2_iters[list_position]);
+    }
+  }
+}
+
 }} // namespace vw::ip
 
 #endif // _INTEREST_POINT_MATCHER_H_
@@ -89,3 +89,31 @@ TEST( BoxFilter, FilterView ) {
   EXPECT_NEAR( 0, applied(0,0), 1e-5 );
   EXPECT_NEAR( 0, applied(3,3), 1e-5 );
 }
+
+TEST( BoxFilter, ApplyByRows ) {
+  ImageView<float> image(40,30);
+  for ( int j = 0; j < image.rows(); j++ )
+    for ( int i = 0; i < image.cols(); i++ )
+      image(i,j) = float((i*7 + j*13) % 17) - 0.25f*i;
+  ImageView<float> integral = IntegralImage( image );
+
+  BoxFilter filter;
+  filter.resize(3);
+  filter[0].start = Vector2i(-5,-5);
+  filter[0].size = Vector2i(11,11);
+  filter[0].weight = 0.5;
+  filter[1].start = Vector2i(-2,-1);
+  filter[1].size = Vector2i(5,3);
+  filter[1].weight = -2;
+  filter[2].start = Vector2i(-1,-3);
+  filter[2].size = Vector2i(3,7);
+  filter[2].weight = 1.5;
+
+  ImageView<float> expected = box_filter( integral, filter );
+  ImageView<float> applied = apply_box_filter( integral, filter );
+  ASSERT_EQ( expected.cols(), applied.cols() );
+  ASSERT_EQ( expected.rows(), applied.rows() );
+  for ( int j = 0; j < applied.rows(); j++ )
+    for ( int i = 0; i < applied.cols(); i++ )
+      EXPECT_EQ( expected(i,j), applied(i,j) );
+}
@@ -0,0 +1,178 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+#include <vw/InterestPoint/BruteForceMatcher.h>
+
+#include <algorithm>
+#include <vector>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using namespace vw;
+using namespace vw::ip;
+
+namespace {
+
+  // Sort every reference by (distance, index) and keep the first knn.
+  template <class T, class DistFuncT>
+  void exhaustive_knn( std::vector<T> const& query, std::vector<T> const& reference,
+                       size_t length, size_t knn, DistFuncT dist_func,
+                       std::vector<int32> & indices, std::vector<float> & distances ) {
+    const size_t num_query = query.size() / length, num_reference = reference.size() / length;
+    indices.assign( num_query*knn, -1 );
+    distances.assign( num_query*knn, 0 );
+    for ( size_t q = 0; q < num_query; q++ ) {
+      std::vector<std::pair<float,int32> > all;
+      for ( size_t r = 0; r < num_reference; r++ )
+        all.push_back( std::make_pair( dist_func( &query[q*length], &reference[r*length], length ),
+                                       int32(r) ) );
+      std::sort( all.begin(), all.end() );
+      for ( size_t k = 0; k < std::min( knn, all.size() ); k++ ) {
+        distances[q*knn+k] = all[k].first;
+        indices  [q*knn+k] = all[k].second;
+      }
+    }
+  }
+
+  float l2_distance( float const* a, float const* b, size_t length ) {
+    float sum = 0;
+    for ( size_t i = 0; i < length; i++ )
+      sum += (a[i]-b[i]) * (a[i]-b[i]);
+    return sum;
+  }
+
+  float bit_distance( uint8 const* a, uint8 const* b, size_t length ) {
+    int count = 0;
+    for ( size_t i = 0; i < length; i++ )
+      for ( uint8 diff = a[i] ^ b[i]; diff; diff &= diff - 1 )
+        count++;
+    return float(count);
+  }
+
+  /// Counts progress reports, optionally requesting an abort at the first one.
+  class CountingProgress : public ProgressCallback {
+    bool m_abort_on_report;
+  public:
+    mutable int reports;
+    CountingProgress( bool abort_on_report ) : m_abort_on_report(abort_on_report), reports(0) {}
+    virtual void report_incremental_progress( double incremental_progress ) const {
+      ProgressCallback::report_incremental_progress( incremental_progress );
+      Mutex::Lock lock( m_mutex );
+      reports++;
+      if ( m_abort_on_report )
+        m_abort_requested = true;
+    }
+  };
+
+} // end anonymous namespace
+
+TEST( BruteForceMatcher, L2 ) {
+  // Sizes which do not fill the last query group or reference block.
+  const size_t length = 37, num_query = 301, num_reference = 700, knn = 3;
+  boost::random::mt19937 gen(7);
+  boost::random::uniform_real_distribution<float> dist(-1, 1);
+  std::vector<float> query( num_query*length ), reference( num_reference*length );
+  for ( size_t i = 0; i < query.size(); i++ )     query[i]     = dist(gen);
+  for ( size_t i = 0; i < reference.size(); i++ ) reference[i] = dist(gen);
+
+  std::vector<int32> indices( num_query*knn ), expected_indices;
+  std::vector<float> distances( num_query*knn ), expected_distances;
+  brute_force_knn_l2( &query[0], num_query, &reference[0], num_reference, length, knn,
+                      &indices[0], &distances[0] );
+  exhaustive_knn( query, reference, length, knn, l2_distance,
+                  expected_indices, expected_distances );
+  for ( size_t i = 0; i < indices.size(); i++ ) {
+    EXPECT_EQ   ( expected_indices[i],   indices[i] );
+    EXPECT_NEAR ( expected_distances[i], distances[i], 1e-4 );
+  }
+}
+
+TEST( BruteForceMatcher, Hamming ) {
+  boost::random::mt19937 gen(11);
+  boost::random::uniform_int_distribution<int> dist(0, 255);
+  // Lengths which do and do not fill whole 64 bit words.
+  const size_t lengths[] = { 32, 61 };
+  for ( size_t l = 0; l < 2; l++ ) {
+    const size_t length = lengths[l], num_query = 130, num_reference = 1000, knn = 2;
+    std::vector<uint8> query( num_query*length ), reference( num_reference*length );
+    for ( size_t i = 0; i < query.size(); i++ )     query[i]     = dist(gen);
+    for ( size_t i = 0; i < reference.size(); i++ ) reference[i] = dist(gen);
+
+    std::vector<int32> indices( num_query*knn ), expected_indices;
+    std::vector<float> distances( num_query*knn ), expected_distances;
+    brute_force_knn( &query[0], num_query, &reference[0], num_reference, length, knn,
+                     &indices[0], &distances[0] );
+    exhaustive_knn( query, reference, length, knn, bit_distance,
+                    expected_indices, expected_distances );
+    // Distances are exact, and ties go to the lower index.
+    for ( size_t i = 0; i < indices.size(); i++ ) {
+      EXPECT_EQ( expected_indices[i],   indices[i] );
+      EXPECT_EQ( expected_distances[i], distances[i] );
+    }
+  }
+}
+
+TEST( BruteForceMatcher, FewReferences ) {
+  float query[]     = { 0, 0,  5, 5 };
+  float reference[] = { 1, 0,  4, 6 };
+  int32 indices[6];
+  float distances[6];
+  brute_force_knn_l2( query, 2, reference, 2, 2, 3, indices, distances );
+  EXPECT_EQ( 0, indices[0] );
+  EXPECT_EQ( 1, indices[1] );
+  EXPECT_EQ( -1, indices[2] );
+  EXPECT_EQ( 1, indices[3] );
+  EXPECT_NEAR( 2.0, distances[3], 1e-6 );
+  EXPECT_EQ( -1, indices[5] );
+
+  EXPECT_THROW( brute_force_knn_l2( query, 2, reference, 2, 2, 0, indices, distances ),
+                ArgumentErr );
+}
+
+TEST( BruteForceMatcher, Progress ) {
+  // Enough queries for many more tiles than threads.
+  const size_t length = 8, num_query = 64*256, num_reference = 50, knn = 2;
+  std::vector<float> query( num_query*length ), reference( num_reference*length );
+  for ( size_t i = 0; i < query.size(); i++ )     query[i]     = float(i % 17);
+  for ( size_t i = 0; i < reference.size(); i++ ) reference[i] = float(i % 13);
+  std::vector<int32> indices( num_query*knn );
+  std::vector<float> distances( num_query*knn );
+
+  CountingProgress progress( false );
+  brute_force_knn_l2( &query[0], num_query, &reference[0], num_reference, length, knn,
+                      &indices[0], &distances[0], progress );
+  EXPECT_EQ( 64, progress.reports );
+  EXPECT_NEAR( 1.0, progress.progress(), 1e-6 );
+
+  // Tiles after the abort request are skipped.
+  CountingProgress abort( true );
+  EXPECT_THROW( brute_force_knn_l2( &query[0], num_query, &reference[0], num_reference, length,
+                                    knn, &indices[0], &distances[0], abort ),
+                Aborted );
+  EXPECT_LT( abort.reports, 64 );
+}
+
+TEST( BruteForceMatcher, Preference ) {
+  // Small searches are exhaustive, large float searches use a tree.
+  EXPECT_TRUE ( prefer_brute_force_knn( false, 1000, 1000, 128 ) );
+  EXPECT_TRUE ( prefer_brute_force_knn( true, 20000, 20000, 32 ) );
+  EXPECT_FALSE( prefer_brute_force_knn( false, 200000, 200000, 128 ) );
+}
@@ -0,0 +1,59 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+#include <vw/InterestPoint/Descriptor.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+
+using namespace vw;
+using namespace vw::ip;
+
+TEST( Descriptor, DescribeSet ) {
+  // Wide enough for two description blocks.
+  ImageView<PixelGray<float> > image(1300, 200);
+  for (int row = 0; row < image.rows(); ++row)
+    for (int col = 0; col < image.cols(); ++col)
+      image(col, row) = 0.5f + 0.25f*sin(0.11f*col + 0.07f*row) + 0.2f*cos(0.05f*col*row/200.0f);
+
+  // Points in both blocks and next to the seam, told apart by their interest.
+  std::vector<InterestPoint> points;
+  for (int i = 0; i < 40; ++i) {
+    InterestPoint ip(30.25f + 31.5f*i, 20.5f + 4.0f*i, 1.0f + 0.05f*(i%5), float(i), 0.3f*i);
+    points.push_back(ip);
+  }
+  points.push_back(InterestPoint(1023.75f, 100.0f, 1.5f, 40.0f, 0.0f));
+  points.push_back(InterestPoint(1024.25f, 100.0f, 1.5f, 41.0f, 0.0f));
+
+  SGradDescriptorGenerator descriptor;
+  InterestPointList list(points.begin(), points.end());
+  describe_interest_points(image, descriptor, list);
+  InterestPointSet set(points);
+  describe_interest_points(image, descriptor, set);
+
+  ASSERT_EQ(size_t(descriptor.descriptor_size()), set.descriptor_length());
+  ASSERT_EQ(list.size(), set.size());
+  // The list version reorders the points by block.
+  for (InterestPointList::const_iterator it = list.begin(); it != list.end(); ++it) {
+    const size_t i = size_t(it->interest);
+    EXPECT_EQ(it->x, set.x(i));
+    ASSERT_EQ(set.descriptor_length(), it->descriptor.size());
+    for (size_t k = 0; k < set.descriptor_length(); ++k)
+      EXPECT_NEAR(it->descriptor[k], set.descriptor(i)[k], 1e-5);
+  }
+}
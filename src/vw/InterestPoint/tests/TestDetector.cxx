@@ -0,0 +1,135 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+#include <vw/InterestPoint/Detector.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using namespace vw;
+using namespace vw::ip;
+using namespace vw::test;
+
+namespace {
+
+  // An image of randomly placed bright and dark blobs.
+  ImageView<PixelGray<float> > blob_image(int cols, int rows, int num_blobs) {
+    boost::random::mt19937 gen(42);
+    boost::random::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    ImageView<PixelGray<float> > image(cols, rows);
+    fill(image, PixelGray<float>(0.5f));
+    for (int b = 0; b < num_blobs; ++b) {
+      const float cx = unit(gen)*cols, cy = unit(gen)*rows;
+      const float sigma = 1.5f + 6.0f*unit(gen);
+      const float height = unit(gen) - 0.5f;
+      for (int row = 0; row < rows; ++row)
+        for (int col = 0; col < cols; ++col) {
+          const float dx = col - cx, dy = row - cy;
+          image(col, row) += height * exp(-(dx*dx + dy*dy) / (2*sigma*sigma));
+        }
+    }
+    return image;
+  }
+
+  bool location_order(InterestPoint const& a, InterestPoint const& b) {
+    if (a.iy != b.iy)
+      return a.iy < b.iy;
+    if (a.ix != b.ix)
+      return a.ix < b.ix;
+    return a.scale < b.scale;
+  }
+
+  template <class DetectorT>
+  void expect_same_as_whole_image(DetectorT & detector,
+                                  ImageView<PixelGray<float> > const& image, int tile_size) {
+    InterestPointList whole_list = detector(image);
+    InterestPointList tiled_list = detect_interest_points_tiled(image, detector, 0, tile_size);
+    std::vector<InterestPoint> whole(whole_list.begin(), whole_list.end());
+    std::vector<InterestPoint> tiled(tiled_list.begin(), tiled_list.end());
+    std::sort(whole.begin(), whole.end(), location_order);
+    std::sort(tiled.begin(), tiled.end(), location_order);
+
+    ASSERT_LT(10u, whole.size());
+    ASSERT_EQ(whole.size(), tiled.size());
+    for (size_t i = 0; i < whole.size(); ++i) {
+      // Only the shift by the tile origin may round differently.
+      EXPECT_NEAR(whole[i].x,         tiled[i].x, 1e-3);
+      EXPECT_NEAR(whole[i].y,         tiled[i].y, 1e-3);
+      EXPECT_EQ(whole[i].ix,          tiled[i].ix);
+      EXPECT_EQ(whole[i].iy,          tiled[i].iy);
+      EXPECT_EQ(whole[i].scale,       tiled[i].scale);
+      EXPECT_EQ(whole[i].interest,    tiled[i].interest);
+      EXPECT_EQ(whole[i].orientation, tiled[i].orientation);
+    }
+  }
+
+} // namespace
+
+TEST( Detector, TiledMatchesWholeImage ) {
+  ImageView<PixelGray<float> > image = blob_image(200, 170, 60);
+
+  ScaledInterestPointDetector<LogInterestOperator> log_detector(LogInterestOperator(0.01), 0);
+  EXPECT_EQ(0, log_detector.support_radius() % 4);
+  expect_same_as_whole_image(log_detector, image, 64);
+
+  ScaledInterestPointDetector<HarrisInterestOperator> harris_detector(HarrisInterestOperator(1e-6), 3, 2, 0);
+  EXPECT_EQ(0, harris_detector.support_radius() % 2);
+  expect_same_as_whole_image(harris_detector, image, 48);
+}
+
+TEST( Detector, TiledGlobalLimit ) {
+  ImageView<PixelGray<float> > image = blob_image(200, 170, 60);
+  ScaledInterestPointDetector<LogInterestOperator> detector(LogInterestOperator(0.01), 0);
+
+  InterestPointList all_list = detect_interest_points_tiled(image, detector, 0, 64);
+  std::vector<InterestPoint> all(all_list.begin(), all_list.end());
+  ASSERT_LT(40u, all.size());
+  std::stable_sort(all.begin(), all.end());
+
+  const int MAX_POINTS = 25;
+  InterestPointList limited_list = detect_interest_points_tiled(image, detector, MAX_POINTS, 64);
+  std::vector<InterestPoint> limited(limited_list.begin(), limited_list.end());
+  ASSERT_EQ(size_t(MAX_POINTS), limited.size());
+  std::stable_sort(limited.begin(), limited.end());
+  for (int i = 0; i < MAX_POINTS; ++i) {
+    EXPECT_EQ(all[i].interest, limited[i].interest);
+    EXPECT_EQ(all[i].x,        limited[i].x);
+    EXPECT_EQ(all[i].y,        limited[i].y);
+  }
+}
+
+TEST( Detector, TiledSeamMerge ) {
+  // Points found on both sides of a seam are merged, keeping the stronger.
+  TiledInterestPointCollector collector(BBox2i(0, 0, 100, 100), 0);
+  InterestPointList left, right;
+  left.push_back (InterestPoint(49.8f, 20.0f, 1.0f, 2.0f));
+  left.push_back (InterestPoint(10.0f, 10.0f, 1.0f, 1.0f));
+  right.push_back(InterestPoint(50.1f, 20.2f, 1.1f, 3.0f));
+  right.push_back(InterestPoint(50.2f, 80.0f, 1.0f, 1.0f));
+  right.push_back(InterestPoint(20.0f, 80.0f, 1.0f, 1.0f)); // In the halo of the right tile
+  collector.add(1, BBox2i(50, 0, 50, 100), right);
+  collector.add(0, BBox2i( 0, 0, 50, 100), left);
+
+  InterestPointList result = collector.result();
+  ASSERT_EQ(3u, result.size());
+  InterestPointList::const_iterator pt = result.begin();
+  EXPECT_EQ(10.0f, pt->x); ++pt;
+  EXPECT_EQ(50.1f, pt->x); ++pt;
+  EXPECT_EQ(50.2f, pt->x);
+}
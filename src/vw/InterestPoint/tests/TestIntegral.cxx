@@ -20,6 +20,7 @@
 #include <gtest/gtest_VW.h>
 
 #include <vw/InterestPoint/IntegralImage.h>
+#include <vw/InterestPoint/BoxFilter.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Interpolation.h>
 #include <vw/FileIO/DiskImageResource.h>
@@ -247,3 +248,77 @@ TEST( Integral, InterpolationProof ) {
                              10.5, 10.0, 10 ),
                1e-4 );
 }
+
+namespace {
+  ImageView<float> random_image( int cols, int rows ) {
+    ImageView<float> image( cols, rows );
+    uint32 state = 12345;
+    for ( int j = 0; j < rows; j++ )
+      for ( int i = 0; i < cols; i++ ) {
+        state = state * 1664525u + 1013904223u;
+        image(i,j) = float(state >> 8) / float(1 << 24);
+      }
+    return image;
+  }
+}
+
+TEST( Integral, ParallelStrips ) {
+  ImageView<float> image = random_image( 301, 1100 );
+
+  // Reference sums, a row at a time in long double.
+  ImageView<long double> expected( image.cols()+1, image.rows()+1 );
+  fill( expected, 0 );
+  for ( int j = 0; j < image.rows(); j++ ) {
+    long double run = 0;
+    for ( int i = 0; i < image.cols(); i++ ) {
+      run += image(i,j);
+      expected(i+1,j+1) = expected(i+1,j) + run;
+    }
+  }
+
+  ImageView<double> integral;
+  integral_image( image, integral, 4 );
+  ImageView<float> float_integral = IntegralImage( image, 4 );
+  // A lazy source is rasterized once and gives the same sums.
+  ImageView<double> lazy_integral;
+  integral_image( pixel_cast<double>( image ), lazy_integral, 4 );
+
+  ASSERT_EQ( image.cols()+1, integral.cols() );
+  ASSERT_EQ( image.rows()+1, integral.rows() );
+  ASSERT_EQ( image.cols()+1, float_integral.cols() );
+  for ( int j = 0; j < integral.rows(); j++ )
+    for ( int i = 0; i < integral.cols(); i++ ) {
+      EXPECT_NEAR( double(expected(i,j)), integral(i,j), 1e-9*(1+double(expected(i,j))) );
+      EXPECT_EQ( integral(i,j), lazy_integral(i,j) );
+      // The float integral is only rounded once.
+      EXPECT_NEAR( double(expected(i,j)), float_integral(i,j), 6e-8*double(expected(i,j)) );
+    }
+}
+
+TEST( Integral, RowResponses ) {
+  ImageView<double> integral = IntegralImage( ImageView<double>( random_image( 90, 80 ) ) );
+  std::vector<double> row( 40 );
+
+  for ( unsigned filter_size = 9; filter_size <= 27; filter_size += 6 ) {
+    box_filter_row( integral, x_second_derivative_filter( filter_size ), 40, 20, 60, &row[0] );
+    for ( int x = 20; x < 60; x++ )
+      EXPECT_NEAR( XSecondDerivative( integral, x, 40, filter_size ), row[x-20], 1e-6 );
+    box_filter_row( integral, y_second_derivative_filter( filter_size ), 40, 20, 60, &row[0] );
+    for ( int x = 20; x < 60; x++ )
+      EXPECT_NEAR( YSecondDerivative( integral, x, 40, filter_size ), row[x-20], 1e-6 );
+    box_filter_row( integral, xy_derivative_filter( filter_size ), 40, 20, 60, &row[0] );
+    for ( int x = 20; x < 60; x++ )
+      EXPECT_NEAR( XYDerivative( integral, x, 40, filter_size ), row[x-20], 1e-6 );
+  }
+
+  // The point wavelets sum in float.
+  const float sizes[] = { 4, 5, 10, 13 };
+  for ( int s = 0; s < 4; s++ ) {
+    box_filter_row( integral, h_haar_wavelet_filter( sizes[s] ), 30, 20, 60, &row[0] );
+    for ( int x = 20; x < 60; x++ )
+      EXPECT_NEAR( HHaarWavelet( integral, x, 30, sizes[s] ), row[x-20], 1e-3 );
+    box_filter_row( integral, v_haar_wavelet_filter( sizes[s] ), 30, 20, 60, &row[0] );
+    for ( int x = 20; x < 60; x++ )
+      EXPECT_NEAR( VHaarWavelet( integral, x, 30, sizes[s] ), row[x-20], 1e-3 );
+  }
+}
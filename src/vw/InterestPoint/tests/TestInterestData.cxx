@@ -19,6 +19,11 @@
 #include <gtest/gtest_VW.h>
 #include <test/Helpers.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+#include <vw/InterestPoint/InterestPointFile.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <fstream>
 
 using namespace vw;
 using namespace vw::ip;
@@ -108,3 +113,210 @@ TEST( InterestData, MATCH_IO_Loop ) {
     ip1iter++; ip2iter++;
   }
 }
+
+TEST( InterestData, SetConversion ) {
+  InterestPointList ip;
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ip.push_back( InterestPoint( 2*i, 2*i+5, 1.0+i, -float(i), i, i%2, 5, i ) );
+    ip.back().descriptor = Vector3(5,6,i);
+  }
+  ip.front().ix = 42;
+
+  InterestPointSet set( ip );
+  ASSERT_EQ( 5u, set.size() );
+  ASSERT_EQ( 3u, set.descriptor_length() );
+  EXPECT_EQ( 0u, size_t(set.descriptor_data()) % InterestPointSet::DESCRIPTOR_ALIGNMENT );
+  EXPECT_EQ( 42, set.ix(0) );
+  EXPECT_EQ( 4.0, set.descriptor_data()[3*4+2] ); // Rows are contiguous
+  EXPECT_EQ( set.descriptor(4), set.descriptor_data()+12 );
+
+  std::vector<InterestPoint> result;
+  set.to_list( result );
+  ASSERT_EQ( 5u, result.size() );
+  InterestPointList::iterator ipiter = ip.begin();
+  for ( uint32 i = 0; i < 5; i++ ) {
+    EXPECT_EQ( ipiter->x, result[i].x );
+    EXPECT_EQ( ipiter->y, result[i].y );
+    EXPECT_EQ( ipiter->scale, result[i].scale );
+    EXPECT_EQ( ipiter->ix, result[i].ix );
+    EXPECT_EQ( ipiter->iy, result[i].iy );
+    EXPECT_EQ( ipiter->orientation, result[i].orientation );
+    EXPECT_EQ( ipiter->interest, result[i].interest );
+    EXPECT_EQ( ipiter->polarity, result[i].polarity );
+    EXPECT_EQ( ipiter->octave, result[i].octave );
+    EXPECT_EQ( ipiter->scale_lvl, result[i].scale_lvl );
+    EXPECT_VECTOR_FLOAT_EQ( ipiter->descriptor, result[i].descriptor );
+    ipiter++;
+  }
+  EXPECT_EQ( 0u, set.point(1, false).descriptor.size() );
+
+  // Crop and copying between sets
+  InterestPointSet cropped = crop( set, BBox2(1, 6, 4, 4) );
+  ASSERT_EQ( 2u, cropped.size() );
+  EXPECT_EQ( 4, cropped.x(1) );
+  cropped.push_back( set, 0 );
+  ASSERT_EQ( 3u, cropped.size() );
+  EXPECT_EQ( 0, cropped.x(2) );
+  EXPECT_EQ( 0, cropped.descriptor(2)[2] );
+  EXPECT_EQ( 6, cropped.descriptor(2)[1] );
+
+  // Binary descriptors are stored as bytes
+  ip.front().descriptor = Vector3(255, 0, 17);
+  BinaryInterestPointSet binary( ip );
+  EXPECT_EQ( 255, binary.descriptor(0)[0] );
+  EXPECT_EQ( 17,  binary.descriptor(0)[2] );
+  EXPECT_EQ( 17,  binary.point(0).descriptor[2] );
+}
+
+TEST( InterestData, SetIO ) {
+  InterestPointList ip;
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ip.push_back( InterestPoint( 2*i, 2*i+5, 1.0, -float(i), i, true, 5 ) );
+    ip.back().descriptor = Vector3(5,6,i);
+  }
+
+  // Sets use the same files as lists, in both directions.
+  UnlinkName vwip_file( "monkey_set.vwip" );
+  write_binary_ip_file( vwip_file, InterestPointSet(ip) );
+  std::vector<InterestPoint> legacy = read_binary_ip_file( vwip_file );
+  ASSERT_EQ( 5u, legacy.size() );
+  EXPECT_VECTOR_FLOAT_EQ( Vector3(5,6,3), legacy[3].descriptor );
+
+  write_binary_ip_file( vwip_file, ip );
+  InterestPointSet set;
+  read_binary_ip_file( vwip_file, set );
+  ASSERT_EQ( 5u, set.size() );
+  ASSERT_EQ( 3u, set.descriptor_length() );
+  for ( uint32 i = 0; i < 5; i++ ) {
+    EXPECT_EQ( legacy[i].x,        set.x(i) );
+    EXPECT_EQ( legacy[i].y,        set.y(i) );
+    EXPECT_EQ( legacy[i].interest, set.interest(i) );
+    EXPECT_EQ( legacy[i].polarity, set.polarity(i) != 0 );
+    EXPECT_EQ( legacy[i].octave,   set.octave(i) );
+    EXPECT_EQ( float(i),           set.descriptor(i)[2] );
+  }
+
+  UnlinkName match_file( "monkey_set.match" );
+  std::vector<InterestPoint> ip1( ip.begin(), ip.end() ), ip2( ip.rbegin(), ip.rend() );
+  write_binary_match_file( match_file, ip1, ip2 );
+  InterestPointSet set1, set2;
+  read_binary_match_file( match_file, set1, set2 );
+  ASSERT_EQ( 5u, set1.size() );
+  ASSERT_EQ( 5u, set2.size() );
+  EXPECT_EQ( 8, set2.x(0) );
+  EXPECT_EQ( 4, set2.descriptor(0)[2] );
+
+  write_binary_match_file( match_file, set2, set1 );
+  std::vector<InterestPoint> result1, result2;
+  read_binary_match_file( match_file, result1, result2 );
+  ASSERT_EQ( 5u, result1.size() );
+  EXPECT_EQ( 8, result1[0].x );
+  EXPECT_EQ( 0, result2[0].x );
+  EXPECT_VECTOR_FLOAT_EQ( Vector3(5,6,4), result1[0].descriptor );
+}
+
+TEST( InterestData, MappedIO ) {
+  boost::random::mt19937 gen(42);
+  boost::random::uniform_real_distribution<float> coord(-50, 450);
+  InterestPointSet set;
+  for ( uint32 i = 0; i < 2000; i++ ) {
+    InterestPoint p( coord(gen), coord(gen), 1.5, float(i), 0.25*i, i%3 == 0, i%4, i%5 );
+    p.ix = i;
+    p.iy = -int32(i);
+    p.descriptor = Vector3(i, 2*i, 0.5);
+    set.push_back( p );
+  }
+  set.x(7) = 400; // On the edge of a crop box below
+
+  UnlinkName vwip_file( "monkey_mapped.vwip" );
+  write_mapped_ip_file( vwip_file, set );
+  EXPECT_TRUE ( is_mapped_ip_file( vwip_file ) );
+
+  MappedInterestPointFile file( vwip_file );
+  ASSERT_EQ( 1u, file.num_sets() );
+  MappedInterestPointSet const& mapped = file[0];
+  ASSERT_EQ( 2000u, mapped.size() );
+  ASSERT_EQ( 3u, mapped.descriptor_length() );
+  EXPECT_EQ( 0u, size_t(mapped.descriptor_data<float>()) % 64 );
+  EXPECT_THROW( mapped.descriptor_data<uint8>(), ArgumentErr );
+  for ( uint32 i = 0; i < 2000; i++ ) {
+    EXPECT_EQ( set.x(i),           mapped.x_data()[i] );
+    EXPECT_EQ( set.y(i),           mapped.y_data()[i] );
+    EXPECT_EQ( set.ix(i),          mapped.ix_data()[i] );
+    EXPECT_EQ( set.iy(i),          mapped.iy_data()[i] );
+    EXPECT_EQ( set.orientation(i), mapped.orientation_data()[i] );
+    EXPECT_EQ( set.interest(i),    mapped.interest_data()[i] );
+    EXPECT_EQ( set.polarity(i),    mapped.polarity_data()[i] );
+    EXPECT_EQ( set.octave(i),      mapped.octave_data()[i] );
+    EXPECT_EQ( set.scale_lvl(i),   mapped.scale_lvl_data()[i] );
+    EXPECT_EQ( set.descriptor(i)[1], mapped.descriptor_data<float>()[3*i+1] );
+  }
+
+  // The readers for the original format also take mapped files.
+  std::vector<InterestPoint> legacy = read_binary_ip_file( vwip_file );
+  ASSERT_EQ( 2000u, legacy.size() );
+  EXPECT_EQ( set.x(1999), legacy[1999].x );
+  EXPECT_VECTOR_FLOAT_EQ( Vector3(1999, 3998, 0.5), legacy[1999].descriptor );
+  BinaryInterestPointSet binary;
+  read_binary_ip_file( vwip_file, binary );
+  ASSERT_EQ( 2000u, binary.size() );
+  EXPECT_EQ( 20, binary.descriptor(10)[1] );
+
+  // Crops match ip::crop on the full list.
+  InterestPointList list;
+  set.to_list( list );
+  BBox2 boxes[] = { BBox2(0, 0, 100, 100), BBox2(400, -100, 10, 600), BBox2(-60, -60, 520, 520),
+                    BBox2(1000, 1000, 5, 5), BBox2(37.5, 12.25, 0.5, 300) };
+  for ( size_t b = 0; b < sizeof(boxes)/sizeof(boxes[0]); b++ ) {
+    InterestPointList expected = crop( list, boxes[b] );
+    InterestPointSet result;
+    mapped.crop( boxes[b], result );
+    ASSERT_EQ( expected.size(), result.size() );
+    size_t i = 0;
+    for ( InterestPointList::const_iterator it = expected.begin(); it != expected.end(); ++it, ++i ) {
+      EXPECT_EQ( it->x,  result.x(i) );
+      EXPECT_EQ( it->ix, result.ix(i) );
+      EXPECT_EQ( it->descriptor[1], result.descriptor(i)[1] );
+    }
+  }
+  std::vector<size_t> indices;
+  mapped.crop_indices( BBox2i(400, 0, 1, 1000), indices );
+  EXPECT_TRUE( std::find(indices.begin(), indices.end(), size_t(7)) != indices.end() );
+}
+
+TEST( InterestData, MappedMatchIO ) {
+  BinaryInterestPointSet ip1, ip2;
+  for ( uint32 i = 0; i < 5; i++ ) {
+    InterestPoint p( 2*i, 2*i+5, 1.0, -float(i), i, true, 5 );
+    p.descriptor = Vector3(5, 6, i);
+    ip1.push_back( p );
+    p.x += 100;
+    ip2.push_back( p );
+  }
+
+  UnlinkName match_file( "monkey_mapped.match" );
+  write_mapped_match_file( match_file, ip1, ip2 );
+  std::vector<InterestPoint> result1, result2;
+  read_binary_match_file( match_file, result1, result2 );
+  ASSERT_EQ( 5u, result1.size() );
+  ASSERT_EQ( 5u, result2.size() );
+  EXPECT_EQ( 6,   result1[3].x );
+  EXPECT_EQ( 106, result2[3].x );
+  EXPECT_VECTOR_FLOAT_EQ( Vector3(5,6,3), result2[3].descriptor );
+  EXPECT_THROW( read_binary_ip_file( match_file ), IOErr );
+
+  // Files which lost their tail are rejected when opened.
+  MappedInterestPointFile file( match_file );
+  EXPECT_EQ( MAPPED_DESCRIPTOR_UINT8, file[1].descriptor_type() );
+  std::ifstream in( match_file.c_str(), std::ios::binary );
+  std::string contents( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+  UnlinkName truncated_file( "monkey_truncated.match" );
+  std::ofstream out( truncated_file.c_str(), std::ios::binary );
+  out.write( contents.data(), contents.size()-64 );
+  out.close();
+  EXPECT_THROW( MappedInterestPointFile truncated( truncated_file ), IOErr );
+
+  // Empty sets are allowed.
+  write_mapped_ip_file( match_file, InterestPointSet() );
+  EXPECT_EQ( 0u, read_binary_ip_file( match_file ).size() );
+}
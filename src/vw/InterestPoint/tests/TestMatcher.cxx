@@ -24,6 +24,8 @@
 #include <test/Helpers.h>
 
 #include <algorithm>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
 
 using namespace vw;
 using namespace vw::ip;
@@ -134,6 +136,224 @@ TEST( Matcher, Matcher ) {
                     Vector3(0,8,0) );
 
   EXPECT_EQ( matched_indexes[0], 3 );
+
+  // The quality comes from the distances to the nearest and second nearest points.
+  std::vector<double> match_quality;
+  matcher(ip1_list, ip2_list, matched_ip1, matched_ip2, match_quality);
+  ASSERT_EQ( 1u, match_quality.size() );
+  L2NormMetric metric;
+  EXPECT_NEAR( 1.0 - metric(ip1a, ip2d)/metric(ip1a, ip2c), match_quality[0], 1e-6 );
 }
 
 
+
+TEST( Matcher, BinarySetMatcher ) {
+  // Each point of ip2 is a point of ip1 in reverse order with a few bits flipped.
+  BinaryInterestPointSet ip1, ip2;
+  for ( int i = 0; i < 50; i++ ) {
+    InterestPoint ip( i, 2*i, 1.0 );
+    ip.descriptor.set_size( 32 );
+    for ( int j = 0; j < 32; j++ )
+      ip.descriptor[j] = (i*37 + j*101 + (i*j)%7) % 256;
+    ip1.push_back( ip );
+  }
+  for ( int i = 49; i >= 0; i-- ) {
+    ip2.push_back( ip1, i );
+    ip2.descriptor( ip2.size()-1 )[i % 32] ^= 0x5;
+  }
+
+  InterestPointMatcher<HammingMetric,NullConstraint> matcher( 0.8 );
+  std::vector<size_t> matched_indexes;
+  matcher( ip1, ip2, matched_indexes );
+  ASSERT_EQ( 50u, matched_indexes.size() );
+  for ( size_t i = 0; i < 50; i++ )
+    EXPECT_EQ( 49-i, matched_indexes[i] );
+
+  BinaryInterestPointSet matched_ip1, matched_ip2;
+  matcher( ip1, ip2, matched_ip1, matched_ip2 );
+  ASSERT_EQ( 50u, matched_ip2.size() );
+  EXPECT_EQ( matched_ip1.x(3), matched_ip2.x(3) );
+
+  // Float sets can not be matched by bit counts.
+  InterestPointSet float_ip( 32 );
+  EXPECT_THROW( matcher( float_ip, float_ip, matched_indexes ), ArgumentErr );
+}
+
+namespace {
+
+  // Points of a second image of the same scene under a known transform,
+  // with a few distractors.
+  void make_guided_scene(Matrix3x3 const& transform,
+                         std::vector<InterestPoint> & ip1, std::vector<InterestPoint> & ip2) {
+    boost::random::mt19937 gen(7);
+    boost::random::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (int i = 0; i < 300; ++i) {
+      InterestPoint ip(400*unit(gen), 300*unit(gen), 1.0);
+      ip.descriptor.set_size(16);
+      for (int j = 0; j < 16; ++j)
+        ip.descriptor[j] = unit(gen);
+      ip1.push_back(ip);
+    }
+    for (size_t i = 0; i < ip1.size(); ++i) {
+      Vector3 p = transform*Vector3(ip1[i].x, ip1[i].y, 1);
+      InterestPoint ip(p[0]/p[2] + 0.5*(unit(gen)-0.5), p[1]/p[2] + 0.5*(unit(gen)-0.5), 1.0);
+      ip.descriptor = ip1[i].descriptor;
+      for (int j = 0; j < 16; ++j)
+        ip.descriptor[j] += 0.05*(unit(gen)-0.5);
+      ip2.push_back(ip);
+      if (i % 3 == 0) {
+        // A distractor with a descriptor too similar for the ratio test
+        // over the whole image, but outside the predicted window.
+        InterestPoint far(400*unit(gen), 300*unit(gen), 1.0);
+        far.descriptor = ip.descriptor;
+        far.descriptor[0] += 0.01;
+        ip2.push_back(far);
+      }
+    }
+    std::reverse(ip2.begin(), ip2.end());
+  }
+
+} // namespace
+
+TEST( Matcher, FloatSetMatcher ) {
+  // Matching sets gives the same result as matching vectors of points.
+  std::vector<InterestPoint> ip1, ip2;
+  make_guided_scene(math::identity_matrix<3>(), ip1, ip2);
+  InterestPointSet set1( ip1 ), set2( ip2 );
+
+  InterestPointMatcher<L2NormMetric,NullConstraint> matcher( 0.8 );
+  std::vector<size_t> list_indexes, set_indexes;
+  matcher( ip1, ip2, list_indexes );
+  matcher( set1, set2, set_indexes );
+  ASSERT_LT( 100u, list_indexes.size() );
+  ASSERT_EQ( list_indexes.size(), set_indexes.size() );
+  for ( size_t i = 0; i < list_indexes.size(); i++ )
+    EXPECT_EQ( list_indexes[i], set_indexes[i] );
+
+  std::vector<InterestPoint> list_matched1, list_matched2;
+  InterestPointSet set_matched1, set_matched2;
+  matcher( ip1, ip2, list_matched1, list_matched2 );
+  matcher( set1, set2, set_matched1, set_matched2 );
+  ASSERT_EQ( list_matched1.size(), set_matched1.size() );
+  ASSERT_EQ( list_matched2.size(), set_matched2.size() );
+  for ( size_t i = 0; i < list_matched1.size(); i++ ) {
+    EXPECT_EQ( list_matched1[i].x, set_matched1.x(i) );
+    EXPECT_EQ( list_matched2[i].x, set_matched2.x(i) );
+    EXPECT_EQ( list_matched2[i].y, set_matched2.y(i) );
+    EXPECT_EQ( list_matched2[i].descriptor[3], set_matched2.descriptor(i)[3] );
+  }
+}
+
+TEST( Matcher, InterestPointGrid ) {
+  boost::random::mt19937 gen(3);
+  boost::random::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  std::vector<float> x(500), y(500);
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = 100*unit(gen) - 20;
+    y[i] = 50*unit(gen);
+  }
+  x[7] = 10; y[7] = 10; // On the box edge
+  InterestPointGrid grid(x, y, 3);
+
+  BBox2 box(Vector2(10, 10), Vector2(35, 30));
+  std::vector<uint32> found;
+  grid.find_in_box(box, found);
+  std::sort(found.begin(), found.end());
+  std::vector<uint32> expected;
+  for (size_t i = 0; i < x.size(); ++i)
+    if (x[i] >= 10 && x[i] <= 35 && y[i] >= 10 && y[i] <= 30)
+      expected.push_back(i);
+  ASSERT_LT(10u, expected.size());
+  EXPECT_EQ(expected, found);
+
+  // Lines close to each axis and a diagonal one.
+  Vector3 lines[] = { Vector3(0.1, 1, -25), Vector3(1, -0.2, -40), Vector3(1, 1, -50) };
+  for (int l = 0; l < 3; ++l) {
+    found.clear();
+    grid.find_near_line(lines[l], 2.0, found);
+    std::sort(found.begin(), found.end());
+    expected.clear();
+    const double norm = sqrt(lines[l][0]*lines[l][0] + lines[l][1]*lines[l][1]);
+    for (size_t i = 0; i < x.size(); ++i)
+      if (fabs(lines[l][0]*x[i] + lines[l][1]*y[i] + lines[l][2]) <= 2.0*norm)
+        expected.push_back(i);
+    ASSERT_LT(5u, expected.size());
+    EXPECT_EQ(expected, found);
+  }
+
+  found.clear();
+  grid.find_in_box(BBox2(Vector2(500, 500), Vector2(600, 600)), found);
+  EXPECT_TRUE(found.empty());
+}
+
+TEST( Matcher, GuidedMatcher ) {
+  Matrix3x3 homography;
+  homography(0,0) = 0.9;  homography(0,1) = 0.1;   homography(0,2) = 30;
+  homography(1,0) = -0.1; homography(1,1) = 1.05;  homography(1,2) = -12;
+  homography(2,0) = 1e-4; homography(2,1) = -2e-4; homography(2,2) = 1;
+  std::vector<InterestPoint> ip1, ip2;
+  make_guided_scene(homography, ip1, ip2);
+
+  typedef GuidedInterestPointMatcher<L2NormMetric, HomographyMatchPrior> MatcherT;
+  MatcherT matcher(HomographyMatchPrior(homography, 4.0), 0.8);
+  std::vector<size_t> guided;
+  matcher(ip1, ip2, guided);
+  ASSERT_EQ(ip1.size(), guided.size());
+
+  // Every point matches its transformed copy, even those the distractors
+  // stop the unguided matcher from matching.
+  InterestPointMatcher<L2NormMetric, NullConstraint> unguided(0.8);
+  std::vector<size_t> full;
+  unguided(ip1, ip2, full);
+  size_t num_full = 0;
+  for (size_t i = 0; i < ip1.size(); ++i) {
+    ASSERT_LT(guided[i], ip2.size());
+    Vector3 p = homography*Vector3(ip1[i].x, ip1[i].y, 1);
+    EXPECT_NEAR(p[0]/p[2], ip2[guided[i]].x, 0.5);
+    EXPECT_NEAR(p[1]/p[2], ip2[guided[i]].y, 0.5);
+    if (full[i] < ip2.size()) {
+      ++num_full;
+      EXPECT_EQ(full[i], guided[i]);
+    }
+  }
+  EXPECT_GT(ip1.size(), num_full);
+
+  std::vector<InterestPoint> matched_ip1, matched_ip2;
+  matcher(ip1, ip2, matched_ip1, matched_ip2);
+  ASSERT_EQ(ip1.size(), matched_ip2.size());
+  EXPECT_EQ(ip2[guided[5]].x, matched_ip2[5].x);
+
+  // A point with a single candidate is matched unless it is too far away.
+  std::vector<InterestPoint> single(1, ip1[0]);
+  std::vector<InterestPoint> near_copy(1, ip2[guided[0]]);
+  matcher(single, near_copy, guided);
+  ASSERT_EQ(1u, guided.size());
+  EXPECT_EQ(0u, guided[0]);
+  MatcherT strict(HomographyMatchPrior(homography, 4.0), 0.8, L2NormMetric(), NullConstraint(), 1e-6);
+  strict(single, near_copy, guided);
+  ASSERT_EQ(1u, guided.size());
+  EXPECT_EQ(size_t(-1), guided[0]);
+}
+
+TEST( Matcher, GuidedMatcherEpipolar ) {
+  // A horizontal shift, so the epipolar lines are the rows.
+  Matrix3x3 shift = math::identity_matrix<3>();
+  shift(0,2) = 25;
+  Matrix3x3 fundamental;
+  fundamental(1,2) = -1;
+  fundamental(2,1) = 1;
+  std::vector<InterestPoint> ip1, ip2;
+  make_guided_scene(shift, ip1, ip2);
+
+  GuidedInterestPointMatcher<L2NormMetric, EpipolarMatchPrior>
+    matcher(EpipolarMatchPrior(fundamental, 1.0), 0.8);
+  std::vector<size_t> guided;
+  matcher(ip1, ip2, guided);
+  ASSERT_EQ(ip1.size(), guided.size());
+  size_t num_correct = 0;
+  for (size_t i = 0; i < ip1.size(); ++i)
+    if (guided[i] < ip2.size() && fabs(ip2[guided[i]].x - ip1[i].x - 25) < 0.5)
+      ++num_correct;
+  // Only a distractor landing by chance on the same row can hide a match.
+  EXPECT_LT(0.9*ip1.size(), double(num_correct));
+}
@@ -64,7 +64,7 @@ namespace math {
                                         Vector<double>& dists,
                                         size_t knn ) {
     // Constrain the number of results that we can return to the number of loaded objects
-    size_t maxNumReturns = m_features_cast.rows();
+    size_t maxNumReturns = m_num_features_loaded;
     if (knn > maxNumReturns)
       knn = maxNumReturns;
 
@@ -151,7 +151,7 @@ template <>
                                         Vector<double>& dists,
                                         size_t knn ) {
     // Constrain the number of results that we can return to the number of loaded objects
-    size_t maxNumReturns = m_features_cast.rows();
+    size_t maxNumReturns = m_num_features_loaded;
     if (knn > maxNumReturns)
       knn = maxNumReturns;
 
@@ -230,7 +230,7 @@ template <>
                                         Vector<double>& dists,
                                         size_t knn ) {
     // Constrain the number of results that we can return to the number of loaded objects
-    size_t maxNumReturns = m_features_cast.rows();
+    size_t maxNumReturns = m_num_features_loaded;
     if (knn > maxNumReturns)
       knn = maxNumReturns;
 
@@ -48,7 +48,8 @@ namespace math {
     size_t m_num_features_loaded;
     void* m_index_ptr;
     FLANN_DistType m_dist_type;
-    Matrix<T> m_features_cast; // The index makes pointers to this object. So we copy it.
+    Matrix<T> m_features_cast; // The index makes pointers to this object. So we copy it,
+                               //  unless the caller keeps the data alive.
 
     /// Returns the number of results found (usually knn)
     size_t knn_search_help( void* data_ptr, size_t rows, size_t cols, // Values we are looking for
@@ -84,6 +85,18 @@ namespace math {
       //         << m_features_cast.cols() << "\n";
     }
 
+    /// Load feature data without copying it, rows features of cols elements each
+    ///  stored one after the other.
+    /// - The data must stay valid and unchanged for as long as this tree is used.
+    void load_match_data( T const* features, size_t rows, size_t cols, FLANN_DistType dist_type) {
+      if (rows == 0)
+        vw_throw( ArgumentErr() << "Cannot create a FLANN tree with no input data!" );
+      m_dist_type           = dist_type;
+      m_features_cast.set_size(0, 0);
+      m_num_features_loaded = rows;
+      construct_index( (void*)features, rows, cols );
+    }
+
     /// Multiple query access via VW's Matrix
     template <class MatrixT>
     size_t knn_search( MatrixBase<MatrixT> const& query,  // Values we are looking for
@@ -122,6 +135,19 @@ namespace math {
       return num_found;
     }
 
+    /// Single query access from a plain array of cols elements, which is not copied.
+    size_t knn_search( T const* query, size_t cols,
+                       Vector<int   >& indices,
+                       Vector<double>& dists,
+                       size_t knn ) {
+      int flann_found = knn_search_help( (void*)query, 1, cols, indices, dists, knn );
+      size_t num_found = 0;
+      for (int i=0; i<flann_found; ++i)
+        if ( (indices[i] >= 0) && (indices[i] < static_cast<int>(m_num_features_loaded)) )
+          ++num_found;
+      return num_found;
+    }
+
     size_t size1() const;
     size_t size2() const;
 
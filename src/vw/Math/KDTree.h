@@ -48,6 +48,10 @@
 ///   -Deletion of a random node
 ///   -Rebalance tree
 ///
+/// For large static point sets, such as point clouds, see StaticKDTree in
+/// StaticKDTree.h, which uses a flat layout and builds and searches in
+/// parallel.
+///
 ///
 /// KD-Tree Implementation Details:
 ///
@@ -117,6 +121,7 @@
 #include <vector>
 #include <iterator>
 #include <queue>
+#include <algorithm>
 
 // for INT_MAX
 #include <climits>
@@ -206,16 +211,14 @@ namespace math {
   /////////////////// Partitioners ////////////////////////////////////////
 
   // Partitions a file into two roughly equal parts.
-  // Sorts the records in a file according to the key selected by
-  // discriminator. The 'median' (not necessarily a true median if there are
-  // duplicate values) is used to partition the file.
+  // Selects the median of the records in a file according to the key chosen
+  // by discriminator, in linear time with nth_element. The 'median' (not
+  // necessarily a true median if there are duplicate values) is used to
+  // partition the file.
   //
   // Returns location of the partition, such that all elements less than
   // the partition are between beg and partition, and all elements
   // greater than or equal are in partition to end
-  //
-  // TODO: sort and partition may be overkill. Try to implement this with
-  // partial_sort.
   class MedianPartitioner
   {
   public:
@@ -225,13 +228,13 @@ namespace math {
       typedef typename std::iterator_traits<RandomAccessIterT>::value_type record_type;
 
       DiscriminatorCompare<record_type> comparator(discriminator);
-      std::sort(beg, end, comparator); //Could use partial_sort() to save time?
 
       //Select the middle point as a pivot
       size_t num_records = distance(beg, end);
       size_t offset = (num_records / 2);
       RandomAccessIterT pivot_position = RandomAccessIterT(beg);
       std::advance(pivot_position, offset);
+      std::nth_element(beg, pivot_position, end, comparator);
 
       //Partition the file around pivot
       comparator.set_pivot(*pivot_position);
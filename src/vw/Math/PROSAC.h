@@ -0,0 +1,522 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file PROSAC.h
+///
+/// A faster drop in replacement for RandomSampleConsensus which combines
+/// three refinements of RANSAC:
+///
+/// Chum, Ondrej and Matas, Jiri. "Matching with PROSAC - Progressive
+/// Sample Consensus" (2005).  Samples are drawn first from the best
+/// ranked matches and then from ever larger sets of them, so with a good
+/// ranking a correct model turns up after few samples.  Without a ranking
+/// the samples are drawn uniformly as in RANSAC.
+///
+/// Matas, Jiri and Chum, Ondrej. "Randomized RANSAC with Sequential
+/// Probability Ratio Test" (2005).  Each hypothesis is checked against the
+/// points in random order, and dropped as soon as a likelihood ratio test
+/// decides it is a bad one, which usually takes a few dozen points.
+///
+/// Sampling stops once the best model so far makes it unlikely, at the
+/// requested confidence, that a better one was missed, either among all
+/// the matches or among the best ranked ones as in PROSAC.
+///
+/// Hypotheses are fitted and checked in batches spread over the thread
+/// pool.  Samples are drawn and results merged in order on the calling
+/// thread, so the result does not depend on the number of threads.  The
+/// fitting and error functors are called from several threads at once
+/// and must not modify any state.
+///
+#ifndef __VW_MATH_PROSAC_H__
+#define __VW_MATH_PROSAC_H__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/RANSAC.h>
+
+namespace vw {
+namespace math {
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    /// The likelihood ratio test which decides, point by point, whether a
+    /// hypothesis is a bad one.
+    struct SprtParameters {
+      double epsilon;      ///< Chance that a point agrees with a good model.
+      double delta;        ///< Chance that a point agrees with a bad model.
+      double threshold;    ///< A model is rejected once its ratio exceeds this.
+      double agree_ratio;  ///< Ratio update for a point which agrees.
+      double differ_ratio; ///< Ratio update for a point which does not.
+
+      SprtParameters(double epsilon_in, double delta_in)
+        : epsilon(epsilon_in), delta(delta_in) {
+        if (!(epsilon > delta) || delta <= 0 || epsilon >= 1) {
+          // The test can not tell good models from bad ones.
+          threshold    = std::numeric_limits<double>::max();
+          agree_ratio  = differ_ratio = 1.0;
+          return;
+        }
+        agree_ratio  = delta/epsilon;
+        differ_ratio = (1-delta)/(1-epsilon);
+
+        // The optimal threshold from the paper, solved by fixed point
+        //  iteration, where fitting a model costs as much as checking
+        //  FIT_COST points.
+        const double FIT_COST = 200.0;
+        const double c = (1-delta)*log((1-delta)/(1-epsilon)) + delta*log(delta/epsilon);
+        const double a = FIT_COST*c + 1;
+        threshold = a;
+        for (int i = 0; i < 10; ++i)
+          threshold = a + log(threshold);
+      }
+    };
+
+    /// Draws samples in the order of PROSAC: the n'th best match is added to
+    /// the sampled set after as many samples as plain RANSAC would draw from
+    /// the best n matches within growth_samples samples of all of them.
+    /// As in the paper the set grows by at most one match per sample, so a
+    /// short search only ever sees the best ranked matches.  With progressive
+    /// false every sample is drawn uniformly from all the matches.
+    class ProsacSampler {
+      size_t m_num_points, m_sample_size, m_subset_size, m_sample_count;
+      double m_subset_samples;       // T_n of the paper
+      size_t m_subset_last_sample;   // T'_n of the paper
+
+    public:
+      ProsacSampler(size_t num_points, size_t sample_size, size_t growth_samples,
+                    bool progressive = true)
+        : m_num_points(num_points), m_sample_size(sample_size),
+          m_subset_size(progressive ? sample_size : num_points), m_sample_count(0),
+          m_subset_samples(double(growth_samples)), m_subset_last_sample(progressive ? 1 : 0) {
+        for (size_t i = 0; i < sample_size; ++i)
+          m_subset_samples *= double(sample_size - i)/double(num_points - i);
+      }
+
+      /// Draw the next sample as positions in the quality order.
+      template <class GeneratorT>
+      void next(GeneratorT & gen, std::vector<size_t> & sample) {
+        ++m_sample_count;
+        if (m_sample_count > m_subset_last_sample && m_subset_size < m_num_points) {
+          const double next_samples = m_subset_samples * double(m_subset_size+1)
+                                      / double(m_subset_size+1-m_sample_size);
+          m_subset_last_sample += size_t(ceil(next_samples - m_subset_samples));
+          m_subset_samples      = next_samples;
+          ++m_subset_size;
+        }
+
+        // Until the set grows again every sample holds its newest point.
+        sample.clear();
+        size_t pool = m_subset_size;
+        if (m_sample_count <= m_subset_last_sample) {
+          sample.push_back(m_subset_size-1);
+          --pool;
+        }
+        boost::random::uniform_int_distribution<size_t> pick(0, pool-1);
+        while (sample.size() < m_sample_size) {
+          const size_t k = pick(gen);
+          if (std::find(sample.begin(), sample.end(), k) == sample.end())
+            sample.push_back(k);
+        }
+      }
+    };
+
+    template <class ResultT>
+    struct ProsacHypothesis {
+      enum Status { FAILED, REJECTED, DISCARDED, SCORED };
+
+      std::vector<size_t> sample;  // Positions in the quality order
+      ResultT model;
+      Status  status;
+      size_t  num_checked, num_agreeing;
+    };
+
+    /// Fits and checks a range of hypotheses.
+    template <class FittingFuncT, class ErrorFuncT, class ContainerT1, class ContainerT2>
+    class ProsacScoringTask : public Task, private boost::noncopyable {
+      typedef ProsacHypothesis<typename FittingFuncT::result_type> HypothesisT;
+
+      FittingFuncT             const& m_fitting_func;
+      ErrorFuncT               const& m_error_func;
+      std::vector<ContainerT1> const& m_p1;
+      std::vector<ContainerT2> const& m_p2;
+      std::vector<size_t>      const& m_quality_order;
+      std::vector<size_t>      const& m_check_order;
+      SprtParameters m_sprt;
+      double         m_inlier_threshold;
+      size_t         m_best_inliers;
+      HypothesisT   *m_begin, *m_end;
+
+    public:
+      ProsacScoringTask(FittingFuncT const& fitting_func, ErrorFuncT const& error_func,
+                        std::vector<ContainerT1> const& p1, std::vector<ContainerT2> const& p2,
+                        std::vector<size_t> const& quality_order, std::vector<size_t> const& check_order,
+                        SprtParameters const& sprt, double inlier_threshold, size_t best_inliers,
+                        HypothesisT *begin, HypothesisT *end)
+        : m_fitting_func(fitting_func), m_error_func(error_func), m_p1(p1), m_p2(p2),
+          m_quality_order(quality_order), m_check_order(check_order), m_sprt(sprt),
+          m_inlier_threshold(inlier_threshold), m_best_inliers(best_inliers),
+          m_begin(begin), m_end(end) {}
+
+      virtual void operator()() {
+        std::vector<ContainerT1> try1;
+        std::vector<ContainerT2> try2;
+        const size_t num_points = m_p1.size();
+        for (HypothesisT *h = m_begin; h != m_end; ++h) {
+          try1.resize(h->sample.size());
+          try2.resize(h->sample.size());
+          for (size_t i = 0; i < h->sample.size(); ++i) {
+            try1[i] = m_p1[m_quality_order[h->sample[i]]];
+            try2[i] = m_p2[m_quality_order[h->sample[i]]];
+          }
+          h->num_checked = h->num_agreeing = 0;
+          try {
+            h->model = m_fitting_func(try1, try2);
+          } catch (const std::exception&) {
+            h->status = HypothesisT::FAILED; // Degenerate sample
+            continue;
+          }
+
+          h->status = HypothesisT::SCORED;
+          double ratio = 1.0;
+          for (size_t j = 0; j < num_points; ++j) {
+            const size_t i = m_check_order[j];
+            if (m_error_func(h->model, m_p1[i], m_p2[i]) < m_inlier_threshold) {
+              ++h->num_agreeing;
+              ratio *= m_sprt.agree_ratio;
+            } else {
+              ratio *= m_sprt.differ_ratio;
+            }
+            h->num_checked = j+1;
+            if (ratio > m_sprt.threshold) {
+              h->status = HypothesisT::REJECTED;
+              break;
+            }
+            if (h->num_agreeing + (num_points - j - 1) <= m_best_inliers) {
+              h->status = HypothesisT::DISCARDED; // Can not beat the best model
+              break;
+            }
+          }
+        }
+      }
+    };
+
+  } // namespace detail
+  /// \endcond
+
+  /// Progressive sample consensus driver class, used like RandomSampleConsensus.
+  /// - max_iterations bounds the number of samples drawn.  Fewer are drawn
+  ///   once the best model found is correct with probability confidence.
+  /// - Samples are drawn from the best matches first when a quality is
+  ///   given for each of them, and uniformly as in RANSAC otherwise.
+  /// - The model with the most inliers is refitted to all of its inliers.
+  /// - The samples are drawn with a fixed seed, so repeated calls give the
+  ///   same result.
+  template <class FittingFuncT, class ErrorFuncT>
+  class ProgressiveSampleConsensus {
+    typedef typename FittingFuncT::result_type      result_type;
+    typedef detail::ProsacHypothesis<result_type>   HypothesisT;
+
+    FittingFuncT m_fitting_func;
+    ErrorFuncT   m_error_func;
+    int          m_max_iterations;
+    double       m_inlier_threshold;
+    int          m_min_num_output_inliers;
+    bool         m_reduce_min_num_output_inliers_if_no_fit;
+    double       m_confidence;
+    int          m_num_iterations;
+
+    /// The number of samples after which a better model is unlikely, for the
+    /// best model so far agreeing with the matches flagged in agrees, listed
+    /// in quality order.  As in PROSAC this is the smallest of the standard
+    /// bounds for the sets of the n best matches, among those holding more
+    /// inliers of the model than a bad model would have, or just the bound
+    /// for all the matches when they are not ranked.  One in every
+    /// sprt_threshold of the good models may be rejected by the SPRT.
+    double needed_iterations(std::vector<uint8> const& agrees, size_t sample_size,
+                             double delta, double sprt_threshold, bool progressive) const {
+      double best_good_sample = 0;
+      size_t num_inliers = 0;
+      for (size_t n = 1; n <= agrees.size(); ++n) {
+        num_inliers += agrees[n-1];
+        if (n < sample_size || num_inliers < sample_size ||
+            (!progressive && n < agrees.size()))
+          continue;
+        // A bad model agrees with each point outside its sample with
+        // probability delta.  Ask for a 5% chance that one does this well.
+        const double extra = double(n - sample_size);
+        if (double(num_inliers) < double(sample_size) + delta*extra + 1.645*sqrt(delta*(1-delta)*extra))
+          continue;
+        double good_sample = 1.0 - 1.0/sprt_threshold;
+        for (size_t i = 0; i < sample_size; ++i)
+          good_sample *= double(num_inliers - i)/double(n - i);
+        best_good_sample = std::max(best_good_sample, good_sample);
+      }
+      if (best_good_sample <= 0)
+        return std::numeric_limits<double>::max();
+      if (best_good_sample >= 1)
+        return 1;
+      return log(1.0 - m_confidence) / log(1.0 - best_good_sample);
+    }
+
+  public:
+
+    ProgressiveSampleConsensus(FittingFuncT const& fitting_func,
+                               ErrorFuncT   const& error_func,
+                               int    max_iterations,
+                               double inlier_threshold,
+                               int    min_num_output_inliers,
+                               bool   reduce_min_num_output_inliers_if_no_fit = false,
+                               double confidence = 0.99)
+      : m_fitting_func(fitting_func), m_error_func(error_func),
+        m_max_iterations(max_iterations),
+        m_inlier_threshold(inlier_threshold),
+        m_min_num_output_inliers(min_num_output_inliers),
+        m_reduce_min_num_output_inliers_if_no_fit(reduce_min_num_output_inliers_if_no_fit),
+        m_confidence(confidence), m_num_iterations(0) {}
+
+    /// The number of samples drawn by the last fit.
+    int num_iterations() const { return m_num_iterations; }
+
+    // Returns the list of inliers.
+    template <class ContainerT1, class ContainerT2>
+    void inliers(result_type const& H,
+                 std::vector<ContainerT1> const& p1, std::vector<ContainerT2> const& p2,
+                 std::vector<ContainerT1>      & inliers1, std::vector<ContainerT2> & inliers2) const {
+      inliers1.clear();
+      inliers2.clear();
+      for (size_t i = 0; i < p1.size(); i++) {
+        if (m_error_func(H, p1[i], p2[i]) < m_inlier_threshold) {
+          inliers1.push_back(p1[i]);
+          inliers2.push_back(p2[i]);
+        }
+      }
+    }
+
+    // Returns the list of inlier indices.
+    template <class ContainerT1, class ContainerT2>
+    std::vector<size_t> inlier_indices(result_type const& H,
+                                       std::vector<ContainerT1> const& p1,
+                                       std::vector<ContainerT2> const& p2) const {
+      std::vector<size_t> result;
+      for (size_t i = 0; i < p1.size(); i++)
+        if (m_error_func(H, p1[i], p2[i]) < m_inlier_threshold)
+          result.push_back(i);
+      return result;
+    }
+
+    /// Fit to unranked matches, sampling all of them uniformly.
+    template <class ContainerT1, class ContainerT2>
+    result_type operator()(std::vector<ContainerT1> const& p1,
+                           std::vector<ContainerT2> const& p2) {
+      std::vector<size_t> quality_order(p1.size());
+      for (size_t i = 0; i < quality_order.size(); ++i)
+        quality_order[i] = i;
+      return fit(p1, p2, quality_order, false);
+    }
+
+    /// Fit to matches ranked by quality, higher first.
+    template <class ContainerT1, class ContainerT2>
+    result_type operator()(std::vector<ContainerT1> const& p1,
+                           std::vector<ContainerT2> const& p2,
+                           std::vector<double>      const& quality) {
+      VW_ASSERT( quality.size() == p1.size(),
+                 RANSACErr() << "PROSAC Error.  Quality and data vectors are not the same size." );
+      std::vector<std::pair<double,size_t> > ranked(quality.size());
+      for (size_t i = 0; i < ranked.size(); ++i)
+        ranked[i] = std::make_pair(-quality[i], i);
+      std::sort(ranked.begin(), ranked.end());
+      std::vector<size_t> quality_order(ranked.size());
+      for (size_t i = 0; i < ranked.size(); ++i)
+        quality_order[i] = ranked[i].second;
+      return fit(p1, p2, quality_order, true);
+    }
+
+  private:
+
+    template <class ContainerT1, class ContainerT2>
+    result_type fit(std::vector<ContainerT1> const& p1,
+                    std::vector<ContainerT2> const& p2,
+                    std::vector<size_t>      const& quality_order,
+                    bool progressive) {
+      typedef detail::ProsacScoringTask<FittingFuncT, ErrorFuncT, ContainerT1, ContainerT2> TaskT;
+
+      VW_ASSERT( !p1.empty(),
+                 RANSACErr() << "PROSAC Error.  Insufficient data.\n");
+      VW_ASSERT( p1.size() == p2.size(),
+                 RANSACErr() << "PROSAC Error.  Data vectors are not the same size." );
+
+      const size_t num_points = p1.size();
+      const size_t min_elems_for_fit = m_fitting_func.min_elements_needed_for_fit(p1[0]);
+
+      VW_ASSERT( num_points >= min_elems_for_fit,
+                 RANSACErr() << "PROSAC Error.  Not enough potential matches for this fitting functor. (" << num_points << "/" << min_elems_for_fit << ")\n");
+      VW_ASSERT( m_min_num_output_inliers >= int(min_elems_for_fit),
+                 RANSACErr() << "PROSAC Error.  Number of requested inliers is less than min number of elements needed for fit. (" << m_min_num_output_inliers << "/" << min_elems_for_fit << ")\n");
+
+      // Hypotheses check the points in a fixed random order, so the
+      // likelihood ratio test sees an unbiased sample of them.
+      boost::random::mt19937 gen(0);
+      std::vector<size_t> check_order(num_points);
+      for (size_t i = 0; i < num_points; ++i)
+        check_order[i] = i;
+      for (size_t i = num_points-1; i > 0; --i)
+        std::swap(check_order[i], check_order[boost::random::uniform_int_distribution<size_t>(0, i)(gen)]);
+
+      const double INITIAL_EPSILON = 0.05, INITIAL_DELTA = 0.01;
+      detail::SprtParameters sprt(INITIAL_EPSILON, INITIAL_DELTA);
+      detail::ProsacSampler sampler(num_points, min_elems_for_fit, std::max(m_max_iterations, 1),
+                                    progressive);
+
+      // Samples drawn between checks of the stopping bound, growing from the
+      // first value to the last so that easy problems stop early.
+      const size_t MIN_BATCH_SIZE = 16, MAX_BATCH_SIZE = 256;
+
+      const int num_threads = vw_settings().default_num_threads();
+      FifoWorkQueue queue(num_threads);
+      std::vector<HypothesisT> batch;
+
+      result_type best_H;
+      size_t best_inliers = 0;
+      std::vector<uint8> best_agrees(num_points, 0);
+      size_t rejected_checked = 0, rejected_agreeing = 0;
+      size_t batch_size = MIN_BATCH_SIZE;
+      double needed = m_max_iterations;
+      m_num_iterations = 0;
+      while (m_num_iterations < needed) {
+
+        // 1. Draw the samples.
+        batch.resize(std::min(batch_size, size_t(ceil(needed)) - m_num_iterations));
+        for (size_t k = 0; k < batch.size(); ++k)
+          sampler.next(gen, batch[k].sample);
+        m_num_iterations += batch.size();
+        batch_size = std::min(2*batch_size, MAX_BATCH_SIZE);
+
+        // 2. Fit and check them, in parallel if that is worth it.
+        const size_t num_tasks = std::min(size_t(num_threads), batch.size());
+        if (num_tasks <= 1) {
+          TaskT(m_fitting_func, m_error_func, p1, p2, quality_order, check_order, sprt,
+                m_inlier_threshold, best_inliers, &batch[0], &batch[0] + batch.size())();
+        } else {
+          for (size_t t = 0; t < num_tasks; ++t) {
+            HypothesisT *begin = &batch[0] + batch.size()*t/num_tasks;
+            HypothesisT *end   = &batch[0] + batch.size()*(t+1)/num_tasks;
+            queue.add_task(boost::shared_ptr<Task>(new TaskT(m_fitting_func, m_error_func, p1, p2,
+                                                             quality_order, check_order, sprt,
+                                                             m_inlier_threshold, best_inliers,
+                                                             begin, end)));
+          }
+          queue.join_all();
+        }
+
+        // 3. Keep the best model and learn how often points agree with bad ones.
+        bool new_best = false;
+        for (size_t k = 0; k < batch.size(); ++k) {
+          HypothesisT const& h = batch[k];
+          if (h.status == HypothesisT::REJECTED) {
+            rejected_checked  += h.num_checked;
+            rejected_agreeing += h.num_agreeing;
+          } else if (h.status == HypothesisT::SCORED && h.num_agreeing > best_inliers) {
+            best_H       = h.model;
+            best_inliers = h.num_agreeing;
+            new_best     = true;
+          }
+        }
+        if (new_best)
+          for (size_t q = 0; q < num_points; ++q)
+            best_agrees[q] = m_error_func(best_H, p1[quality_order[q]], p2[quality_order[q]])
+                             < m_inlier_threshold;
+        double delta = sprt.delta;
+        if (rejected_checked > 0)
+          delta = std::max(double(rejected_agreeing)/double(rejected_checked), 1e-4);
+        const double epsilon = std::max(double(best_inliers)/double(num_points), INITIAL_EPSILON);
+        if (epsilon != sprt.epsilon || fabs(delta - sprt.delta) > 0.1*sprt.delta)
+          sprt = detail::SprtParameters(std::min(epsilon, 0.99), delta);
+
+        // 4. Stop once a better model is unlikely.
+        needed = std::min(double(m_max_iterations),
+                          needed_iterations(best_agrees, min_elems_for_fit, sprt.delta,
+                                            sprt.threshold, progressive));
+      }
+
+      // Lower the bar as RandomSampleConsensus does on repeated attempts.
+      int min_num_output_inliers = m_min_num_output_inliers;
+      for (int attempt = 1; attempt < 10 && int(best_inliers) < min_num_output_inliers &&
+             m_reduce_min_num_output_inliers_if_no_fit; ++attempt) {
+        if (int(min_num_output_inliers/1.5) < 2)
+          break;
+        min_num_output_inliers = int(min_num_output_inliers/1.5);
+      }
+      if (best_inliers == 0 || int(best_inliers) < min_num_output_inliers)
+        vw_throw( RANSACErr() << "PROSAC was unable to find a fit that matched the supplied data." );
+
+      // Refit to all the inliers, keeping the refit unless it loses some.
+      std::vector<ContainerT1> inliers1;
+      std::vector<ContainerT2> inliers2;
+      inliers(best_H, p1, p2, inliers1, inliers2);
+      try {
+        result_type refit_H = m_fitting_func(inliers1, inliers2, best_H);
+        if (inlier_indices(refit_H, p1, p2).size() >= best_inliers)
+          best_H = refit_H;
+      } catch (const std::exception&) {}
+
+      VW_OUT(InfoMessage, "interest_point") << "\nPROSAC Summary:"     << std::endl;
+      VW_OUT(InfoMessage, "interest_point") << "\tFit = "              << best_H       << std::endl;
+      VW_OUT(InfoMessage, "interest_point") << "\tInliers / Total  = " << best_inliers << " / " << num_points << "\n";
+      VW_OUT(InfoMessage, "interest_point") << "\tSamples = "          << m_num_iterations << "\n\n";
+
+      return best_H;
+    }
+
+  }; // End of ProgressiveSampleConsensus class definition
+
+  // Helper function to instantiate a PROSAC class object and immediately call it
+  template <class ContainerT1, class ContainerT2, class FittingFuncT, class ErrorFuncT>
+  typename FittingFuncT::result_type prosac(std::vector<ContainerT1> const& p1,
+                                            std::vector<ContainerT2> const& p2,
+                                            FittingFuncT             const& fitting_func,
+                                            ErrorFuncT               const& error_func,
+                                            int     max_iterations,
+                                            double  inlier_threshold,
+                                            int     min_num_output_inliers,
+                                            bool    reduce_min_num_output_inliers_if_no_fit = false
+                                            ) {
+    ProgressiveSampleConsensus<FittingFuncT, ErrorFuncT> prosac_instance(fitting_func,
+                                                                         error_func,
+                                                                         max_iterations,
+                                                                         inlier_threshold,
+                                                                         min_num_output_inliers,
+                                                                         reduce_min_num_output_inliers_if_no_fit
+                                                                         );
+    return prosac_instance(p1,p2);
+  }
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_PROSAC_H__
@@ -0,0 +1,479 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file StaticKDTree.h
+///
+/// A k-d tree over a fixed set of points, for exact nearest neighbor and
+/// radius queries on large low dimensional sets such as point clouds.
+///
+/// Unlike KDTree, which keeps one graph vertex per record, the tree has an
+/// implicit layout: node i has children 2i+1 and 2i+2, each node splits its
+/// points in half, and the leaves hold buckets of up to leaf_size points.
+/// Only a split dimension and value are stored per node.  The points are
+/// copied in leaf order with each coordinate stored contiguously, so a leaf
+/// is scanned by loops over plain arrays which the compiler vectorizes.
+///
+/// The tree is built by splitting each node on its widest dimension at the
+/// median found with nth_element.  Below the first few levels the subtrees
+/// are built in parallel, and batches of queries are spread over the thread
+/// pool as well.
+///
+#ifndef __VW_MATH_STATIC_KDTREE_H__
+#define __VW_MATH_STATIC_KDTREE_H__
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+namespace vw {
+namespace math {
+
+  /// A static k-d tree over points with RealT coordinates.
+  /// - Points are identified by their index in the input.
+  /// - Distances are squared Euclidean.
+  /// - Queries are const and may run from several threads at once.
+  template <class RealT>
+  class StaticKDTree {
+  public:
+    typedef RealT value_type;
+
+    StaticKDTree() : m_num_points(0), m_dim(0), m_leaf_size(1), m_depth(0) {}
+
+    /// Build the tree over num_points points of dim coordinates each,
+    ///  stored one point after the other.  The points are copied.
+    StaticKDTree(RealT const* points, size_t num_points, size_t dim, size_t leaf_size = 32)
+      : m_num_points(num_points), m_dim(dim), m_leaf_size(leaf_size), m_depth(0) {
+      build(points);
+    }
+
+    /// Build the tree over a file of records, as taken by KDTree.
+    template <class FileT>
+    explicit StaticKDTree(FileT const& file, size_t leaf_size = 32)
+      : m_num_points(std::distance(file.begin(), file.end())), m_dim(0),
+        m_leaf_size(leaf_size), m_depth(0) {
+      if (m_num_points > 0)
+        m_dim = std::distance(file.begin()->begin(), file.begin()->end());
+      std::vector<RealT> points;
+      points.reserve(m_num_points*m_dim);
+      for (typename FileT::const_iterator record = file.begin(); record != file.end(); ++record) {
+        VW_ASSERT( size_t(std::distance(record->begin(), record->end())) == m_dim,
+                   ArgumentErr() << "StaticKDTree: All records must have the same size." );
+        std::copy(record->begin(), record->end(), std::back_inserter(points));
+      }
+      build(points.empty() ? 0 : &points[0]);
+    }
+
+    size_t size     () const { return m_num_points; }
+    size_t dim      () const { return m_dim; }
+    size_t leaf_size() const { return m_leaf_size; }
+    /// The leaves are at this depth, the root being at depth 0.
+    int    depth    () const { return m_depth; }
+
+    /// Find the k points nearest to query, nearest first, returning how
+    ///  many were found.  Entries past that have index uint32(-1).
+    size_t knn_search(RealT const* query, size_t k, uint32* indices, RealT* distances) const {
+      std::vector<RealT> scratch(m_leaf_size);
+      return knn_search(query, k, indices, distances, scratch);
+    }
+
+    /// Find the k nearest points for each of num_queries queries, stored one
+    ///  after the other.  Query i gets entries i*k to i*k+k-1 of the results.
+    void knn_search(RealT const* queries, size_t num_queries, size_t k,
+                    uint32* indices, RealT* distances) const {
+      run_batch(num_queries, KnnBatch(*this, queries, k, indices, distances));
+    }
+
+    /// Find the points within radius of query, returning how many there are.
+    /// - The indices are sorted.
+    size_t radius_search(RealT const* query, RealT radius, std::vector<uint32> & indices) const {
+      std::vector<RealT> scratch(m_leaf_size);
+      return radius_search(query, radius, indices, scratch);
+    }
+
+    /// Find the points within radius of each of num_queries queries.
+    void radius_search(RealT const* queries, size_t num_queries, RealT radius,
+                       std::vector<std::vector<uint32> > & indices) const {
+      indices.resize(num_queries);
+      run_batch(num_queries, RadiusBatch(*this, queries, radius, indices));
+    }
+
+  private:
+
+    size_t m_num_points, m_dim, m_leaf_size;
+    int    m_depth;
+    std::vector<RealT>  m_coords;      // Coordinate d of the point in leaf order j is m_coords[d*m_num_points+j]
+    std::vector<uint32> m_indices;     // Input index of the point in leaf order j
+    std::vector<RealT>  m_split_value; // Per internal node
+    std::vector<uint8>  m_split_dim;   // Per internal node
+
+    // ------------------------------------------------------------------
+    // Building
+
+    /// Orders point indices by one coordinate.
+    struct CoordinateLess {
+      RealT const* m_points;
+      size_t m_dim, m_d;
+      CoordinateLess(RealT const* points, size_t dim, size_t d) : m_points(points), m_dim(dim), m_d(d) {}
+      bool operator()(uint32 a, uint32 b) const {
+        return m_points[a*m_dim + m_d] < m_points[b*m_dim + m_d];
+      }
+    };
+
+    /// Split the points of a node in half along their widest dimension.
+    void split_node(RealT const* points, std::vector<uint32> & order,
+                    size_t node, size_t begin, size_t end) {
+      // The spread is estimated from at most a few thousand points.
+      const size_t MAX_SAMPLES = 4096;
+      const size_t stride = std::max((end - begin)/MAX_SAMPLES, size_t(1));
+      size_t best_dim = 0;
+      RealT  best_spread = -1;
+      for (size_t d = 0; d < m_dim; ++d) {
+        RealT lo = std::numeric_limits<RealT>::max(), hi = -lo;
+        for (size_t j = begin; j < end; j += stride) {
+          const RealT x = points[order[j]*m_dim + d];
+          lo = std::min(lo, x);
+          hi = std::max(hi, x);
+        }
+        if (hi - lo > best_spread) {
+          best_spread = hi - lo;
+          best_dim    = d;
+        }
+      }
+      const size_t mid = begin + (end - begin)/2;
+      m_split_dim[node]   = uint8(best_dim);
+      m_split_value[node] = 0;
+      if (mid == end)
+        return;
+      // Large nodes select on a contiguous copy of the keys rather than
+      // through the indices, which misses the cache on every comparison.
+      const size_t MIN_COPY_SIZE = 1024;
+      if (end - begin < MIN_COPY_SIZE) {
+        std::nth_element(order.begin()+begin, order.begin()+mid, order.begin()+end,
+                         CoordinateLess(points, m_dim, best_dim));
+      } else {
+        std::vector<std::pair<RealT, uint32> > keys(end - begin);
+        for (size_t j = begin; j < end; ++j)
+          keys[j-begin] = std::make_pair(points[order[j]*m_dim + best_dim], order[j]);
+        std::nth_element(keys.begin(), keys.begin()+(mid-begin), keys.end());
+        for (size_t j = begin; j < end; ++j)
+          order[j] = keys[j-begin].second;
+      }
+      m_split_value[node] = points[order[mid]*m_dim + best_dim];
+    }
+
+    /// Split the nodes of a subtree down to stop_depth, collecting the
+    ///  nodes reached there.
+    void split_levels(RealT const* points, std::vector<uint32> & order,
+                      size_t node, size_t begin, size_t end, int depth, int stop_depth,
+                      std::vector<size_t> * stopped) {
+      if (depth == stop_depth) {
+        if (stopped)
+          stopped->push_back(node);
+        return;
+      }
+      split_node(points, order, node, begin, end);
+      const size_t mid = begin + (end - begin)/2;
+      split_levels(points, order, 2*node+1, begin, mid, depth+1, stop_depth, stopped);
+      split_levels(points, order, 2*node+2, mid,   end, depth+1, stop_depth, stopped);
+    }
+
+    /// The range of leaf order positions covered by a node.
+    void node_range(size_t node, size_t & begin, size_t & end) const {
+      // Walk down from the root along the path to the node.
+      int depth = 0;
+      for (size_t n = node; n > 0; n = (n-1)/2)
+        ++depth;
+      begin = 0;
+      end   = m_num_points;
+      for (int level = depth-1; level >= 0; --level) {
+        const size_t mid = begin + (end - begin)/2;
+        if ((((node+1) >> level) & 1) == 0)
+          end = mid;
+        else
+          begin = mid;
+      }
+    }
+
+    /// Builds the subtree below a node and copies its points into place.
+    class BuildTask : public Task, private boost::noncopyable {
+      StaticKDTree        & m_tree;
+      RealT          const* m_points;
+      std::vector<uint32> & m_order;
+      size_t m_node;
+      int    m_depth;
+    public:
+      BuildTask(StaticKDTree & tree, RealT const* points, std::vector<uint32> & order,
+                size_t node, int depth)
+        : m_tree(tree), m_points(points), m_order(order), m_node(node), m_depth(depth) {}
+
+      virtual void operator()() {
+        size_t begin, end;
+        m_tree.node_range(m_node, begin, end);
+        m_tree.split_levels(m_points, m_order, m_node, begin, end, m_depth, m_tree.m_depth, 0);
+        for (size_t j = begin; j < end; ++j) {
+          const uint32 i = m_order[j];
+          m_tree.m_indices[j] = i;
+          for (size_t d = 0; d < m_tree.m_dim; ++d)
+            m_tree.m_coords[d*m_tree.m_num_points + j] = m_points[size_t(i)*m_tree.m_dim + d];
+        }
+      }
+    };
+
+    void build(RealT const* points) {
+      VW_ASSERT( m_num_points < size_t(std::numeric_limits<uint32>::max()),
+                 ArgumentErr() << "StaticKDTree: Too many points." );
+      VW_ASSERT( m_dim > 0 || m_num_points == 0,
+                 ArgumentErr() << "StaticKDTree: Points must have at least one coordinate." );
+      VW_ASSERT( m_dim <= size_t(std::numeric_limits<uint8>::max()),
+                 ArgumentErr() << "StaticKDTree: Too many dimensions." );
+      m_leaf_size = std::max(m_leaf_size, size_t(1));
+
+      // Halve the points until they fit in the leaves.
+      size_t num_leaves = 1;
+      m_depth = 0;
+      while (num_leaves*m_leaf_size < m_num_points) {
+        num_leaves *= 2;
+        ++m_depth;
+      }
+      m_split_value.resize(num_leaves-1);
+      m_split_dim.resize(num_leaves-1);
+      m_coords.resize(m_num_points*m_dim);
+      m_indices.resize(m_num_points);
+      if (m_num_points == 0)
+        return;
+
+      std::vector<uint32> order(m_num_points);
+      for (size_t i = 0; i < m_num_points; ++i)
+        order[i] = uint32(i);
+
+      // Split the top levels here, until there are enough subtrees to
+      // keep the threads busy, then build the subtrees in parallel.
+      const int num_threads = vw_settings().default_num_threads();
+      int parallel_depth = 0;
+      while ((1 << parallel_depth) < 4*num_threads && parallel_depth < m_depth &&
+             (m_num_points >> parallel_depth) > 4096)
+        ++parallel_depth;
+      std::vector<size_t> subtrees;
+      split_levels(points, order, 0, 0, m_num_points, 0, parallel_depth, &subtrees);
+      if (subtrees.size() == 1) {
+        BuildTask(*this, points, order, subtrees[0], parallel_depth)();
+        return;
+      }
+      FifoWorkQueue queue(num_threads);
+      for (size_t s = 0; s < subtrees.size(); ++s)
+        queue.add_task(boost::shared_ptr<Task>(new BuildTask(*this, points, order,
+                                                             subtrees[s], parallel_depth)));
+      queue.join_all();
+    }
+
+    // ------------------------------------------------------------------
+    // Searching
+
+    /// The nearest points found so far, nearest first.
+    struct KnnResult {
+      size_t  k, count;
+      uint32* indices;
+      RealT*  distances;
+
+      RealT worst() const {
+        return count < k ? std::numeric_limits<RealT>::max() : distances[k-1];
+      }
+      void insert(RealT distance, uint32 index) {
+        size_t j = (count < k) ? count++ : k-1;
+        for (; j > 0 && distances[j-1] > distance; --j) {
+          distances[j] = distances[j-1];
+          indices  [j] = indices  [j-1];
+        }
+        distances[j] = distance;
+        indices  [j] = index;
+      }
+    };
+
+    /// Squared distances from query to the points of a leaf.
+    void leaf_distances(RealT const* query, size_t begin, size_t end, RealT * distances) const {
+      const size_t n = end - begin;
+      std::fill(distances, distances + n, RealT(0));
+      for (size_t d = 0; d < m_dim; ++d) {
+        RealT const* coords = &m_coords[d*m_num_points + begin];
+        const RealT q = query[d];
+        for (size_t j = 0; j < n; ++j) {
+          const RealT diff = coords[j] - q;
+          distances[j] += diff*diff;
+        }
+      }
+    }
+
+    // The searches keep, per dimension, the distance from the query to the
+    // cell of the current node, and their squared sum as a lower bound on
+    // the distance to any point of the cell.
+
+    void knn_recurse(RealT const* query, size_t node, size_t begin, size_t end, int depth,
+                     RealT bound, RealT * offsets, KnnResult & result, RealT * scratch) const {
+      if (depth == m_depth) {
+        leaf_distances(query, begin, end, scratch);
+        for (size_t j = 0; j < end - begin; ++j)
+          if (scratch[j] < result.worst())
+            result.insert(scratch[j], m_indices[begin+j]);
+        return;
+      }
+      const size_t d   = m_split_dim[node];
+      const size_t mid = begin + (end - begin)/2;
+      const RealT diff = query[d] - m_split_value[node];
+      const bool  low  = diff < 0;
+      knn_recurse(query, low ? 2*node+1 : 2*node+2, low ? begin : mid, low ? mid : end, depth+1,
+                  bound, offsets, result, scratch);
+
+      const RealT saved = offsets[d];
+      const RealT far_bound = bound - saved*saved + diff*diff;
+      if (far_bound < result.worst()) {
+        offsets[d] = diff;
+        knn_recurse(query, low ? 2*node+2 : 2*node+1, low ? mid : begin, low ? end : mid, depth+1,
+                    far_bound, offsets, result, scratch);
+        offsets[d] = saved;
+      }
+    }
+
+    void radius_recurse(RealT const* query, size_t node, size_t begin, size_t end, int depth,
+                        RealT bound, RealT * offsets, RealT radius_sq,
+                        std::vector<uint32> & indices, RealT * scratch) const {
+      if (depth == m_depth) {
+        leaf_distances(query, begin, end, scratch);
+        for (size_t j = 0; j < end - begin; ++j)
+          if (scratch[j] <= radius_sq)
+            indices.push_back(m_indices[begin+j]);
+        return;
+      }
+      const size_t d   = m_split_dim[node];
+      const size_t mid = begin + (end - begin)/2;
+      const RealT diff = query[d] - m_split_value[node];
+      const bool  low  = diff < 0;
+      radius_recurse(query, low ? 2*node+1 : 2*node+2, low ? begin : mid, low ? mid : end, depth+1,
+                     bound, offsets, radius_sq, indices, scratch);
+
+      const RealT saved = offsets[d];
+      const RealT far_bound = bound - saved*saved + diff*diff;
+      if (far_bound <= radius_sq) {
+        offsets[d] = diff;
+        radius_recurse(query, low ? 2*node+2 : 2*node+1, low ? mid : begin, low ? end : mid, depth+1,
+                       far_bound, offsets, radius_sq, indices, scratch);
+        offsets[d] = saved;
+      }
+    }
+
+    size_t knn_search(RealT const* query, size_t k, uint32* indices, RealT* distances,
+                      std::vector<RealT> & scratch) const {
+      std::fill(indices,   indices   + k, std::numeric_limits<uint32>::max());
+      std::fill(distances, distances + k, std::numeric_limits<RealT>::max());
+      if (k == 0 || m_num_points == 0)
+        return 0;
+      KnnResult result;
+      result.k = k;
+      result.count = 0;
+      result.indices = indices;
+      result.distances = distances;
+      std::vector<RealT> offsets(m_dim, RealT(0));
+      knn_recurse(query, 0, 0, m_num_points, 0, RealT(0), &offsets[0], result, &scratch[0]);
+      return result.count;
+    }
+
+    size_t radius_search(RealT const* query, RealT radius, std::vector<uint32> & indices,
+                         std::vector<RealT> & scratch) const {
+      indices.clear();
+      if (m_num_points == 0 || radius < 0)
+        return 0;
+      std::vector<RealT> offsets(m_dim, RealT(0));
+      radius_recurse(query, 0, 0, m_num_points, 0, RealT(0), &offsets[0], radius*radius,
+                     indices, &scratch[0]);
+      std::sort(indices.begin(), indices.end());
+      return indices.size();
+    }
+
+    // ------------------------------------------------------------------
+    // Batches of queries
+
+    struct KnnBatch {
+      StaticKDTree const& tree;
+      RealT const* queries;
+      size_t  k;
+      uint32* indices;
+      RealT*  distances;
+      KnnBatch(StaticKDTree const& tree_in, RealT const* queries_in, size_t k_in,
+               uint32* indices_in, RealT* distances_in)
+        : tree(tree_in), queries(queries_in), k(k_in), indices(indices_in), distances(distances_in) {}
+      void operator()(size_t q, std::vector<RealT> & scratch) const {
+        tree.knn_search(queries + q*tree.m_dim, k, indices + q*k, distances + q*k, scratch);
+      }
+    };
+
+    struct RadiusBatch {
+      StaticKDTree const& tree;
+      RealT const* queries;
+      RealT radius;
+      std::vector<std::vector<uint32> > & indices;
+      RadiusBatch(StaticKDTree const& tree_in, RealT const* queries_in, RealT radius_in,
+                  std::vector<std::vector<uint32> > & indices_in)
+        : tree(tree_in), queries(queries_in), radius(radius_in), indices(indices_in) {}
+      void operator()(size_t q, std::vector<RealT> & scratch) const {
+        tree.radius_search(queries + q*tree.m_dim, radius, indices[q], scratch);
+      }
+    };
+
+    /// Runs the queries of a batch in a range.
+    template <class BatchT>
+    class QueryTask : public Task, private boost::noncopyable {
+      BatchT m_batch;
+      size_t m_begin, m_end, m_leaf_size;
+    public:
+      QueryTask(BatchT const& batch, size_t begin, size_t end, size_t leaf_size)
+        : m_batch(batch), m_begin(begin), m_end(end), m_leaf_size(leaf_size) {}
+      virtual void operator()() {
+        std::vector<RealT> scratch(m_leaf_size);
+        for (size_t q = m_begin; q < m_end; ++q)
+          m_batch(q, scratch);
+      }
+    };
+
+    template <class BatchT>
+    void run_batch(size_t num_queries, BatchT const& batch) const {
+      const size_t QUERIES_PER_TASK = 1024;
+      if (num_queries <= QUERIES_PER_TASK) {
+        QueryTask<BatchT>(batch, 0, num_queries, m_leaf_size)();
+        return;
+      }
+      FifoWorkQueue queue;
+      for (size_t begin = 0; begin < num_queries; begin += QUERIES_PER_TASK)
+        queue.add_task(boost::shared_ptr<Task>(new QueryTask<BatchT>(batch, begin,
+                                                 std::min(begin + QUERIES_PER_TASK, num_queries),
+                                                 m_leaf_size)));
+      queue.join_all();
+    }
+  }; // End class StaticKDTree
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_STATIC_KDTREE_H__
@@ -237,12 +237,14 @@ namespace vw {
 
   // Resample transform functor
   //
-  // Transform points by applying a scaling in x and y.
+  // Transform points by applying a scaling in x and y.  The optional
+  // offset is the input location of output pixel (0,0), in input pixels.
   class ResampleTransform : public TransformHelper<ResampleTransform,ConvexFunction,ConvexFunction> {
     double m_xfactor, m_yfactor;
+    Vector2 m_offset;
   public:
-    ResampleTransform( double x_scaling, double y_scaling ) :
-      m_xfactor( x_scaling ) , m_yfactor( y_scaling ) {}
+    ResampleTransform( double x_scaling, double y_scaling, Vector2 const& offset = Vector2() ) :
+      m_xfactor( x_scaling ) , m_yfactor( y_scaling ), m_offset( offset ) {}
 
     template <class VectorT>
     ResampleTransform( VectorBase<VectorT> const& v ) {
@@ -253,11 +255,11 @@ namespace vw {
     }
 
     inline Vector2 reverse( Vector2 const& p ) const {
-      return Vector2( p(0) / m_xfactor, p(1) / m_yfactor );
+      return Vector2( p(0) / m_xfactor + m_offset(0), p(1) / m_yfactor + m_offset(1) );
     }
 
     inline Vector2 forward( Vector2 const& p ) const {
-      return Vector2( p(0) * m_xfactor, p(1) * m_yfactor );
+      return Vector2( (p(0) - m_offset(0)) * m_xfactor, (p(1) - m_offset(1)) * m_yfactor );
     }
   };
 
@@ -0,0 +1,170 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+#include <vw/Core/Settings.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+#include <vw/Math/Geometry.h>
+#include <vw/Math/PROSAC.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using namespace vw;
+using namespace vw::math;
+
+namespace {
+
+  Matrix3x3 test_homography() {
+    Matrix3x3 H;
+    H(0,0) = 0.95; H(0,1) = 0.08;  H(0,2) = 25;
+    H(1,0) = -0.1; H(1,1) = 1.02;  H(1,2) = -14;
+    H(2,0) = 2e-5; H(2,1) = -3e-5; H(2,2) = 1;
+    return H;
+  }
+
+  // Matches under test_homography() with a little noise, where every
+  // outlier_period'th match is an inlier and the rest are random.
+  // The quality puts the inliers first, with a few outliers among them.
+  void make_matches(size_t num_matches, size_t outlier_period,
+                    std::vector<Vector3> & p1, std::vector<Vector3> & p2,
+                    std::vector<double> & quality, std::vector<bool> & is_inlier) {
+    boost::random::mt19937 gen(11);
+    boost::random::uniform_real_distribution<double> unit(0.0, 1.0);
+    Matrix3x3 H = test_homography();
+    for (size_t i = 0; i < num_matches; ++i) {
+      Vector3 a(1000*unit(gen), 1000*unit(gen), 1);
+      Vector3 b(1000*unit(gen), 1000*unit(gen), 1);
+      const bool inlier = (i % outlier_period == 0);
+      if (inlier) {
+        b = H*a;
+        b /= b[2];
+        b[0] += 0.4*(unit(gen)-0.5);
+        b[1] += 0.4*(unit(gen)-0.5);
+      }
+      p1.push_back(a);
+      p2.push_back(b);
+      is_inlier.push_back(inlier);
+      quality.push_back(inlier ? unit(gen) + 0.5 : unit(gen));
+    }
+  }
+
+  void expect_homography_near(Matrix<double> const& H) {
+    ASSERT_EQ(3u, H.rows());
+    Matrix3x3 expected = test_homography();
+    Vector3 corners[] = { Vector3(0,0,1), Vector3(1000,0,1), Vector3(0,1000,1), Vector3(1000,1000,1) };
+    for (int i = 0; i < 4; ++i) {
+      Vector3 a = Matrix3x3(H)*corners[i], b = expected*corners[i];
+      EXPECT_VECTOR_NEAR(subvector(a/a[2],0,2), subvector(b/b[2],0,2), 1.0);
+    }
+  }
+
+} // namespace
+
+TEST(PROSAC, FitsWithOutliers) {
+  std::vector<Vector3> p1, p2;
+  std::vector<double> quality;
+  std::vector<bool> is_inlier;
+  make_matches(3000, 3, p1, p2, quality, is_inlier);
+
+  ProgressiveSampleConsensus<HomographyFittingFunctor, InterestPointErrorMetric>
+    prosac_instance(HomographyFittingFunctor(), InterestPointErrorMetric(), 10000, 2.0, 500);
+  Matrix<double> H = prosac_instance(p1, p2);
+  expect_homography_near(H);
+
+  // The stopping bound ends the search long before the iteration limit.
+  EXPECT_GT(2000, prosac_instance.num_iterations());
+
+  std::vector<size_t> indices = prosac_instance.inlier_indices(H, p1, p2);
+  size_t num_true = 0;
+  for (size_t i = 0; i < indices.size(); ++i)
+    num_true += is_inlier[indices[i]];
+  EXPECT_EQ(1000u, num_true);
+  EXPECT_GT(1010u, indices.size());
+}
+
+TEST(PROSAC, QualityOrdering) {
+  // With one inlier in twenty plain RANSAC needs over a million samples.
+  std::vector<Vector3> p1, p2;
+  std::vector<double> quality;
+  std::vector<bool> is_inlier;
+  make_matches(4000, 20, p1, p2, quality, is_inlier);
+
+  ProgressiveSampleConsensus<HomographyFittingFunctor, InterestPointErrorMetric>
+    prosac_instance(HomographyFittingFunctor(), InterestPointErrorMetric(), 5000, 2.0, 100);
+  Matrix<double> H = prosac_instance(p1, p2, quality);
+  expect_homography_near(H);
+  EXPECT_GT(200, prosac_instance.num_iterations());
+}
+
+TEST(PROSAC, UnrankedSamplesAreUniform) {
+  // A short PROSAC search only sees the best ranked matches, so unranked
+  // ones must be sampled from all of them.
+  const size_t num_points = 5000;
+  boost::random::mt19937 gen(0);
+  std::vector<size_t> sample;
+  size_t progressive_max = 0, uniform_max = 0;
+  detail::ProsacSampler progressive(num_points, 4, 100);
+  detail::ProsacSampler uniform(num_points, 4, 100, false);
+  for (int i = 0; i < 100; ++i) {
+    progressive.next(gen, sample);
+    progressive_max = std::max(progressive_max, *std::max_element(sample.begin(), sample.end()));
+    uniform.next(gen, sample);
+    uniform_max = std::max(uniform_max, *std::max_element(sample.begin(), sample.end()));
+  }
+  EXPECT_GT(200u, progressive_max);
+  EXPECT_LT(4000u, uniform_max);
+}
+
+TEST(PROSAC, SameResultForAnyThreadCount) {
+  std::vector<Vector3> p1, p2;
+  std::vector<double> quality;
+  std::vector<bool> is_inlier;
+  make_matches(2000, 2, p1, p2, quality, is_inlier);
+
+  const uint32 num_threads = vw_settings().default_num_threads();
+  ProgressiveSampleConsensus<HomographyFittingFunctor, InterestPointErrorMetric>
+    prosac_instance(HomographyFittingFunctor(), InterestPointErrorMetric(), 500, 2.0, 100);
+  vw_settings().set_default_num_threads(1);
+  Matrix<double> H1 = prosac_instance(p1, p2);
+  int iterations1 = prosac_instance.num_iterations();
+  vw_settings().set_default_num_threads(4);
+  Matrix<double> H4 = prosac_instance(p1, p2);
+  vw_settings().set_default_num_threads(num_threads);
+
+  EXPECT_EQ(iterations1, prosac_instance.num_iterations());
+  EXPECT_MATRIX_EQ(H1, H4);
+}
+
+TEST(PROSAC, NoFit) {
+  std::vector<Vector3> p1, p2;
+  std::vector<double> quality;
+  std::vector<bool> is_inlier;
+  make_matches(200, 4, p1, p2, quality, is_inlier);
+
+  // Fifty inliers can not satisfy a request for a hundred.
+  ProgressiveSampleConsensus<HomographyFittingFunctor, InterestPointErrorMetric>
+    prosac_instance(HomographyFittingFunctor(), InterestPointErrorMetric(), 1000, 2.0, 100);
+  EXPECT_THROW(prosac_instance(p1, p2), RANSACErr);
+
+  // Unless the requirement may be lowered.
+  ProgressiveSampleConsensus<HomographyFittingFunctor, InterestPointErrorMetric>
+    reducing(HomographyFittingFunctor(), InterestPointErrorMetric(), 1000, 2.0, 100, true);
+  expect_homography_near(reducing(p1, p2));
+}
@@ -0,0 +1,203 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <gtest/gtest_VW.h>
+#include <vw/Core/Settings.h>
+#include <vw/Math/StaticKDTree.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using std::vector;
+using namespace vw;
+using namespace vw::math;
+
+namespace {
+
+  vector<double> random_points(size_t num_points, size_t dim, unsigned seed) {
+    boost::random::mt19937 gen(seed);
+    boost::random::uniform_real_distribution<double> unit(0.0, 1.0);
+    vector<double> points(num_points*dim);
+    for (size_t i = 0; i < points.size(); ++i)
+      points[i] = unit(gen);
+    return points;
+  }
+
+  // All points sorted by squared distance to the query, then by index.
+  vector<std::pair<double, uint32> > brute_force(vector<double> const& points, size_t dim,
+                                                 double const* query) {
+    vector<std::pair<double, uint32> > result;
+    for (size_t i = 0; i < points.size()/dim; ++i) {
+      double distance = 0;
+      for (size_t d = 0; d < dim; ++d)
+        distance += (points[i*dim+d] - query[d])*(points[i*dim+d] - query[d]);
+      result.push_back(std::make_pair(distance, uint32(i)));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  void check_knn(size_t num_points, size_t dim, size_t leaf_size, size_t k) {
+    vector<double> points  = random_points(num_points, dim, 3);
+    vector<double> queries = random_points(50, dim, 4);
+    StaticKDTree<double> tree(&points[0], num_points, dim, leaf_size);
+    EXPECT_EQ(num_points, tree.size());
+
+    vector<uint32> indices(k);
+    vector<double> distances(k);
+    for (size_t q = 0; q < 50; ++q) {
+      vector<std::pair<double, uint32> > expected = brute_force(points, dim, &queries[q*dim]);
+      ASSERT_EQ(std::min(k, num_points),
+                tree.knn_search(&queries[q*dim], k, &indices[0], &distances[0]));
+      for (size_t j = 0; j < std::min(k, num_points); ++j) {
+        EXPECT_NEAR(expected[j].first, distances[j], 1e-12);
+        EXPECT_EQ(expected[j].second, indices[j]);
+      }
+    }
+  }
+
+} // namespace
+
+TEST(StaticKDTree, KnnMatchesBruteForce) {
+  check_knn(1000, 2, 8,  5);
+  check_knn(2000, 3, 32, 10);
+  check_knn(1500, 5, 16, 3);
+  check_knn(777,  3, 1,  1);
+}
+
+TEST(StaticKDTree, FewPoints) {
+  // More neighbors are asked for than there are points.
+  check_knn(5, 3, 32, 8);
+
+  vector<double> points(3, 1.0);
+  StaticKDTree<double> tree(&points[0], 1, 3);
+  EXPECT_EQ(0, tree.depth());
+  uint32 indices[2];
+  double distances[2];
+  double query[] = { 1, 1, 2 };
+  EXPECT_EQ(1u, tree.knn_search(query, 2, indices, distances));
+  EXPECT_EQ(0u, indices[0]);
+  EXPECT_DOUBLE_EQ(1.0, distances[0]);
+  EXPECT_EQ(uint32(-1), indices[1]);
+
+  StaticKDTree<double> empty(0, 0, 3);
+  EXPECT_EQ(0u, empty.knn_search(query, 2, indices, distances));
+  vector<uint32> found;
+  EXPECT_EQ(0u, empty.radius_search(query, 10.0, found));
+}
+
+TEST(StaticKDTree, RadiusMatchesBruteForce) {
+  const size_t dim = 3;
+  vector<double> points  = random_points(3000, dim, 5);
+  vector<double> queries = random_points(40, dim, 6);
+  StaticKDTree<double> tree(&points[0], 3000, dim, 16);
+
+  vector<uint32> found;
+  for (size_t q = 0; q < 40; ++q) {
+    vector<std::pair<double, uint32> > all = brute_force(points, dim, &queries[q*dim]);
+    vector<uint32> expected;
+    for (size_t i = 0; i < all.size() && all[i].first <= 0.1*0.1; ++i)
+      expected.push_back(all[i].second);
+    std::sort(expected.begin(), expected.end());
+    tree.radius_search(&queries[q*dim], 0.1, found);
+    EXPECT_EQ(expected, found);
+  }
+}
+
+TEST(StaticKDTree, Duplicates) {
+  // Many points on a few locations must still split into valid leaves.
+  vector<float> points;
+  for (int i = 0; i < 1000; ++i) {
+    points.push_back(float(i % 3));
+    points.push_back(0);
+  }
+  StaticKDTree<float> tree(&points[0], 1000, 2, 4);
+  float query[] = { 1.1f, 0 };
+  vector<uint32> found;
+  EXPECT_EQ(333u, tree.radius_search(query, 0.5f, found));
+  for (size_t i = 0; i < found.size(); ++i)
+    EXPECT_EQ(1u, found[i] % 3);
+
+  uint32 indices[10];
+  float  distances[10];
+  EXPECT_EQ(10u, tree.knn_search(query, 10, indices, distances));
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(1u, indices[i] % 3);
+    EXPECT_NEAR(0.01f, distances[i], 1e-5);
+  }
+}
+
+TEST(StaticKDTree, Batches) {
+  // Large enough to build and search in parallel.
+  const size_t dim = 3, num_points = 50000, num_queries = 3000, k = 4;
+  const uint32 num_threads = vw_settings().default_num_threads();
+  vw_settings().set_default_num_threads(4);
+  vector<double> points  = random_points(num_points, dim, 7);
+  vector<double> queries = random_points(num_queries, dim, 8);
+  StaticKDTree<double> tree(&points[0], num_points, dim);
+
+  vector<uint32> indices(num_queries*k);
+  vector<double> distances(num_queries*k);
+  tree.knn_search(&queries[0], num_queries, k, &indices[0], &distances[0]);
+  vector<vector<uint32> > neighbors;
+  tree.radius_search(&queries[0], num_queries, 0.02, neighbors);
+  vw_settings().set_default_num_threads(num_threads);
+
+  ASSERT_EQ(num_queries, neighbors.size());
+  vector<uint32> single_indices(k), found;
+  vector<double> single_distances(k);
+  for (size_t q = 0; q < num_queries; q += 7) {
+    tree.knn_search(&queries[q*dim], k, &single_indices[0], &single_distances[0]);
+    for (size_t j = 0; j < k; ++j) {
+      EXPECT_EQ(single_indices[j], indices[q*k+j]);
+      EXPECT_EQ(single_distances[j], distances[q*k+j]);
+    }
+    tree.radius_search(&queries[q*dim], 0.02, found);
+    EXPECT_EQ(found, neighbors[q]);
+  }
+
+  // Spot check the parallel build against brute force.
+  for (size_t q = 0; q < 20; ++q) {
+    vector<std::pair<double, uint32> > expected = brute_force(points, dim, &queries[q*dim]);
+    for (size_t j = 0; j < k; ++j)
+      EXPECT_EQ(expected[j].second, indices[q*k+j]);
+  }
+}
+
+TEST(StaticKDTree, FromFile) {
+  vector<vector<int> > file;
+  for (int x = 0; x < 10; ++x)
+    for (int y = 0; y < 10; ++y) {
+      vector<int> record;
+      record.push_back(x);
+      record.push_back(y);
+      file.push_back(record);
+    }
+  StaticKDTree<double> tree(file, 4);
+  EXPECT_EQ(100u, tree.size());
+  EXPECT_EQ(2u, tree.dim());
+
+  double query[] = { 3.2, 6.9 };
+  uint32 index;
+  double distance;
+  tree.knn_search(query, 1, &index, &distance);
+  EXPECT_EQ(37u, index);
+  EXPECT_NEAR(0.05, distance, 1e-12);
+}
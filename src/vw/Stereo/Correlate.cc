@@ -22,11 +22,122 @@
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/PixelAccessors.h>
 
+#include <vw/Core/RunOnce.h>
+#include <vw/Math/Functions.h>
 #include <vw/Stereo/Correlate.h>
 
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  #include <immintrin.h> // AVX2 gathers for run-time dispatch
+#endif
+
 using namespace vw;
 using namespace vw::stereo;
 
+namespace {
+
+  // Same arithmetic as BilinearInterpolation on a float image, so the
+  // samples match those of an InterpolationView exactly.
+  inline float bilinear_sample(const float* data, ptrdiff_t stride, float xx, float yy) {
+    const double i = xx, j = yy;
+    const int32 x = math::impl::_floor(i), y = math::impl::_floor(j);
+    const float* p = data + y*stride + x;
+    if (x == i && y == j)
+      return p[0];
+    float normx = float(i)-float(x), normy = float(j)-float(y), norm1mx = 1-normx, norm1my = 1-normy;
+    float result = p[0] * norm1mx;
+    result += p[1] * normx;
+    result *= norm1my;
+    float row = p[stride] * norm1mx;
+    row += p[stride+1] * normx;
+    result += row * normy;
+    return result;
+  }
+
+  void sample_row_scalar(const float* data, ptrdiff_t stride, float a, float b, float c, float e,
+                         int32 first, int32 count, float* out) {
+    for (int32 k=0; k<count; ++k) {
+      const int32 ii = first + k;
+      out[k] = bilinear_sample(data, stride, a * ii + b, c * ii + e);
+    }
+  }
+
+  typedef void (*SampleRowKernel)(const float*, ptrdiff_t, float, float, float, float,
+                                  int32, int32, float*);
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && \
+    defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (__GNUC__ >= 8))
+  #define VW_SUBPIXEL_AVX_KERNELS 1
+
+  // Eight samples at a time with gathers.  The operations are the same as in
+  // bilinear_sample() and are not fused, so each lane gives the same result.
+  __attribute__((target("avx2")))
+  void sample_row_avx2(const float* data, ptrdiff_t stride, float a, float b, float c, float e,
+                       int32 first, int32 count, float* out) {
+    const int LANES = 8;
+    const __m256  va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b);
+    const __m256  vc = _mm256_set1_ps(c), ve = _mm256_set1_ps(e);
+    const __m256  one = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps();
+    const __m256i vstride = _mm256_set1_epi32(int32(stride));
+    const __m256i lane    = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int32 k = 0;
+    for (; k+LANES<=count; k+=LANES) {
+      const __m256 ii = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(first+k), lane));
+      const __m256 xx = _mm256_add_ps(_mm256_mul_ps(va, ii), vb);
+      const __m256 yy = _mm256_add_ps(_mm256_mul_ps(vc, ii), ve);
+      const __m256 fx = _mm256_floor_ps(xx), fy = _mm256_floor_ps(yy);
+      const __m256i idx = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(fy), vstride),
+                                           _mm256_cvttps_epi32(fx));
+      const __m256 p00 = _mm256_i32gather_ps(data,          idx, 4);
+      const __m256 p10 = _mm256_i32gather_ps(data+1,        idx, 4);
+      const __m256 p01 = _mm256_i32gather_ps(data+stride,   idx, 4);
+      const __m256 p11 = _mm256_i32gather_ps(data+stride+1, idx, 4);
+
+      const __m256 normx = _mm256_sub_ps(xx, fx), normy = _mm256_sub_ps(yy, fy);
+      const __m256 norm1mx = _mm256_sub_ps(one, normx), norm1my = _mm256_sub_ps(one, normy);
+      __m256 result = _mm256_mul_ps(p00, norm1mx);
+      result = _mm256_add_ps(result, _mm256_mul_ps(p10, normx));
+      result = _mm256_mul_ps(result, norm1my);
+      __m256 row = _mm256_mul_ps(p01, norm1mx);
+      row    = _mm256_add_ps(row, _mm256_mul_ps(p11, normx));
+      result = _mm256_add_ps(result, _mm256_mul_ps(row, normy));
+
+      // Integer locations return the pixel itself, like BilinearInterpolation.
+      const __m256 on_pixel = _mm256_and_ps(_mm256_cmp_ps(normx, zero, _CMP_EQ_OQ),
+                                            _mm256_cmp_ps(normy, zero, _CMP_EQ_OQ));
+      _mm256_storeu_ps(out+k, _mm256_blendv_ps(result, p00, on_pixel));
+    }
+    // Clear the upper halves before the scalar tail, which is not VEX encoded.
+    _mm256_zeroupper();
+    sample_row_scalar(data, stride, a, b, c, e, first+k, count-k, out+k);
+  }
+#endif
+
+  SampleRowKernel sample_row_kernel      = sample_row_scalar;
+  vw::RunOnce     sample_row_kernel_once = VW_RUNONCE_INIT;
+
+  /// Pick the fastest bilinear row sampler that the current CPU supports.
+  void select_sample_row_kernel() {
+#if defined(VW_SUBPIXEL_AVX_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      sample_row_kernel = sample_row_avx2;
+#endif
+  }
+
+} // end anonymous namespace
+
+void stereo::detail::bilinear_sample_affine_row(ImageView<float> const& image,
+                                                float a, float b, float c, float e,
+                                                int32 first, int32 count, float* out) {
+  sample_row_kernel_once.run(select_sample_row_kernel);
+  // The vector kernel uses 32 bit offsets into the image.
+  if (double(image.cols())*double(image.rows()) >= 2147483647.0)
+    sample_row_scalar(image.data(), image.cols(), a, b, c, e, first, count, out);
+  else
+    sample_row_kernel(image.data(), image.cols(), a, b, c, e, first, count, out);
+}
+
 
 int
 stereo::adjust_weight_image(ImageView<float> &weight,
@@ -45,6 +45,14 @@ namespace stereo {
     ImageView<float>
     compute_spatial_weight_image(int32 kern_width, int32 kern_height,
                                  float two_sigma_sqr);
+
+    /// Bilinearly interpolate a float image at (a*i + b, c*i + e) for
+    /// i = first ... first+count-1, giving the same values as BilinearInterpolation.
+    /// - Every point must lie at least one pixel inside the right and bottom edges.
+    /// - Uses AVX2 gathers if the CPU supports them.
+    void bilinear_sample_affine_row(ImageView<float> const& image,
+                                    float a, float b, float c, float e,
+                                    int32 first, int32 count, float* out);
   }
 
   /// Check for consistency between a left-to-right and right-to-left
@@ -76,6 +76,156 @@ void cross_corr_consistency_check( ImageViewBase<ImageT1> const& l2r,
                                           << ((float)count/match_count*100) << " percent).\n";
 }
 
+namespace detail {
+
+  /// Cholesky factorization of a symmetric positive definite NxN matrix
+  /// stored row major.  The lower triangle is replaced by the factor.
+  /// - Returns false if the matrix is not positive definite, like LAPACK posv.
+  template <int N>
+  inline bool cholesky_factor(float* a) {
+    for (int j=0; j<N; ++j) {
+      float ajj = a[j*N+j];
+      for (int k=0; k<j; ++k)
+        ajj -= a[j*N+k]*a[j*N+k];
+      if (!(ajj > 0)) // Also catches NaN
+        return false;
+      ajj = std::sqrt(ajj);
+      a[j*N+j] = ajj;
+      for (int i=j+1; i<N; ++i) {
+        float s = a[i*N+j];
+        for (int k=0; k<j; ++k)
+          s -= a[i*N+k]*a[j*N+k];
+        a[i*N+j] = s / ajj;
+      }
+    }
+    return true;
+  }
+
+  /// Solve (L L^T) x = b in place using the output of cholesky_factor().
+  template <int N>
+  inline void cholesky_solve(const float* l, float* b) {
+    for (int i=0; i<N; ++i) {
+      for (int k=0; k<i; ++k)
+        b[i] -= l[i*N+k]*b[k];
+      b[i] /= l[i*N+i];
+    }
+    for (int i=N-1; i>=0; --i) {
+      for (int k=i+1; k<N; ++k)
+        b[i] -= l[k*N+i]*b[k];
+      b[i] /= l[i*N+i];
+    }
+  }
+
+  /// Complete the 6x6 affine normal equations from the entries accumulated
+  /// in the upper triangle.  The UR block entries (1,3), (2,3) and (2,4)
+  /// equal (0,4), (0,5) and (1,5) and are not accumulated.
+  inline void fill_affine_normal_matrix(float* rhs) {
+    rhs[ 9] = rhs[ 4]; // (1,3) = (0,4)
+    rhs[15] = rhs[ 5]; // (2,3) = (0,5)
+    rhs[16] = rhs[11]; // (2,4) = (1,5)
+    for (int r = 1; r < 6; ++r)
+      for (int c = 0; c < r; ++c)
+        rhs[r*6+c] = rhs[c*6+r];
+  }
+
+  /// Contiguous row major copy of the left image and its gradients over a
+  /// correlation window, so the subpixel refiners can use plain arrays.
+  template <class ChannelT>
+  struct SubpixelWindow {
+    std::vector<ChannelT> left;
+    std::vector<float>    I_x, I_y;
+
+    SubpixelWindow(int32 kern_width, int32 kern_height)
+      : left(kern_width*kern_height), I_x(kern_width*kern_height), I_y(kern_width*kern_height) {}
+
+    void load(ImageView<ChannelT> const& left_image, ImageView<float> const& x_deriv,
+              ImageView<float> const& y_deriv, BBox2i const& window) {
+      size_t k = 0;
+      for (int32 r = window.min().y(); r < window.max().y(); ++r) {
+        for (int32 c = window.min().x(); c < window.max().x(); ++c) {
+          left[k] = left_image(c,r);
+          I_x [k] = x_deriv   (c,r);
+          I_y [k] = y_deriv   (c,r);
+          ++k;
+        }
+      }
+    }
+  };
+
+  /// Bilinearly samples the right image over a correlation window warped by
+  /// an affine transform.  Windows which are safely inside the image are
+  /// sampled a row at a time without edge checks.
+  template <class ChannelT>
+  class AffineWindowSampler {
+    typedef InterpolationView<EdgeExtensionView<ImageView<ChannelT>, ZeroEdgeExtension>, BilinearInterpolation> SafeInterpT;
+    typedef InterpolationView<EdgeExtensionView<ImageView<ChannelT>, NoEdgeExtension  >, BilinearInterpolation> UnsafeInterpT;
+
+    ImageView<ChannelT> m_image;
+    SafeInterpT   m_safe_interp;
+    UnsafeInterpT m_unsafe_interp;
+    int32 m_kern_width, m_kern_height;
+
+    // Generic row sampling, and a vectorized version for float images.
+    template <class T>
+    static void sample_row(ImageView<T> const& /*image*/, UnsafeInterpT const& interp,
+                           float a, float b, float c, float e,
+                           int32 first, int32 count, T* out) {
+      for (int32 k=0; k<count; ++k) {
+        const int32 ii = first + k;
+        out[k] = interp(a * ii + b, c * ii + e);
+      }
+    }
+    static void sample_row(ImageView<float> const& image, UnsafeInterpT const& /*interp*/,
+                           float a, float b, float c, float e,
+                           int32 first, int32 count, float* out) {
+      bilinear_sample_affine_row(image, a, b, c, e, first, count, out);
+    }
+
+  public:
+    AffineWindowSampler(ImageView<ChannelT> const& image, int32 kern_width, int32 kern_height)
+      : m_image(image),
+        m_safe_interp  (interpolate(image, BilinearInterpolation(), ZeroEdgeExtension())),
+        m_unsafe_interp(interpolate(image, BilinearInterpolation(), NoEdgeExtension  ())),
+        m_kern_width(kern_width), m_kern_height(kern_height) {}
+
+    /// Sample the window about (x_base, y_base) warped by the row major 2x3
+    /// transform d, writing kern_width*kern_height samples to out in row major order.
+    /// - Window pixel (ii,jj) is sampled at
+    ///   (d[0]*ii + (x_base + d[1]*jj + d[2]),  d[3]*ii + (y_base + d[4]*jj + d[5])).
+    void sample(float x_base, float y_base, const float* d, ChannelT* out) const {
+      const int32 half_width  = m_kern_width /2;
+      const int32 half_height = m_kern_height/2;
+
+      // The transform is affine so the extremes are at the corners.  Leave a
+      // pixel of margin to cover rounding and the interpolation footprint.
+      bool inside = true;
+      for (int corner = 0; corner < 4; ++corner) {
+        const int32 ii = (corner & 1) ? half_width  : -half_width;
+        const int32 jj = (corner & 2) ? half_height : -half_height;
+        const float xx = d[0] * ii + (x_base + d[1] * jj + d[2]);
+        const float yy = d[3] * ii + (y_base + d[4] * jj + d[5]);
+        if (!(xx >= 1 && xx < m_image.cols()-2 && yy >= 1 && yy < m_image.rows()-2))
+          inside = false;
+      }
+
+      for (int32 jj = -half_height; jj <= half_height; ++jj) {
+        const float xx_partial = x_base + d[1] * jj + d[2];
+        const float yy_partial = y_base + d[4] * jj + d[5];
+        if (inside) {
+          sample_row(m_image, m_unsafe_interp, d[0], xx_partial, d[3], yy_partial,
+                     -half_width, m_kern_width, out);
+        } else {
+          for (int32 ii = -half_width; ii <= half_width; ++ii)
+            out[ii+half_width] = m_safe_interp(d[0] * ii + xx_partial, d[3] * ii + yy_partial);
+        }
+        out += m_kern_width;
+      }
+    }
+  };
+
+} // End namespace detail
+
+
 
 template<class ChannelT> void
 subpixel_correlation_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
@@ -482,10 +632,6 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
                                 bool   do_vertical_subpixel,
                                 bool /*verbose*/ ) {
   typedef Vector<float,6  > Vector6f;
-  typedef Matrix<float,6,6> Matrix6x6f;
-  typedef typename ImageView<float>::pixel_accessor ImageViewFAcc;
-  typedef typename CropView<ImageView<float   > >::pixel_accessor CropViewFAcc;
-  typedef typename CropView<ImageView<ChannelT> >::pixel_accessor CropViewTAcc;
 
   // Bail out if no subpixel computation has been requested
   if (!do_horizontal_subpixel && !do_vertical_subpixel) return;
@@ -499,9 +645,8 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
              ArgumentErr() << "subpixel_correlation: left image and "
              << "disparity map do not have the same dimensions.");
 
-  // Interpolated Input Images
-  InterpolationView<EdgeExtensionView<ImageView<ChannelT>, ZeroEdgeExtension>, BilinearInterpolation> right_interp_image =
-    interpolate(right_image, BilinearInterpolation(), ZeroEdgeExtension());
+  // Interpolated right image windows
+  detail::AffineWindowSampler<ChannelT> right_sampler(right_image, kern_width, kern_height);
 
   // This is the maximum number of pixels that the solution can be
   // adjusted by affine subpixel refinement.
@@ -517,9 +662,11 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
   ImageView<float> weight_template =
     detail::compute_spatial_weight_image(kern_width, kern_height, two_sigma_sqr);
 
-  // Workspace images are allocated up here out of the tight inner
-  // loop.  We rasterize into these directly in the code below.
+  // Workspace buffers are allocated up here out of the tight inner loop.
   ImageView<float> w(kern_width, kern_height);
+  detail::SubpixelWindow<ChannelT> window(kern_width, kern_height);
+  std::vector<ChannelT> right_samples(kern_pixels);
+  std::vector<float>    I_e(kern_pixels);
 
   // Iterate over all of the pixels in the disparity map except for
   // the outer edges.
@@ -549,12 +696,6 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
       Vector6f d;
       d(0) = 1.0; d(1) = 0.0; d(2) = 0.0;
       d(3) = 0.0; d(4) = 1.0; d(5) = 0.0;
-      float *dPtr = &(d[0]);
-
-      // Compute the derivative image patches
-      CropView<ImageView<ChannelT> > left_image_patch = crop(left_image, current_window);
-      CropView<ImageView<float> > I_x = crop(x_deriv, current_window);
-      CropView<ImageView<float> > I_y = crop(y_deriv, current_window);
 
       // Compute the base weight image
       int32 good_pixels = adjust_weight_image(w, crop(disparity_map, current_window), weight_template);
@@ -566,6 +707,10 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
         continue;
       }
 
+      // Every sample is weighted by the first weight in the window.
+      const float window_weight = w(0,0);
+      window.load(left_image, x_deriv, y_deriv, current_window);
+
       float curr_sum_I_e_val = 0.0;
       float prev_sum_I_e_val = 0.0;
 
@@ -582,7 +727,12 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
         float x_base = x + disparity_map(x,y)[0];
         float y_base = y + disparity_map(x,y)[1];
 
-        Matrix6x6f rhs;
+        // The right image samples do not change during the EM iterations.
+        right_sampler.sample(x_base, y_base, &(d[0]), &right_samples[0]);
+        for (int32 k = 0; k < kern_pixels; ++k)
+          I_e[k] = right_samples[k] - window.left[k];
+
+        float    rhs[36];
         Vector6f lhs, prev_lhs;
 
         //set init params - START
@@ -596,7 +746,6 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
         float in_curr_sum_I_e_val = 0.0;
         Vector6f d_em;
         d_em = d;
-        float *d_emPtr = &(d_em[0]);
 
         for (unsigned em_iter=0; em_iter < M_MAX_EM_ITER; em_iter++){
           float noise_norm_factor = 1.0/sqrt(2*M_PI*var2_noise);
@@ -604,44 +753,33 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
 
           //reset lhs and rhs
           std::fill( lhs.begin(), lhs.end(), 0.0f );
-          std::fill( rhs.begin(), rhs.end(), 0.0f );
+          std::fill( rhs, rhs+36, 0.0f );
 
           in_curr_sum_I_e_val = 0.0;
           float mean_noise_tmp  = 0.0;
           float sum_gamma_noise = 0.0;
           float sum_gamma_plane = 0.0;
 
-          // Set up pixel accessors
-          CropViewFAcc I_x_row = I_x.origin(), I_y_row = I_y.origin();
-          CropViewTAcc left_image_patch_row = left_image_patch.origin();
-          ImageViewFAcc w_row = w.origin();
-
           // Counts pixels skipped on evaluation.
           int32 skip = 0;
 
           // Perform loop that does Expectation and Maximization in one go
+          int32 k = 0;
           for (int32 jj = -kern_half_height; jj <= kern_half_height; ++jj) {
-            ImageViewFAcc w_ptr = w_row;
-            CropViewFAcc I_x_ptr = I_x_row, I_y_ptr = I_y_row;
-            CropViewTAcc left_image_patch_ptr = left_image_patch_row;
-            float xx_partial      = x_base + d[1] * jj + d[2];
-            float yy_partial      = y_base + d[4] * jj + d[5];
             float delta_x_partial = d_em[1] * jj + d_em[2];
             float delta_y_partial = d_em[4] * jj + d_em[5];
 
-            for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii) {
-              // First we compute the pixel offset for the right image
-              // and the error for the current pixel.
-              float xx      = dPtr   [0] * ii + xx_partial;
-              float yy      = dPtr   [3] * ii + yy_partial;
-              float delta_x = d_emPtr[0] * ii + delta_x_partial;
-              float delta_y = d_emPtr[3] * ii + delta_y_partial;
+            for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii, ++k) {
+              float delta_x = d_em[0] * ii + delta_x_partial;
+              float delta_y = d_em[3] * ii + delta_y_partial;
+              const float I_x_k = window.I_x[k];
+              const float I_y_k = window.I_y[k];
 
               /// Expectation
-              ChannelT interpreted_px = right_interp_image(xx,yy);  // 10% of function time is spent in this call, 6% performing bounds checking.
-              float I_e_val = interpreted_px - (*left_image_patch_ptr);
+              ChannelT interpreted_px = right_samples[k];
+              float I_e_val = I_e[k];
               in_curr_sum_I_e_val += I_e_val;
-              float temp_plane     = I_e_val - delta_x*(*I_x_ptr) - delta_y*(*I_y_ptr);
+              float temp_plane     = I_e_val - delta_x*I_x_k - delta_y*I_y_k;
               float temp_noise     = interpreted_px - mean_noise;
               float plane_prob_exp = -1*(temp_plane*temp_plane)/(2*var2_plane); // precompute to avoid underflow
               float plane_prob     = (plane_prob_exp < -75) ? 0.0f : plane_norm_factor * exp(plane_prob_exp);
@@ -661,20 +799,17 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
 
               // We combine the error value with the derivative and
               // add this to the update equation.
-              float weight  = gamma_plane*(*w_ptr);
+              float weight  = gamma_plane*window_weight;
               if ( weight < 1e-26 ) {
                 // avoid underflow
-                I_x_ptr.next_col();
-                I_y_ptr.next_col();
-                left_image_patch_ptr.next_col();
                 skip++;
                 continue;
               }
-              float I_x_val = weight  * (*I_x_ptr);
-              float I_y_val = weight  * (*I_y_ptr);
-              float I_x_sqr = I_x_val * (*I_x_ptr);
-              float I_y_sqr = I_y_val * (*I_y_ptr);
-              float I_x_I_y = I_x_val * (*I_y_ptr);
+              float I_x_val = weight  * I_x_k;
+              float I_y_val = weight  * I_y_k;
+              float I_x_sqr = I_x_val * I_x_k;
+              float I_y_sqr = I_y_val * I_y_k;
+              float I_x_I_y = I_x_val * I_y_k;
 
               // Left hand side
               lhs(0) -= ii * I_x_val * I_e_val;
@@ -689,92 +824,42 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
               multipliers[1] = ii*jj;
               multipliers[2] = jj*jj;
 
-
-
-              // Right Hand Side UL
-              float* rhsData = rhs.data(); // TEST: Access RHS by raw data pointer
-              rhsData[ 0] += multipliers[0] * I_x_sqr;
-              rhsData[ 1] += multipliers[1] * I_x_sqr;
-              rhsData[ 2] += ii    * I_x_sqr;
-              rhsData[ 7] += multipliers[2] * I_x_sqr;
-              rhsData[ 8] += jj    * I_x_sqr;
-              rhsData[14] +=         I_x_sqr;
-
-              // Right Hand Side UR
-              rhsData[ 3] += multipliers[0] * I_x_I_y;
-              rhsData[ 4] += multipliers[1] * I_x_I_y;
-              rhsData[ 5] += ii    * I_x_I_y;
-              rhsData[10] += multipliers[2] * I_x_I_y;
-              rhsData[11] += jj    * I_x_I_y;
-              rhsData[17] +=         I_x_I_y;
-
-              // Right Hand Side LR
-              rhsData[21] += multipliers[0] * I_y_sqr;
-              rhsData[22] += multipliers[1] * I_y_sqr;
-              rhsData[23] += ii    * I_y_sqr;
-              rhsData[28] += multipliers[2] * I_y_sqr;
-              rhsData[29] += jj    * I_y_sqr;
-              rhsData[35] +=         I_y_sqr;
-              
-              
-/*
               // Right Hand Side UL
-              rhs(0,0) += multipliers[0] * I_x_sqr;
-              rhs(0,1) += multipliers[1] * I_x_sqr;
-              rhs(0,2) += ii    * I_x_sqr;
-              rhs(1,1) += multipliers[2] * I_x_sqr;
-              rhs(1,2) += jj    * I_x_sqr;
-              rhs(2,2) +=         I_x_sqr;
+              rhs[ 0] += multipliers[0] * I_x_sqr;
+              rhs[ 1] += multipliers[1] * I_x_sqr;
+              rhs[ 2] += ii    * I_x_sqr;
+              rhs[ 7] += multipliers[2] * I_x_sqr;
+              rhs[ 8] += jj    * I_x_sqr;
+              rhs[14] +=         I_x_sqr;
 
               // Right Hand Side UR
-              rhs(0,3) += multipliers[0] * I_x_I_y;
-              rhs(0,4) += multipliers[1] * I_x_I_y;
-              rhs(0,5) += ii    * I_x_I_y;
-              rhs(1,4) += multipliers[2] * I_x_I_y;
-              rhs(1,5) += jj    * I_x_I_y;
-              rhs(2,5) +=         I_x_I_y;
+              rhs[ 3] += multipliers[0] * I_x_I_y;
+              rhs[ 4] += multipliers[1] * I_x_I_y;
+              rhs[ 5] += ii    * I_x_I_y;
+              rhs[10] += multipliers[2] * I_x_I_y;
+              rhs[11] += jj    * I_x_I_y;
+              rhs[17] +=         I_x_I_y;
 
               // Right Hand Side LR
-              rhs(3,3) += multipliers[0] * I_y_sqr;
-              rhs(3,4) += multipliers[1] * I_y_sqr;
-              rhs(3,5) += ii    * I_y_sqr;
-              rhs(4,4) += multipliers[2] * I_y_sqr;
-              rhs(4,5) += jj    * I_y_sqr;
-              rhs(5,5) +=         I_y_sqr;
+              rhs[21] += multipliers[0] * I_y_sqr;
+              rhs[22] += multipliers[1] * I_y_sqr;
+              rhs[23] += ii    * I_y_sqr;
+              rhs[28] += multipliers[2] * I_y_sqr;
+              rhs[29] += jj    * I_y_sqr;
+              rhs[35] +=         I_y_sqr;
               // End Maximization
-*/
-              I_x_ptr.next_col();
-              I_y_ptr.next_col();
-              left_image_patch_ptr.next_col();
             }
-            I_x_row.next_row();
-            I_y_row.next_row();
-            left_image_patch_row.next_row();
           }
 
           // Checking for early termination
           if ( skip == kern_pixels )
             break;
 
-          // Fill in symmetric entries
-          rhs(1,0) = rhs(0,1);
-          rhs(2,0) = rhs(0,2);
-          rhs(2,1) = rhs(1,2);
-          rhs(3,0) = rhs(0,3);
-          rhs(1,3) = rhs(3,1) = rhs(4,0) = rhs(0,4);
-          rhs(2,3) = rhs(3,2) = rhs(5,0) = rhs(0,5);
-          rhs(4,1) = rhs(1,4);
-          rhs(2,4) = rhs(4,2) = rhs(5,1) = rhs(1,5);
-          rhs(5,2) = rhs(2,5);
-          rhs(4,3) = rhs(3,4);
-          rhs(5,3) = rhs(3,5);
-          rhs(5,4) = rhs(4,5);
-
-          // Solves lhs = rhs * x, and stores the result in-place in lhs.
-          const math::f77_int n = 6;
-          const math::f77_int nrhs = 1;
-          math::f77_int info;
-          math::posv('L',n,nrhs,&(rhs(0,0)), n, &(lhs(0)), n, &info);
+          // Fill in symmetric entries and solve lhs = rhs * x in place.
+          // - lhs is left unchanged if rhs is not positive definite, as with posv.
+          detail::fill_affine_normal_matrix(rhs);
+          if (detail::cholesky_factor<6>(rhs))
+            detail::cholesky_solve<6>(rhs, &(lhs(0)));
 
           //normalize the mean of the noise
           mean_noise = mean_noise_tmp/sum_gamma_noise;
@@ -898,10 +983,6 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
                              bool /*verbose*/ ) {
                              
   typedef Vector<float,6  > Vector6f;
-  typedef Matrix<float,6,6> Matrix6x6f;
-  typedef typename ImageView<float>::pixel_accessor ImageViewFAcc;
-  typedef typename CropView<ImageView<float   > >::pixel_accessor CropViewFAcc;
-  typedef typename CropView<ImageView<ChannelT> >::pixel_accessor CropViewTAcc;
 
   // Bail out if no subpixel computation has been requested
   if (!do_horizontal_subpixel && !do_vertical_subpixel) return;
@@ -919,14 +1000,8 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
   //  changes in the results and significantly increased the run time.  This is true for both the pyramid
   //  and non-pyramid version of this algorithm.
 
-  // Interpolated Input Images
-  InterpolationView<EdgeExtensionView<ImageView<ChannelT>, ZeroEdgeExtension>, BilinearInterpolation> right_interp_image =
-         interpolate(right_image, BilinearInterpolation(), ZeroEdgeExtension());
-  // An alternate interpolation view with no bounds checking!
-  InterpolationView<EdgeExtensionView<ImageView<ChannelT>, NoEdgeExtension>, BilinearInterpolation> right_interp_image_unsafe =
-         interpolate(right_image, BilinearInterpolation(), NoEdgeExtension());
-
-
+  // Interpolated right image windows
+  detail::AffineWindowSampler<ChannelT> right_sampler(right_image, kern_width, kern_height);
 
   // This is the maximum number of pixels that the solution can be
   // adjusted by affine subpixel refinement.
@@ -943,9 +1018,11 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
   ImageView<float> weight_template =
     detail::compute_spatial_weight_image(kern_width, kern_height, two_sigma_sqr);
 
-  // Workspace images are allocated up here out of the tight inner
-  // loop.  We rasterize into these directly in the code below.
+  // Workspace buffers are allocated up here out of the tight inner loop.
   ImageView<float> w(kern_width, kern_height);
+  detail::SubpixelWindow<ChannelT> window(kern_width, kern_height);
+  std::vector<ChannelT> right_samples(kern_pixels);
+  std::vector<float>    I_x_w(kern_pixels), I_y_w(kern_pixels);
 
   // Iterate over all of the pixels in the disparity map except for the outer edges.
   for ( int32 y = std::max(region_of_interest.min().y()-1,kern_half_height);
@@ -974,12 +1051,6 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
       Vector6f d;
       d(0) = 1.0; d(1) = 0.0; d(2) = 0.0;
       d(3) = 0.0; d(4) = 1.0; d(5) = 0.0;
-      float *dPtr = &(d[0]); // Raw data pointer access to avoid inlining failure
-
-      // Compute the derivative image patches
-      CropView<ImageView<ChannelT> > left_image_patch = crop(left_image, current_window);
-      CropView<ImageView<float> > I_x = crop(x_deriv, current_window);
-      CropView<ImageView<float> > I_y = crop(y_deriv, current_window);
 
       // Compute the base weight image
       int32 good_pixels = adjust_weight_image(w, crop(disparity_map, current_window), weight_template);
@@ -991,8 +1062,59 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
         continue;
       }
 
-      //float curr_sum_I_e_val = 0.0;
-      //float prev_sum_I_e_val = 0.0;
+      // Every sample is weighted by the first weight in the window.
+      const float weight = w(0,0);
+
+      // The normal equations only depend on the left image gradients, so
+      // they are built and factored once and reused by every iteration.
+      window.load(left_image, x_deriv, y_deriv, current_window);
+      float rhs[36] = {0};
+      int32 k = 0;
+      for (int32 jj = -kern_half_height; jj <= kern_half_height; ++jj) {
+        for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii, ++k) {
+          float I_x_val = weight  * window.I_x[k];
+          float I_y_val = weight  * window.I_y[k];
+          float I_x_sqr = I_x_val * window.I_x[k];
+          float I_y_sqr = I_y_val * window.I_y[k];
+          float I_x_I_y = I_x_val * window.I_y[k];
+          I_x_w[k] = I_x_val;
+          I_y_w[k] = I_y_val;
+
+          float multipliers[3];
+          multipliers[0] = ii*ii;
+          multipliers[1] = ii*jj;
+          multipliers[2] = jj*jj;
+
+          // Right Hand Side UL
+          rhs[ 0] += multipliers[0] * I_x_sqr;
+          rhs[ 1] += multipliers[1] * I_x_sqr;
+          rhs[ 2] += ii    * I_x_sqr;
+          rhs[ 7] += multipliers[2] * I_x_sqr;
+          rhs[ 8] += jj    * I_x_sqr;
+          rhs[14] +=         I_x_sqr;
+
+          // Right Hand Side UR
+          rhs[ 3] += multipliers[0] * I_x_I_y;
+          rhs[ 4] += multipliers[1] * I_x_I_y;
+          rhs[ 5] += ii    * I_x_I_y;
+          rhs[10] += multipliers[2] * I_x_I_y;
+          rhs[11] += jj    * I_x_I_y;
+          rhs[17] +=         I_x_I_y;
+
+          // Right Hand Side LR
+          rhs[21] += multipliers[0] * I_y_sqr;
+          rhs[22] += multipliers[1] * I_y_sqr;
+          rhs[23] += ii    * I_y_sqr;
+          rhs[28] += multipliers[2] * I_y_sqr;
+          rhs[29] += jj    * I_y_sqr;
+          rhs[35] +=         I_y_sqr;
+        }
+      }
+
+      // Fill in the lower triangle and factor.  If the factorization fails
+      // the update is the unsolved gradient, as it was with posv.
+      detail::fill_affine_normal_matrix(rhs);
+      const bool solvable = detail::cholesky_factor<6>(rhs);
 
       // Iterate until a solution is found or the max number of
       // iterations is reached.
@@ -1006,202 +1128,31 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
 
         float x_base = x + disparity_map(x,y)[0];
         float y_base = y + disparity_map(x,y)[1];
+        right_sampler.sample(x_base, y_base, &(d[0]), &right_samples[0]);
 
-        //curr_sum_I_e_val = 0.0;
-        
-        Matrix6x6f rhs;
         Vector6f lhs;
-
-
-        // Compute the outer range of xx and yy values and determine if everything will
-        // fall within the bounds of right_interp_image
-        // - If everything is safely in bounds, we can skip bounds checking in the main pixel loop below.
-        float xVals[4], yVals[4];
-        xVals[0] = dPtr[0]*(-kern_half_width) + dPtr[1]*  kern_half_height  + dPtr[2];
-        yVals[0] = dPtr[3]*(-kern_half_width) + dPtr[4]*  kern_half_height  + dPtr[5];
-        xVals[1] = dPtr[0]*(-kern_half_width) + dPtr[1]*(-kern_half_height) + dPtr[2];
-        yVals[1] = dPtr[3]*(-kern_half_width) + dPtr[4]*(-kern_half_height) + dPtr[5];
-        xVals[2] = dPtr[0]*  kern_half_width  + dPtr[1]*(-kern_half_height) + dPtr[2];
-        yVals[2] = dPtr[3]*  kern_half_width  + dPtr[4]*(-kern_half_height) + dPtr[5];
-        xVals[3] = dPtr[0]*  kern_half_width  + dPtr[1]*  kern_half_height  + dPtr[2];
-        yVals[3] = dPtr[3]*  kern_half_width  + dPtr[4]*  kern_half_height  + dPtr[5];
-        bool use_unsafe_interp = true;
-        const float SAFETY_BUFFER = kern_half_width + kern_half_height; // Extra buffer to make sure we stay in bounds
-        float minCol = -x_base + SAFETY_BUFFER;
-        float maxCol = right_image.cols() - x_base - SAFETY_BUFFER;
-        float minRow = -y_base + SAFETY_BUFFER;
-        float maxRow = right_image.rows() - y_base - SAFETY_BUFFER;
-        for (int i=0; i<4; ++i) { // If each corner of the kernel is in the safe bounds we should be safe
-          if ( (xVals[i] >= maxCol) || (xVals[i] <= minCol) ||
-               (yVals[i] >= maxRow) || (yVals[i] <= minRow)   ) {
-            use_unsafe_interp = false;
-            break;
-          }
-        }
-
-        // Set up pixel accessors
-        CropViewFAcc I_x_row = I_x.origin(), I_y_row = I_y.origin();
-        CropViewTAcc left_image_patch_row = left_image_patch.origin();
-        ImageViewFAcc w_row = w.origin();
-
+        k = 0;
         for (int32 jj = -kern_half_height; jj <= kern_half_height; ++jj) {
-        
-          ImageViewFAcc w_ptr = w_row;
-          CropViewFAcc  I_x_ptr = I_x_row, I_y_ptr = I_y_row;
-          CropViewTAcc  left_image_patch_ptr = left_image_patch_row;
-          float xx_partial      = x_base + dPtr[1] * jj + dPtr[2]; // Compute outside inner loop for speed
-          float yy_partial      = y_base + dPtr[4] * jj + dPtr[5];
-
-
-          for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii) {
-            // First we compute the pixel offset for the right image
-            // and the error for the current pixel.
-            float xx = dPtr[0] * ii + xx_partial;
-            float yy = dPtr[3] * ii + yy_partial;
-
-            // Avoid using the edge-extension view when possible.
-            ChannelT interpreted_px;
-            if (use_unsafe_interp)
-              interpreted_px = right_interp_image_unsafe(xx,yy);
-            else
-              interpreted_px = right_interp_image(xx,yy);
-            float I_e_val = interpreted_px - (*left_image_patch_ptr);
-            
-            
-            // Apply the robust cost function.  We use a cauchy
-            // function to gently remove outliers for small errors.
-            //float thresh = 1e-4;
-
-            // Cauchy seems to work well with thresh ~= 1e-4
-            //float error_value   = fabsf(I_e_val);
-            //float robust_weight = sqrtf(detail::cauchy_robust_coefficient(error_value,thresh))/error_value;
-
-            //curr_sum_I_e_val += error_value; // Accumulated error value over pixels
-
-            // Huber seems to work well with thresh >= 1e-5
-            //        float robust_weight = sqrt(detail::huber_robust_coefficient(fabs(I_e_val),thresh))/fabs(I_e_val);
-
-            // Disable robust cost function altogether
-            float robust_weight = 1;
-        
+          for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii, ++k) {
             // We combine the error value with the derivative and
             // add this to the update equation.
-            float weight = robust_weight *(*w_ptr);
-            
-            //in_curr_sum_I_e_val += I_e_val;
-           
-            
-            float I_x_val = weight  * (*I_x_ptr);
-            float I_y_val = weight  * (*I_y_ptr);
-            float I_x_sqr = I_x_val * (*I_x_ptr);
-            float I_y_sqr = I_y_val * (*I_y_ptr);
-            float I_x_I_y = I_x_val * (*I_y_ptr);
-
-            // Left hand side
-            float IxIe = I_x_val * I_e_val;
-            float IyIe = I_y_val * I_e_val;
+            float I_e_val = right_samples[k] - window.left[k];
+            float IxIe = I_x_w[k] * I_e_val;
+            float IyIe = I_y_w[k] * I_e_val;
             lhs(0) -= ii * IxIe;
             lhs(1) -= jj * IxIe;
             lhs(2) -=      IxIe;
             lhs(3) -= ii * IyIe;
             lhs(4) -= jj * IyIe;
             lhs(5) -=      IyIe;
-
-            float multipliers[3];
-            multipliers[0] = ii*ii;
-            multipliers[1] = ii*jj;
-            multipliers[2] = jj*jj;
-
-            float* rhsData = rhs.data(); // Access RHS by raw data pointer to avoid inlining failure
-            
-            // Right Hand Side UL
-            rhsData[ 0] += multipliers[0] * I_x_sqr;
-            rhsData[ 1] += multipliers[1] * I_x_sqr;
-            rhsData[ 2] += ii    * I_x_sqr;
-            rhsData[ 7] += multipliers[2] * I_x_sqr;
-            rhsData[ 8] += jj    * I_x_sqr;
-            rhsData[14] +=         I_x_sqr;
-
-            // Right Hand Side UR
-            rhsData[ 3] += multipliers[0] * I_x_I_y;
-            rhsData[ 4] += multipliers[1] * I_x_I_y;
-            rhsData[ 5] += ii    * I_x_I_y;
-            rhsData[10] += multipliers[2] * I_x_I_y;
-            rhsData[11] += jj    * I_x_I_y;
-            rhsData[17] +=         I_x_I_y;
-
-            // Right Hand Side LR
-            rhsData[21] += multipliers[0] * I_y_sqr;
-            rhsData[22] += multipliers[1] * I_y_sqr;
-            rhsData[23] += ii    * I_y_sqr;
-            rhsData[28] += multipliers[2] * I_y_sqr;
-            rhsData[29] += jj    * I_y_sqr;
-            rhsData[35] +=         I_y_sqr;
-
-/*          For some reason these function calls are not being inlined!!!
-            // Right Hand Side UL
-            rhs(0,0) += multipliers[0] * I_x_sqr;
-            rhs(0,1) += multipliers[1] * I_x_sqr;
-            rhs(0,2) += ii    * I_x_sqr;
-            rhs(1,1) += multipliers[2] * I_x_sqr;
-            rhs(1,2) += jj    * I_x_sqr;
-            rhs(2,2) +=         I_x_sqr;
-
-            // Right Hand Side UR
-            rhs(0,3) += multipliers[0] * I_x_I_y;
-            rhs(0,4) += multipliers[1] * I_x_I_y;
-            rhs(0,5) += ii    * I_x_I_y;
-            rhs(1,4) += multipliers[2] * I_x_I_y;
-            rhs(1,5) += jj    * I_x_I_y;
-            rhs(2,5) +=         I_x_I_y;
-
-            // Right Hand Side LR
-            rhs(3,3) += multipliers[0] * I_y_sqr;
-            rhs(3,4) += multipliers[1] * I_y_sqr;
-            rhs(3,5) += ii    * I_y_sqr;
-            rhs(4,4) += multipliers[2] * I_y_sqr;
-            rhs(4,5) += jj    * I_y_sqr;
-            rhs(5,5) +=         I_y_sqr;
-*/
-
-            I_x_ptr.next_col();
-            I_y_ptr.next_col();
-            left_image_patch_ptr.next_col();
           }
-          I_x_row.next_row();
-          I_y_row.next_row();
-          left_image_patch_row.next_row();
         }
 
-        // Fill in symmetric entries
-        rhs(1,0) = rhs(0,1);
-        rhs(2,0) = rhs(0,2);
-        rhs(2,1) = rhs(1,2);
-        rhs(3,0) = rhs(0,3);
-        rhs(1,3) = rhs(3,1) = rhs(4,0) = rhs(0,4);
-        rhs(2,3) = rhs(3,2) = rhs(5,0) = rhs(0,5);
-        rhs(4,1) = rhs(1,4);
-        rhs(2,4) = rhs(4,2) = rhs(5,1) = rhs(1,5);
-        rhs(5,2) = rhs(2,5);
-        rhs(4,3) = rhs(3,4);
-        rhs(5,3) = rhs(3,5);
-        rhs(5,4) = rhs(4,5);
-
         // Solves lhs = rhs * x, and stores the result in-place in lhs.
-        const math::f77_int n = 6;
-        const math::f77_int nrhs = 1;
-        math::f77_int info;
-        math::posv('L',n,nrhs,&(rhs(0,0)), n, &(lhs(0)), n, &info);
-
-        //Termination
-        //if (in_curr_sum_I_e_val < 0)
-        //  in_curr_sum_I_e_val = - in_curr_sum_I_e_val;
-
-        //curr_sum_I_e_val = in_curr_sum_I_e_val;
+        if (solvable)
+          detail::cholesky_solve<6>(rhs, &(lhs(0)));
 
         d += lhs; // Update the affine transform
-        //if (curr_sum_I_e_val < 0)
-        //  curr_sum_I_e_val = - curr_sum_I_e_val;
 
         // Termination condition
         // - Quit if the change in the affine transform is tiny
@@ -1216,18 +1167,6 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
         weighted_lhs[4] *= kern_quarter_height;
         if (norm_2(weighted_lhs) < 0.05)
           break;
-
-        /*
-        // Termination condition
-        // - Quit if the fit error starts increasing
-        //if ((prev_sum_I_e_val < curr_sum_I_e_val) && (iter > 0))
-        if ( (fabs(prev_sum_I_e_val - curr_sum_I_e_val) < 0.1)  && (iter > 0))
-          break;
-        else
-          prev_sum_I_e_val = curr_sum_I_e_val;
-        */
-        
-        
       } // End multiple iteration loop
       
       // If there is too much translation in our affine transform or we got NaNs, invalidate the pixel
@@ -1256,10 +1195,6 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
                          bool /*verbose*/ ) {
                              
   typedef Vector<float,2  > Vector2f;
-  typedef Matrix<float,2,2> Matrix2x2f;
-  typedef typename ImageView<float>::pixel_accessor ImageViewFAcc;
-  typedef typename CropView<ImageView<float   > >::pixel_accessor CropViewFAcc;
-  typedef typename CropView<ImageView<ChannelT> >::pixel_accessor CropViewTAcc;
 
   // Bail out if no subpixel computation has been requested
   if (!do_horizontal_subpixel && !do_vertical_subpixel) return;
@@ -1273,9 +1208,8 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
              ArgumentErr() << "subpixel_correlation: left image and "
              << "disparity map do not have the same dimensions.");
 
-  // Interpolated Input Images
-  InterpolationView<EdgeExtensionView<ImageView<ChannelT>, ZeroEdgeExtension>, BilinearInterpolation> right_interp_image =
-         interpolate(right_image, BilinearInterpolation(), ZeroEdgeExtension());
+  // Interpolated right image windows
+  detail::AffineWindowSampler<ChannelT> right_sampler(right_image, kern_width, kern_height);
 
   // This is the maximum number of pixels that the solution can be
   // adjusted by subpixel refinement.
@@ -1291,9 +1225,11 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
   ImageView<float> y_deriv = derivative_filter(left_image, 0, 1);
   ImageView<float> weight_template = detail::compute_spatial_weight_image(kern_width, kern_height, two_sigma_sqr);
 
-  // Workspace images are allocated up here out of the tight inner
-  // loop.  We rasterize into these directly in the code below.
+  // Workspace buffers are allocated up here out of the tight inner loop.
   ImageView<float> w(kern_width, kern_height);
+  detail::SubpixelWindow<ChannelT> window(kern_width, kern_height);
+  std::vector<ChannelT> right_samples(kern_pixels);
+  std::vector<float>    I_x_w(kern_pixels), I_y_w(kern_pixels);
 
   // Iterate over all of the pixels in the disparity map except for the outer edges.
   for ( int32 y = std::max(region_of_interest.min().y()-1,kern_half_height);
@@ -1315,11 +1251,6 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
       Vector2f d;
       d(0) = 0.0; d(1) = 0.0;
 
-      // Compute the derivative image patches
-      CropView<ImageView<ChannelT> > left_image_patch = crop(left_image, current_window);
-      CropView<ImageView<float> > I_x = crop(x_deriv, current_window);
-      CropView<ImageView<float> > I_y = crop(y_deriv, current_window);
-
       // Compute the base weight image
       int32 good_pixels = adjust_weight_image(w, crop(disparity_map, current_window), weight_template);
 
@@ -1330,6 +1261,25 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
         continue;
       }
 
+      // Every sample is weighted by the first weight in the window.
+      const float weight = w(0,0);
+
+      // The normal equations only depend on the left image gradients, so
+      // they are built and factored once and reused by every iteration.
+      window.load(left_image, x_deriv, y_deriv, current_window);
+      float rhs[4] = {0};
+      for (int32 k = 0; k < kern_pixels; ++k) {
+        float I_x_val = weight  * window.I_x[k];
+        float I_y_val = weight  * window.I_y[k];
+        I_x_w[k] = I_x_val;
+        I_y_w[k] = I_y_val;
+        rhs[0] += I_x_val * window.I_x[k];
+        rhs[1] += I_x_val * window.I_y[k];
+        rhs[3] += I_y_val * window.I_y[k];
+      }
+      rhs[2] = rhs[1];
+      const bool solvable = detail::cholesky_factor<2>(rhs);
+
       // Iterate until a solution is found or the max number of
       // iterations is reached.
       for (unsigned iter = 0; iter < MAX_NUM_ITERATIONS; ++iter) {
@@ -1343,80 +1293,20 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
         float x_base = x + disparity_map(x,y)[0];
         float y_base = y + disparity_map(x,y)[1];
 
-        Matrix2x2f rhs;
-        Vector2f lhs;
-   
-        // Set up pixel accessors
-        CropViewFAcc I_x_row = I_x.origin(), I_y_row = I_y.origin();
-        CropViewTAcc left_image_patch_row = left_image_patch.origin();
-        ImageViewFAcc w_row = w.origin();
-
-        // Perform loop that does Expectation and Maximization in one go
-        for (int32 jj = -kern_half_height; jj <= kern_half_height; ++jj) {
-        
-          ImageViewFAcc w_ptr = w_row;
-          CropViewFAcc  I_x_ptr = I_x_row, I_y_ptr = I_y_row;
-          CropViewTAcc  left_image_patch_ptr = left_image_patch_row;
-          
-          float xx_partial = x_base + d[0]; // Compute outside inner loop for speed
-          
-          float yy = y_base + jj + d[1];
-
-          for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii) {
-            // First we compute the pixel offset for the right image
-            // and the error for the current pixel.
-            float xx = ii + xx_partial;
-
-            /// Expectation
-            ChannelT interpreted_px = right_interp_image(xx,yy);
-            float I_e_val = interpreted_px - (*left_image_patch_ptr);
-            
-            // Disable robust cost function altogether
-            float robust_weight = 1;
-        
-            // We combine the error value with the derivative and
-            // add this to the update equation.
-            float weight = robust_weight *(*w_ptr);
-        
-            
-            float I_x_val = weight  * (*I_x_ptr);
-            float I_y_val = weight  * (*I_y_ptr);
-            float I_x_sqr = I_x_val * (*I_x_ptr);
-            float I_y_sqr = I_y_val * (*I_y_ptr);
-            float I_x_I_y = I_x_val * (*I_y_ptr);
-
-            // Left hand side
-            lhs(0) -= I_x_val * I_e_val;
-            lhs(1) -= I_y_val * I_e_val;
+        // A translation is the affine transform | 1 0 d(0) | 0 1 d(1) |
+        const float translation[6] = {1, 0, d[0], 0, 1, d[1]};
+        right_sampler.sample(x_base, y_base, translation, &right_samples[0]);
 
-            float* rhsData = rhs.data(); // Access RHS by raw data pointer to avoid inlining failure
-
-            // Right Hand Side UL
-            rhsData[0] += I_x_sqr;
-
-            // Right Hand Side UR
-            rhsData[1] += I_x_I_y;
-
-            // Right Hand Side LR
-            rhsData[3] += I_y_sqr;
-
-            I_x_ptr.next_col();
-            I_y_ptr.next_col();
-            left_image_patch_ptr.next_col();
-          }
-          I_x_row.next_row();
-          I_y_row.next_row();
-          left_image_patch_row.next_row();
+        Vector2f lhs;
+        for (int32 k = 0; k < kern_pixels; ++k) {
+          float I_e_val = right_samples[k] - window.left[k];
+          lhs(0) -= I_x_w[k] * I_e_val;
+          lhs(1) -= I_y_w[k] * I_e_val;
         }
 
-        // Fill in symmetric entries
-        rhs(1,0) = rhs(0,1);
-
         // Solves lhs = rhs * x, and stores the result in-place in lhs.
-        const math::f77_int n    = 2;
-        const math::f77_int nrhs = 1;
-        math::f77_int info;
-        math::posv('L',n,nrhs,&(rhs(0,0)), n, &(lhs(0)), n, &info);
+        if (solvable)
+          detail::cholesky_solve<2>(rhs, &(lhs(0)));
 
         d += lhs; // Update the affine transform
 
@@ -1441,3 +1331,4 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
 
 
 
+
@@ -15,19 +15,71 @@
 //  limitations under the License.
 // __END_LICENSE__
 
+#include <vw/Core/Log.h>
+#include <vw/Core/RunOnce.h>
 #include <vw/Math/BBox.h>
+#include <vw/Math/Functions.h>
+#include <vw/Image/EdgeExtension.h>
 #include <vw/Image/Statistics.h>
 #include <vw/Stereo/Correlation.h>
+#include <vw/Stereo/DisparityBounds.h>
+
+#include <algorithm>
+#include <limits>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  #include <immintrin.h> // SSE4.1, plus AVX-512 for run-time dispatch
+#endif
+
+// The popcount kernels are compiled for their instruction sets individually
+//  and are only selected if the CPU running the code supports them.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (__GNUC__ >= 8))
+  #define VW_CENSUS_POPCOUNT_KERNELS 1
+#endif
 
 namespace vw {
 namespace stereo {
 
- 
-bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
-                        BBox2i const& current_bbox,
-                        std::vector<SearchParam>& list,
-                        Vector2i const& kernel_size,
-                        int32 fail_count ) {
+namespace {
+
+  /// Disparity range of the valid pixels of a disparity image in a region.
+  struct DisparityImageRange {
+    ImageView<PixelMask<Vector2i> > const& disparity;
+    DisparityImageRange(ImageView<PixelMask<Vector2i> > const& d) : disparity(d) {}
+
+    BBox2i full_bbox() const { return bounding_box(disparity); }
+
+    bool operator()(BBox2i const& region, BBox2i &range) const {
+      PixelAccumulator<EWMinMaxAccumulator<Vector2i> > accumulator;
+      for_each_pixel( crop(disparity, region), accumulator );
+      if ( !accumulator.is_valid() )
+        return false;
+      range = BBox2i(accumulator.minimum(), accumulator.maximum() + Vector2i(1,1));
+      return true;
+    }
+  };
+
+  /// Disparity range of the trusted pixels of a DisparityBounds object in a region.
+  struct DisparityBoundsRange {
+    DisparityBounds const& bounds;
+    DisparityBoundsRange(DisparityBounds const& b) : bounds(b) {}
+
+    BBox2i full_bbox() const { return BBox2i(0, 0, bounds.cols(), bounds.rows()); }
+
+    bool operator()(BBox2i const& region, BBox2i &range) const {
+      return bounds.region_range(region, range);
+    }
+  };
+
+  /// Implementation of subdivide_regions shared by both input types.
+  /// - RangeT finds the disparity search range needed by a region.
+  template <class RangeT>
+  bool subdivide_regions_impl( RangeT const& region_range,
+                               BBox2i const& current_bbox,
+                               std::vector<SearchParam>& list,
+                               Vector2i const& kernel_size,
+                               int32 fail_count ) {
 
     // Looking at the 2d disparity vectors inside current_bbox
 
@@ -38,14 +90,11 @@ bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
          current_bbox.width() < MIN_REGION_SIZE || current_bbox.height() < MIN_REGION_SIZE ){
       BBox2i expanded = current_bbox;
       expanded.expand(1);
-      expanded.crop( bounding_box( disparity ) );
-      PixelAccumulator<EWMinMaxAccumulator<Vector2i> > accumulator;
-      for_each_pixel( crop(disparity, expanded), accumulator );
-      if ( !accumulator.is_valid() ) return true;
+      expanded.crop( region_range.full_bbox() );
+      BBox2i search;
+      if ( !region_range( expanded, search ) ) return true;
 
-      list.push_back( SearchParam( current_bbox,
-                                   BBox2i(accumulator.minimum(),
-                                          accumulator.maximum() + Vector2i(1,1) ) ) );
+      list.push_back( SearchParam( current_bbox, search ) );
       return true;
     }
 
@@ -64,42 +113,14 @@ bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
     // - Accumulate product of disparity search region + pixel area
     // - TODO: Should get some of this logic into class functions.
     int32 split_search = 0;
-    { // Q1
-      PixelAccumulator<EWMinMaxAccumulator<Vector2i> > accumulator;
-      for_each_pixel( crop(disparity,q1), accumulator );
-      if ( accumulator.is_valid() ) {
-        q1_search = BBox2i(accumulator.minimum(),
-                           accumulator.maximum()+Vector2i(1,1));
-        split_search += q1_search.area() * prod(q1.size()+kernel_size);
-      }
-    }
-    { // Q2
-      PixelAccumulator<EWMinMaxAccumulator<Vector2i> > accumulator;
-      for_each_pixel( crop(disparity,q2), accumulator );
-      if ( accumulator.is_valid() ) {
-        q2_search = BBox2i(accumulator.minimum(),
-                           accumulator.maximum()+Vector2i(1,1));
-        split_search += q2_search.area() * prod(q2.size()+kernel_size);
-      }
-    }
-    { // Q3
-      PixelAccumulator<EWMinMaxAccumulator<Vector2i> > accumulator;
-      for_each_pixel( crop(disparity,q3), accumulator );
-      if ( accumulator.is_valid() ) {
-        q3_search = BBox2i(accumulator.minimum(),
-                           accumulator.maximum()+Vector2i(1,1));
-        split_search += q3_search.area() * prod(q3.size()+kernel_size);
-      }
-    }
-    { // Q4
-      PixelAccumulator<EWMinMaxAccumulator<Vector2i> > accumulator;
-      for_each_pixel( crop(disparity,q4), accumulator );
-      if ( accumulator.is_valid() ) {
-        q4_search = BBox2i(accumulator.minimum(),
-                           accumulator.maximum()+Vector2i(1,1));
-        split_search += q4_search.area() * prod(q4.size()+kernel_size);
-      }
-    }
+    if ( region_range( q1, q1_search ) ) // Q1
+      split_search += q1_search.area() * prod(q1.size()+kernel_size);
+    if ( region_range( q2, q2_search ) ) // Q2
+      split_search += q2_search.area() * prod(q2.size()+kernel_size);
+    if ( region_range( q3, q3_search ) ) // Q3
+      split_search += q3_search.area() * prod(q3.size()+kernel_size);
+    if ( region_range( q4, q4_search ) ) // Q4
+      split_search += q4_search.area() * prod(q4.size()+kernel_size);
     // Now we have an estimate of the cost of processing these four
     // quadrants seperately
 
@@ -131,13 +152,13 @@ bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
       // This is our first failure, so see if we can still improve by
       //  subdividing the quadrants one more time.
       std::vector<SearchParam> failed;
-      if (!subdivide_regions( disparity, q1, list, kernel_size, fail_count + 1 ) )
+      if (!subdivide_regions_impl( region_range, q1, list, kernel_size, fail_count + 1 ) )
         failed.push_back(SearchParam(q1,q1_search));
-      if (!subdivide_regions( disparity, q2, list, kernel_size, fail_count + 1 ) )
+      if (!subdivide_regions_impl( region_range, q2, list, kernel_size, fail_count + 1 ) )
         failed.push_back(SearchParam(q2,q2_search));
-      if (!subdivide_regions( disparity, q3, list, kernel_size, fail_count + 1 ) )
+      if (!subdivide_regions_impl( region_range, q3, list, kernel_size, fail_count + 1 ) )
         failed.push_back(SearchParam(q3,q3_search));
-      if (!subdivide_regions( disparity, q4, list, kernel_size, fail_count + 1 ) )
+      if (!subdivide_regions_impl( region_range, q4, list, kernel_size, fail_count + 1 ) )
         failed.push_back(SearchParam(q4,q4_search));
               
       if ( failed.size() == 4 ) {
@@ -206,13 +227,427 @@ bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
       return false;
     } else {
       // Good split, Try to keep splitting each of the four quadrants further.
-      subdivide_regions( disparity, q1, list, kernel_size );
-      subdivide_regions( disparity, q2, list, kernel_size );
-      subdivide_regions( disparity, q3, list, kernel_size );
-      subdivide_regions( disparity, q4, list, kernel_size );
+      subdivide_regions_impl( region_range, q1, list, kernel_size, 0 );
+      subdivide_regions_impl( region_range, q2, list, kernel_size, 0 );
+      subdivide_regions_impl( region_range, q3, list, kernel_size, 0 );
+      subdivide_regions_impl( region_range, q4, list, kernel_size, 0 );
     }
     return true;
   }
 
+} // end anonymous namespace
+
+
+bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
+                        BBox2i const& current_bbox,
+                        std::vector<SearchParam>& list,
+                        Vector2i const& kernel_size,
+                        int32 fail_count ) {
+  return subdivide_regions_impl( DisparityImageRange(disparity), current_bbox,
+                                 list, kernel_size, fail_count );
+}
+
+bool subdivide_regions( DisparityBounds const& bounds,
+                        BBox2i const& current_bbox,
+                        std::vector<SearchParam>& list,
+                        Vector2i const& kernel_size,
+                        int32 fail_count ) {
+  return subdivide_regions_impl( DisparityBoundsRange(bounds), current_bbox,
+                                 list, kernel_size, fail_count );
+}
+
+double zone_cost( SearchParam const& zone, Vector2i const& kernel_size,
+                  double seconds_per_op ) {
+  const Vector2i half_kernel = kernel_size/2;
+  SearchParam padded = zone;
+  padded.image_region().min() -= half_kernel;
+  padded.image_region().max() += half_kernel;
+  return seconds_per_op * padded.search_volume();
+}
+
+namespace {
+
+  /// True if the two regions share a whole edge, so their union is a box.
+  bool share_edge( BBox2i const& a, BBox2i const& b ) {
+    if ( a.min().y() == b.min().y() && a.max().y() == b.max().y() )
+      return a.max().x() == b.min().x() || b.max().x() == a.min().x();
+    if ( a.min().x() == b.min().x() && a.max().x() == b.max().x() )
+      return a.max().y() == b.min().y() || b.max().y() == a.min().y();
+    return false;
+  }
+
+  void split_zone( SearchParam const& zone, std::vector<SearchParam>& work,
+                   Vector2i const& kernel_size, double max_cost, Vector2i const& min_size ) {
+    BBox2i const& region = zone.image_region();
+    const bool split_x = region.width() >= region.height();
+    const int32 size   = split_x ? region.width() : region.height();
+    const int32 limit  = split_x ? min_size.x()   : min_size.y();
+    if ( zone_cost( zone, kernel_size ) <= max_cost || size < 2*limit ) {
+      work.push_back( zone );
+      return;
+    }
+    BBox2i first = region, second = region;
+    if ( split_x )
+      first.max().x() = second.min().x() = region.min().x() + size/2;
+    else
+      first.max().y() = second.min().y() = region.min().y() + size/2;
+    split_zone( SearchParam(first,  zone.disparity_range()), work, kernel_size, max_cost, min_size );
+    split_zone( SearchParam(second, zone.disparity_range()), work, kernel_size, max_cost, min_size );
+  }
+
+  /// Functor for sorting work items, most expensive first.
+  struct ZoneCostGreaterThan {
+    Vector2i kernel_size;
+    ZoneCostGreaterThan( Vector2i const& kernel ) : kernel_size(kernel) {}
+    bool operator()( SearchParam const& a, SearchParam const& b ) const {
+      return zone_cost( a, kernel_size ) > zone_cost( b, kernel_size );
+    }
+  };
+
+} // end anonymous namespace
+
+void schedule_zones( std::vector<SearchParam> const& zones,
+                     std::vector<SearchParam>& work,
+                     Vector2i const& kernel_size, int32 num_tasks,
+                     Vector2i const& min_size ) {
+  work.clear();
+  if ( zones.empty() )
+    return;
+
+  double total_cost = 0;
+  for ( size_t i = 0; i < zones.size(); ++i )
+    total_cost += zone_cost( zones[i], kernel_size );
+  const double max_cost = total_cost / std::max( num_tasks, 1 );
+
+  // Merge neighbors until no more pairs qualify.  There are rarely more
+  //  than a few hundred zones, so the quadratic search is fine.  Widening a
+  //  range to merge zones would change their results, so only zones with the
+  //  same range are merged, which always saves work.
+  std::vector<SearchParam> merged = zones;
+  bool changed = true;
+  while ( changed ) {
+    changed = false;
+    for ( size_t i = 0; i < merged.size(); ++i ) {
+      for ( size_t j = i+1; j < merged.size(); ++j ) {
+        if ( merged[i].disparity_range() != merged[j].disparity_range() ||
+             !share_edge( merged[i].image_region(), merged[j].image_region() ) )
+          continue;
+        SearchParam joined = merged[i];
+        joined.image_region().grow( merged[j].image_region() );
+        if ( zone_cost( joined, kernel_size ) > max_cost )
+          continue;
+        merged[i] = joined;
+        merged.erase( merged.begin() + j );
+        changed = true;
+        --j;
+      }
+    }
+  }
+
+  for ( size_t i = 0; i < merged.size(); ++i )
+    split_zone( merged[i], work, kernel_size, max_cost, min_size );
+  std::stable_sort( work.begin(), work.end(), ZoneCostGreaterThan(kernel_size) );
+}
+
+FifoWorkQueue& zone_work_queue() {
+  static FifoWorkQueue queue;
+  return queue;
+}
+
+void census_transform( ImageView<uint8> const& image, CostFunctionType cost_type,
+                       ImageView<uint64> & codes, int ternary_threshold ) {
+  VW_ASSERT( cost_type == CENSUS_TRANSFORM || cost_type == TERNARY_CENSUS_TRANSFORM,
+             ArgumentErr() << "census_transform: Not a census cost function." );
+  const bool  ternary = ( cost_type == TERNARY_CENSUS_TRANSFORM );
+  const int32 radius  = ternary ? 2 : 3;
+  const int32 cols    = image.cols();
+  codes.set_size( cols, image.rows() );
+
+  // Work from an edge extended copy so every neighbor is at a fixed offset.
+  BBox2i padded_box = bounding_box(image);
+  padded_box.expand( radius );
+  ImageView<uint8> padded = crop( edge_extend(image), padded_box );
+  const ptrdiff_t stride = padded.cols();
+
+  // Neighbor offsets in the order their bits are stored.
+  std::vector<ptrdiff_t> offsets;
+  for ( int32 dy = -radius; dy <= radius; ++dy )
+    for ( int32 dx = -radius; dx <= radius; ++dx )
+      if ( dx != 0 || dy != 0 )
+        offsets.push_back( dy*stride + dx );
+  const size_t per_byte = ternary ? 4 : 8; // Both transforms fill six bytes
+
+  // Each byte of the codes is built for a whole row at a time with
+  //  byte sized operations, which the compiler can vectorize.
+  std::vector<uint8> byte( cols ), low( cols ), high( cols );
+  for ( int32 row = 0; row < image.rows(); ++row ) {
+    uint64*      out    = &codes(0,row);
+    const uint8* center = &padded(radius, row+radius);
+    std::fill( out, out+cols, uint64(0) );
+    for ( int32 c = 0; c < cols; ++c ) {
+      low [c] = uint8( std::max( int(center[c]) - ternary_threshold, 0   ) );
+      high[c] = uint8( std::min( int(center[c]) + ternary_threshold, 255 ) );
+    }
+    for ( size_t first = 0; first < offsets.size(); first += per_byte ) {
+      std::fill( byte.begin(), byte.end(), 0 );
+      for ( size_t n = first; n < first + per_byte; ++n ) {
+        const uint8* neighbor = center + offsets[n];
+        if ( ternary ) {
+          // Lower is 00, within the threshold is 01, and higher is 11.
+          for ( int32 c = 0; c < cols; ++c )
+            byte[c] = uint8(byte[c] << 2) | uint8(neighbor[c] >= low[c]) | uint8((neighbor[c] > high[c]) << 1);
+        } else {
+          for ( int32 c = 0; c < cols; ++c )
+            byte[c] = uint8(byte[c] << 1) | uint8(neighbor[c] > center[c]);
+        }
+      }
+      for ( int32 c = 0; c < cols; ++c )
+        out[c] = (out[c] << 8) | byte[c];
+    }
+  }
+}
+
+namespace {
+
+  // The census block matching keeps, for each column of the left image, the
+  //  Hamming costs of every disparity summed over the kernel height.  The
+  //  kernels below update those column sums a row at a time and slide the
+  //  kernel width over them.  The costs of a pixel's disparities are contiguous
+  //  so all of the work is done on vectors of disparities.
+  // - The sums are 16 bits when a kernel's cost always fits in 16 bits, which
+  //   is the case for kernels of up to 1365 pixels.  Larger kernels use 32 bit
+  //   sums and the scalar kernels.
+
+  /// Add the Hamming distances between each left code of the row entering the
+  ///  kernel and the right codes of each disparity to the column sums, and
+  ///  subtract those of the row leaving the kernel.
+  /// - col_sums holds num_disp sums for each of the cols columns.
+  template <typename SumT>
+  inline void column_sums_scalar( const uint64* left_in,  const uint64* right_in,
+                                  const uint64* left_out, const uint64* right_out,
+                                  int32 cols, int32 num_disp, SumT* col_sums ) {
+    for ( int32 x = 0; x < cols; ++x ) {
+      SumT* sums = col_sums + size_t(x)*num_disp;
+      for ( int32 d = 0; d < num_disp; ++d )
+        sums[d] += SumT( hamming_distance(left_in [x], right_in [x+d]) )
+                 - SumT( hamming_distance(left_out[x], right_out[x+d]) );
+    }
+  }
+
+  template <typename SumT>
+  struct ColumnSumKernel {
+    typedef void (*Func)( const uint64* left_in,  const uint64* right_in,
+                          const uint64* left_out, const uint64* right_out,
+                          int32 cols, int32 num_disp, SumT* col_sums );
+    static Func func;
+  };
+
+  template <typename SumT>
+  typename ColumnSumKernel<SumT>::Func ColumnSumKernel<SumT>::func = column_sums_scalar<SumT>;
+
+#if defined(VW_CENSUS_POPCOUNT_KERNELS)
+
+  template <typename SumT> __attribute__((target("popcnt")))
+  void column_sums_popcnt( const uint64* left_in,  const uint64* right_in,
+                           const uint64* left_out, const uint64* right_out,
+                           int32 cols, int32 num_disp, SumT* col_sums ) {
+    column_sums_scalar( left_in, right_in, left_out, right_out, cols, num_disp, col_sums );
+  }
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  __attribute__((target("avx512f,avx512bw,avx512vl,avx512vpopcntdq")))
+  void column_sums_avx512( const uint64* left_in,  const uint64* right_in,
+                           const uint64* left_out, const uint64* right_out,
+                           int32 cols, int32 num_disp, uint16* col_sums ) {
+    for ( int32 x = 0; x < cols; ++x ) {
+      const __m512i vin  = _mm512_set1_epi64( static_cast<long long>(left_in [x]) );
+      const __m512i vout = _mm512_set1_epi64( static_cast<long long>(left_out[x]) );
+      uint16* sums = col_sums + size_t(x)*num_disp;
+      for ( int32 d = 0; d < num_disp; d += 8 ) {
+        const __mmask8 mask = (num_disp-d >= 8) ? 0xFF : ((1u << (num_disp-d)) - 1);
+        __m512i added   = _mm512_popcnt_epi64( _mm512_xor_si512( vin,
+                                 _mm512_maskz_loadu_epi64(mask, right_in +x+d) ) );
+        __m512i removed = _mm512_popcnt_epi64( _mm512_xor_si512( vout,
+                                 _mm512_maskz_loadu_epi64(mask, right_out+x+d) ) );
+        __m128i change  = _mm512_cvtepi64_epi16( _mm512_sub_epi64(added, removed) );
+        _mm_mask_storeu_epi16( sums+d, mask,
+                               _mm_add_epi16( _mm_maskz_loadu_epi16(mask, sums+d), change ) );
+      }
+    }
+  }
+#endif // VW_ENABLE_SSE
+
+#endif
+
+  /// Slide the kernel one column: add the front column sums to the window sums
+  ///  and subtract the back ones.  Returns the smallest and largest window sums.
+  template <typename SumT>
+  inline void window_sums( const SumT* front, const SumT* back, int32 num_disp,
+                           SumT* window, SumT &min_sum, SumT &max_sum ) {
+    SumT low = std::numeric_limits<SumT>::max(), high = 0;
+    for ( int32 d = 0; d < num_disp; ++d ) {
+      window[d] += front[d] - back[d];
+      low  = std::min( low,  window[d] );
+      high = std::max( high, window[d] );
+    }
+    min_sum = low;
+    max_sum = high;
+  }
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+
+  inline void window_sums( const uint16* front, const uint16* back, int32 num_disp,
+                           uint16* window, uint16 &min_sum, uint16 &max_sum ) {
+    __m128i low  = _mm_set1_epi16( -1 );
+    __m128i high = _mm_setzero_si128();
+    int32 d = 0;
+    for ( ; d+8 <= num_disp; d += 8 ) {
+      __m128i w = _mm_add_epi16( _mm_loadu_si128((const __m128i*)(window+d)),
+                                 _mm_sub_epi16( _mm_loadu_si128((const __m128i*)(front+d)),
+                                                _mm_loadu_si128((const __m128i*)(back +d)) ) );
+      _mm_storeu_si128( (__m128i*)(window+d), w );
+      low  = _mm_min_epu16( low,  w );
+      high = _mm_max_epu16( high, w );
+    }
+    uint16 tail_low, tail_high;
+    window_sums<uint16>( front+d, back+d, num_disp-d, window+d, tail_low, tail_high );
+    // The largest value is the complement of the smallest complement.
+    min_sum = std::min( tail_low, uint16(_mm_extract_epi16(_mm_minpos_epu16(low), 0)) );
+    max_sum = std::max( tail_high, uint16(~_mm_extract_epi16(
+                          _mm_minpos_epu16(_mm_xor_si128(high, _mm_set1_epi16(-1))), 0)) );
+  }
+
+#endif
+
+  vw::RunOnce census_kernel_once = VW_RUNONCE_INIT;
+
+  /// Pick the fastest column sum kernels that the current CPU supports.
+  void select_census_kernels() {
+    std::string name = "scalar";
+#if defined(VW_CENSUS_POPCOUNT_KERNELS)
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("popcnt") ) {
+      ColumnSumKernel<uint16>::func = column_sums_popcnt<uint16>;
+      ColumnSumKernel<uint32>::func = column_sums_popcnt<uint32>;
+      name = "POPCNT";
+    }
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+    if ( __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl") &&
+         __builtin_cpu_supports("avx512vpopcntdq") ) {
+      ColumnSumKernel<uint16>::func = column_sums_avx512;
+      name = "AVX-512";
+    }
+#endif
+#endif
+    vw_out(DebugMessage, "stereo") << "Census block matching: Using " << name << " kernels.\n";
+  }
+
+  template <typename SumT>
+  ImageView<PixelMask<Vector2i> >
+  best_of_search_hamming_impl( ImageView<uint64> const& left_codes,
+                               ImageView<uint64> const& right_codes,
+                               Vector2i          const& search_volume,
+                               Vector2i          const& kernel_size ) {
+
+    const typename ColumnSumKernel<SumT>::Func column_sums = ColumnSumKernel<SumT>::func;
+
+    const Vector2i result_size = bounding_box(left_codes).size() - kernel_size + Vector2i(1,1);
+    const int32    in_cols     = left_codes.cols();
+    const int32    out_cols    = result_size[0];
+    const int32    num_disp    = search_volume[0];
+
+    // Best and worst cost so far of each pixel, and the index of the disparity
+    //  with the best cost.
+    const size_t out_count = size_t(prod(result_size));
+    std::vector<SumT>  best( out_count ), worst( out_count );
+    std::vector<int32> best_index( out_count, 0 );
+
+    std::vector<SumT>   col_sums( size_t(in_cols)*num_disp );
+    std::vector<SumT>   window( num_disp ), no_sums( num_disp, 0 );
+    std::vector<uint64> no_codes( right_codes.cols(), 0 ); // Removes nothing from the column sums
+
+    const ptrdiff_t left_stride  = left_codes.cols();
+    const ptrdiff_t right_stride = right_codes.cols();
+
+    // Each row of the search volume is searched separately.
+    for ( int32 dy = 0; dy < search_volume[1]; ++dy ) {
+      const uint64* left_row  = left_codes.data();
+      const uint64* right_row = right_codes.data() + dy*right_stride;
+
+      // Seed the column sums with all but the last row of the first kernel.
+      std::fill( col_sums.begin(), col_sums.end(), 0 );
+      for ( int32 ky = 0; ky < kernel_size[1]-1; ++ky )
+        column_sums( left_row + ky*left_stride, right_row + ky*right_stride,
+                     &no_codes[0], &no_codes[0], in_cols, num_disp, &col_sums[0] );
+
+      for ( int32 y = 0; y < result_size[1]; ++y ) {
+        // Bring in the bottom row of the kernel, and drop the row above it.
+        const ptrdiff_t front = y + kernel_size[1] - 1;
+        if ( y == 0 )
+          column_sums( left_row + front*left_stride, right_row + front*right_stride,
+                       &no_codes[0], &no_codes[0], in_cols, num_disp, &col_sums[0] );
+        else
+          column_sums( left_row + front*left_stride, right_row + front*right_stride,
+                       left_row + (y-1)*left_stride, right_row + (y-1)*right_stride,
+                       in_cols, num_disp, &col_sums[0] );
+
+        std::fill( window.begin(), window.end(), 0 );
+        SumT min_sum = 0, max_sum = 0;
+        for ( int32 x = 0; x < in_cols; ++x ) {
+          const SumT* back = x < kernel_size[0] ? &no_sums[0]
+                                                : &col_sums[size_t(x-kernel_size[0])*num_disp];
+          window_sums( &col_sums[size_t(x)*num_disp], back, num_disp, &window[0], min_sum, max_sum );
+          if ( x < kernel_size[0] - 1 )
+            continue;
+
+          // The first disparity with the smallest cost wins, as in best_of_search_convolution.
+          const size_t i = size_t(y)*out_cols + x - (kernel_size[0]-1);
+          if ( dy == 0 || min_sum < best[i] ) {
+            int32 d = 0;
+            while ( window[d] != min_sum )
+              ++d;
+            best      [i] = min_sum;
+            best_index[i] = dy*num_disp + d;
+          }
+          worst[i] = ( dy == 0 ) ? max_sum : std::max( worst[i], max_sum );
+        }
+      } // End row loop
+    } // End disparity row loop
+
+    // Pixels whose cost was the same at every disparity have no match.
+    ImageView<PixelMask<Vector2i> > disparity_map( result_size[0], result_size[1] );
+    PixelMask<Vector2i>* disp_ptr = disparity_map.data();
+    for ( size_t i = 0; i < out_count; ++i, ++disp_ptr ) {
+      *disp_ptr = PixelMask<Vector2i>( Vector2i( best_index[i] % num_disp,
+                                                 best_index[i] / num_disp ) );
+      if ( best[i] == worst[i] )
+        invalidate( *disp_ptr );
+    }
+    return disparity_map;
+  }
+
+} // end anonymous namespace
+
+ImageView<PixelMask<Vector2i> >
+best_of_search_hamming( ImageView<uint64> const& left_codes,
+                        ImageView<uint64> const& right_codes,
+                        Vector2i          const& search_volume,
+                        Vector2i          const& kernel_size ) {
+
+  VW_ASSERT( kernel_size[0] % 2 == 1 && kernel_size[1] % 2 == 1,
+             ArgumentErr() << "best_of_search_hamming: Kernel input not sized with odd values." );
+  VW_ASSERT( left_codes.cols() >= kernel_size[0] && left_codes.rows() >= kernel_size[1],
+             ArgumentErr() << "best_of_search_hamming: Image is not big enough for kernel." );
+  VW_ASSERT( right_codes.cols() >= left_codes.cols() + search_volume[0] - 1 &&
+             right_codes.rows() >= left_codes.rows() + search_volume[1] - 1,
+             ArgumentErr() << "best_of_search_hamming: Right raster too small for search volume." );
+
+  census_kernel_once.run( select_census_kernels );
+
+  // A census code differs from another in at most 48 bits.
+  if ( 48*prod(kernel_size) <= std::numeric_limits<uint16>::max() )
+    return best_of_search_hamming_impl<uint16>( left_codes, right_codes, search_volume, kernel_size );
+  return best_of_search_hamming_impl<uint32>( left_codes, right_codes, search_volume, kernel_size );
+}
 
 }} // end namespace vw::stereo
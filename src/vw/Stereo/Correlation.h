@@ -22,13 +22,17 @@
 #include <vw/Core/Exception.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/AlgorithmFunctions.h>
+#include <vw/Image/Algorithms.h>
 #include <vw/Image/PixelMask.h>
+#include <vw/Image/Statistics.h>
 #include <vw/Stereo/Algorithms.h>
 #include <vw/Stereo/CostFunctions.h>
 
 #include <vector>
 #include <algorithm>
+#include <numeric>
 #include <utility>
 
 #include <boost/type_traits/is_integral.hpp>
@@ -36,9 +40,88 @@
 namespace vw {
 namespace stereo {
 
+  namespace detail {
+
+    /// Compute one row of per pixel costs into cost_row and add them to the
+    /// running column sums.
+    template <class FunctorT, class AccumT, class PixelT>
+    inline void add_cost_row(FunctorT const& cost, PixelT const* left, PixelT const* right,
+                             AccumT* cost_row, AccumT* col_sum, int32 count) {
+      for (int32 i=0; i<count; ++i) {
+        cost_row[i] = AccumT(cost(left[i], right[i]));
+        col_sum [i] += cost_row[i];
+      }
+    }
+
+    /// Slide the column sums down one row: add a new row of costs and remove
+    /// the costs stored in cost_row, which is then replaced by the new costs.
+    template <class FunctorT, class AccumT, class PixelT>
+    inline void slide_cost_row(FunctorT const& cost, PixelT const* left, PixelT const* right,
+                               AccumT* cost_row, AccumT* col_sum, int32 count) {
+      for (int32 i=0; i<count; ++i) {
+        AccumT front = AccumT(cost(left[i], right[i]));
+        col_sum [i] += front;
+        col_sum [i] -= cost_row[i];
+        cost_row[i] = front;
+      }
+    }
+
+    /// Slide the kernel along a row of column sums, writing one box sum per output pixel.
+    template <class AccumT>
+    inline void box_sum_row(AccumT const* col_sum, int32 kernel_width,
+                            int32 out_width, AccumT* out) {
+      AccumT row_sum(0);
+      row_sum = std::accumulate(col_sum, col_sum+kernel_width, row_sum);
+      AccumT const *cback = col_sum, *cfront = col_sum + kernel_width;
+      for (int32 i=0; i<out_width-1; ++i) {
+        out[i] = row_sum;
+        row_sum += *cfront++ - *cback++;
+      }
+      out[out_width-1] = row_sum;
+    }
+
+    /// Record new costs for a disparity in the best/worst quality buffers.
+    template <class CostT, class AccumT, class QualT>
+    inline void update_best_disparity(CostT const& cost_function, Vector2i const& disparity,
+                                      AccumT const* cost_ptr, AccumT const* cost_ptr_end,
+                                      QualT* quality_ptr, PixelMask<Vector2i>* disparity_ptr) {
+      if ( disparity != Vector2i(0,0) ) {
+        // Normal comparison operations
+        while ( cost_ptr != cost_ptr_end ) {
+          if ( cost_function.quality_comparison( *cost_ptr, quality_ptr->first ) ) {
+            // Better than best?
+            quality_ptr->first = *cost_ptr;
+            disparity_ptr->child() = disparity;
+          } else if ( !cost_function.quality_comparison( *cost_ptr, quality_ptr->second ) ) {
+            // Worse than worse
+            quality_ptr->second = *cost_ptr;
+          }
+          ++cost_ptr;
+          ++quality_ptr;
+          ++disparity_ptr;
+        }
+      } else {
+        // Initializing quality_map and disparity_map with first result
+        while ( cost_ptr != cost_ptr_end ) {
+          quality_ptr->first = quality_ptr->second = *cost_ptr;
+          ++cost_ptr;
+          ++quality_ptr;
+        }
+      }
+    }
+
+  } // namespace detail
+
   /// Lower level implementation function for calc_disparity.
   /// - The inputs must already be rasterized to safe sizes!
   /// - Since the inputs are rasterized, the input images must not be too big.
+  ///
+  /// For each disparity the kernel is slid over the image keeping running
+  /// column sums of the per pixel costs, so the cost of a disparity is O(1)
+  /// per pixel regardless of kernel_size. The pixel costs are computed on the
+  /// fly from the two rasters and the sums are compared with the best and worst
+  /// costs one row at a time, so no per disparity cost images are created
+  /// unless the cost function needs to modify the summed costs (NCC).
   template <template<class,bool> class CostFuncT, class PixelT>
   ImageView<PixelMask<Vector2i> >
   best_of_search_convolution(ImageView<PixelT> const& left_raster,
@@ -48,15 +131,23 @@ namespace stereo {
                              Vector2i          const& kernel_size) {
 
     typedef ImageView<PixelT> ImageType;
-    typedef typename CostFuncT<ImageType,
-      boost::is_integral<typename PixelChannelType<PixelT>::type>::value>::accumulator_type AccumChannelT;
+    typedef CostFuncT<ImageType,
+      boost::is_integral<typename PixelChannelType<PixelT>::type>::value> CostType;
+    typedef typename CostType::accumulator_type AccumChannelT;
     typedef typename PixelChannelCast<PixelT,AccumChannelT>::type AccumT;
     typedef typename std::pair<AccumT,AccumT> QualT;
 
+    VW_ASSERT( kernel_size[0] % 2 == 1 && kernel_size[1] % 2 == 1,
+               ArgumentErr() << "best_of_search_convolution: Kernel input not sized with odd values." );
+    VW_ASSERT( left_raster.cols() >= kernel_size[0] && left_raster.rows() >= kernel_size[1],
+               ArgumentErr() << "best_of_search_convolution: Image is not big enough for kernel." );
+    VW_ASSERT( right_raster.cols() >= left_raster.cols() + search_volume[0] - 1 &&
+               right_raster.rows() >= left_raster.rows() + search_volume[1] - 1,
+               ArgumentErr() << "best_of_search_convolution: Right raster too small for search volume." );
 
     // Build cost function which sometimes has side car data
-    CostFuncT<ImageType,boost::is_integral<typename PixelChannelType<PixelT>::type>::value> 
-          cost_function( left_raster, right_raster, kernel_size);
+    CostType cost_function( left_raster, right_raster, kernel_size);
+    typename CostType::pixel_cost_type pixel_cost;
 
     // Result buffers
     Vector2i result_size = bounding_box(left_raster).size() - kernel_size + Vector2i(1,1);
@@ -65,67 +156,63 @@ namespace stereo {
                PixelMask<Vector2i>(Vector2i()) );
     // First channel is best, second is worst.
     ImageView<QualT > quality_map( result_size[0], result_size[1] );
-    
+
     // Storage buffers
-    ImageView<AccumT> cost_metric      ( result_size[0], result_size[1] );
-    ImageView<AccumT> cost_applied     ( left_raster.cols(), left_raster.rows() );
-    ImageView<PixelT> right_raster_crop( left_raster.cols(), left_raster.rows() );
+    // - The full cost image is only needed when the cost function modifies it.
+    const int32 in_cols  = left_raster.cols();
+    const int32 out_cols = result_size[0];
+    std::vector<AccumT> col_sum ( in_cols  );
+    std::vector<AccumT> row_cost( out_cols );
+    // Ring buffer of the pixel costs of the rows currently inside the kernel
+    std::vector<AccumT> cost_rows( size_t(in_cols)*kernel_size[1] );
+    ImageView<AccumT> cost_metric;
+    if ( CostType::modifies_cost )
+      cost_metric.set_size( result_size[0], result_size[1] );
+
+    const PixelT* left_origin  = left_raster.data();
+    const ptrdiff_t left_stride  = left_raster.cols();
+    const ptrdiff_t right_stride = right_raster.cols();
 
     // Loop across the disparity range we are searching over.
     Vector2i disparity(0,0);
     for ( ; disparity.y() != search_volume[1]; ++disparity.y() ) {
       for ( disparity.x() = 0; disparity.x() != search_volume[0]; ++disparity.x() ) {
-      
-        // Compute correlations quickly by shifting the right image by the
-        //  current disparity, computing the pixel difference at each location,
-        //  and using fast_box_sum/cost_function to get the final convolution
-        //  value at each location in "cost_metric"
-      
-        // There's only one raster here. Fast box sum calls each pixel
-        // individually by pixel accessor. It only calls each pixel
-        // once so there's no reason to copy/rasterize the cost result before hand.
-        //
-        // The cost function should also not be applying an edge
-        // extension as we've already over cropped the input.
-        
-        right_raster_crop = crop(right_raster, bounding_box(left_raster)+disparity);
-        cost_applied      = cost_function( left_raster, right_raster_crop);
-        cost_metric       = fast_box_sum<AccumChannelT>(cost_applied, kernel_size );
-        cost_function.cost_modification( cost_metric, disparity );
-
-        // Loop across the region we want to compute disparities for.
-        // - The correlation score for each pixel is located in "cost_metric"
-        // - We update the best and worst disparity for each pixel in "quality_map"
-
-        // These conditionals might be served outside of the iteration
-        // of dx and dy. It would make the code slightly longer but
-        // would avoid a conditional inside a double loop.
-        const AccumT* cost_ptr     = cost_metric.data();
-        const AccumT* cost_ptr_end = cost_metric.data() + prod(result_size);
-        QualT* quality_ptr         = quality_map.data();
-        PixelMask<Vector2i>* disparity_ptr = disparity_map.data();
-        if ( disparity != Vector2i(0,0) ) {
-          // Normal comparison operations
-          while ( cost_ptr != cost_ptr_end ) {
-            if ( cost_function.quality_comparison( *cost_ptr, quality_ptr->first ) ) {
-              // Better than best?
-              quality_ptr->first = *cost_ptr;
-              disparity_ptr->child() = disparity;
-            } else if ( !cost_function.quality_comparison( *cost_ptr, quality_ptr->second ) ) {
-              // Worse than worse
-              quality_ptr->second = *cost_ptr;
-            }
-            ++cost_ptr;
-            ++quality_ptr;
-            ++disparity_ptr;
+
+        // Shifting the right image by the current disparity is just an offset
+        // into the right raster.
+        const PixelT* right_origin = right_raster.data() + disparity.y()*right_stride + disparity.x();
+
+        // Seed the column sums with the first kernel_size[1] rows
+        std::fill( col_sum.begin(), col_sum.end(), AccumT(0) );
+        for ( int32 ky = 0; ky < kernel_size[1]; ++ky )
+          detail::add_cost_row( pixel_cost, left_origin + ky*left_stride, right_origin + ky*right_stride,
+                                &cost_rows[size_t(ky)*in_cols], &col_sum[0], in_cols );
+
+        for ( int32 y = 0; y < result_size[1]; ++y ) {
+          if ( y > 0 ) {
+            // Slide the column sums down one row. The row leaving the kernel
+            // is stored in the same ring buffer slot as the row entering it.
+            const int32 front = y - 1 + kernel_size[1];
+            detail::slide_cost_row( pixel_cost, left_origin + front*left_stride, right_origin + front*right_stride,
+                                    &cost_rows[size_t((y-1) % kernel_size[1])*in_cols], &col_sum[0], in_cols );
           }
-        } else {
-          // Initializing quality_map and disparity_map with first result
-          while ( cost_ptr != cost_ptr_end ) {
-            quality_ptr->first = quality_ptr->second = *cost_ptr;
-            ++cost_ptr;
-            ++quality_ptr;
+
+          if ( CostType::modifies_cost ) {
+            detail::box_sum_row( &col_sum[0], kernel_size[0], out_cols, &cost_metric(0,y) );
+          } else {
+            // Update the best and worst disparity for this row of pixels
+            detail::box_sum_row( &col_sum[0], kernel_size[0], out_cols, &row_cost[0] );
+            detail::update_best_disparity( cost_function, disparity,
+                                           &row_cost[0], &row_cost[0] + out_cols,
+                                           &quality_map(0,y), &disparity_map(0,y) );
           }
+        } // End row loop
+
+        if ( CostType::modifies_cost ) {
+          cost_function.cost_modification( cost_metric, disparity );
+          detail::update_best_disparity( cost_function, disparity,
+                                         cost_metric.data(), cost_metric.data() + prod(result_size),
+                                         quality_map.data(), disparity_map.data() );
         }
       } // End x loop
     } // End y loop
@@ -151,6 +238,42 @@ namespace stereo {
 
 
 
+  /// Compute the census code of each pixel of an image for block matching.
+  /// - CENSUS_TRANSFORM compares each pixel with the other 48 pixels of its
+  ///   7x7 neighborhood, one bit per neighbor.
+  /// - TERNARY_CENSUS_TRANSFORM compares each pixel with the other 24 pixels
+  ///   of its 5x5 neighborhood, two bits per neighbor, treating differences
+  ///   of up to ternary_threshold as equal.
+  /// - Pixels beyond the edges of the image are edge extended.
+  void census_transform( ImageView<uint8> const& image, CostFunctionType cost_type,
+                         ImageView<uint64> & codes, int ternary_threshold = 5 );
+
+  /// Convert an image to uint8 the same way as the SGM census costs do, then
+  ///  compute its census codes.
+  template <class ImageT>
+  ImageView<uint64> census_codes( ImageViewBase<ImageT> const& image,
+                                  CostFunctionType cost_type ) {
+    ImageView<PixelGray<uint8> > image_u8;
+    u8_convert(image, image_u8);
+    ImageView<uint64> codes;
+    census_transform(image_u8, cost_type, codes);
+    return codes;
+  }
+
+  /// Version of best_of_search_convolution for images of census codes.
+  /// - The cost of a pixel is the Hamming distance between its left and right
+  ///   codes, summed over the kernel.
+  /// - Instead of one disparity at a time, the costs of all of the disparities
+  ///   in a row of the search volume are carried along together, so the sliding
+  ///   sums and the search for the best cost work on vectors of disparities.
+  ///   The popcount kernel is picked for the CPU at run time.
+  ImageView<PixelMask<Vector2i> >
+  best_of_search_hamming( ImageView<uint64> const& left_codes,
+                          ImageView<uint64> const& right_codes,
+                          Vector2i          const& search_volume,
+                          Vector2i          const& kernel_size );
+
+
   /// This actually RASTERIZES/COPY the input images. It then makes an
   /// allocation to store current costs.
   ///
@@ -191,9 +314,30 @@ namespace stereo {
                      left_region.max().y() <= left_in.impl().rows(),
                      ArgumentErr() << "calc_disparity: Region not inside left image." );
 
-    // Rasterize input so that we can do a lot of processing on it.
     BBox2i right_region = left_region;
     right_region.max() += search_volume - Vector2i(1,1);
+
+    // The census costs compare census codes instead of pixels.  The codes
+    // are computed with the pixels around the regions so they don't depend
+    // on where the regions were cut.
+    if ( cost_type == CENSUS_TRANSFORM || cost_type == TERNARY_CENSUS_TRANSFORM ) {
+      const int32 border = 3; // Radius of the largest census window
+      BBox2i left_census_region  = left_region;
+      BBox2i right_census_region = right_region;
+      left_census_region.expand (border);
+      right_census_region.expand(border);
+      ImageView<uint64> left_codes
+        = census_codes(crop(edge_extend(left_in.impl()),  left_census_region),  cost_type);
+      ImageView<uint64> right_codes
+        = census_codes(crop(edge_extend(right_in.impl()), right_census_region), cost_type);
+      return best_of_search_hamming(crop(left_codes,  border, border, left_region.width(),
+                                         left_region.height()),
+                                    crop(right_codes, border, border, right_region.width(),
+                                         right_region.height()),
+                                    search_volume, kernel_size);
+    }
+
+    // Rasterize input so that we can do a lot of processing on it.
     ImageView<typename ImageT1::pixel_type> left ( crop(left_in.impl(),  left_region) );
     ImageView<typename ImageT2::pixel_type> right( crop(right_in.impl(), right_region) );
     
@@ -329,6 +473,46 @@ namespace stereo {
                           Vector2i const& kernel_size,
                           int32 fail_count = 0 );
 
+  /// Estimated cost of correlating a zone with calc_disparity(), including
+  ///  the kernel border that is searched around it.
+  /// - Pass the result of calc_seconds_per_op() to get seconds, or leave
+  ///   seconds_per_op at 1 to get the number of operations.
+  double zone_cost( SearchParam const& zone, Vector2i const& kernel_size,
+                    double seconds_per_op = 1.0 );
+
+  /// Rearrange correlation zones into work items of similar cost for a thread pool.
+  /// - Neighboring zones sharing a whole edge and the same disparity range are
+  ///   merged.  This saves the kernel border and the per-zone overhead of many
+  ///   small zones.
+  /// - Zones costing more than 1/num_tasks of the total are halved along their
+  ///   longer side until they don't, or until they would be smaller than min_size.
+  /// - Neither merging nor splitting changes the search range of any pixel,
+  ///   so the result does not depend on num_tasks.
+  /// - The work items cover the same pixels as the zones and are sorted by
+  ///   decreasing cost, so the slowest ones are started first.
+  void schedule_zones( std::vector<SearchParam> const& zones,
+                       std::vector<SearchParam>& work, // Output goes here
+                       Vector2i const& kernel_size, int32 num_tasks,
+                       Vector2i const& min_size = Vector2i(16,16) );
+
+  /// Thread pool shared by the tiles of every PyramidCorrelationView for their zones.
+  /// - The tiles are already rasterized in parallel, so a pool per tile would start
+  ///   up to the square of the thread count.  This one has the default number of
+  ///   threads at its first use, and its tasks never rasterize tiles themselves.
+  FifoWorkQueue& zone_work_queue();
+
+  class DisparityBounds;
+
+  /// Version of subdivide_regions which works directly from per-pixel search
+  ///  bounds instead of a coarse disparity image.
+  /// - Only the trusted pixels of the bounds are used, so regions which
+  ///   contain no trusted pixels are left out of the list.
+  bool subdivide_regions( DisparityBounds const& bounds,
+                          BBox2i const& current_bbox,
+                          std::vector<SearchParam>& list, // Output goes here
+                          Vector2i const& kernel_size,
+                          int32 fail_count = 0 );
+
 }}
 
 #endif//__VW_STEREO_CORRELATION_H__
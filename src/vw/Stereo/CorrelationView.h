@@ -22,6 +22,7 @@
 #include <vw/Core/Exception.h>
 #include <vw/Core/Stopwatch.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/ErodeView.h>
 #include <vw/Image/PerPixelAccessorViews.h>
@@ -29,6 +30,7 @@
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Stereo/Correlation.h>
 #include <vw/Stereo/Correlate.h>
+#include <vw/Stereo/DisparityBounds.h>
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/Stereo/PreFilter.h>
 #include <boost/foreach.hpp>
@@ -287,6 +289,59 @@ namespace stereo {
                               std::vector<ImageView<typename Mask1T::pixel_type > > & left_mask_pyramid,
                               std::vector<ImageView<typename Mask2T::pixel_type > > & right_mask_pyramid) const;
 
+    /// Block match one zone at one pyramid level, writing its part of disparity.
+    /// - With check_rl the right to left disparity of the zone is also found and
+    ///   inconsistent pixels are invalidated.
+    /// - Zones don't overlap, so several can be processed at once.
+    /// - With the census cost functions the codes computed once for the whole
+    ///   level are matched instead of the images.
+    void correlate_zone(SearchParam const& zone, Vector2i const& region_offset, bool check_rl,
+                        ImageView<typename Image1T::pixel_type> const& left,
+                        ImageView<typename Image2T::pixel_type> const& right,
+                        ImageView<uint64> const* left_codes,
+                        ImageView<uint64> const* right_codes,
+                        ImageView<pixel_typeI> & disparity) const;
+
+    /// Estimated seconds for correlate_zone(), from m_seconds_per_op.
+    double zone_seconds(SearchParam const& zone, bool check_rl) const;
+
+    /// Runs correlate_zone() in a thread pool and logs how long the zone took
+    ///  against what the cost model predicted.
+    class ZoneTask : public Task, private boost::noncopyable {
+      PyramidCorrelationView const& m_view;
+      SearchParam  m_zone;
+      Vector2i     m_region_offset;
+      bool         m_check_rl;
+      ImageView<typename Image1T::pixel_type> const& m_left;
+      ImageView<typename Image2T::pixel_type> const& m_right;
+      ImageView<uint64> const* m_left_codes;
+      ImageView<uint64> const* m_right_codes;
+      ImageView<pixel_typeI> & m_disparity;
+    public:
+      ZoneTask(PyramidCorrelationView const& view, SearchParam const& zone,
+               Vector2i const& region_offset, bool check_rl,
+               ImageView<typename Image1T::pixel_type> const& left,
+               ImageView<typename Image2T::pixel_type> const& right,
+               ImageView<uint64> const* left_codes,
+               ImageView<uint64> const* right_codes,
+               ImageView<pixel_typeI> & disparity)
+        : m_view(view), m_zone(zone), m_region_offset(region_offset), m_check_rl(check_rl),
+          m_left(left), m_right(right), m_left_codes(left_codes), m_right_codes(right_codes),
+          m_disparity(disparity) {}
+
+      virtual void operator()() {
+        Stopwatch watch;
+        watch.start();
+        m_view.correlate_zone(m_zone, m_region_offset, m_check_rl, m_left, m_right,
+                              m_left_codes, m_right_codes, m_disparity);
+        watch.stop();
+        vw_out(DebugMessage,"stereo") << "Zone " << m_zone.image_region() << " with range "
+                                      << m_zone.disparity_range() << ": estimated "
+                                      << m_view.zone_seconds(m_zone, m_check_rl) << " s, took "
+                                      << watch.elapsed_seconds() << " s\n";
+      }
+    };
+
     /// Filter out isolated blobs of valid disparity regions which are usually wrong.
     /// - Using this can decrease run time in images with lots of little disparity islands.
     void disparity_blob_filter(ImageView<pixel_typeI > &disparity, int level,
@@ -224,6 +224,85 @@ disparity_blob_filter(ImageView<pixel_typeI> &disparity, int level,
 
 
 
+template <class Image1T, class Image2T, class Mask1T, class Mask2T>
+void PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
+correlate_zone(SearchParam const& zone, Vector2i const& region_offset, bool check_rl,
+               ImageView<typename Image1T::pixel_type> const& left,
+               ImageView<typename Image2T::pixel_type> const& right,
+               ImageView<uint64> const* left_codes,
+               ImageView<uint64> const* right_codes,
+               ImageView<pixel_typeI> & disparity) const {
+
+  // The input zone is in the normal pixel coordinates for this  level.
+  // We need to convert it to a bbox in the expanded base of support image at this level.
+  Vector2i half_kernel = m_kernel_size/2;
+  BBox2i left_region = zone.image_region() + region_offset; // Kernel width offset
+  left_region.expand(half_kernel);
+  BBox2i right_region = left_region + zone.disparity_range().min(); // Make right region contain all of
+  right_region.max() += zone.disparity_range().size();              //  the needed match area.
+  // Setting up the ROIs in this way means that the range of disparities calculated is always >=0
+
+  // Compute left to right disparity vectors in this zone.
+  // - The cropped regions we pass in have padding for the kernel.
+  if (left_codes)
+    crop(disparity, zone.image_region())
+      = best_of_search_hamming(crop(*left_codes,  left_region),
+                               crop(*right_codes, right_region),
+                               zone.disparity_range().size(), m_kernel_size);
+  else
+    crop(disparity, zone.image_region())
+      = calc_disparity(m_cost_type,
+                       crop(left,  left_region),
+                       crop(right, right_region),
+                       left_region - left_region.min(), // Specify that the whole cropped region is valid
+                       zone.disparity_range().size(),
+                       m_kernel_size);
+
+  // If the user requested a left<->right consistency check, compute right to left disparity.
+  if (check_rl) {
+    BBox2i left_rl_region = left_region - zone.disparity_range().size();
+    ImageView<pixel_typeI> disparity_rl;
+    if (left_codes) {
+      // Unlike calc_disparity, the search needs the whole left match area.
+      left_rl_region.max() = left_rl_region.min() + right_region.size()
+                           + zone.disparity_range().size() - Vector2i(1,1);
+      disparity_rl = best_of_search_hamming(crop(edge_extend(*right_codes), right_region),
+                                            crop(edge_extend(*left_codes),  left_rl_region),
+                                            zone.disparity_range().size(), m_kernel_size);
+    } else {
+      disparity_rl = calc_disparity(m_cost_type,
+                                    crop(edge_extend(right), right_region),
+                                    crop(edge_extend(left),  left_rl_region),
+                                    right_region - right_region.min(),
+                                    zone.disparity_range().size(), m_kernel_size);
+    }
+    disparity_rl -= pixel_typeI(zone.disparity_range().size());
+
+    // Find pixels where the disparity distance is greater than m_consistency_threshold
+    const bool verbose = true;
+    stereo::cross_corr_consistency_check(crop(disparity,zone.image_region()),
+                                         disparity_rl,
+                                         m_consistency_threshold, verbose);
+  }
+
+  // Fix the offsets to account for cropping.
+  crop(disparity, zone.image_region()) += pixel_typeI(zone.disparity_range().min());
+}
+
+template <class Image1T, class Image2T, class Mask1T, class Mask2T>
+double PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
+zone_seconds(SearchParam const& zone, bool check_rl) const {
+  double seconds = zone_cost(zone, m_kernel_size, m_seconds_per_op);
+  if (check_rl) {
+    // The right to left search covers the left region grown by the disparity range.
+    SearchParam right_zone(zone.image_region(), zone.disparity_range());
+    right_zone.image_region().max() += zone.disparity_range().size();
+    seconds += zone_cost(right_zone, m_kernel_size, m_seconds_per_op);
+  }
+  return seconds;
+}
+
+
 template <class Image1T, class Image2T, class Mask1T, class Mask2T>
 typename PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::prerasterize_type
 PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
@@ -277,7 +356,7 @@ prerasterize(BBox2i const& bbox) const {
     }
     
     // 3.0) Actually perform correlation now
-    ImageView<pixel_typeI> disparity, prev_disparity, disparity_rl, prev_disparity_rl;
+    ImageView<pixel_typeI> disparity, prev_disparity, disparity_rl;
     std::vector<stereo::SearchParam> zones; 
     // Start off the search at the lowest resolution pyramid level.  This zone covers
     // the entire image and uses the disparity range that was loaded into the class.
@@ -314,8 +393,7 @@ prerasterize(BBox2i const& bbox) const {
 
       int32 scaling = 1 << level;
       if (use_sgm) {
-        prev_disparity    = disparity;
-        prev_disparity_rl = disparity_rl;
+        prev_disparity = disparity;
       }
 
       disparity.set_size( left_mask_pyramid[level] ); // Note, no kernel padding here.
@@ -329,8 +407,6 @@ prerasterize(BBox2i const& bbox) const {
       vw_out(DebugMessage,"stereo") << "region_offset = " << region_offset << std::endl;
       vw_out(DebugMessage,"stereo") << "Number of zones = " << zones.size() << std::endl;
 
-      ImageView<typename Mask2T::pixel_type> right_rl_mask, left_rl_mask;
-
       // SGM method
       if (use_sgm) {
 
@@ -361,6 +437,10 @@ prerasterize(BBox2i const& bbox) const {
         //       The left mask size should exactly equal the output size here.
         // - To be fully accurate, should crop the right mask slightly but SGM does not require this.
         
+        // If the user requested a left<->right consistency check at this level, the
+        //  right to left disparity is found from the same accumulated costs.
+        check_rl = ( m_consistency_threshold >= 0 && level >= m_min_consistency_level );
+
         boost::shared_ptr<SemiGlobalMatcher> sgm_matcher_ptr;
         crop(disparity, zone.image_region()) // This crop not needed in SGM case!
           = calc_disparity_sgm(m_cost_type,
@@ -371,134 +451,26 @@ prerasterize(BBox2i const& bbox) const {
                            m_kernel_size, use_mgm, m_sgm_subpixel_mode, m_sgm_search_buffer, m_memory_limit_mb,
                            sgm_matcher_ptr,
                            &(left_mask_pyramid[level]), &(right_mask_pyramid[level]),
-                           prev_disp_ptr);
+                           prev_disp_ptr, check_rl);
         // Delete the matcher pointer right after we use it to free up its large buffers.
         // - On the last level we need to generate the subpixel view before we delete it.
         // - Note that the subpixel image is created BEFORE filtering out bad pixels at the
         //   integer level.  This is ok, we just apply the integer filter results before 
-        //   returning the subpixel disparity.  Doing things in this order avoids having
-        //   to keep both the LR and the RL large accumulation buffers in memory at the 
-        //   same time but it does mean we waste time computing subpixel values for pixels
-        //   that will get invalidated later.
+        //   returning the subpixel disparity.  Doing things in this order means we waste
+        //   time computing subpixel values for pixels that will get invalidated later.
         if (level == 0)
           subpixel_disparity = sgm_matcher_ptr->create_disparity_view_subpixel(disparity);
+        if (check_rl)
+          disparity_rl = sgm_matcher_ptr->right_disparity();
         sgm_matcher_ptr.reset();
 
-
-        // If the user requested a left<->right consistency check at this level,
-        //   compute right to left disparity.
-        if ( m_consistency_threshold >= 0 && level >= m_min_consistency_level ) {
-
-          check_rl = true;
-
-          // Update m_search_region for this level
-          BBox2i search_region_level = m_search_region;
-          search_region_level /= scaling;
-          
-          // To properly perform the reverse correlation, we need to fix the ROIs
-          //  to account for the different sizes of the left and right images
-          //  and make sure they line up with the previous disparity image and the
-          //  input masks.
-
-          BBox2i right_reverse_region = right_region;
-          BBox2i left_reverse_region = left_region - zone.disparity_range().size(); // Shift to right
-          left_reverse_region.max() += 2*zone.disparity_range().size(); // Enlarge to fit the search range
-
-          if (m_write_debug_images) { // DEBUG
-            std::cout << "\n====== RL CHECK =====\n";
-            std::cout << "left region = " << left_region << std::endl;
-            std::cout << "right region = " << right_region << std::endl;
-            std::cout << "scaling       = " << scaling << std::endl;
-            std::cout << "half_kernel   = " << half_kernel << std::endl;
-            std::cout << "region_offset = " << region_offset << std::endl;
-            std::cout << "right_reverse_region  = " << right_reverse_region << std::endl;
-            std::cout << "left_reverse_region   = " << left_reverse_region << std::endl;
-            std::cout << "m_search_region     = " << m_search_region << std::endl;
-            std::cout << "search_region_level = " << search_region_level << std::endl;
-            std::cout << "search_region_level.max() = " << search_region_level.max() << std::endl;
-            std::cout << "zone.image_region() = " << zone.image_region() << std::endl;
-            std::cout << "zone.disparity_range() = " << zone.disparity_range() << std::endl;
-            std::cout << "zone.disparity_range().max() = " << zone.disparity_range().max() << std::endl;
-            std::cout << "right_pyramid[level].size()   = " << bounding_box(right_pyramid[level]) << std::endl;
-            std::cout << "left_pyramid[level].size()   = " << bounding_box(left_pyramid[level]) << std::endl;
-          }
-
-          ImageView<pixel_typeI> *prev_disp_ptr_rl=0; // Pass in upper level disparity
-          if (level < max_pyramid_levels) {
-            prev_disp_ptr_rl = &prev_disparity_rl;
-            vw_out(VerboseDebugMessage, "stereo") << "Prev Disparity size RL = " << bounding_box(prev_disparity_rl) << std::endl;
-          }
-
-          
-          // Set the masks to the exact size needed and adjust the position of the left one to match the image shift.
-          BBox2i right_mask_bbox = BBox2i(0,0, right_reverse_region.width ()-2*half_kernel[0],
-                                               right_reverse_region.height()-2*half_kernel[1]);
-          BBox2i left_mask_bbox  = BBox2i(0,0, left_reverse_region.width  ()-2*half_kernel[0],
-                                               left_reverse_region.height ()-2*half_kernel[1]) - zone.disparity_range().size();
-          
-          // Rasterization needed because we pass these by address below.
-          // - Could be avoided with some refactoring.
-          right_rl_mask = crop(edge_extend(right_mask_pyramid[level], ZeroEdgeExtension()), right_mask_bbox); 
-          left_rl_mask  = crop(edge_extend(left_mask_pyramid [level], ZeroEdgeExtension()), left_mask_bbox );
-
-          if (m_write_debug_images) { // DEBUG
-            std::cout << "left mask input: "  << bounding_box(left_mask_pyramid [level]) << std::endl;
-            std::cout << "right mask input: " << bounding_box(right_mask_pyramid[level]) << std::endl;
-            std::cout << "left mask: "  << left_mask_bbox << std::endl;
-            std::cout << "right mask: " << right_mask_bbox << std::endl;
-          }
-
-          //write_image("lr_cropl.tif", crop(left_pyramid [level], left_region));
-          //write_image("lr_cropr.tif", crop(right_pyramid[level], right_region));
-          //write_image("rl_cropl.tif", crop(edge_extend(left_pyramid[level]), left_reverse_region));
-          //write_image("rl_cropr.tif", crop(right_pyramid[level], right_reverse_region));
-
-
-          // Write out masks with borders inserted - should line up with images!
-          //right_mask_bbox.expand(half_kernel);
-          //write_image("rl_cropRmaskPad.tif", crop(edge_extend(right_rl_mask, ZeroEdgeExtension()), right_mask_bbox));
-          //BBox2i temp = bounding_box(left_rl_mask);
-          //temp.expand(half_kernel);
-          //write_image("rl_cropLmaskPad.tif", crop(edge_extend(left_rl_mask, ZeroEdgeExtension()), temp));
-          //write_image("lr_result.tif", crop(disparity, zone.image_region()));
-
-          boost::shared_ptr<SemiGlobalMatcher> sgm_right_matcher_ptr;
-          disparity_rl = calc_disparity_sgm(m_cost_type,
-                           crop(right_pyramid[level], right_reverse_region),
-                           crop(edge_extend(left_pyramid[level]), left_reverse_region),
-                           right_reverse_region - right_reverse_region.min(), // Full RR region
-                           zone.disparity_range().size(), 
-                           m_kernel_size, use_mgm, m_sgm_subpixel_mode, m_sgm_search_buffer, m_memory_limit_mb,
-                           sgm_right_matcher_ptr,
-                           &(right_rl_mask), 
-                           &(left_rl_mask),
-                           prev_disp_ptr_rl);
-          sgm_right_matcher_ptr.reset(); // Immediately delete this to clear memory.
-
-          //write_image("rl_result.tif", disparity_rl);
-
-          // Convert from RL to negative LR values
-          pixel_typeI offset(zone.disparity_range().size());
-          disparity_rl -= offset;
-
-          //write_image("rl_result2.tif", disparity_rl);
-
+        if (check_rl) {
           // Find pixels where the disparity distance is greater than m_consistency_threshold
           //  and flag those pixels as invalid.
           const bool verbose = true;
-          stereo::cross_corr_consistency_check(crop(disparity,zone.image_region()), // Crop not needed for SGM!
-                                               disparity_rl, m_consistency_threshold, verbose);
-          
-          //write_image("lr_result_cons.tif", crop(disparity, zone.image_region()));
-                                               
-          //disparity_rl *= -1;
-          //write_image("rl_result3.tif", disparity_rl);
-          //disparity_rl *= -1;
-          
-          // This offset was used for the cross-corr check but must be reset for the previous disparity image
-          disparity_rl += offset;                                               
-                                               
-        } // End of last level right to left disparity check
+          stereo::cross_corr_consistency_check(disparity, disparity_rl,
+                                               m_consistency_threshold, verbose);
+        } // End of right to left disparity check
 
 
       } else { // Normal block matching method
@@ -506,85 +478,69 @@ prerasterize(BBox2i const& bbox) const {
         // 3.1) Process each zone with their refined search estimates
         // - The zones are subregions of the image with similar disparities
         //   that we identified in previous iterations.
-        // - Prioritize the zones which take less time so we don't miss
-        //   a bunch of tiles because we spent all our time on a slow one.
-        std::sort(zones.begin(), zones.end(), SearchParamLessThan()); // Sort the zones, smallest to largest.
-        BOOST_FOREACH( SearchParam const& zone, zones ) {
-
-          // The input zone is in the normal pixel coordinates for this  level.
-          // We need to convert it to a bbox in the expanded base of support image at this level.
-          BBox2i left_region = zone.image_region() + region_offset; // Kernel width offset
-          left_region.expand(half_kernel);
-          BBox2i right_region = left_region + zone.disparity_range().min(); // Make right region contain all of
-          right_region.max() += zone.disparity_range().size();              //  the needed match area.
-          // Setting up the ROIs in this way means that the range of disparities calculated is always >=0
-
-          // Check timing estimate to see if we should go ahead with this zone or quit.
-          SearchParam params(left_region, zone.disparity_range());
-          double next_elapsed = m_seconds_per_op * params.search_volume();
-          if (m_corr_timeout > 0.0 && estim_elapsed + next_elapsed > m_corr_timeout){
-            vw_out() << "Tile: " << bbox << " reached timeout: "
-                     << m_corr_timeout << " s" << std::endl;
-            break;
-          }else
-            estim_elapsed += next_elapsed;
-
-          // See if it is time to actually accurately compute the time
-          if (m_corr_timeout > 0.0 && estim_elapsed - prev_estim > measure_spacing){
-            std::time (&end);
-            double diff = std::difftime(end, start);
-            estim_elapsed = diff;
-            prev_estim = estim_elapsed;
-          }
+        // TODO: Support checks at higher levels like with SGM!
+        check_rl = ( m_consistency_threshold >= 0 && level == 0 );
+
+        // The census codes are computed once for the whole level rather than
+        // for each zone, which would repeat the work where the zones overlap.
+        ImageView<uint64> left_codes, right_codes;
+        ImageView<uint64> const *left_codes_ptr = 0, *right_codes_ptr = 0;
+        if (m_cost_type == CENSUS_TRANSFORM || m_cost_type == TERNARY_CENSUS_TRANSFORM) {
+          left_codes  = census_codes(left_pyramid [level], m_cost_type);
+          right_codes = census_codes(right_pyramid[level], m_cost_type);
+          left_codes_ptr  = &left_codes;
+          right_codes_ptr = &right_codes;
+        }
 
-          // Compute left to right disparity vectors in this zone.
-          // - The cropped regions we pass in have padding for the kernel.
-          crop(disparity, zone.image_region())
-            = calc_disparity(m_cost_type,
-                             crop(left_pyramid [level], left_region), 
-                             crop(right_pyramid[level], right_region),
-                             left_region - left_region.min(), // Specify that the whole cropped region is valid
-                             zone.disparity_range().size(), 
-                             m_kernel_size);
-
-
-          // TODO: Support checks at higher levels like with SGM!
-          // If at the last level and the user requested a left<->right consistency check,
-          //   compute right to left disparity.
-          if ( m_consistency_threshold >= 0 && level == 0 ) {
-            check_rl = true;
-
-            // Check the time again before moving on with this
-            SearchParam params2(right_region, zone.disparity_range());
-            double next_elapsed = m_seconds_per_op * params2.search_volume();
-            if (m_corr_timeout > 0.0 && estim_elapsed + next_elapsed > m_corr_timeout){
+        if (m_corr_timeout > 0.0) {
+          // Prioritize the zones which take less time so we don't miss
+          // a bunch of tiles because we spent all our time on a slow one.
+          std::sort(zones.begin(), zones.end(), SearchParamLessThan()); // Sort the zones, smallest to largest.
+          BOOST_FOREACH( SearchParam const& zone, zones ) {
+
+            // Check timing estimate to see if we should go ahead with this zone or quit.
+            double next_elapsed = zone_seconds(zone, check_rl);
+            if (estim_elapsed + next_elapsed > m_corr_timeout){
               vw_out() << "Tile: " << bbox << " reached timeout: "
                        << m_corr_timeout << " s" << std::endl;
               break;
-            }else{
+            }else
               estim_elapsed += next_elapsed;
+
+            // See if it is time to actually accurately compute the time
+            if (estim_elapsed - prev_estim > measure_spacing){
+              std::time (&end);
+              double diff = std::difftime(end, start);
+              estim_elapsed = diff;
+              prev_estim = estim_elapsed;
             }
-            // Compute right to left disparity in this zone       
-            
-            disparity_rl = calc_disparity(m_cost_type,
-                             crop(edge_extend(right_pyramid[level]), right_region),
-                             crop(edge_extend(left_pyramid [level]),
-                                  left_region - zone.disparity_range().size()),
-                             right_region - right_region.min(),
-                             zone.disparity_range().size(), m_kernel_size)
-            - pixel_typeI(zone.disparity_range().size());
-
-
-            // Find pixels where the disparity distance is greater than m_consistency_threshold
-            const bool verbose = true;
-            stereo::cross_corr_consistency_check(crop(disparity,zone.image_region()),
-                                                  disparity_rl,
-                                                 m_consistency_threshold, verbose);
-          } // End of last level right to left disparity check
-
-          // Fix the offsets to account for cropping.
-          crop(disparity, zone.image_region()) += pixel_typeI(zone.disparity_range().min());
-        } // End of zone loop
+
+            correlate_zone(zone, region_offset, check_rl,
+                           left_pyramid[level], right_pyramid[level],
+                           left_codes_ptr, right_codes_ptr, disparity);
+          } // End of zone loop
+        } else {
+          // Without a time limit the zones are rearranged into work items of
+          // similar cost, largest first, and spread over the pool shared by all
+          // tiles.  A tile with a large search range then no longer runs on one
+          // thread while the threads of the tiles that finished early sit idle.
+          FifoWorkQueue& queue = zone_work_queue();
+          std::vector<SearchParam> work;
+          schedule_zones(zones, work, m_kernel_size, queue.max_threads());
+          vw_out(DebugMessage,"stereo") << "Scheduled " << zones.size() << " zones as "
+                                        << work.size() << " work items\n";
+          std::vector<boost::shared_ptr<ZoneTask> > tasks;
+          BOOST_FOREACH( SearchParam const& zone, work ) {
+            tasks.push_back(boost::shared_ptr<ZoneTask>(
+              new ZoneTask(*this, zone, region_offset, check_rl,
+                           left_pyramid[level], right_pyramid[level],
+                           left_codes_ptr, right_codes_ptr, disparity)));
+            queue.add_task(tasks.back());
+          }
+          // Only wait for this tile, the other tiles have their own tasks queued.
+          BOOST_FOREACH( boost::shared_ptr<ZoneTask> const& task, tasks )
+            task->join();
+        }
       } // End non-SGM case
 
       // 3.2a) Filter the disparity so we are not processing more than we need to.
@@ -594,9 +550,6 @@ prerasterize(BBox2i const& bbox) const {
       const float rm_min_matches_percent = 0.5;
       const float rm_threshold = 3.0;
 
-      // R-L image only needs to be filtered when using SGM because it is used in that case
-      //  to initialize the search range of the following pyramid level.
-
       if (m_filter_half_kernel > 0) { // Skip filtering if zero radius passed in
         if ( !on_last_level ) {
           disparity = disparity_mask(disparity_cleanup_using_thresh
@@ -606,15 +559,6 @@ prerasterize(BBox2i const& bbox) const {
                                         rm_min_matches_percent),
                                        left_mask_pyramid [level],
                                        right_mask_pyramid[level]);
-          if (check_rl && use_sgm) {
-            disparity_rl = disparity_mask(disparity_cleanup_using_thresh
-                                           (disparity_rl,
-                                            m_filter_half_kernel, m_filter_half_kernel,
-                                            rm_threshold,
-                                            rm_min_matches_percent),
-                                           right_rl_mask, 
-                                           left_rl_mask);
-          }
         } else { // On the last level
         
           // We don't do a single hot pixel check on the final level as it leaves a border.
@@ -625,29 +569,19 @@ prerasterize(BBox2i const& bbox) const {
                                         rm_min_matches_percent),
                                        left_mask_pyramid [level],
                                        right_mask_pyramid[level]);
-
-          // No need to filter R-L disparity with SGM on the last level.
         }
       } // End of 
 
       // The kernel based filtering tends to leave isolated blobs behind.
       disparity_blob_filter(disparity, level, m_blob_filter_area);
-      if (check_rl && !on_last_level)
-        disparity_blob_filter(disparity_rl, level, m_blob_filter_area);
 
 
       // 3.2b) Refine search estimates but never let them go beyond
       // the search region defined by the user
       // - SGM method does not use zones.
+      DisparityBounds next_bounds;
       if ( !on_last_level && !use_sgm) {
         const size_t next_level = level-1;
-        zones.clear();
-        
-        // On the next resolution level, break up the image area into multiple
-        // smaller zones with similar disparities.  This helps minimize
-        // the total amount of searching done on the image.
-        subdivide_regions( disparity, bounding_box(disparity),
-                           zones, m_kernel_size );
       
         scaling >>= 1;
         
@@ -664,19 +598,27 @@ prerasterize(BBox2i const& bbox) const {
         
         BBox2i default_disparity_range = BBox2i(0,0,m_search_region.width(),
                                                     m_search_region.height());
+
+        // Predict the search range of each pixel at the next level from the
+        // disparity at this level.
+        // - The margin of 2 is practically required. Our correlation will fail
+        //   if the search has only one solution.
+        // - Increasing the margin improves results slightly but significantly
+        //   increases the processing times.
+        const Vector2i NEXT_LEVEL_SEARCH_MARGIN(2,2);
+        next_bounds.populate_from_coarse(disparity,
+                                         next_zone_size.width(), next_zone_size.height(),
+                                         Vector4i(0, 0, scale_search_region.width ()-1,
+                                                        scale_search_region.height()-1),
+                                         NEXT_LEVEL_SEARCH_MARGIN, 2, false);
+
+        // On the next resolution level, break up the image area into multiple
+        // smaller zones with similar disparities.  This helps minimize
+        // the total amount of searching done on the image.
+        zones.clear();
+        subdivide_regions( next_bounds, next_zone_size, zones, m_kernel_size );
         
         BOOST_FOREACH( SearchParam& zone, zones ) {
-        
-          zone.image_region() *= 2;
-          zone.image_region().crop( next_zone_size );
-          zone.disparity_range() *= 2;
-          zone.disparity_range().expand(2); // This is practically required. Our
-          // correlation will fail if the search has only one solution.
-          // - Increasing this expansion number improves results slightly but
-          //   significantly increases the processing times.
-          
-          zone.disparity_range().crop( scale_search_region );
-          
           if (zone.disparity_range().empty()) {
             zone.disparity_range() = default_disparity_range; // Reset invalid disparity!
           }
@@ -702,6 +644,8 @@ prerasterize(BBox2i const& bbox) const {
             f << zone.image_region() << " " << zone.disparity_range() << "\n";
           }
           f.close();
+          if (!on_last_level)
+            next_bounds.write(ostr.str() + "_next_bounds.bin");
         }
         write_image( ostr.str() + "left.tif",  left_pyramid [level] );
         write_image( ostr.str() + "right.tif", right_pyramid[level] );
@@ -191,6 +191,11 @@ namespace stereo {
     typedef typename AbsAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
 
+    // Per pixel cost and whether cost_modification() alters the box summed
+    // costs. Used by the sliding window search in best_of_search_convolution.
+    typedef AbsDifferenceFunctor pixel_cost_type;
+    static const bool modifies_cost = false;
+
     // Does nothing
     template <class ImageT1, class ImageT2>
     AbsoluteCost( ImageViewBase<ImageT1> const& /*left*/,
@@ -220,6 +225,9 @@ namespace stereo {
     typedef typename SqrDiffAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
 
+    typedef SquaredDifferenceFunctor pixel_cost_type;
+    static const bool modifies_cost = false;
+
     // Does nothing
     template <class ImageT1, class ImageT2>
     SquaredCost( ImageViewBase<ImageT1> const& /*left*/,
@@ -249,6 +257,10 @@ namespace stereo {
   struct NCCCost {
     typedef typename SqrDiffAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
+
+    // The box summed products are normalized by cost_modification().
+    typedef CrossCorrelationFunctor pixel_cost_type;
+    static const bool modifies_cost = true;
     ImageView<pixel_accumulator_type> left_precision, right_precision;
 
     template <class ImageT1, class ImageT2>
@@ -287,6 +299,10 @@ namespace stereo {
   struct NCCCost<ImageT, true> {
     typedef typename SqrDiffAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
+
+    // As in the float version, but normalized by the window variances.
+    typedef CrossCorrelationFunctor pixel_cost_type;
+    static const bool modifies_cost = true;
     ImageView<pixel_accumulator_type> left_variance, right_variance;
 
     template <class ImageT1, class ImageT2>
@@ -0,0 +1,251 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include <vw/Core/Exception.h>
+#include <vw/Stereo/DisparityBounds.h>
+
+namespace vw {
+namespace stereo {
+
+namespace {
+  // Identifies the binary bounds file format.
+  const char   BOUNDS_FILE_MAGIC[8]  = {'V','W','D','B','N','D','S','1'};
+  const size_t BOUNDS_FILE_MAGIC_LEN = sizeof(BOUNDS_FILE_MAGIC);
+}
+
+void DisparityBounds::set_constant(int32 cols, int32 rows, Vector4i const& search_range) {
+  m_search_range = search_range;
+  m_bounds.set_size(cols, rows);
+  m_full_range.set_size(cols, rows);
+  const size_t num_pixels = size_t(cols)*size_t(rows);
+  std::fill(m_bounds.data(),     m_bounds.data()    +num_pixels, search_range);
+  std::fill(m_full_range.data(), m_full_range.data()+num_pixels, uint8(255));
+}
+
+
+size_t DisparityBounds::populate_from_coarse(ImageView<PixelMask<Vector2i> > const& coarse_disparity,
+                                             int32 cols, int32 rows,
+                                             Vector4i const& search_range,
+                                             Vector2i const& margin,
+                                             int32 scale, bool reject_edges) {
+  set_constant(cols, rows, search_range);
+
+  // There needs to be some "room" in the disparity search space for
+  // us to discard prior results on the edge as not trustworthy predictors.
+  // In other words, don't mark any pixels as edge if the search space is too small!
+  // - The edges come from the previous resolution level, so don't check edges unless
+  //   the previous level was at least 5 pixels in that axis.
+  const bool check_x_edge = reject_edges && (search_range[2] - search_range[0] + 1 >= 10);
+  const bool check_y_edge = reject_edges && (search_range[3] - search_range[1] + 1 >= 10);
+
+  size_t num_trusted = 0;
+  for (int32 r=0; r<rows; ++r) {
+    const int32 r_in = r / scale;
+    if (r_in >= coarse_disparity.rows())
+      break; // Rows past the prior image keep the full range
+    for (int32 c=0; c<cols; ++c) {
+      const int32 c_in = c / scale;
+      if (c_in >= coarse_disparity.cols())
+        break;
+
+      PixelMask<Vector2i> const& input_disp = coarse_disparity(c_in, r_in);
+      if (!is_valid(input_disp))
+        continue;
+
+      // Disparity values on the edge of our 2D search range are not considered trustworthy!
+      const int32 dx_scaled = input_disp[0] * scale;
+      const int32 dy_scaled = input_disp[1] * scale;
+      bool on_edge = (  ( check_x_edge && ((dx_scaled <= search_range[0]) || (dx_scaled >= search_range[2])) )
+                     || ( check_y_edge && ((dy_scaled <= search_range[1]) || (dy_scaled >= search_range[3])) ) );
+      if (on_edge)
+        continue;
+
+      // We are more confident in the prior disparity, search nearby.
+      // - Constrain to global limits.
+      Vector4i bounds(std::max(dx_scaled - margin[0], search_range[0]),
+                      std::max(dy_scaled - margin[1], search_range[1]),
+                      std::min(dx_scaled + margin[0], search_range[2]),
+                      std::min(dy_scaled + margin[1], search_range[3]));
+      m_bounds    (c, r) = bounds;
+      m_full_range(c, r) = 0;
+      ++num_trusted;
+    } // End col loop
+  } // End row loop
+
+  return num_trusted;
+}
+
+
+size_t DisparityBounds::fill_full_range_pixels(int32 search_radius, int32 expansion,
+                                               bool discard_unfilled) {
+
+  const BBox2i max_range_bbox(Vector2i(m_search_range[0], m_search_range[1]),
+                              Vector2i(m_search_range[2], m_search_range[3]));
+  const Vector4i ZERO_SEARCH_AREA = empty_bounds();
+
+  size_t num_changed = 0;
+  for (int32 r=0; r<rows(); ++r) {
+
+    // Get vertical search range
+    const int32 min_search_r = std::max(r - search_radius, 0);
+    const int32 max_search_r = std::min(r + search_radius, rows()-1);
+
+    for (int32 c=0; c<cols(); ++c) {
+      // Skip pixels without a full search range
+      if (!m_full_range(c,r))
+        continue;
+
+      // Get horizontal search range
+      const int32 min_search_c = std::max(c - search_radius, 0);
+      const int32 max_search_c = std::min(c + search_radius, cols()-1);
+
+      // Look through the search range
+      BBox2i new_range;
+      for (int32 rs=min_search_r; rs<=max_search_r; ++rs) {
+        for (int32 cs=min_search_c; cs<=max_search_c; ++cs) {
+          if (m_full_range(cs,rs)) // Don't look at other uncertain pixels
+            continue;
+          Vector4i const& vec = m_bounds(cs,rs);
+          if (vec == ZERO_SEARCH_AREA) // Skip zeroed out pixels too
+            continue;
+          new_range.grow(Vector2i(vec[0], vec[1]));
+          new_range.grow(Vector2i(vec[2], vec[3]));
+        }
+      }
+
+      if (new_range.empty()) { // If we did not find a new estimate
+        if (discard_unfilled) {
+          m_bounds(c,r) = ZERO_SEARCH_AREA;
+          ++num_changed;
+        }
+        continue; // Otherwise keep the full search range.
+      }
+      // Grow the bounding box a bit and then record it
+      new_range.expand(expansion);
+      new_range.crop(max_range_bbox); // Constrain to global limits
+      m_bounds(c,r) = Vector4i(new_range.min().x(), new_range.min().y(),
+                               new_range.max().x(), new_range.max().y());
+      ++num_changed;
+    } // End col loop
+  } // End row loop
+
+  return num_changed;
+}
+
+
+bool DisparityBounds::region_range(BBox2i const& region, BBox2i &range) const {
+  BBox2i roi = region;
+  roi.crop(BBox2i(0, 0, cols(), rows()));
+
+  bool found = false;
+  Vector2i min_disp, max_disp;
+  for (int32 r=roi.min().y(); r<roi.max().y(); ++r) {
+    for (int32 c=roi.min().x(); c<roi.max().x(); ++c) {
+      if (m_full_range(c,r))
+        continue;
+      Vector4i const& b = m_bounds(c,r);
+      if ((b[0] > b[2]) || (b[1] > b[3])) // Empty pixel
+        continue;
+      if (!found) {
+        min_disp = Vector2i(b[0], b[1]);
+        max_disp = Vector2i(b[2], b[3]);
+        found = true;
+        continue;
+      }
+      min_disp[0] = std::min(min_disp[0], b[0]);
+      min_disp[1] = std::min(min_disp[1], b[1]);
+      max_disp[0] = std::max(max_disp[0], b[2]);
+      max_disp[1] = std::max(max_disp[1], b[3]);
+    }
+  }
+  if (found)
+    range = BBox2i(min_disp, max_disp + Vector2i(1,1));
+  return found;
+}
+
+
+double DisparityBounds::search_volume() const {
+  double volume = 0;
+  const size_t num_pixels = size_t(cols())*size_t(rows());
+  const Vector4i* b = m_bounds.data();
+  for (size_t i=0; i<num_pixels; ++i) {
+    if ((b[i][0] <= b[i][2]) && (b[i][1] <= b[i][3]))
+      volume += double(b[i][2]-b[i][0]+1)*double(b[i][3]-b[i][1]+1);
+  }
+  return volume;
+}
+
+
+void DisparityBounds::write(std::string const& filename) const {
+  std::ofstream f(filename.c_str(), std::ios::binary | std::ios::out);
+  if (!f.is_open())
+    vw_throw( IOErr() << "DisparityBounds: Failed to open \"" << filename << "\" for writing." );
+
+  const int32 size[2] = {cols(), rows()};
+  f.write(BOUNDS_FILE_MAGIC, BOUNDS_FILE_MAGIC_LEN);
+  f.write((const char*)size,                 sizeof(size));
+  f.write((const char*)&m_search_range[0],   4*sizeof(int32));
+
+  // Write one row at a time so that the in-memory Vector4i layout is not relied on.
+  std::vector<int32> row_buffer(4*cols());
+  for (int32 r=0; (cols() > 0) && (r<rows()); ++r) {
+    for (int32 c=0; c<cols(); ++c)
+      for (int i=0; i<4; ++i)
+        row_buffer[4*c+i] = m_bounds(c,r)[i];
+    f.write((const char*)&row_buffer[0], row_buffer.size()*sizeof(int32));
+    f.write((const char*)&m_full_range(0,r), cols());
+  }
+  if (!f.good())
+    vw_throw( IOErr() << "DisparityBounds: Failed writing \"" << filename << "\"." );
+}
+
+
+void DisparityBounds::read(std::string const& filename) {
+  std::ifstream f(filename.c_str(), std::ios::binary | std::ios::in);
+  if (!f.is_open())
+    vw_throw( IOErr() << "DisparityBounds: Failed to open \"" << filename << "\" for reading." );
+
+  char magic[BOUNDS_FILE_MAGIC_LEN];
+  int32 size[2];
+  Vector4i search_range;
+  f.read(magic,              BOUNDS_FILE_MAGIC_LEN);
+  f.read((char*)size,        sizeof(size));
+  f.read((char*)&search_range[0], 4*sizeof(int32));
+  if (!f.good() || (std::memcmp(magic, BOUNDS_FILE_MAGIC, BOUNDS_FILE_MAGIC_LEN) != 0) ||
+      (size[0] < 0) || (size[1] < 0))
+    vw_throw( IOErr() << "DisparityBounds: \"" << filename << "\" is not a disparity bounds file." );
+
+  m_search_range = search_range;
+  m_bounds.set_size(size[0], size[1]);
+  m_full_range.set_size(size[0], size[1]);
+  std::vector<int32> row_buffer(4*size[0]);
+  for (int32 r=0; (size[0] > 0) && (r<size[1]); ++r) {
+    f.read((char*)&row_buffer[0], row_buffer.size()*sizeof(int32));
+    f.read((char*)&m_full_range(0,r), size[0]);
+    for (int32 c=0; c<size[0]; ++c)
+      m_bounds(c,r) = Vector4i(row_buffer[4*c], row_buffer[4*c+1], row_buffer[4*c+2], row_buffer[4*c+3]);
+  }
+  if (!f.good())
+    vw_throw( IOErr() << "DisparityBounds: \"" << filename << "\" is truncated." );
+}
+
+}} // namespace vw::stereo
@@ -0,0 +1,124 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DisparityBounds.h
+///
+/// Per-pixel disparity search ranges for coarse-to-fine stereo.
+///
+/// Each level of a correlation pyramid is searched using the disparity
+/// found at the next coarser level.  DisparityBounds holds the resulting
+/// search range for every pixel of a level so that the same pruning logic
+/// can be shared by SemiGlobalMatcher and PyramidCorrelationView, and so
+/// that the ranges can be saved to disk and reused.
+///
+#ifndef __VW_STEREO_DISPARITY_BOUNDS_H__
+#define __VW_STEREO_DISPARITY_BOUNDS_H__
+
+#include <string>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+
+namespace vw {
+namespace stereo {
+
+  /// Image of inclusive disparity search bounds, one per pixel.
+  /// - Bounds are stored as min_dx, min_dy, max_dx, max_dy.
+  /// - Pixels without a trusted estimate from the coarser level are flagged
+  ///   as "full range" and initially search the entire range for the level.
+  ///   fill_full_range_pixels() can later shrink them using their neighbors.
+  class DisparityBounds {
+  public:
+
+    DisparityBounds() {}
+
+    /// Bounds value for a pixel which should not be searched at all.
+    static Vector4i empty_bounds() { return Vector4i(0, 0, -1, -1); }
+
+    int32 cols() const { return m_bounds.cols(); }
+    int32 rows() const { return m_bounds.rows(); }
+
+    /// The inclusive range which all bounds are constrained to.
+    Vector4i const& search_range() const { return m_search_range; }
+
+    Vector4i const& operator()(int32 col, int32 row) const { return m_bounds(col, row); }
+
+    /// Return true if this pixel did not get a trusted estimate from the coarser level.
+    bool is_full_range(int32 col, int32 row) const { return m_full_range(col, row) != 0; }
+
+    /// Replace the bounds of a pixel, keeping its full range flag.
+    void set(int32 col, int32 row, Vector4i const& bounds) { m_bounds(col, row) = bounds; }
+
+    /// Mark a pixel as not searched.
+    void set_empty(int32 col, int32 row) {
+      m_bounds    (col, row) = empty_bounds();
+      m_full_range(col, row) = 0;
+    }
+
+    /// Give every pixel of a cols by rows image the full search range.
+    void set_constant(int32 cols, int32 rows, Vector4i const& search_range);
+
+    /// Compute the bounds of a level from the disparity found at the coarser level.
+    /// - coarse_disparity must be 1/scale the resolution of this level.
+    /// - Trusted pixels search margin pixels around their scaled prior disparity.
+    /// - Invalid prior disparities and, if reject_edges is set, disparities on the
+    ///   edge of the search range are not trusted and get the full search range.
+    /// - Returns the number of pixels which were assigned trusted bounds.
+    size_t populate_from_coarse(ImageView<PixelMask<Vector2i> > const& coarse_disparity,
+                                int32 cols, int32 rows,
+                                Vector4i const& search_range,
+                                Vector2i const& margin,
+                                int32 scale = 2, bool reject_edges = true);
+
+    /// Shrink the search range of full range pixels to the union of the ranges
+    /// of trusted pixels within search_radius of them, grown by expansion.
+    /// - If no trusted pixels are nearby the pixel is left at the full range, or
+    ///   set to empty if discard_unfilled is set.
+    /// - The full range flags are not changed, so this can be called again with
+    ///   different parameters.
+    /// - Returns the number of pixels whose bounds were changed.
+    size_t fill_full_range_pixels(int32 search_radius, int32 expansion,
+                                  bool discard_unfilled);
+
+    /// The union of the bounds of the trusted pixels in an image region.
+    /// - The output is in the exclusive SearchParam convention.
+    /// - Returns false if there are no trusted pixels in the region.
+    bool region_range(BBox2i const& region, BBox2i &range) const;
+
+    /// Total number of disparities searched over all pixels.
+    double search_volume() const;
+
+    /// Save to and load from a binary file.
+    void write(std::string const& filename) const;
+    void read (std::string const& filename);
+
+    /// Direct access to the bounds image.
+    ImageView<Vector4i> const& bounds_image() const { return m_bounds; }
+
+  private:
+    ImageView<Vector4i> m_bounds;
+    ImageView<uint8>    m_full_range; ///< Nonzero where no trusted prior was available.
+    Vector4i            m_search_range;
+  };
+
+}} // namespace vw::stereo
+
+#endif // __VW_STEREO_DISPARITY_BOUNDS_H__
@@ -34,6 +34,30 @@ namespace stereo {
   }
 
 
+  DisparityFilterStep DisparityFilterStep::thresh(int32 half_h_kernel, int32 half_v_kernel,
+                                                  double pixel_threshold, double rejection_threshold) {
+    DisparityFilterStep step = {THRESH, half_h_kernel, half_v_kernel, pixel_threshold, rejection_threshold};
+    return step;
+  }
+
+  DisparityFilterStep DisparityFilterStep::mean(int32 half_h_kernel, int32 half_v_kernel,
+                                                double max_mean_diff) {
+    DisparityFilterStep step = {MEAN, half_h_kernel, half_v_kernel, max_mean_diff, 0};
+    return step;
+  }
+
+  DisparityFilterStep DisparityFilterStep::stddev(int32 half_h_kernel, int32 half_v_kernel,
+                                                  double pixel_threshold, double rejection_threshold) {
+    DisparityFilterStep step = {STDDEV, half_h_kernel, half_v_kernel, pixel_threshold, rejection_threshold};
+    return step;
+  }
+
+  DisparityFilterStep DisparityFilterStep::quantile(double quantile, double multiple) {
+    DisparityFilterStep step = {QUANTILE, 0, 0, quantile, multiple};
+    return step;
+  }
+
+
   // Compute the plane that best fits a set of 3D points.
   // - The plane is described as z = ax + by + c
   //( the output vector contains [a, b, c]
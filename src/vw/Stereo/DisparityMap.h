@@ -21,6 +21,8 @@
 
 #include <vw/config.h>
 #include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
 #include <vw/Math/BBox.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/Matrix.h>
@@ -33,6 +35,9 @@
 #include <vw/Image/Transform.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/Statistics.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/BlockRasterize.h>
 
 #include <ostream>
 
@@ -1167,6 +1172,326 @@ template <class ViewT>
 
 
 
+  // Method 6: A fused pipeline of the filters above.
+  // - The chained views re-read every neighbor through the pixel accessors
+  //   of the view below them, so the windows of the lower filters are
+  //   recomputed many times.  This engine reads each tile plus the halo
+  //   needed by all of its filters once, and runs the filters one after the
+  //   other on that buffer.
+  // - Each filter sees its input extended past the image edges with
+  //   ConstantEdgeExtension, the same as a single rm_outliers_using_*() call.
+
+  /// One filter of a disparity_cleanup() pipeline.  Use the static functions
+  /// to create these, their arguments are the same as the matching
+  /// rm_outliers_using_*() functions.
+  struct DisparityFilterStep {
+    enum FilterType { THRESH = 0, MEAN, STDDEV, QUANTILE };
+
+    FilterType type;
+    int32  half_h_kernel, half_v_kernel; ///< Zero for QUANTILE.
+    double param1, param2;
+
+    static DisparityFilterStep thresh  (int32 half_h_kernel, int32 half_v_kernel,
+                                        double pixel_threshold, double rejection_threshold);
+    static DisparityFilterStep mean    (int32 half_h_kernel, int32 half_v_kernel,
+                                        double max_mean_diff);
+    static DisparityFilterStep stddev  (int32 half_h_kernel, int32 half_v_kernel,
+                                        double pixel_threshold, double rejection_threshold);
+    /// Rejects pixels over multiple times the quantile of the whole image,
+    /// like rm_outliers_using_quantiles().  The image from all of the steps
+    /// before this one is rasterized to compute the quantile.
+    static DisparityFilterStep quantile(double quantile, double multiple);
+  };
+
+  typedef std::vector<DisparityFilterStep> DisparityFilterList;
+
+  namespace detail {
+
+    /// Apply one window filter to the pixels of src in region, writing dst.
+    /// - Both images are the same size and region is shrunk from their
+    ///   bounds by at least the kernel size.
+    /// - rejected is incremented for each pixel rejected inside count_box.
+    template <class PixelT>
+    void apply_disparity_filter(DisparityFilterStep const& step, Vector2 const& cutoff,
+                                ImageView<PixelT> const& src, ImageView<PixelT> &dst,
+                                BBox2i const& region, BBox2i const& count_box,
+                                int64 &rejected) {
+      const int32 h = step.half_h_kernel, v = step.half_v_kernel;
+
+      // Running sums for the STDDEV filter.  The values are taken relative
+      // to the first valid pixel to keep the sums of squares accurate.
+      std::vector<double> sums;
+      double ref_x = 0, ref_y = 0;
+      const int32 sum_cols = region.width() + 2*h + 1;
+      if (step.type == DisparityFilterStep::STDDEV) {
+        const int32 sum_rows = region.height() + 2*v + 1;
+        sums.assign(5*sum_cols*sum_rows, 0.0);
+        bool have_ref = false;
+        for (int32 y = 0; y < sum_rows-1; ++y) {
+          const PixelT* src_row = &src(region.min().x()-h, region.min().y()-v+y);
+          double row[5] = {0, 0, 0, 0, 0};
+          for (int32 x = 0; x < sum_cols-1; ++x) {
+            if (is_valid(src_row[x])) {
+              if (!have_ref) {
+                ref_x = src_row[x][0];
+                ref_y = src_row[x][1];
+                have_ref = true;
+              }
+              const double dx = src_row[x][0] - ref_x, dy = src_row[x][1] - ref_y;
+              row[0] += 1;  row[1] += dx;  row[2] += dy;
+              row[3] += dx*dx;  row[4] += dy*dy;
+            }
+            double       *out   = &sums[5*((y+1)*sum_cols + x+1)];
+            const double *above = &sums[5*(y*sum_cols + x+1)];
+            for (int k = 0; k < 5; ++k)
+              out[k] = above[k] + row[k];
+          }
+        }
+      }
+
+      std::vector<double> lengths;
+      const double max_mean_diff_sq = step.param1*step.param1;
+      const double total = (2*h+1)*(2*v+1);
+
+      for (int32 y = region.min().y(); y < region.max().y(); ++y) {
+        for (int32 x = region.min().x(); x < region.max().x(); ++x) {
+          PixelT const& center = src(x,y);
+          bool reject = false;
+          if (is_valid(center)) {
+            switch (step.type) {
+            case DisparityFilterStep::THRESH: {
+              // Stop once enough rows have matched to keep the pixel.
+              int32 matched = 0;
+              for (int32 yk = y-v; yk <= y+v && matched/total < step.param2; ++yk) {
+                const PixelT* row = &src(0,yk);
+                for (int32 xk = x-h; xk <= x+h; ++xk) {
+                  if (is_valid(row[xk]) &&
+                      fabs(center[0]-row[xk][0]) <= step.param1 &&
+                      fabs(center[1]-row[xk][1]) <= step.param1)
+                    ++matched;
+                }
+              }
+              reject = (matched/total < step.param2);
+              break;
+            }
+            case DisparityFilterStep::MEAN: {
+              // Drop disparities larger than twice the 75th percentile
+              // magnitude, then compare to the mean of the rest.
+              lengths.clear();
+              for (int32 yk = y-v; yk <= y+v; ++yk) {
+                const PixelT* row = &src(0,yk);
+                for (int32 xk = x-h; xk <= x+h; ++xk)
+                  if (is_valid(row[xk]))
+                    lengths.push_back(std::abs(row[xk][0]) + std::abs(row[xk][1]));
+              }
+              std::vector<double>::iterator nth = lengths.begin() + (int)(0.75*lengths.size());
+              std::nth_element(lengths.begin(), nth, lengths.end());
+              const double length_cutoff = 2.0 * (*nth);
+              double mean_x = 0, mean_y = 0;
+              int32 matched = 0;
+              for (int32 yk = y-v; yk <= y+v; ++yk) {
+                const PixelT* row = &src(0,yk);
+                for (int32 xk = x-h; xk <= x+h; ++xk) {
+                  if (!is_valid(row[xk]) ||
+                      std::abs(row[xk][0]) + std::abs(row[xk][1]) > length_cutoff)
+                    continue;
+                  mean_x += row[xk][0];
+                  mean_y += row[xk][1];
+                  ++matched;
+                }
+              }
+              double error_sq = max_mean_diff_sq + 1.0;
+              if (matched > 0) {
+                const double dx = center[0] - mean_x/matched, dy = center[1] - mean_y/matched;
+                error_sq = dx*dx + dy*dy;
+              }
+              reject = (error_sq > max_mean_diff_sq);
+              break;
+            }
+            case DisparityFilterStep::STDDEV: {
+              const int32 sx = x - region.min().x(), sy = y - region.min().y();
+              double s[5];
+              const double *s11 = &sums[5*((sy+2*v+1)*sum_cols + sx+2*h+1)];
+              const double *s01 = &sums[5*((sy+2*v+1)*sum_cols + sx      )];
+              const double *s10 = &sums[5*( sy       *sum_cols + sx+2*h+1)];
+              const double *s00 = &sums[5*( sy       *sum_cols + sx      )];
+              for (int k = 0; k < 5; ++k)
+                s[k] = s11[k] - s01[k] - s10[k] + s00[k];
+              const double mean_x = s[1]/s[0], mean_y = s[2]/s[0];
+              double std_x = sqrt(std::max(0.0, s[3]/s[0] - mean_x*mean_x));
+              double std_y = sqrt(std::max(0.0, s[4]/s[0] - mean_y*mean_y));
+              std_x = std::max(std_x, step.param2);
+              std_y = std::max(std_y, step.param2);
+              reject = (std::abs(center[0] - ref_x - mean_x) > step.param1*std_x ||
+                        std::abs(center[1] - ref_y - mean_y) > step.param1*std_y);
+              break;
+            }
+            case DisparityFilterStep::QUANTILE:
+              reject = (static_cast<float>(center[0]) > cutoff[0] ||
+                        static_cast<float>(center[1]) > cutoff[1]);
+              break;
+            }
+          }
+          if (reject) {
+            dst(x,y) = PixelT();
+            if (count_box.contains(Vector2i(x,y)))
+              ++rejected;
+          } else {
+            dst(x,y) = center;
+          }
+        }
+      }
+    }
+
+  } // end namespace detail
+
+  /// A view which applies a DisparityFilterList to a disparity image.
+  /// - Rasterize it in parallel with block_rasterize() or block_write_image().
+  template <class ViewT>
+  class DisparityCleanupView : public ImageViewBase<DisparityCleanupView<ViewT> > {
+  public:
+    typedef typename ViewT::pixel_type pixel_type;
+    typedef pixel_type                 result_type;
+    typedef ProceduralPixelAccessor<DisparityCleanupView> pixel_accessor;
+
+    /// Steps up to the last QUANTILE step are rasterized here, with
+    /// num_threads threads (zero for the vw default).
+    DisparityCleanupView(ViewT const& disparity_map, DisparityFilterList const& filters,
+                         int32 num_threads = 0)
+      : m_child(disparity_map), m_steps(filters), m_first_step(0),
+        m_state(new CleanupState()) {
+      m_state->rejected_points.assign(filters.size(), 0);
+      m_state->total_points = 0;
+
+      size_t last_quantile = filters.size();
+      for (size_t i = 0; i < filters.size(); ++i) {
+        if (filters[i].type == DisparityFilterStep::QUANTILE)
+          last_quantile = i;
+        else
+          VW_ASSERT(filters[i].half_h_kernel > 0 && filters[i].half_v_kernel > 0,
+                    ArgumentErr() << "DisparityCleanupView: half kernel sizes must be non-zero.");
+      }
+      if (last_quantile == filters.size())
+        return;
+
+      // The quantile needs the whole image of the steps before it.
+      DisparityFilterList prior(filters.begin(), filters.begin() + last_quantile);
+      DisparityCleanupView<ViewT> prior_view(disparity_map, prior, num_threads);
+      const int32 tile_size = vw_settings().default_tile_size();
+      m_rasterized.reset(new ImageView<pixel_type>
+                         (block_rasterize(prior_view, Vector2i(tile_size, tile_size), num_threads)));
+      for (size_t i = 0; i < prior.size(); ++i)
+        m_state->rejected_points[i] = prior_view.rejected_points(i);
+
+      DisparityCdfFunctor<pixel_type> cdf_functor;
+      for_each_pixel(*m_rasterized, cdf_functor);
+      const double quantile = filters[last_quantile].param1,
+                   multiple = filters[last_quantile].param2;
+      m_cutoff = Vector2(multiple * cdf_functor.getQuantileX(quantile),
+                         multiple * cdf_functor.getQuantileY(quantile));
+      m_first_step = last_quantile;
+    }
+
+    inline int32 cols  () const { return m_child.cols(); }
+    inline int32 rows  () const { return m_child.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+
+    inline result_type operator()(int32 i, int32 j, int32 p = 0) const {
+      return prerasterize(BBox2i(i,j,1,1))(i,j,p);
+    }
+
+    /// The number of pixels rejected by filters[step].
+    int64 rejected_points(size_t step) const {
+      Mutex::WriteLock lock(m_state->mutex);
+      return m_state->rejected_points[step];
+    }
+    /// The number of pixels rasterized.
+    int64 total_points() const {
+      Mutex::WriteLock lock(m_state->mutex);
+      return m_state->total_points;
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      // Each step needs its kernel around the output of the one before.
+      Vector2i halo;
+      for (size_t i = m_first_step; i < m_steps.size(); ++i)
+        halo += Vector2i(m_steps[i].half_h_kernel, m_steps[i].half_v_kernel);
+      const BBox2i buffer_box(bbox.min() - halo, bbox.max() + halo);
+
+      ImageView<pixel_type> src, dst;
+      if (m_rasterized)
+        src = crop(edge_extend(*m_rasterized, ConstantEdgeExtension()), buffer_box);
+      else
+        src = crop(edge_extend(m_child,       ConstantEdgeExtension()), buffer_box);
+      dst.set_size(src.cols(), src.rows());
+
+      // In buffer coordinates
+      const BBox2i image_box = BBox2i(0,0,cols(),rows()) - buffer_box.min();
+      const BBox2i count_box = bbox - buffer_box.min();
+      BBox2i region(Vector2i(), Vector2i(src.cols(), src.rows()));
+      std::vector<int64> rejected(m_steps.size(), 0);
+
+      for (size_t i = m_first_step; i < m_steps.size(); ++i) {
+        const Vector2i kernel(m_steps[i].half_h_kernel, m_steps[i].half_v_kernel);
+        region = BBox2i(region.min() + kernel, region.max() - kernel);
+        detail::apply_disparity_filter(m_steps[i], m_cutoff, src, dst,
+                                       region, count_box, rejected[i]);
+
+        // Repeat the edge pixels past the image edges for the next step.
+        if (i+1 < m_steps.size()) {
+          for (int32 y = region.min().y(); y < region.max().y(); ++y) {
+            const int32 cy = std::min(std::max(y, image_box.min().y()), image_box.max().y()-1);
+            for (int32 x = region.min().x(); x < region.max().x(); ++x) {
+              const int32 cx = std::min(std::max(x, image_box.min().x()), image_box.max().x()-1);
+              if (cx != x || cy != y)
+                dst(x,y) = dst(cx,cy);
+            }
+          }
+        }
+        std::swap(src, dst);
+      }
+
+      {
+        Mutex::WriteLock lock(m_state->mutex);
+        for (size_t i = m_first_step; i < m_steps.size(); ++i)
+          m_state->rejected_points[i] += rejected[i];
+        m_state->total_points += bbox.width()*bbox.height();
+      }
+      return prerasterize_type(src, BBox2i(-buffer_box.min().x(), -buffer_box.min().y(),
+                                           cols(), rows()));
+    }
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+
+  private:
+    struct CleanupState {
+      Mutex mutex;
+      std::vector<int64> rejected_points;
+      int64 total_points;
+    };
+
+    ViewT               m_child;
+    DisparityFilterList m_steps;
+    size_t              m_first_step; ///< Steps before this are in m_rasterized.
+    Vector2             m_cutoff;     ///< From the last QUANTILE step.
+    boost::shared_ptr<ImageView<pixel_type> > m_rasterized;
+    boost::shared_ptr<CleanupState>           m_state;
+  };
+
+  /// Apply a list of outlier filters to a disparity image in one pass per tile.
+  /// - The filters are applied in order, each to the output of the one before.
+  template <class ViewT>
+  DisparityCleanupView<ViewT>
+  disparity_cleanup(ImageViewBase<ViewT> const& disparity_map,
+                    DisparityFilterList const& filters, int32 num_threads = 0) {
+    return DisparityCleanupView<ViewT>(disparity_map.impl(), filters, num_threads);
+  }
+
+
   // DisparityTransform image transform functor
   //
   // Used to transform an image by using a disparity map
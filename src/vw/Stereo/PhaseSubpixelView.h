@@ -20,6 +20,9 @@
 #define __VW_STEREO_PHASESUBPIXEL_VIEW__
 
 #include <vw/Image/ImageView.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/Transform.h>
 #include <vw/Image/Fourier.h>
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/Stereo/Correlate.h>
@@ -27,6 +30,8 @@
 #include <vw/Stereo/CostFunctions.h>
 #include <vw/Stereo/Correlation.h>
 
+#include <map>
+
 
 /**
 
@@ -44,77 +49,274 @@ https://www.mathworks.com/matlabcentral/fileexchange/18401-efficient-subpixel-im
 namespace vw {
 namespace stereo {
 
-/// Use matrix multiplication to upsample a DFT in only a small region.
-///  It is usually faster than doing the equivalent series of steps:
-///   1) pad_fourier_transform(input, input.rows()*upscale, input.cols()*upscale)
-///      dimension. fftshift(inverse) to bring the center of the image to (0,0).
-///   2) dft(upsampled_image)
-///   3) crop(dft_result, col_offset, row_offset, upsampled_width, upsampled_height)
+/// Build the matrix which upsamples the columns of a DFT in partial_upsample_dft().
 inline
-cv::Mat partial_upsample_dft(cv::Mat const& input, int upsampled_height, int upsampled_width, 
-                             int upscale, int row_offset=0, int col_offset=0) {
+cv::Mat upsample_dft_col_kernel(int input_cols, int upsampled_width, int upscale, int col_offset) {
 
-  // Generate some linear row vectors
   const int COMPLEX_TYPE_CV = CV_32FC2;
   typedef std::complex<float> c_type;
 
-  cv::Mat col_vector   (1, input.cols,       COMPLEX_TYPE_CV);
-  cv::Mat row_vector   (1, input.rows,       COMPLEX_TYPE_CV);
-  cv::Mat col_up_vector(1, upsampled_width,  COMPLEX_TYPE_CV);
-  cv::Mat row_up_vector(1, upsampled_height, COMPLEX_TYPE_CV);
-
-  for (int i=0; i<input.cols; ++i)
+  cv::Mat col_vector   (1, input_cols,      COMPLEX_TYPE_CV);
+  cv::Mat col_up_vector(1, upsampled_width, COMPLEX_TYPE_CV);
+  for (int i=0; i<input_cols; ++i)
     col_vector.at<c_type>(0,i) = static_cast<c_type>(i);
-  for (int i=0; i<input.rows; ++i)
-    row_vector.at<c_type>(0,i) = static_cast<c_type>(i);
   for (int i=0; i<upsampled_width; ++i)
     col_up_vector.at<c_type>(0,i) = static_cast<c_type>(i);
-  for (int i=0; i<upsampled_height; ++i)
-    row_up_vector.at<c_type>(0,i) = static_cast<c_type>(i);
 
   const c_type neg_i(0, -1);
   float two_pi = 2.0*M_PI;
 
-  cv::Mat col_kernel, row_kernel;
+  cv::Mat col_kernel;
   cv::Mat temp_vec = fftshift(col_vector, true).t();
-  cv::Mat v1 = temp_vec - floor(input.cols/2);
+  cv::Mat v1 = temp_vec - floor(input_cols/2);
   cv::Mat v2 = col_up_vector - col_offset;
   
   cv::Mat dummy;
   cv::gemm(v1,v2,1.0, dummy, 0.0, col_kernel); //m  = v1*v2;
   
-  c_type constant = neg_i*two_pi/static_cast<float>(input.cols*upscale);
+  c_type constant = neg_i*two_pi/static_cast<float>(input_cols*upscale);
   for (int i=0; i<col_kernel.rows; ++i)
     for (int j=0; j<col_kernel.cols; ++j)
       col_kernel.at<c_type>(i,j) = std::exp(col_kernel.at<c_type>(i,j)*constant);
+  return col_kernel;
+}
+
+/// Build the matrix which upsamples the rows of a DFT in partial_upsample_dft().
+inline
+cv::Mat upsample_dft_row_kernel(int input_rows, int upsampled_height, int upscale, int row_offset) {
 
-  temp_vec = fftshift(row_vector, true);
-  v1 = row_up_vector.t() - row_offset;
-  v2 = temp_vec - floor(input.rows/2);
+  const int COMPLEX_TYPE_CV = CV_32FC2;
+  typedef std::complex<float> c_type;
+
+  cv::Mat row_vector   (1, input_rows,       COMPLEX_TYPE_CV);
+  cv::Mat row_up_vector(1, upsampled_height, COMPLEX_TYPE_CV);
+  for (int i=0; i<input_rows; ++i)
+    row_vector.at<c_type>(0,i) = static_cast<c_type>(i);
+  for (int i=0; i<upsampled_height; ++i)
+    row_up_vector.at<c_type>(0,i) = static_cast<c_type>(i);
+
+  const c_type neg_i(0, -1);
+  float two_pi = 2.0*M_PI;
+
+  cv::Mat row_kernel;
+  cv::Mat temp_vec = fftshift(row_vector, true);
+  cv::Mat v1 = row_up_vector.t() - row_offset;
+  cv::Mat v2 = temp_vec - floor(input_rows/2);
   
+  cv::Mat dummy;
   cv::gemm(v1,v2,1.0, dummy, 0.0, row_kernel); //m  = v1*v2;
   
-  constant = neg_i*two_pi/static_cast<float>(input.rows*upscale);
+  c_type constant = neg_i*two_pi/static_cast<float>(input_rows*upscale);
   for (int i=0; i<row_kernel.rows; ++i)
     for (int j=0; j<row_kernel.cols; ++j)
       row_kernel.at<c_type>(i,j) = std::exp(row_kernel.at<c_type>(i,j)*constant);
+  return row_kernel;
+}
+
+/// Use matrix multiplication to upsample a DFT in only a small region.
+///  It is usually faster than doing the equivalent series of steps:
+///   1) pad_fourier_transform(input, input.rows()*upscale, input.cols()*upscale)
+///      dimension. fftshift(inverse) to bring the center of the image to (0,0).
+///   2) dft(upsampled_image)
+///   3) crop(dft_result, col_offset, row_offset, upsampled_width, upsampled_height)
+inline
+cv::Mat partial_upsample_dft(cv::Mat const& input, int upsampled_height, int upsampled_width, 
+                             int upscale, int row_offset=0, int col_offset=0) {
 
-  //save_mag_from_ft(row_kernel,  "/home/smcmich1/data/subpixel/row_kernel.tif", false);
-  //save_mag_from_ft(col_kernel,  "/home/smcmich1/data/subpixel/col_kernel.tif", false);
+  cv::Mat col_kernel = upsample_dft_col_kernel(input.cols, upsampled_width,  upscale, col_offset);
+  cv::Mat row_kernel = upsample_dft_row_kernel(input.rows, upsampled_height, upscale, row_offset);
 
   // These muliplications are the slowest part of the phase correlation method.
   cv::Mat o1  = row_kernel*input;
   cv::Mat out = o1*col_kernel;
 
-  //cv::Mat temp = complex_multiply(row_kernel, input);
-  //cv::Mat out  = complex_multiply(temp, col_kernel);
-
   return out;
 }
 
+/// Phase correlation of many windows of the same size, as done by subpixel_phase_2d().
+/// - The DFT buffers are reused from one window to the next and the upsampling
+///   kernels are only built once for each accuracy and peak location.
+/// - The left window is transformed once in set_left() and can be matched against
+///   several right windows.
+/// - Not thread safe, each thread should have its own instance.
+class PhaseSubpixelCorrelator {
+public:
+
+  /// Load the left window, it is used by find_offset() until the next call.
+  template <class ViewT>
+  void set_left(ImageViewBase<ViewT> const& left_image) {
+    load_dft(left_image, m_left_dft);
+  }
+
+  /// Compute the subpixel translation from the left window to right_image,
+  ///  which must be the same size.
+  /// - Maximum accuracy is 1/subpixel_accuracy
+  template <class ViewT>
+  void find_offset(ImageViewBase<ViewT> const& right_image, Vector2f &offset,
+                   int subpixel_accuracy=10, bool debug=false) {
+    if (right_image.impl().cols() != m_left_dft.cols ||
+        right_image.impl().rows() != m_left_dft.rows)
+      vw_throw( ArgumentErr() << "phase_correlation_subpixel requires images to be the same size!\n" );
+    load_dft(right_image, m_right_dft);
+    compute_offset(offset, subpixel_accuracy, debug);
+  }
+
+private:
+
+  /// The kernels are keyed on the input and upsampled sizes, then upscale and offset.
+  typedef std::pair<std::pair<int,int>, std::pair<int,int> > KernelKey;
+  typedef std::map<KernelKey, cv::Mat> KernelMap;
+
+  ImageView<float> m_window;  ///< Float copy of the window being transformed
+  cv::Mat m_left_dft, m_right_dft, m_conj, m_padded_conj, m_conv;
+  cv::Mat m_partial, m_partial_upsampled, m_magnitude;
+  KernelMap m_row_kernels, m_col_kernels;
+
+  /// Fourier transform of a window, in the same format as get_dft().
+  template <class ViewT>
+  void load_dft(ImageViewBase<ViewT> const& image, cv::Mat &dft) {
+    m_window = pixel_cast<float>(image.impl());
+    cv::Mat wrapper(m_window.rows(), m_window.cols(), CV_32F, m_window.data());
+    cv::dft(wrapper, dft, cv::DFT_COMPLEX_OUTPUT);
+  }
+
+  /// Return the cached upsampling kernel, building it on first use.
+  cv::Mat const& upsample_kernel(KernelMap &kernels, bool row_kernel, int input_size,
+                                 int upsampled_size, int upscale, int offset) {
+    cv::Mat &kernel = kernels[std::make_pair(std::make_pair(input_size, upsampled_size),
+                                             std::make_pair(upscale,    offset))];
+    if (kernel.empty())
+      kernel = row_kernel ? upsample_dft_row_kernel(input_size, upsampled_size, upscale, offset)
+                          : upsample_dft_col_kernel(input_size, upsampled_size, upscale, offset);
+    return kernel;
+  }
+
+  /// Same as pad_fourier_transform() to twice the size, writing into m_padded_conj.
+  /// - The padding area is only cleared when the buffer is allocated.
+  void pad_conj_by_two() {
+    const int rows = m_conj.rows, cols = m_conj.cols;
+    const int padded_rows = 2*rows, padded_cols = 2*cols;
+    if (m_padded_conj.rows != padded_rows || m_padded_conj.cols != padded_cols)
+      m_padded_conj = cv::Mat::zeros(padded_rows, padded_cols, m_conj.type());
+
+    // The non-negative frequencies stay where they are and the negative ones
+    //  move to the far end of the larger transform.
+    const int pos_rows = (rows+1)/2, neg_rows = rows - pos_rows;
+    const int pos_cols = (cols+1)/2, neg_cols = cols - pos_cols;
+    const double scale = 4.0;
+    const cv::Rect src[4] = { cv::Rect(0,        0,        pos_cols, pos_rows),
+                              cv::Rect(pos_cols, 0,        neg_cols, pos_rows),
+                              cv::Rect(0,        pos_rows, pos_cols, neg_rows),
+                              cv::Rect(pos_cols, pos_rows, neg_cols, neg_rows) };
+    const cv::Rect dst[4] = { cv::Rect(0,                    0,                    pos_cols, pos_rows),
+                              cv::Rect(padded_cols-neg_cols, 0,                    neg_cols, pos_rows),
+                              cv::Rect(0,                    padded_rows-neg_rows, pos_cols, neg_rows),
+                              cv::Rect(padded_cols-neg_cols, padded_rows-neg_rows, neg_cols, neg_rows) };
+    for (int i=0; i<4; ++i) {
+      if (src[i].area() == 0)
+        continue;
+      cv::Mat out_ref(m_padded_conj, dst[i]);
+      m_conj(src[i]).convertTo(out_ref, -1, scale);
+    }
+  }
+
+  /// The two pass search of phase_correlation_subpixel() on the loaded transforms.
+  void compute_offset(Vector2f &offset, int subpixel_accuracy, bool debug) {
+
+    // The first pass will try to find the best shift location at a low resolution, 
+    // then the second pass will try to refine the result nearby that location.
+    // By doing this we avoid doing full resolution computations over the entire image.
+
+    // Compute convolution of the two images.
+    cv::mulSpectrums(m_left_dft, m_right_dft, m_conj, 0, true);
+
+    // Pad the results to we get higher DFT accuracy.
+    int pad_factor = subpixel_accuracy; // Controls maximum subpixel accuracy.
+
+    const int INITIAL_PAD_FACTOR = 2;
+    pad_conj_by_two();
+
+    // Inverse FFT to get back to image coordinates.
+    cv::dft(m_padded_conj, m_conv, cv::DFT_INVERSE + cv::DFT_REAL_OUTPUT+ cv::DFT_SCALE, 0);
+
+    // Find the peak.
+    int width  = m_conv.cols;
+    int height = m_conv.rows;
+    double maxVal;
+    cv::Point maxLoc;
+    cv::minMaxLoc(m_conv, NULL, &maxVal, NULL, &maxLoc);
+
+    // Convert peak location back to the input pixel coordinates.
+    float initial_shift_x = (maxLoc.x<width /2) ? (maxLoc.x) : (maxLoc.x-width );
+    float initial_shift_y = (maxLoc.y<height/2) ? (maxLoc.y) : (maxLoc.y-height);
+    initial_shift_x /= static_cast<float>(INITIAL_PAD_FACTOR);
+    initial_shift_y /= static_cast<float>(INITIAL_PAD_FACTOR);
+
+    if (debug) {
+      std::cout << "padded_conj.size() = " << m_padded_conj.size() << std::endl;    
+      std::cout << "maxLoc = " << maxLoc << std::endl;
+      std::cout << "initial_shift_x = " << initial_shift_x << std::endl;
+      std::cout << "initial_shift_y = " << initial_shift_y << std::endl;
+    }
+
+    // End of the first pass, stop here if the output resolution is low.
+    if (pad_factor <= 2) {
+      offset[0] = initial_shift_x;
+      offset[1] = initial_shift_y;
+      return;
+    }
+
+    // No do a second pass to improve the answer resolution.
+
+    // The size of the region (in units of input pixels) around the low-resolution
+    // peak where we will search for the high resolution peak.
+    const float UPSAMPLE_REGION_FACTOR = 1.5;
+
+    // Compute the location of interest to be upsampled.
+    float shift_x = round(initial_shift_x*pad_factor)/pad_factor; 
+    float shift_y = round(initial_shift_y*pad_factor)/pad_factor; 
+    float dft_shift = floor(ceil(pad_factor*UPSAMPLE_REGION_FACTOR)/2); //% Center of output array at dftshift+1
+
+    // Use the matrix multiply trick to upsample the region of interest.
+    int upsampled_height = ceil(pad_factor*UPSAMPLE_REGION_FACTOR);
+    int upsampled_width  = ceil(pad_factor*UPSAMPLE_REGION_FACTOR);
+    int row_offset = dft_shift-shift_y*pad_factor;
+    int col_offset = dft_shift-shift_x*pad_factor;
+    cv::mulSpectrums(m_right_dft, m_left_dft, m_conj, 0, true); // Left/Right order is reversed here.
+    cv::Mat const& row_kernel = upsample_kernel(m_row_kernels, true,  m_conj.rows,
+                                                upsampled_height, pad_factor, row_offset);
+    cv::Mat const& col_kernel = upsample_kernel(m_col_kernels, false, m_conj.cols,
+                                                upsampled_width,  pad_factor, col_offset);
+    cv::gemm(row_kernel, m_conj, 1.0, cv::noArray(), 0.0, m_partial);
+    cv::gemm(m_partial, col_kernel, 1.0, cv::noArray(), 0.0, m_partial_upsampled);
+
+    // Find the peak
+    get_magnitude(m_partial_upsampled, m_magnitude);
+    cv::minMaxLoc(m_magnitude, NULL, &maxVal, NULL, &maxLoc);
+
+    // Convert result into the final offset value
+    maxLoc.y = maxLoc.y - dft_shift;
+    maxLoc.x = maxLoc.x - dft_shift;
+    shift_y = shift_y + static_cast<float>(maxLoc.y)/static_cast<float>(pad_factor);
+    shift_x = shift_x + static_cast<float>(maxLoc.x)/static_cast<float>(pad_factor);
+
+    offset[0] = shift_x;
+    offset[1] = shift_y;
+
+    if (debug) {
+      std::cout << "partial_upsampled.size() = " << m_partial_upsampled.size() << std::endl;
+      std::cout << "maxLoc = " << maxLoc << std::endl;
+      std::cout << "shift_x = " << shift_x << std::endl;
+      std::cout << "shift_y = " << shift_y << std::endl;
+    }
+  }
+}; // End class PhaseSubpixelCorrelator
+
 /// Compute the subpixel translation between two images using a two-pass frequency based method.
 /// - The images must be the same size!
 /// - Maximum accuracy is 1/subpixel_accuracy
+/// - When matching many windows use PhaseSubpixelCorrelator directly so that
+///   the buffers and kernels are reused.
 template <class T1, class T2>
 void phase_correlation_subpixel(ImageViewBase<T1> const& left_image,
                                 ImageViewBase<T2> const& right_image,
@@ -127,123 +329,11 @@ void phase_correlation_subpixel(ImageViewBase<T1> const& left_image,
     vw_throw( ArgumentErr() << "phase_correlation_subpixel requires images to be the same size!\n" );
   }
 
-  // Fourier transform of the input images.
-  // TODO: Use padding for an optimal DFT size?
-  cv::Mat complexI_left, complexI_right;
-  get_dft(left_image,  complexI_left);
-  get_dft(right_image, complexI_right);
-
   // Some papers suggest filtering out high frequency image content prior to correlation
-  //  but that does not seem to help in all cases.
-  //const float BETA = 0.35;
-  ////save_mag_from_ft(complexI_left,  "/home/smcmich1/data/subpixel/magI_left_prefilter.tif");
-  ////save_mag_from_ft(complexI_right,  "/home/smcmich1/data/subpixel/magI_right_prefilter.tif");
-  //apply_raised_cosine_filter(complexI_left,  BETA);
-  //apply_raised_cosine_filter(complexI_right, BETA);
-  
-  // The first pass will try to find the best shift location at a low resolution, 
-  // then the second pass will try to refine the result nearby that location.
-  // By doing this we avoid doing full resolution computations over the entire image.
-
-  // Compute convolution of the two images.
-  cv::Mat initial_conj;
-  cv::mulSpectrums(complexI_left, complexI_right, initial_conj, 0, true);
-
-  // Pad the results to we get higher DFT accuracy.
-  int pad_factor = subpixel_accuracy; // Controls maximum subpixel accuracy.
-
-  const int INITIAL_PAD_FACTOR = 2;
-  int padded_width  = INITIAL_PAD_FACTOR*initial_conj.cols;
-  int padded_height = INITIAL_PAD_FACTOR*initial_conj.rows;
-  cv::Mat padded_conj = pad_fourier_transform(initial_conj, padded_width, padded_height);
-
-  // Inverse FFT to get back to image coordinates.
-  cv::Mat conv;
-  cv::dft(padded_conj, conv, cv::DFT_INVERSE + cv::DFT_REAL_OUTPUT+ cv::DFT_SCALE, 0);
-
-  // Find the peak.
-  int width  = conv.cols;
-  int height = conv.rows;
-  double maxVal;
-  cv::Point maxLoc;
-  cv::minMaxLoc(conv, NULL, &maxVal, NULL, &maxLoc);
-
-  // Convert peak location back to the input pixel coordinates.
-  float initial_shift_x = (maxLoc.x<width /2) ? (maxLoc.x) : (maxLoc.x-width );
-  float initial_shift_y = (maxLoc.y<height/2) ? (maxLoc.y) : (maxLoc.y-height);
-  initial_shift_x /= static_cast<float>(INITIAL_PAD_FACTOR);
-  initial_shift_y /= static_cast<float>(INITIAL_PAD_FACTOR);
-
-  if (debug) {
-
-    std::cout << "padded_conj.size() = " << padded_conj.size() << std::endl;    
-    std::cout << "maxLoc = " << maxLoc << std::endl;
-    std::cout << "initial_shift_x = " << initial_shift_x << std::endl;
-    std::cout << "initial_shift_y = " << initial_shift_y << std::endl;
-
-    save_mag_from_ft(complexI_left,  "/home/smcmich1/data/subpixel/magI_left.tif");
-    save_mag_from_ft(complexI_right, "/home/smcmich1/data/subpixel/magI_right.tif");
-    save_mag_from_ft(initial_conj, "/home/smcmich1/data/subpixel/initial_conj.tif");
-    save_mag_from_ft(padded_conj, "/home/smcmich1/data/subpixel/padded_conj.tif");
-
-    boost::shared_ptr<cv::Mat> ocv_ptr(&conv, boost::null_deleter());
-    ImageResourceView<float> ocv_view(new ImageResourceOpenCV(ocv_ptr));
-    write_image( "/home/smcmich1/data/subpixel/conv.tif", ocv_view);
-  }
-
-  // End of the first pass, stop here if the output resolution is low.
-  if (pad_factor <= 2) {
-    offset[0] = initial_shift_x;
-    offset[1] = initial_shift_y;
-    return;
-  }
-
-  // No do a second pass to improve the answer resolution.
-
-  // The size of the region (in units of input pixels) around the low-resolution
-  // peak where we will search for the high resolution peak.
-  const float UPSAMPLE_REGION_FACTOR = 1.5;
-
-  // Compute the location of interest to be upsampled.
-  float shift_x = round(initial_shift_x*pad_factor)/pad_factor; 
-  float shift_y = round(initial_shift_y*pad_factor)/pad_factor; 
-  float dft_shift = floor(ceil(pad_factor*UPSAMPLE_REGION_FACTOR)/2); //% Center of output array at dftshift+1
-
-  // Use the matrix multiply trick to upsample the region of interest.
-  int upsampled_height = ceil(pad_factor*UPSAMPLE_REGION_FACTOR);
-  int upsampled_width  = ceil(pad_factor*UPSAMPLE_REGION_FACTOR);
-  cv::Mat new_conj;
-  cv::mulSpectrums(complexI_right, complexI_left, new_conj, 0, true); // Left/Right order is reversed here.
-  cv::Mat partial_upsampled = partial_upsample_dft(new_conj, 
-                                                   upsampled_height,
-                                                   upsampled_width,
-                                                   pad_factor,
-                                                   dft_shift-shift_y*pad_factor,
-                                                   dft_shift-shift_x*pad_factor);
-
-  // Find the peak
-  cv::Mat CC;
-  get_magnitude(partial_upsampled, CC);
-  cv::minMaxLoc(CC, NULL, &maxVal, NULL, &maxLoc); // TODO: magnitude(conv)??
-
-  // Convert result into the final offset value
-  maxLoc.y = maxLoc.y - dft_shift;
-  maxLoc.x = maxLoc.x - dft_shift;
-  shift_y = shift_y + static_cast<float>(maxLoc.y)/static_cast<float>(pad_factor);
-  shift_x = shift_x + static_cast<float>(maxLoc.x)/static_cast<float>(pad_factor);
-
-  offset[0] = shift_x;
-  offset[1] = shift_y;
-
-  if (debug) {
-    std::cout << "partial_upsampled.size() = " << partial_upsampled.size() << std::endl;
-    std::cout << "CC.type = " << CC.type() << std::endl;
-    std::cout << "maxLoc = " << maxLoc << std::endl;
-    std::cout << "shift_x = " << shift_x << std::endl;
-    std::cout << "shift_y = " << shift_y << std::endl;
-
-    save_mag_from_ft(partial_upsampled, "/home/smcmich1/data/subpixel/partial_upsampled.tif", false);
-  }
+  //  but that does not seem to help in all cases, see apply_raised_cosine_filter().
+  PhaseSubpixelCorrelator correlator;
+  correlator.set_left(left_image);
+  correlator.find_offset(right_image, offset, subpixel_accuracy, debug);
 }
 
 
@@ -252,6 +342,8 @@ void phase_correlation_subpixel(ImageViewBase<T1> const& left_image,
 /// Update the values in disparity_map according to region_of_interest.
 /// - This function is set up to work with the PyramidSubpixelView class.
 /// - use_second_refinement improves results by repeating the computation.
+/// - Each call uses one PhaseSubpixelCorrelator for all of its pixels, so
+///   tiles processed in separate threads don't share any buffers.
 template<class ChannelT> void
 subpixel_phase_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
                   ImageView<ChannelT> const& left_image,
@@ -266,9 +358,9 @@ subpixel_phase_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
              ArgumentErr() << "subpixel_correlation: left image and "
                             << "disparity map do not have the same dimensions.");
 
-  // Interpolated right image in case we go out of bounds.
-  InterpolationView<EdgeExtensionView<ImageView<ChannelT>, ZeroEdgeExtension>, BilinearInterpolation> right_interp_image =
-         interpolate(right_image, BilinearInterpolation(), ZeroEdgeExtension());
+  // Right image windows are at integer offsets, zero extended in case we go out of bounds.
+  EdgeExtensionView<ImageView<ChannelT>, ZeroEdgeExtension> right_extended_image =
+         edge_extend(right_image, ZeroEdgeExtension());
 
   // This is the maximum number of pixels that the solution can be
   // adjusted by subpixel refinement.
@@ -278,6 +370,12 @@ subpixel_phase_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
   const int32 kern_half_height    = kern_height/2;
   const int32 kern_half_width     = kern_width /2;
 
+  int initial_subpixel_accuracy = subpixel_accuracy;
+  if (use_second_refinement) // The first pass can be lower resolution.
+    initial_subpixel_accuracy /= 2;
+
+  PhaseSubpixelCorrelator correlator;
+
   // Iterate over all of the pixels in the disparity map except for the outer edges.
   for ( int32 y = std::max(region_of_interest.min().y()-1,kern_half_height);
               y < std::min(left_image.rows()-kern_half_height,
@@ -300,38 +398,24 @@ subpixel_phase_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
                             kern_width, kern_height);
       BBox2i right_window = current_window + Vector2i(disparity_map(x,y)[0], disparity_map(x,y)[1]);
 
-      // Compute the image patches
-      ImageView<ChannelT> left_image_patch  = crop(left_image,         current_window);
-      ImageView<ChannelT> right_image_patch = crop(right_interp_image, right_window);
-
-      //write_image("/home/smcmich1/data/subpixel/left_patch.tif",  left_image_patch );
-      //write_image("/home/smcmich1/data/subpixel/right_patch.tif", right_image_patch);
-
       // We are just solving for a simple translation vector
       Vector2f d;
-      bool debug = false;
-      int initial_subpixel_accuracy = subpixel_accuracy;
-      if (use_second_refinement) // The first pass can be lower resolution.
-        initial_subpixel_accuracy /= 2;
-      phase_correlation_subpixel(left_image_patch, right_image_patch,
-                                 d, initial_subpixel_accuracy, debug);
+      correlator.set_left(crop(left_image, current_window));
+      correlator.find_offset(crop(right_extended_image, right_window),
+                             d, initial_subpixel_accuracy);
 
       if (use_second_refinement) {
         // Shift the right crop by the computed offset, then re-run
         // phase correlation to get a final offset.
         // - This improves the results at the cost of taking twice as long.
-
-        ImageView<ChannelT> shift_right_crop = crop(translate( right_image,
-                                                              d[0], d[1],
-                                                              ZeroEdgeExtension(),
-                                                              BicubicInterpolation()),
-                                                    right_window
-                                                  );
-        //write_image("/home/smcmich1/data/subpixel/right_patch_refined.tif", shift_right_crop);
-
+        // - The left window transform is reused.
         Vector2f d2(0,0);
-        phase_correlation_subpixel(left_image_patch, shift_right_crop,
-                                  d2, subpixel_accuracy, debug);
+        correlator.find_offset(crop(translate( right_image,
+                                               d[0], d[1],
+                                               ZeroEdgeExtension(),
+                                               BicubicInterpolation()),
+                                    right_window),
+                               d2, subpixel_accuracy);
         d += d2; // The second translation adds to the first one.
       }
 
@@ -342,7 +426,6 @@ subpixel_phase_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
       else
         remove_mask(disparity_map(x,y)) -= d; // TODO: Why is this subtracted?
 
-      //vw_throw( NoImplErr() << "DEBUG!!!!" );
     } // X increment
   } // Y increment
 
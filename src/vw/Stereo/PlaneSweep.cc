@@ -0,0 +1,343 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <vw/Core/Exception.h>
+#include <vw/Camera/CameraModel.h>
+#include <vw/Stereo/PlaneSweep.h>
+
+namespace vw {
+namespace stereo {
+
+namespace {
+
+  /// Bilinear interpolation of a uint8 image, returning false outside of it.
+  inline bool sample_bilinear(ImageView<uint8> const& image, float x, float y, float &value) {
+    if (!(x >= 0 && y >= 0 && x <= image.cols()-1 && y <= image.rows()-1))
+      return false;
+    const int32 x0 = std::min(int32(x), image.cols()-2);
+    const int32 y0 = std::min(int32(y), image.rows()-2);
+    const float fx = x - x0, fy = y - y0;
+    const uint8* p = &image(x0, y0);
+    const ptrdiff_t stride = image.cols();
+    const float top    = p[0     ] + fx*(float(p[       1]) - float(p[0     ]));
+    const float bottom = p[stride] + fx*(float(p[stride+1]) - float(p[stride]));
+    value = top + fy*(bottom - top);
+    return true;
+  }
+
+  /// Pixel coordinates of the projection grid nodes along one axis.
+  inline int32 grid_node(int32 i, int32 spacing, int32 size) {
+    return std::min(i*spacing, size-1);
+  }
+
+  /// Pick the best plane of each pixel from a cost volume, with a parabola
+  /// fit through the neighboring planes for a fractional plane index.
+  template <class T>
+  void select_planes(std::vector<T> const& volume, ImageView<uint8> const& has_data,
+                     int32 num_planes, PlaneSweepStereo const& sweep,
+                     ImageView<PixelMask<float> > &depth) {
+    const int32 cols = has_data.cols(), rows = has_data.rows();
+    depth.set_size(cols, rows);
+    for (int32 r=0; r<rows; ++r) {
+      for (int32 c=0; c<cols; ++c) {
+        if (!has_data(c,r)) {
+          depth(c,r) = PixelMask<float>(); // Invalid
+          continue;
+        }
+        const T* cost = &volume[(size_t(r)*cols + c)*num_planes];
+        const int32 best = int32(std::min_element(cost, cost+num_planes) - cost);
+        double plane = best;
+        if ((best > 0) && (best < num_planes-1)) {
+          const double lo = cost[best-1], mid = cost[best], hi = cost[best+1];
+          const double curvature = lo - 2*mid + hi;
+          if (curvature > 0)
+            plane += 0.5*(lo - hi)/curvature;
+        }
+        depth(c,r) = PixelMask<float>(float(sweep.plane_depth(plane)));
+      }
+    }
+  }
+
+} // end anonymous namespace
+
+
+PlaneSweepStereo::PlaneSweepStereo(std::vector<const camera::CameraModel *> const& cameras,
+                                   double min_depth, double max_depth, int32 num_planes,
+                                   int32 kernel_size, AggregationType aggregation,
+                                   uint16 p1, uint16 p2, int32 grid_spacing)
+  : m_cameras(cameras), m_min_depth(min_depth), m_max_depth(max_depth),
+    m_num_planes(num_planes), m_kernel_size(kernel_size), m_grid_spacing(grid_spacing),
+    m_aggregation(aggregation), m_p1(p1), m_p2(p2) {
+
+  // Default penalties are in units of mean absolute intensity difference.
+  if (m_p1 == 0) m_p1 = 8;
+  if (m_p2 == 0) m_p2 = std::max(uint16(32), m_p1);
+
+  VW_ASSERT(m_cameras.size() >= 2,
+            ArgumentErr() << "PlaneSweepStereo: At least two cameras are required.");
+  VW_ASSERT((min_depth > 0) && (min_depth < max_depth),
+            ArgumentErr() << "PlaneSweepStereo: Invalid depth range " << min_depth
+                          << " to " << max_depth << ".");
+  VW_ASSERT(num_planes >= 2,
+            ArgumentErr() << "PlaneSweepStereo: At least two planes are required.");
+  VW_ASSERT((kernel_size > 0) && (kernel_size % 2 == 1),
+            ArgumentErr() << "PlaneSweepStereo: Kernel size must be odd.");
+  VW_ASSERT(grid_spacing > 0,
+            ArgumentErr() << "PlaneSweepStereo: Grid spacing must be positive.");
+  // The sum of the eight path costs must fit in AccumCostType.
+  VW_ASSERT((m_p1 <= m_p2) && (8*(255 + int32(m_p2)) <= int32(std::numeric_limits<AccumCostType>::max())),
+            ArgumentErr() << "PlaneSweepStereo: Invalid SGM penalties " << m_p1 << ", " << m_p2 << ".");
+}
+
+
+double PlaneSweepStereo::plane_depth(double plane) const {
+  const double near_inv = 1.0 / m_min_depth;
+  const double far_inv  = 1.0 / m_max_depth;
+  return 1.0 / (near_inv + (far_inv - near_inv) * plane / (m_num_planes-1));
+}
+
+
+void PlaneSweepStereo::compute_costs(std::vector<ImageView<uint8> > const& images,
+                                     std::vector<CostType> &costs, ImageView<uint8> &has_data) const {
+  VW_ASSERT(images.size() == m_cameras.size(),
+            ArgumentErr() << "PlaneSweepStereo: Got " << images.size() << " images for "
+                          << m_cameras.size() << " cameras.");
+  for (size_t i=0; i<images.size(); ++i)
+    VW_ASSERT((images[i].cols() >= 2) && (images[i].rows() >= 2),
+              ArgumentErr() << "PlaneSweepStereo: Image " << i << " is too small.");
+
+  ImageView<uint8> const& ref = images[0];
+  const int32 cols = ref.cols(), rows = ref.rows();
+  const int32 num_views = int32(images.size());
+  const int32 spacing = m_grid_spacing;
+  const int32 grid_cols = (cols-1 + spacing-1)/spacing + 1;
+  const int32 grid_rows = (rows-1 + spacing-1)/spacing + 1;
+  const size_t num_pixels = size_t(cols)*size_t(rows);
+  const size_t num_nodes  = size_t(grid_cols)*size_t(grid_rows);
+
+  costs.resize(num_pixels*m_num_planes);
+  has_data.set_size(cols, rows);
+  std::fill(has_data.data(), has_data.data()+num_pixels, uint8(0));
+
+  // Reference rays at the grid nodes.
+  std::vector<Vector3> node_centers(num_nodes), node_dirs(num_nodes);
+  std::vector<uint8>   node_has_ray(num_nodes, 1);
+  for (int32 j=0; j<grid_rows; ++j) {
+    for (int32 i=0; i<grid_cols; ++i) {
+      const size_t n = size_t(j)*grid_cols + i;
+      const Vector2 pix(grid_node(i, spacing, cols), grid_node(j, spacing, rows));
+      try {
+        node_centers[n] = m_cameras[0]->camera_center  (pix);
+        node_dirs   [n] = m_cameras[0]->pixel_to_vector(pix);
+      } catch (const camera::PixelToRayErr& /*e*/) {
+        node_has_ray[n] = 0;
+      }
+    }
+  }
+
+  // Workspace for one plane.
+  std::vector<float>  node_x(num_nodes), node_y(num_nodes);
+  std::vector<uint8>  node_ok(num_nodes);
+  std::vector<float>  row_x(grid_cols), row_y(grid_cols);
+  std::vector<uint8>  row_ok(grid_cols);
+  std::vector<uint32> ad_sum(num_pixels);
+  std::vector<uint16> view_count(num_pixels);
+  std::vector<uint32> integral(size_t(cols+1)*size_t(rows+1));
+  const int32 half_kernel = m_kernel_size/2;
+
+  for (int32 plane=0; plane<m_num_planes; ++plane) {
+    const double depth = plane_depth(plane);
+    std::fill(ad_sum.begin(),     ad_sum.end(),     0u);
+    std::fill(view_count.begin(), view_count.end(), uint16(0));
+
+    for (int32 view=1; view<num_views; ++view) {
+      ImageView<uint8> const& image = images[view];
+
+      // Project the plane at the grid nodes.
+      for (size_t n=0; n<num_nodes; ++n) {
+        node_ok[n] = 0;
+        if (!node_has_ray[n])
+          continue;
+        try {
+          const Vector2 pix = m_cameras[view]->point_to_pixel(node_centers[n] + depth*node_dirs[n]);
+          node_x[n]  = float(pix[0]);
+          node_y[n]  = float(pix[1]);
+          node_ok[n] = (pix[0] == pix[0]) && (pix[1] == pix[1]); // Reject NaN
+        } catch (const camera::PointToPixelErr& /*e*/) {}
+      }
+
+      // Interpolate the projections to every pixel and add up the differences.
+      for (int32 r=0; r<rows; ++r) {
+        const int32  j  = std::min(r/spacing, grid_rows-2);
+        const int32  y0 = grid_node(j, spacing, rows), y1 = grid_node(j+1, spacing, rows);
+        const float  ty = float(r - y0)/float(y1 - y0);
+        const size_t n0 = size_t(j)*grid_cols, n1 = n0 + grid_cols;
+        for (int32 i=0; i<grid_cols; ++i) {
+          row_ok[i] = node_ok[n0+i] && node_ok[n1+i];
+          row_x [i] = node_x[n0+i] + ty*(node_x[n1+i] - node_x[n0+i]);
+          row_y [i] = node_y[n0+i] + ty*(node_y[n1+i] - node_y[n0+i]);
+        }
+
+        const uint8* ref_row  = &ref(0, r);
+        uint32*      sum_row   = &ad_sum    [size_t(r)*cols];
+        uint16*      count_row = &view_count[size_t(r)*cols];
+        for (int32 i=0; i+1<grid_cols; ++i) {
+          if (!row_ok[i] || !row_ok[i+1])
+            continue;
+          const int32 x0 = grid_node(i, spacing, cols), x1 = grid_node(i+1, spacing, cols);
+          const int32 x_end = (i+2 == grid_cols) ? x1+1 : x1; // The last cell includes its end
+          const float dx = (row_x[i+1] - row_x[i])/float(x1 - x0);
+          const float dy = (row_y[i+1] - row_y[i])/float(x1 - x0);
+          for (int32 c=x0; c<x_end; ++c) {
+            float value;
+            if (!sample_bilinear(image, row_x[i] + dx*(c-x0), row_y[i] + dy*(c-x0), value))
+              continue;
+            sum_row  [c] += uint32(std::fabs(value - float(ref_row[c])) + 0.5f);
+            count_row[c] += 1;
+          }
+        }
+      }
+    } // End view loop
+
+    // The plane cost is the mean difference over the views with data, or the
+    // maximum cost if there are none.  Box filter it with an integral image.
+    for (int32 r=0; r<rows; ++r) {
+      uint32 row_sum = 0;
+      uint32* out      = &integral[size_t(r+1)*(cols+1)];
+      uint32* out_prev = &integral[size_t(r  )*(cols+1)];
+      for (int32 c=0; c<cols; ++c) {
+        const size_t k = size_t(r)*cols + c;
+        uint32 cost = std::numeric_limits<CostType>::max();
+        if (view_count[k] > 0) {
+          cost = (ad_sum[k] + view_count[k]/2) / view_count[k];
+          has_data(c,r) = 1;
+        }
+        row_sum += cost;
+        out[c+1] = out_prev[c+1] + row_sum;
+      }
+    }
+    for (int32 r=0; r<rows; ++r) {
+      const int32 r0 = std::max(r-half_kernel, 0), r1 = std::min(r+half_kernel+1, rows);
+      const uint32* top    = &integral[size_t(r0)*(cols+1)];
+      const uint32* bottom = &integral[size_t(r1)*(cols+1)];
+      for (int32 c=0; c<cols; ++c) {
+        const int32  c0 = std::max(c-half_kernel, 0), c1 = std::min(c+half_kernel+1, cols);
+        const uint32 area = uint32((r1-r0)*(c1-c0));
+        const uint32 sum  = bottom[c1] - bottom[c0] - top[c1] + top[c0];
+        costs[(size_t(r)*cols + c)*m_num_planes + plane] = CostType((sum + area/2)/area);
+      }
+    }
+  } // End plane loop
+}
+
+
+void PlaneSweepStereo::accumulate_path(std::vector<CostType> const& costs, int32 cols, int32 rows,
+                                       int32 dx, int32 dy, std::vector<AccumCostType> &accum) const {
+  const int32  num_planes = m_num_planes;
+  const uint32 p1 = m_p1, p2 = m_p2;
+
+  // Path costs of the current and previous rows, in the order they are visited.
+  std::vector<AccumCostType> prev(size_t(cols)*num_planes), curr(size_t(cols)*num_planes);
+  std::vector<AccumCostType> prev_min(cols), curr_min(cols);
+
+  const int32 row_start = (dy >= 0) ? 0 : rows-1, row_step = (dy >= 0) ? 1 : -1;
+  const int32 col_start = (dx >= 0) ? 0 : cols-1, col_step = (dx >= 0) ? 1 : -1;
+  for (int32 n=0, r=row_start; n<rows; ++n, r+=row_step) {
+    for (int32 m=0, c=col_start; m<cols; ++m, c+=col_step) {
+      const CostType* cost = &costs[(size_t(r)*cols + c)*num_planes];
+      AccumCostType*  path = &curr[size_t(c)*num_planes];
+      AccumCostType*  sum  = &accum[(size_t(r)*cols + c)*num_planes];
+
+      // The path starts at the image edge with just the local cost.
+      const int32 pc = c - dx, pr = r - dy;
+      if ((pc < 0) || (pc >= cols) || (pr < 0) || (pr >= rows)) {
+        AccumCostType best = std::numeric_limits<AccumCostType>::max();
+        for (int32 d=0; d<num_planes; ++d) {
+          path[d] = cost[d];
+          sum [d] += path[d];
+          best = std::min(best, path[d]);
+        }
+        curr_min[c] = best;
+        continue;
+      }
+
+      const AccumCostType* prior = (dy == 0) ? &curr[size_t(pc)*num_planes] : &prev[size_t(pc)*num_planes];
+      const uint32 prior_min = (dy == 0) ? curr_min[pc] : prev_min[pc];
+      const uint32 jump = prior_min + p2;
+      AccumCostType best = std::numeric_limits<AccumCostType>::max();
+      for (int32 d=0; d<num_planes; ++d) {
+        uint32 v = prior[d];
+        if (d > 0)            v = std::min(v, prior[d-1] + p1);
+        if (d < num_planes-1) v = std::min(v, prior[d+1] + p1);
+        v = std::min(v, jump);
+        path[d] = AccumCostType(cost[d] + v - prior_min);
+        sum [d] += path[d];
+        best = std::min(best, path[d]);
+      }
+      curr_min[c] = best;
+    } // End col loop
+    prev.swap(curr);
+    prev_min.swap(curr_min);
+  } // End row loop
+}
+
+
+ImageView<PixelMask<float> >
+PlaneSweepStereo::operator()(std::vector<ImageView<uint8> > const& images) const {
+  std::vector<CostType> costs;
+  ImageView<uint8> has_data;
+  compute_costs(images, costs, has_data);
+  const int32 cols = has_data.cols(), rows = has_data.rows();
+
+  ImageView<PixelMask<float> > depth;
+  if (m_aggregation == AGGREGATE_BOX) {
+    select_planes(costs, has_data, m_num_planes, *this, depth);
+    return depth;
+  }
+
+  const int32 NUM_PATHS = 8;
+  const int32 path_dx[NUM_PATHS] = {1, -1, 0,  0, 1, -1,  1, -1};
+  const int32 path_dy[NUM_PATHS] = {0,  0, 1, -1, 1,  1, -1, -1};
+  std::vector<AccumCostType> accum(costs.size(), 0);
+  for (int32 i=0; i<NUM_PATHS; ++i)
+    accumulate_path(costs, cols, rows, path_dx[i], path_dy[i], accum);
+  select_planes(accum, has_data, m_num_planes, *this, depth);
+  return depth;
+}
+
+
+ImageView<Vector3> PlaneSweepStereo::points(ImageView<PixelMask<float> > const& depth) const {
+  ImageView<Vector3> points(depth.cols(), depth.rows());
+  for (int32 r=0; r<depth.rows(); ++r) {
+    for (int32 c=0; c<depth.cols(); ++c) {
+      if (!is_valid(depth(c,r)))
+        continue; // Already a zero vector
+      const Vector2 pix(c, r);
+      try {
+        points(c,r) = m_cameras[0]->camera_center(pix)
+                    + double(depth(c,r).child()) * m_cameras[0]->pixel_to_vector(pix);
+      } catch (const camera::PixelToRayErr& /*e*/) {}
+    }
+  }
+  return points;
+}
+
+}} // namespace vw::stereo
@@ -0,0 +1,116 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file PlaneSweep.h
+///
+/// Multi-view plane-sweep stereo.
+///
+/// Instead of correlating every pair of images and fusing the results, all
+/// of the images are matched against a reference view in a single pass.
+/// For each depth hypothesis the other images are warped into the reference
+/// view through their camera models, the matching costs of all of the views
+/// are averaged into one cost volume, and the volume is aggregated with a
+/// box filter or with semi-global matching.  The output is the depth along
+/// the ray of each reference pixel.
+///
+#ifndef __VW_STEREO_PLANE_SWEEP_H__
+#define __VW_STEREO_PLANE_SWEEP_H__
+
+#include <vector>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Math/Vector.h>
+
+namespace vw {
+
+  // forward declaration
+  namespace camera {
+    class CameraModel;
+  }
+
+namespace stereo {
+
+  /// Plane-sweep stereo over any number of views.
+  /// - The depth hypotheses are distances along the reference pixel rays from
+  ///   the reference camera center, sampled uniformly in inverse depth.
+  /// - Camera projections are only computed on a grid of reference pixels and
+  ///   interpolated in between, so the models are not called for every pixel.
+  /// - The cost of a hypothesis is the mean absolute intensity difference over
+  ///   the views which see it, so views that fall off their image do not spoil
+  ///   the match.
+  class PlaneSweepStereo {
+  public:
+
+    typedef uint8  CostType;      ///< Cost of one depth at one pixel.
+    typedef uint16 AccumCostType; ///< Used to accumulate the SGM path costs.
+
+    enum AggregationType { AGGREGATE_BOX = 0, ///< Box filter each depth plane
+                           AGGREGATE_SGM = 1  ///< Box filter, then 8-path semi-global matching
+                         };
+
+    /// cameras[0] is the reference camera.  Like StereoModel, the camera
+    /// models are not copied and must outlive this object.
+    /// - num_planes depths are searched from min_depth to max_depth.
+    /// - p1 and p2 are the SGM penalties for a change of one plane and of more
+    ///   than one plane.  Zero selects a default.
+    /// - grid_spacing is the pixel spacing of the camera projection grid.
+    PlaneSweepStereo(std::vector<const camera::CameraModel *> const& cameras,
+                     double min_depth, double max_depth, int32 num_planes,
+                     int32 kernel_size = 5,
+                     AggregationType aggregation = AGGREGATE_SGM,
+                     uint16 p1 = 0, uint16 p2 = 0,
+                     int32 grid_spacing = 8);
+
+    /// Compute the depth of each pixel of images[0], with images[i] seen by cameras[i].
+    /// - Pixels for which no other view has data at any depth are invalid.
+    ImageView<PixelMask<float> > operator()(std::vector<ImageView<uint8> > const& images) const;
+
+    /// Convert a depth image from operator() into an image of XYZ points.
+    /// Invalid pixels become zero vectors, as with StereoModel.
+    ImageView<Vector3> points(ImageView<PixelMask<float> > const& depth) const;
+
+    /// The depth of a (possibly fractional) plane index.
+    double plane_depth(double plane) const;
+
+    int32 num_planes() const { return m_num_planes; }
+
+    /// Compute the cost volume without aggregation.
+    /// - The costs of pixel (col,row) are stored contiguously starting at
+    ///   (row*cols + col)*num_planes().
+    /// - Pixels with no data at any plane are zero in has_data.
+    void compute_costs(std::vector<ImageView<uint8> > const& images,
+                       std::vector<CostType> &costs, ImageView<uint8> &has_data) const;
+
+  private:
+
+    std::vector<const camera::CameraModel *> m_cameras;
+    double          m_min_depth, m_max_depth;
+    int32           m_num_planes, m_kernel_size, m_grid_spacing;
+    AggregationType m_aggregation;
+    uint16          m_p1, m_p2;
+
+    /// Add the costs along one SGM path direction into accum.
+    void accumulate_path(std::vector<CostType> const& costs, int32 cols, int32 rows,
+                         int32 dx, int32 dy, std::vector<AccumCostType> &accum) const;
+  };
+
+}}      // namespace vw::stereo
+
+#endif  // __VW_STEREO_PLANE_SWEEP_H__
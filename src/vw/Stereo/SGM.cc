@@ -9,9 +9,10 @@
 #include <vw/Image/PixelMask.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
 
+#include <vw/Core/RunOnce.h>
+
 #if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-  #include <emmintrin.h>
-  #include <smmintrin.h> // SSE4.1
+  #include <immintrin.h> // SSE4.1, plus AVX2 and AVX-512 for run-time dispatch
 #endif
 
 namespace vw {
@@ -114,20 +115,18 @@ void SemiGlobalMatcher::set_parameters(CostFunctionType cost_type,
 
 
 void SemiGlobalMatcher::populate_constant_disp_bound_image() {
-  // Allocate the image
-  m_disp_bound_image.set_size(m_num_output_cols, m_num_output_rows);
   // Fill it up with an identical vector
   Vector4i bounds_vector(m_min_disp_x, m_min_disp_y, m_max_disp_x, m_max_disp_y);
-  size_t buffer_size = m_num_output_cols*m_num_output_rows;
-
-  std::fill(m_disp_bound_image.data(), m_disp_bound_image.data()+buffer_size, bounds_vector);
+  m_disp_bounds.set_constant(m_num_output_cols, m_num_output_rows, bounds_vector);
 }
 
 bool SemiGlobalMatcher::populate_disp_bound_image(ImageView<uint8> const* left_image_mask,
                                                   ImageView<uint8> const* right_image_mask,
-                                                  DisparityImage const* prev_disparity) {
+                                                  DisparityImage const* prev_disparity,
+                                                  DisparityBounds const* prior_bounds) {
 
-  vw_out(VerboseDebugMessage, "stereo") << "disparity bound image size = " << bounding_box(m_disp_bound_image) << std::endl;
+  vw_out(VerboseDebugMessage, "stereo") << "disparity bound image size = "
+                                        << BBox2i(0, 0, m_disp_bounds.cols(), m_disp_bounds.rows()) << std::endl;
 
   // The masks are assumed to be the same size as the output image.
   // TODO: Check or automatically compute the left valid mask size!
@@ -135,8 +134,8 @@ bool SemiGlobalMatcher::populate_disp_bound_image(ImageView<uint8> const* left_i
   if (left_image_mask) {
     vw_out(VerboseDebugMessage, "stereo") << "Left  mask image size:" << bounding_box(*left_image_mask ) << std::endl;
     // Currently the left mask is required to EXACTLY match the output size...
-    if ( (left_image_mask->cols() == m_disp_bound_image.cols()) && 
-         (left_image_mask->rows() == m_disp_bound_image.rows())   )
+    if ( (left_image_mask->cols() == m_disp_bounds.cols()) && 
+         (left_image_mask->rows() == m_disp_bounds.rows())   )
       left_mask_valid = true;
     else
       vw_throw( LogicErr() << "Left mask size does not match the output size!\n" );
@@ -146,45 +145,33 @@ bool SemiGlobalMatcher::populate_disp_bound_image(ImageView<uint8> const* left_i
 
     // Currently this class assumes a positive search range and requires the right mask to
     //  be big enough to contain the output size PLUS the search range.
-    if ( (right_image_mask->cols() >= m_disp_bound_image.cols()+m_num_disp_x-1) && 
-         (right_image_mask->rows() >= m_disp_bound_image.rows()+m_num_disp_y-1)   )
+    if ( (right_image_mask->cols() >= m_disp_bounds.cols()+m_num_disp_x-1) && 
+         (right_image_mask->rows() >= m_disp_bounds.rows()+m_num_disp_y-1)   )
       right_mask_valid = true;
     else
       vw_throw( LogicErr() << "Right mask size is not large enough to support search range!\n" );
   }
 
-  // The low-res disparity image must be half-resolution.
+  // Start with the search ranges predicted by the lower resolution level.
+  // - The low-res disparity image must be half-resolution.
   const int SCALE_UP = 2; 
+  const Vector4i full_range(m_min_disp_x, m_min_disp_y, m_max_disp_x, m_max_disp_y);
+  const bool have_prior = (prior_bounds || prev_disparity);
+  if (prior_bounds) {
+    if ( (prior_bounds->cols() != m_disp_bounds.cols()) ||
+         (prior_bounds->rows() != m_disp_bounds.rows()) ||
+         (prior_bounds->search_range() != full_range) )
+      vw_throw( ArgumentErr() << "SGM: Prior disparity bounds do not match the output size and search range!\n" );
+    m_disp_bounds = *prior_bounds;
+  } else if (prev_disparity) {
+    m_disp_bounds.populate_from_coarse(*prev_disparity, m_num_output_cols, m_num_output_rows,
+                                       full_range, m_search_buffer, SCALE_UP);
+  }
 
-  // Require that the right image mask is valid for this percentage of the
-  // search range for each pixel in the left image.
-  // - If this value is too low, many border pixels will be assigned the full
-  //   search range and significantly slow down SGM!
-  //const double MIN_MASK_OVERLAP = 0.95;
-
-  // There needs to be some "room" in the disparity search space for
-  // us to discard prior results on the edge as not trustworthy predictors.
-  // In other words, don't mark any pixels as edge if the search space is too small!
-  // - The edges come from the previous resolution level, so don't check edges unless
-  //   the previous level was at least 5 pixels in that axis.
-  const int disp_range_width  = (m_max_disp_x - m_min_disp_x + 1);
-  const int disp_range_height = (m_max_disp_y - m_min_disp_y + 1);
-  const bool check_x_edge = (disp_range_width  >= 10);
-  const bool check_y_edge = (disp_range_height >= 10);
+  const Vector4i ZERO_SEARCH_AREA = DisparityBounds::empty_bounds();
 
   double area = 0, percent_trusted = 0, percent_masked = 0;
 
-  // NOTE: We don't use this class anymore because the right mask checking it was doing
-  //       was too conservative in checking for right image area and was causing valid
-  //       stereo area to go unprocessed.
-  // This class will check the right image mask in an efficient manner.
-  // - This implementation relies on >= 0 disparity ranges!
-  //IterativeMaskBoxCounter right_mask_checker(right_image_mask, Vector2i(m_num_disp_x, m_num_disp_y));
-
-  const Vector4i ZERO_SEARCH_AREA(0, 0, -1, -1);
-
-  ImageView<uint8> full_search_image(m_disp_bound_image.cols(), m_disp_bound_image.rows());
-
   // Find the upper and lower bounds of valid pixels in the right mask image.
   int min_valid_right_row = 0, max_valid_right_row = 0;
 
@@ -192,7 +179,7 @@ bool SemiGlobalMatcher::populate_disp_bound_image(ImageView<uint8> const* left_i
 
     min_valid_right_row = right_image_mask->rows()-1;
 
-    int num_cols = m_disp_bound_image.cols();
+    int num_cols = m_disp_bounds.cols();
 
     // For each column, find the maximum and minimum valid rows.
     for (int c=0; c<num_cols; ++c) {
@@ -215,14 +202,8 @@ bool SemiGlobalMatcher::populate_disp_bound_image(ImageView<uint8> const* left_i
 
   } // End mask valid case
 
-  // Loop through the output disparity image and compute a search range for each pixel
-  int r_in, c_in;
-  int dx_scaled, dy_scaled;
-  PixelMask<Vector2i> input_disp;
-  Vector4i bounds;
-  double missing_prev_disp_count = 0;
-  for (int r=0; r<m_disp_bound_image.rows(); ++r) { // Start loop through rows
-    r_in = r / SCALE_UP;
+  // Loop through the output disparity image and apply the masks to the search ranges
+  for (int r=0; r<m_disp_bounds.rows(); ++r) { // Start loop through rows
 
     int min_valid_right_column = -1, max_valid_right_column = -2;
     if (right_mask_valid) {
@@ -243,74 +224,22 @@ bool SemiGlobalMatcher::populate_disp_bound_image(ImageView<uint8> const* left_i
       }
     } // End mask column checking
 
-    for (int c=0; c<m_disp_bound_image.cols(); ++c) {
-/*
-      // TODO: This will fail if not used with positive search ranges!
-      // Verify that there is sufficient overlap with the right image mask
-      if (right_mask_valid) {
-        double right_percent  = right_mask_checker.next_pixel();
-        bool   right_check_ok = (right_percent >= MIN_MASK_OVERLAP);
-        // If none of the right mask pixels were valid, flag this pixel as invalid.
-        if (!right_check_ok) {
-          m_disp_bound_image(c,r) = ZERO_SEARCH_AREA;
-          ++percent_masked;
-          continue;
-        }
-      } // End right mask handling
-*/
+    for (int c=0; c<m_disp_bounds.cols(); ++c) {
+
       // If the left mask is invalid here, flag the pixel as invalid.
-      //// - Do this second so that our right image pixel tracker stays up to date.
       if (left_mask_valid && (left_image_mask->operator()(c,r) == 0)) {
-        m_disp_bound_image(c,r) = ZERO_SEARCH_AREA;
+        m_disp_bounds.set_empty(c,r);
         ++percent_masked;
         continue;
       }
 
-      // If a previous disparity was provided, see if we have a valid disparity 
-      // estimate for this pixel.
-      bool good_disparity = false;
-      c_in = c / SCALE_UP; // Pixel location in prior disparity map if it exists
-
-      if (prev_disparity) {
-
-        // Verify that the pixel we want exists
-        if ( (c_in >= prev_disparity->cols()) || (r_in >= prev_disparity->rows()) ) {
-          missing_prev_disp_count += 1;
-        } else {
-          input_disp = prev_disparity->operator()(c_in,r_in);
-          // Disparity values on the edge of our 2D search range are not considered trustworthy!
-          dx_scaled = input_disp[0] * SCALE_UP; 
-          dy_scaled = input_disp[1] * SCALE_UP;
-
-          bool on_edge = (  ( check_x_edge && ((dx_scaled <= m_min_disp_x) || (dx_scaled >= m_max_disp_x)) )
-                         || ( check_y_edge && ((dy_scaled <= m_min_disp_y) || (dy_scaled >= m_max_disp_y)) ) );
-
-          good_disparity = (is_valid(input_disp) && !on_edge);
-        }
-
-      } // End prev disparity check
-
-      if (good_disparity) {
-
-        // We are more confident in the prior disparity, search nearby.
-        bounds[0]  = dx_scaled - m_search_buffer[0]; // Min x
-        bounds[2]  = dx_scaled + m_search_buffer[0]; // Max X
-        bounds[1]  = dy_scaled - m_search_buffer[1]; // Min y
-        bounds[3]  = dy_scaled + m_search_buffer[1]; // Max y
-
-        // Constrain to global limits
-        if (bounds[0] < m_min_disp_x) bounds[0] = m_min_disp_x;
-        if (bounds[1] < m_min_disp_y) bounds[1] = m_min_disp_y;
-        if (bounds[2] > m_max_disp_x) bounds[2] = m_max_disp_x;
-        if (bounds[3] > m_max_disp_y) bounds[3] = m_max_disp_y;
-
-        percent_trusted += 1.0;
-      } else {
-        // Not a trusted prior disparity, search the entire range!
-        // - This takes a long time.
-        bounds = Vector4i(m_min_disp_x, m_min_disp_y, m_max_disp_x, m_max_disp_y);
-        full_search_image(c,r) = 255;
+      Vector4i bounds = m_disp_bounds(c,r);
+      if (bounds == ZERO_SEARCH_AREA) { // Already discarded by the prior bounds
+        ++percent_masked;
+        continue;
       }
+      if (!m_disp_bounds.is_full_range(c,r))
+        percent_trusted += 1.0;
 
       // Restrict search range to the right image mask
       // - This could be improved and more efficient!
@@ -327,9 +256,8 @@ bool SemiGlobalMatcher::populate_disp_bound_image(ImageView<uint8> const* left_i
         // Case with no valid offsets available
         if ((valid_offsets.min()[0] > valid_offsets.max()[0]) ||
             (valid_offsets.min()[1] > valid_offsets.max()[1])   ) {
-          m_disp_bound_image(c,r) = ZERO_SEARCH_AREA;
+          m_disp_bounds.set_empty(c,r);
           ++percent_masked;
-          full_search_image(c,r) = 0;
           continue;
         }
 
@@ -337,22 +265,20 @@ bool SemiGlobalMatcher::populate_disp_bound_image(ImageView<uint8> const* left_i
         bounds[1] = valid_offsets.min()[1];
         bounds[2] = valid_offsets.max()[0];
         bounds[3] = valid_offsets.max()[1];
+        m_disp_bounds.set(c,r, bounds);
       } // End mask checking case
 
-      m_disp_bound_image(c,r) = bounds;
       int this_area = (bounds[3]-bounds[1]+1)*(bounds[2]-bounds[0]+1);
       area += this_area;
     } // End col loop
-    //right_mask_checker.advance_row();
   } // End row loop
 
-  double num_pixels = m_disp_bound_image.rows()*m_disp_bound_image.cols();
+  double num_pixels = m_disp_bounds.rows()*m_disp_bounds.cols();
   percent_masked  /= num_pixels;
   percent_trusted /= num_pixels;
 
   vw_out(InfoMessage, "stereo") << "Percent masked pixels  = "            << percent_masked  << std::endl;
   vw_out(InfoMessage, "stereo") << "Percent trusted prior disparities = " << percent_trusted << std::endl;
-  vw_out(InfoMessage, "stereo") << "Number missing prev disp = "          << missing_prev_disp_count << std::endl;
 
   // Next we attempt to refine the search ranges to stay within the memory usage limits.
   const int NO_CONSERVE  = 0;
@@ -362,8 +288,7 @@ bool SemiGlobalMatcher::populate_disp_bound_image(ImageView<uint8> const* left_i
     // Refine the disparity search ranges with the current conservation level.
     vw_out(InfoMessage, "stereo") << "Refining search ranges with conservation level "
                                   << conserve_level << std::endl;
-    constrain_disp_bound_image(full_search_image, prev_disparity, percent_trusted, 
-                               percent_masked, area, conserve_level);
+    constrain_disp_bound_image(have_prior, percent_trusted, percent_masked, area, conserve_level);
     try { // Check if the computed boundaries fall within the user specified memory limit
       result = compute_buffer_length();
       break; // Memory usage is ok!
@@ -379,18 +304,14 @@ bool SemiGlobalMatcher::populate_disp_bound_image(ImageView<uint8> const* left_i
 }
 
 
-bool SemiGlobalMatcher::constrain_disp_bound_image(ImageView<uint8> const &full_search_image, 
-                                                   DisparityImage const* prev_disparity,
+bool SemiGlobalMatcher::constrain_disp_bound_image(bool have_prior,
                                                    double percent_trusted, double percent_masked, double area,
                                                    int conserve_memory) {
 
-  const Vector4i ZERO_SEARCH_AREA(0, 0, -1, -1);
-
   const BBox2i max_range_bbox(Vector2i(m_min_disp_x, m_min_disp_y), Vector2i(m_max_disp_x, m_max_disp_y));
   const double max_search_area = max_range_bbox.area();
 
   // Shrink the search range of full range pixels based on neighbors
-  // TODO: Make this more efficient!!!
         int NEARBY_DISP_SEARCH_RANGE = 10; // Look this many pixels in each direction
   const int NEARBY_DISP_EXPANSION    = 2; // Grow search range from what nearby pixels have
   if (conserve_memory == 1) // Look further, but failing pixels are discarded.
@@ -400,133 +321,18 @@ bool SemiGlobalMatcher::constrain_disp_bound_image(ImageView<uint8> const &full_
   if (conserve_memory == 3) // Most conservative, don't look for ranges at all.
     NEARBY_DISP_SEARCH_RANGE = 0;
   double percent_shrunk = 0, shrunk_area = area;
-  float conserved = 0;
-  if (prev_disparity) { // No point doing this if a previous disparity image was not provided
-
-    //// DEBUG
-    //std::stringstream s;
-    //s << m_disp_bound_image.cols();
-    //if (conserve_memory)
-    //  s << "_conserve_";
-    //write_image("full_search_image"+s.str()+".tif", full_search_image);
-
-    // Debug image to record the search size for each pixel
-    //ImageView<int> search_size_image(full_search_image.cols(), full_search_image.rows());
-
-    for (int r=0; r<m_disp_bound_image.rows(); ++r) {      
-
-      // Get vertical search range
-      int min_search_r = r - NEARBY_DISP_SEARCH_RANGE;
-      int max_search_r = r + NEARBY_DISP_SEARCH_RANGE;
-      if (min_search_r <  0                        ) min_search_r = 0;
-      if (max_search_r >= m_disp_bound_image.rows()) max_search_r = m_disp_bound_image.rows()-1;
-
-
-      for (int c=0; c<m_disp_bound_image.cols(); ++c) {
-        // Skip pixels without a full search range
-        //Vector4i bounds = m_disp_bound_image(c,r);
-        //int this_area = (bounds[3]-bounds[1]+1)*(bounds[2]-bounds[0]+1);
-        if (!full_search_image(c,r)) {
-          //search_size_image(c,r) = this_area;
-          continue;
-        }
-
-        /* We stopped using this star pattern search because it could lead to
-         * some weird looking results that were undesirable.
-        // Look in a star pattern to cheaply search a larger space
-        // - Keep expanding outward and quit when we find valid pixels.
-        BBox2i new_range;
-        for (int i=1; i<=NEARBY_DISP_SEARCH_RANGE; ++i) {
-          std::vector<Vector2i> coords;
-          coords.push_back(Vector2i(c+i,r  )); // Next set of pixels
-          coords.push_back(Vector2i(c  ,r+i));
-          coords.push_back(Vector2i(c-i,r  ));
-          coords.push_back(Vector2i(c  ,r-i));
-          coords.push_back(Vector2i(c-i,r-i));
-          coords.push_back(Vector2i(c+i,r-i));
-          coords.push_back(Vector2i(c-i,r+i));
-          coords.push_back(Vector2i(c+i,r+i));
-
-          for (size_t j=0; j<coords.size(); ++j) { // Loop through the four points.
-            int cs = coords[j][0];
-            int rs = coords[j][1];
-            if ((cs < 0) || (rs < 0) || 
-                (cs >= m_disp_bound_image.cols()) || (rs >= m_disp_bound_image.rows()))
-              continue; // Skip out of bounds pixels
-            if (full_search_image(cs,rs)) // Don't look at other uncertain pixels
-              continue;
-            Vector4i vec = m_disp_bound_image(cs,rs);
-            if (vec == ZERO_SEARCH_AREA) // Skip zeroed out pixels too
-              continue;
-            new_range.grow(Vector2i(vec[0], vec[1])); // Expand to contain this pixel
-            new_range.grow(Vector2i(vec[2], vec[3]));
-            if ((c == DEBUG_X) && (r == DEBUG_Y))
-              vw_out() << "Expand to contain: " << vec << std::endl;
-          }
-          if (!new_range.empty())
-            break; // Quit when we hit valid pixels
-        }
-        */
-
-
-        // Get horizontal search range
-        int min_search_c = c - NEARBY_DISP_SEARCH_RANGE;
-        int max_search_c = c + NEARBY_DISP_SEARCH_RANGE;
-        if (min_search_c <  0                        ) min_search_c = 0;
-        if (max_search_c >= m_disp_bound_image.cols()) max_search_c = m_disp_bound_image.cols()-1;
-
-        // Look through the search range
-        BBox2i new_range;
-        for (int rs=min_search_r; rs<=max_search_r; ++rs) {
-          for (int cs=min_search_c; cs<=max_search_c; ++cs) {
-            if (full_search_image(cs,rs)) // Don't look at other uncertain pixels
-              continue;
-            // Expand bounding box
-            Vector4i vec = m_disp_bound_image(cs,rs);
-            if (vec == ZERO_SEARCH_AREA) // Skip zeroed out pixels too
-              continue;
-            new_range.grow(Vector2i(vec[0], vec[1]));
-            new_range.grow(Vector2i(vec[2], vec[3]));
-          }
-        }
-
-        if (new_range.empty()) { // If we did not find a new estimate
-          // If worried about memory, don't try to solve pixels with no estimate.
-          if (conserve_memory > 0) {
-            m_disp_bound_image(c,r) = ZERO_SEARCH_AREA;
-            percent_shrunk += 1.0;
-            shrunk_area -= max_search_area;
-            conserved += 1.0;
-            //search_size_image(c,r) = 0;
-          }
-          //else
-          //  search_size_image(c,r) = this_area;
-
-          // Otherwise use the full search range for them.
-          continue;
-        }
-        // Grow the bounding box a bit and then record it  
-        new_range.expand(NEARBY_DISP_EXPANSION);
-        new_range.crop(max_range_bbox); // Constrain to global limits
-        m_disp_bound_image(c,r) = Vector4i(new_range.min().x(),   new_range.min().y(),
-                                           new_range.max().x(),   new_range.max().y());
-        percent_shrunk += 1.0;
-        shrunk_area -= (max_search_area - new_range.area());
-        //search_size_image(c,r) = new_range.area();
-
-      } // End col loop
-    } // End row loop
-    //std::cout << "max_range_bbox = " << max_range_bbox << std::endl;
-    //std::cout << "===> Writing file: search_size_image"+s.str()+".tif\n";
-    //write_image("search_size_image"+s.str()+".tif", search_size_image);
-  } // End of search range shrinking code
+  if (have_prior) { // No point doing this if a previous disparity image was not provided
+    percent_shrunk = m_disp_bounds.fill_full_range_pixels(NEARBY_DISP_SEARCH_RANGE,
+                                                          NEARBY_DISP_EXPANSION,
+                                                          conserve_memory > 0);
+    shrunk_area = m_disp_bounds.search_volume();
+  }
 
   // Compute some statistics for help improving the speed
-  double num_pixels = m_disp_bound_image.rows()*m_disp_bound_image.cols();
+  double num_pixels = m_disp_bounds.rows()*m_disp_bounds.cols();
   area            /= num_pixels;
   shrunk_area     /= num_pixels; 
   percent_shrunk  /= num_pixels;
-  conserved       /= num_pixels;
 
   double initial_percent_full_range = 1.0 - (percent_trusted+percent_masked);
   double final_percent_full_range   = initial_percent_full_range - percent_shrunk;
@@ -536,16 +342,13 @@ bool SemiGlobalMatcher::constrain_disp_bound_image(ImageView<uint8> const &full_
   vw_out(InfoMessage, "stereo") << "Percent shrunk pixels  = "            << percent_shrunk     << std::endl;
   vw_out(InfoMessage, "stereo") << "Percent full search range pixels (initial) = " << initial_percent_full_range << std::endl;
   vw_out(InfoMessage, "stereo") << "Percent full search range pixels (final  ) = " << final_percent_full_range   << std::endl;
-  if (conserve_memory)
-    vw_out(InfoMessage, "stereo") << "Percent pixels conserved for memory = " << conserved << std::endl;
-
 
   // Return false if the image cannot be processed
   if ((area <= 0) || (percent_masked >= 100))
     return false;
   return true;
 
-} // End populate_disp_bound_image
+} // End constrain_disp_bound_image
 
 
 size_t SemiGlobalMatcher::compute_buffer_length() {
@@ -580,6 +383,15 @@ size_t SemiGlobalMatcher::compute_buffer_length() {
 
   m_buffer_lengths = total_offset; // Record this value
 
+  // The low-memory mode only needs a band of rows in memory at once.
+  if (m_low_memory && !m_use_mgm) {
+    size_t streamed_bytes = compute_streamed_buffer_size();
+    if (streamed_bytes/BYTES_PER_MB > m_memory_limit_mb)
+      vw_throw( ArgumentErr() << "SGM: Required low-memory mode usage is "<< streamed_bytes/BYTES_PER_MB
+                              << " MB which is greater than the cap of "<< m_memory_limit_mb <<" MB!\n" );
+    return total_offset;
+  }
+
 
   // Verify that allocating the "small" buffers won't put us over the limit.
   // - m_buffer_lengths must be set for this to work.
@@ -599,6 +411,17 @@ size_t SemiGlobalMatcher::compute_buffer_length() {
                                  << small_buffer_size_bytes/BYTES_PER_MB << " MB\n";
 
   size_t total_num_bytes = main_buffer_bytes + small_buffer_size_bytes;
+  if ((total_num_bytes/BYTES_PER_MB > m_memory_limit_mb) && !m_use_mgm) {
+    // Before giving up, see if the low-memory mode would fit.
+    size_t streamed_bytes = compute_streamed_buffer_size();
+    if (streamed_bytes/BYTES_PER_MB <= m_memory_limit_mb) {
+      vw_out(InfoMessage, "stereo") << "SGM: Full cost buffers need " << total_num_bytes/BYTES_PER_MB
+                                    << " MB, switching to low-memory mode using "
+                                    << streamed_bytes/BYTES_PER_MB << " MB.\n";
+      m_low_memory = true;
+      return total_offset;
+    }
+  }
   if (total_num_bytes/BYTES_PER_MB > m_memory_limit_mb) {
     vw_throw( ArgumentErr() << "SGM: Required memory usage is "<< total_num_bytes 
                             << " MB which is greater than the cap of "<< m_memory_limit_mb <<" MB!\n" );
@@ -629,241 +452,504 @@ void SemiGlobalMatcher::allocate_large_buffers() {
 }
 
 
+size_t SemiGlobalMatcher::compute_streamed_buffer_size() {
+
+  // Every row buffer is allocated at the size of the longest row.
+  size_t max_row_length = 0;
+  for (int r=0; r<m_num_output_rows; ++r)
+    max_row_length = std::max(max_row_length, get_rows_length(r, r+1));
+
+  // Each band of rows stores its costs and forward path sums, and the forward trip
+  //  state (three rows of path outputs) is saved at the start of every band.
+  // - The total of those two is smallest with bands of about sqrt(2*rows) rows.
+  const int NUM_TRAIL_PATHS = 3;
+  m_rows_per_block = static_cast<int>(ceil(sqrt(2.0*m_num_output_rows)));
+  if (m_rows_per_block > m_num_output_rows) m_rows_per_block = m_num_output_rows;
+  if (m_rows_per_block < 1                ) m_rows_per_block = 1;
+  const int num_blocks = (m_num_output_rows + m_rows_per_block - 1) / m_rows_per_block;
+
+  size_t checkpoint_size = 0, max_block_length = 0;
+  for (int b=0; b<num_blocks; ++b) {
+    int row_start = b*m_rows_per_block;
+    int row_end   = std::min(row_start + m_rows_per_block, m_num_output_rows);
+    max_block_length = std::max(max_block_length, get_rows_length(row_start, row_end));
+    if (b > 0)
+      checkpoint_size += NUM_TRAIL_PATHS*get_rows_length(row_start-1, row_start);
+  }
 
-void SemiGlobalMatcher::populate_adjacent_disp_lookup_table() {
+  // Leading and trailing row sets for each of the two trip directions.
+  const int NUM_ROW_SETS = 4;
+  const size_t checkpoint_bytes = checkpoint_size * sizeof(AccumCostType);
+  const size_t block_bytes      = max_block_length * (sizeof(CostType) + sizeof(AccumCostType));
+  const size_t row_bytes        = NUM_ROW_SETS*NUM_TRAIL_PATHS*max_row_length * sizeof(AccumCostType);
 
-  const int TABLE_WIDTH = 8;
-  m_adjacent_disp_lookup.resize(m_num_disp*TABLE_WIDTH);
+  const size_t BYTES_PER_MB = 1024*1024;
+  vw_out(DebugMessage, "stereo") << "SGM: Low-memory mode uses " << num_blocks << " bands of "
+                                 << m_rows_per_block << " rows.\n";
+  vw_out(DebugMessage, "stereo") << "SGM: Estimating low-memory buffer size: " 
+                                 << (checkpoint_bytes+block_bytes+row_bytes)/BYTES_PER_MB << " MB\n";
+
+  return checkpoint_bytes + block_bytes + row_bytes;
+}
 
-  // Loop through the disparities
-  int d = 0;
-  for (int dy=m_min_disp_y; dy<=m_max_disp_y; ++dy) {
-    // Figure out above and below disparities with bounds checking
-    int y_less = dy - 1;
-    int y_more = dy + 1;
-    if (y_less < m_min_disp_y) y_less = dy;
-    if (y_more > m_max_disp_y) y_more = dy;
 
-    int y_less_o = y_less - m_min_disp_y; // Offset from min y disparity
-    int y_o      = dy     - m_min_disp_y;
-    int y_more_o = y_more - m_min_disp_y;
 
-    for (int dx=m_min_disp_x; dx<=m_max_disp_x; ++dx) {
+// The inner loop of the path accumulation operates on one row of disparities at a time.
+// - Each kernel computes, for n consecutive disparities:
+//     output = min( min(the eight adjacent priors)+p1, the same prior, dJ) + local - dP
+// - prior points to the entry in the padded full prior buffer for the first disparity,
+//   so the adjacent priors are always at fixed offsets of +-1 and +-stride.
+// - The SSE and AVX2 kernels handle a partial final vector by re-running an overlapping
+//   full vector or, for short rows, by staging the input in a small padded window.
+//   The AVX-512 kernel uses masked loads and stores instead.
+namespace {
+
+  typedef void   (*PathRowKernel)(const uint16* prior, int stride, const uint8* local, int n,
+                                  uint16 dJ, uint16 dP, uint16 p1, uint16* output);
+  typedef uint16 (*MinKernel    )(const uint16* data, int n, uint16 init);
+
+  void path_row_scalar(const uint16* prior, int stride, const uint8* local, int n,
+                       uint16 dJ, uint16 dP, uint16 p1, uint16* output) {
+    for (int i=0; i<n; ++i) {
+      const uint16* c = prior + i;
+      uint16 min_adj = std::min(c[-1], c[1]);
+      min_adj = std::min(min_adj, c[-stride-1]);
+      min_adj = std::min(min_adj, c[-stride  ]);
+      min_adj = std::min(min_adj, c[-stride+1]);
+      min_adj = std::min(min_adj, c[ stride-1]);
+      min_adj = std::min(min_adj, c[ stride  ]);
+      min_adj = std::min(min_adj, c[ stride+1]);
+      min_adj += p1;
+      uint16 min_val = std::min(min_adj, c[0]);
+      min_val = std::min(min_val, dJ);
+      output[i] = min_val + (local[i] - dP);
+    }
+  }
 
-      // Figure out left and right disparities with bounds checking
-      int x_less = dx - 1;
-      int x_more = dx + 1;
-      if (x_less < m_min_disp_x) x_less = dx;
-      if (x_more > m_max_disp_x) x_more = dx;
+  uint16 min_scalar(const uint16* data, int n, uint16 init) {
+    uint16 result = init;
+    for (int i=0; i<n; ++i)
+      if (data[i] < result)
+        result = data[i];
+    return result;
+  }
 
-      int x_less_o = x_less - m_min_disp_x; // Offset from min x disparity
-      int x_o      = dx     - m_min_disp_x;
-      int x_more_o = x_more - m_min_disp_x;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
 
-      // Record the disparity indices of each of the adjacent pixels
-      int table_pos = d*TABLE_WIDTH;
-      m_adjacent_disp_lookup[table_pos+0] = y_less_o*m_num_disp_x + x_o;      // The four adjacent pixels
-      m_adjacent_disp_lookup[table_pos+1] = y_o     *m_num_disp_x + x_less_o;
-      m_adjacent_disp_lookup[table_pos+2] = y_o     *m_num_disp_x + x_more_o;
-      m_adjacent_disp_lookup[table_pos+3] = y_more_o*m_num_disp_x + x_o;
-      m_adjacent_disp_lookup[table_pos+4] = y_less_o*m_num_disp_x + x_less_o; // The four diagonal pixels
-      m_adjacent_disp_lookup[table_pos+5] = y_less_o*m_num_disp_x + x_more_o;
-      m_adjacent_disp_lookup[table_pos+6] = y_more_o*m_num_disp_x + x_less_o;
-      m_adjacent_disp_lookup[table_pos+7] = y_more_o*m_num_disp_x + x_more_o;
+  /// Handle a row that is shorter than one vector by copying it into a padded window
+  ///  that the vector kernel can safely read in full.
+  template <int LANES, void (*ChunkT)(const uint16*, int, const uint8*, uint16*, uint16, uint16, uint16)>
+  void path_row_short(const uint16* prior, int stride, const uint8* local, int n,
+                      uint16 dJ, uint16 dP, uint16 p1, uint16* output) {
+    const int W = LANES+2;
+    uint16 window[3*W];
+    uint8  local_window[LANES];
+    uint16 result[LANES];
+    std::fill(window, window+3*W, std::numeric_limits<uint16>::max());
+    std::fill(local_window, local_window+LANES, 0);
+    for (int r=-1; r<=1; ++r)
+      std::copy(prior+r*stride-1, prior+r*stride+n+1, window+(r+1)*W);
+    std::copy(local, local+n, local_window);
+    ChunkT(window+W+1, W, local_window, result, dJ, dP, p1);
+    std::copy(result, result+n, output);
+  }
 
-      ++d;
+  inline __m128i path_chunk_sse_vec(const uint16* c, int stride, __m128i dL,
+                                    __m128i dJ, __m128i dP, __m128i p1) {
+    __m128i m = _mm_min_epu16(_mm_loadu_si128((const __m128i*)(c-1)),
+                              _mm_loadu_si128((const __m128i*)(c+1)));
+    m = _mm_min_epu16(m, _mm_loadu_si128((const __m128i*)(c-stride-1)));
+    m = _mm_min_epu16(m, _mm_loadu_si128((const __m128i*)(c-stride  )));
+    m = _mm_min_epu16(m, _mm_loadu_si128((const __m128i*)(c-stride+1)));
+    m = _mm_min_epu16(m, _mm_loadu_si128((const __m128i*)(c+stride-1)));
+    m = _mm_min_epu16(m, _mm_loadu_si128((const __m128i*)(c+stride  )));
+    m = _mm_min_epu16(m, _mm_loadu_si128((const __m128i*)(c+stride+1)));
+    m = _mm_adds_epu16(m, p1);
+    m = _mm_min_epu16(m, _mm_loadu_si128((const __m128i*)c));
+    m = _mm_min_epu16(m, dJ);
+    return _mm_subs_epu16(_mm_adds_epu16(m, dL), dP);
+  }
+
+  void path_chunk_sse(const uint16* c, int stride, const uint8* local, uint16* output,
+                      uint16 dJ, uint16 dP, uint16 p1) {
+    __m128i dL = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)local));
+    _mm_storeu_si128((__m128i*)output,
+                     path_chunk_sse_vec(c, stride, dL, _mm_set1_epi16(dJ),
+                                        _mm_set1_epi16(dP), _mm_set1_epi16(p1)));
+  }
+
+  void path_row_sse(const uint16* prior, int stride, const uint8* local, int n,
+                    uint16 dJ, uint16 dP, uint16 p1, uint16* output) {
+    const int LANES = 8;
+    if (n < LANES) {
+      path_row_short<LANES, path_chunk_sse>(prior, stride, local, n, dJ, dP, p1, output);
+      return;
+    }
+    const __m128i vJ  = _mm_set1_epi16(dJ);
+    const __m128i vP  = _mm_set1_epi16(dP);
+    const __m128i vp1 = _mm_set1_epi16(p1);
+    for (int i=0; ; i+=LANES) {
+      if (i > n-LANES)
+        i = n-LANES; // Overlap the last vector with the previous one
+      __m128i dL = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(local+i)));
+      _mm_storeu_si128((__m128i*)(output+i), path_chunk_sse_vec(prior+i, stride, dL, vJ, vP, vp1));
+      if (i == n-LANES)
+        break;
     }
   }
-} // End function populate_adjacent_disp_lookup_table
 
+  uint16 min_sse(const uint16* data, int n, uint16 init) {
+    const int LANES = 8;
+    __m128i m = _mm_set1_epi16(init);
+    int i = 0;
+    for (; i+LANES<=n; i+=LANES)
+      m = _mm_min_epu16(m, _mm_loadu_si128((const __m128i*)(data+i)));
+    uint16 result = _mm_extract_epi16(_mm_minpos_epu16(m), 0);
+    return min_scalar(data+i, n-i, result);
+  }
 
-#if not defined(VW_ENABLE_SSE) || (VW_ENABLE_SSE==0)
-// Note: local and output are the same size.
-// full_prior_buffer is always length m_num_disps and comes in initialized to a
-//  large flag value.  When the function quits the buffer must be returned to this state.
-void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
-                       AccumCostType* const prior,
-                       AccumCostType*       full_prior_buffer,
-                       CostType     * const local,
-                       AccumCostType*       output,
-                       int path_intensity_gradient, bool debug ) {
+// The AVX2 and AVX-512 kernels are compiled for their instruction sets individually
+//  and are only selected if the CPU running the code supports them.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (__GNUC__ >= 8))
+  #define VW_SGM_AVX_KERNELS 1
+
+  __attribute__((target("avx2")))
+  inline __m256i path_chunk_avx2_vec(const uint16* c, int stride, __m256i dL,
+                                     __m256i dJ, __m256i dP, __m256i p1) {
+    __m256i m = _mm256_min_epu16(_mm256_loadu_si256((const __m256i*)(c-1)),
+                                 _mm256_loadu_si256((const __m256i*)(c+1)));
+    m = _mm256_min_epu16(m, _mm256_loadu_si256((const __m256i*)(c-stride-1)));
+    m = _mm256_min_epu16(m, _mm256_loadu_si256((const __m256i*)(c-stride  )));
+    m = _mm256_min_epu16(m, _mm256_loadu_si256((const __m256i*)(c-stride+1)));
+    m = _mm256_min_epu16(m, _mm256_loadu_si256((const __m256i*)(c+stride-1)));
+    m = _mm256_min_epu16(m, _mm256_loadu_si256((const __m256i*)(c+stride  )));
+    m = _mm256_min_epu16(m, _mm256_loadu_si256((const __m256i*)(c+stride+1)));
+    m = _mm256_adds_epu16(m, p1);
+    m = _mm256_min_epu16(m, _mm256_loadu_si256((const __m256i*)c));
+    m = _mm256_min_epu16(m, dJ);
+    return _mm256_subs_epu16(_mm256_adds_epu16(m, dL), dP);
+  }
 
-  // Decrease p2 (jump cost) with increasing disparity along the path
-  AccumCostType p2_mod = m_p2;
-  if (path_intensity_gradient > 0)
-    p2_mod /= path_intensity_gradient;
-  if (p2_mod < m_p1)
-    p2_mod = m_p1;
+  __attribute__((target("avx2")))
+  void path_chunk_avx2(const uint16* c, int stride, const uint8* local, uint16* output,
+                       uint16 dJ, uint16 dP, uint16 p1) {
+    __m256i dL = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)local));
+    _mm256_storeu_si256((__m256i*)output,
+                        path_chunk_avx2_vec(c, stride, dL, _mm256_set1_epi16(dJ),
+                                            _mm256_set1_epi16(dP), _mm256_set1_epi16(p1)));
+  }
 
-  //int num_disparities   = get_num_disparities(col,   row  ); // Can be input arg
-  //int num_disparities_p = get_num_disparities(col_p, row_p);
+  __attribute__((target("avx2")))
+  void path_row_avx2(const uint16* prior, int stride, const uint8* local, int n,
+                     uint16 dJ, uint16 dP, uint16 p1, uint16* output) {
+    const int LANES = 16;
+    if (n < LANES) {
+      // Half a vector of work or less is cheaper with SSE than with a staged window.
+      if (n >= 8)
+        path_row_sse(prior, stride, local, n, dJ, dP, p1, output);
+      else
+        path_row_short<8, path_chunk_sse>(prior, stride, local, n, dJ, dP, p1, output);
+      return;
+    }
+    const __m256i vJ  = _mm256_set1_epi16(dJ);
+    const __m256i vP  = _mm256_set1_epi16(dP);
+    const __m256i vp1 = _mm256_set1_epi16(p1);
+    for (int i=0; ; i+=LANES) {
+      if (i > n-LANES)
+        i = n-LANES;
+      __m256i dL = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(local+i)));
+      _mm256_storeu_si256((__m256i*)(output+i), path_chunk_avx2_vec(prior+i, stride, dL, vJ, vP, vp1));
+      if (i == n-LANES)
+        break;
+    }
+  }
 
-  Vector4i pixel_disp_bounds   = m_disp_bound_image(col, row);
-  Vector4i pixel_disp_bounds_p = m_disp_bound_image(col_p, row_p);
+  __attribute__((target("avx2")))
+  uint16 min_avx2(const uint16* data, int n, uint16 init) {
+    const int LANES = 16;
+    __m256i m = _mm256_set1_epi16(init);
+    int i = 0;
+    for (; i+LANES<=n; i+=LANES)
+      m = _mm256_min_epu16(m, _mm256_loadu_si256((const __m256i*)(data+i)));
+    __m128i half = _mm_min_epu16(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+    uint16 result = _mm_extract_epi16(_mm_minpos_epu16(half), 0);
+    return min_sse(data+i, n-i, result);
+  }
 
-  // Init the min prior in case the previous pixel is invalid.
-  AccumCostType BAD_VAL = get_bad_accum_val();
-  AccumCostType min_prior = BAD_VAL;
+  __attribute__((target("avx512f,avx512bw,avx512vl")))
+  void path_row_avx512(const uint16* prior, int stride, const uint8* local, int n,
+                       uint16 dJ, uint16 dP, uint16 p1, uint16* output) {
+    const int LANES = 32;
+    const __m512i vJ   = _mm512_set1_epi16(dJ);
+    const __m512i vP   = _mm512_set1_epi16(dP);
+    const __m512i vp1  = _mm512_set1_epi16(p1);
+    const __m512i vbad = _mm512_set1_epi16(-1);
+    for (int i=0; i<n; i+=LANES) {
+      const __mmask32 mask = (n-i >= LANES) ? 0xFFFFFFFFu : ((1u << (n-i)) - 1);
+      const uint16* c = prior + i;
+      __m512i m = _mm512_min_epu16(_mm512_mask_loadu_epi16(vbad, mask, c-1),
+                                   _mm512_mask_loadu_epi16(vbad, mask, c+1));
+      m = _mm512_min_epu16(m, _mm512_mask_loadu_epi16(vbad, mask, c-stride-1));
+      m = _mm512_min_epu16(m, _mm512_mask_loadu_epi16(vbad, mask, c-stride  ));
+      m = _mm512_min_epu16(m, _mm512_mask_loadu_epi16(vbad, mask, c-stride+1));
+      m = _mm512_min_epu16(m, _mm512_mask_loadu_epi16(vbad, mask, c+stride-1));
+      m = _mm512_min_epu16(m, _mm512_mask_loadu_epi16(vbad, mask, c+stride  ));
+      m = _mm512_min_epu16(m, _mm512_mask_loadu_epi16(vbad, mask, c+stride+1));
+      m = _mm512_adds_epu16(m, vp1);
+      m = _mm512_min_epu16(m, _mm512_mask_loadu_epi16(vbad, mask, c));
+      m = _mm512_min_epu16(m, vJ);
+      __m512i dL = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(mask, local+i));
+      m = _mm512_subs_epu16(_mm512_adds_epu16(m, dL), vP);
+      _mm512_mask_storeu_epi16(output+i, mask, m);
+    }
+  }
 
-  // Insert the valid disparity scores into full_prior buffer so they are
-  //  easy to access quickly within the pixel loop below.
-  int d = 0;
-  for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
+  __attribute__((target("avx512f,avx512bw,avx512vl")))
+  uint16 min_avx512(const uint16* data, int n, uint16 init) {
+    const int LANES = 32;
+    const __m512i vbad = _mm512_set1_epi16(-1);
+    __m512i m = _mm512_set1_epi16(init);
+    for (int i=0; i<n; i+=LANES) {
+      const __mmask32 mask = (n-i >= LANES) ? 0xFFFFFFFFu : ((1u << (n-i)) - 1);
+      m = _mm512_min_epu16(m, _mm512_mask_loadu_epi16(vbad, mask, data+i));
+    }
+    __m256i quarter = _mm256_min_epu16(_mm512_castsi512_si256(m), _mm512_extracti64x4_epi64(m, 1));
+    __m128i eighth  = _mm_min_epu16(_mm256_castsi256_si128(quarter), _mm256_extracti128_si256(quarter, 1));
+    return _mm_extract_epi16(_mm_minpos_epu16(eighth), 0);
+  }
 
-    // Get initial fill linear storage index for this dy row
-    int full_index = xy_to_disp(pixel_disp_bounds_p[0], dy);
+#endif // AVX kernels
+#endif // VW_ENABLE_SSE
 
-    for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
+  // The census cost kernels compute the Hamming distance between one left census value and
+  //  n consecutive right census values, which covers one row of a pixel's disparity range.
+  // - The SSE and AVX2 kernels count the bits of each byte with a nibble lookup table and then
+  //   sum the bytes of each census value.
+  // - The AVX-512 kernels use the VPOPCNTDQ and BITALG popcount instructions with masked tails.
 
-      // Get the min prior while we are at it.
-      if (prior[d] < min_prior) {
-        min_prior  = prior[d];
-      }
+  template <typename T>
+  struct HammingRowKernel {
+    typedef void (*Func)(T left, const T* right, int n, uint8* output);
+    static Func func;
+  };
 
-      full_prior_buffer[full_index] = prior[d];
-      ++full_index;
-      ++d;
-    }
+  template <typename T>
+  void hamming_row_scalar(T left, const T* right, int n, uint8* output) {
+    for (int i=0; i<n; ++i)
+      output[i] = static_cast<uint8>(hamming_distance(left, right[i]));
   }
-  AccumCostType min_prev_disparity_cost = min_prior + p2_mod;
-  if (debug) {
-    std::cout << "Prior pixel = ("<<col_p<<","<<row_p<<")\n";
-    std::cout << "m_p2  : " << m_p2 << std::endl;
-    std::cout << "path_intensity_gradient  : " << path_intensity_gradient << std::endl;
-    std::cout << "p2_mod  : " << p2_mod << std::endl;
-    std::cout << "Bounds  : " << pixel_disp_bounds << std::endl;
-    std::cout << "Bounds_P: " << pixel_disp_bounds_p << std::endl;
 
-    std::cout << "min_prior = " <<  min_prior << std::endl;
-    std::cout << "min_prev_disparity_cost = " <<  min_prev_disparity_cost << std::endl;
+  template <typename T>
+  typename HammingRowKernel<T>::Func HammingRowKernel<T>::func = hamming_row_scalar<T>;
 
-    std::cout << "Priors: \n";
-    int i=0;    
-    for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
-      for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
-        std::cout << prior[i] << " ";
-        ++i;
-      }
-      std::cout << std::endl;
-    }
-    std::cout << std::endl;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
 
-    std::cout << "Costs: \n";
-    i=0;
-    for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
-      for (int dx=pixel_disp_bounds[0]; dx<=pixel_disp_bounds[2]; ++dx) {
-        std::cout << int(local[i]) << " ";
-        ++i;
-      }
-      std::cout << std::endl;
+  inline __m128i broadcast_sse(uint8  v) { return _mm_set1_epi8 (static_cast<char >(v)); }
+  inline __m128i broadcast_sse(uint16 v) { return _mm_set1_epi16(static_cast<short>(v)); }
+  inline __m128i broadcast_sse(uint32 v) { return _mm_set1_epi32(static_cast<int  >(v)); }
+  inline __m128i broadcast_sse(uint64 v) { return _mm_set1_epi64x(static_cast<long long>(v)); }
+
+  /// Byte shuffle mask which moves the low byte of each T sized element to the front,
+  ///  starting at output position first.  Unused positions are zeroed.
+  template <typename T>
+  void low_byte_shuffle(char* mask, int first) {
+    const int count = 16 / sizeof(T);
+    for (int k=0; k<16; ++k)
+      mask[k] = -128;
+    for (int k=0; k<count && first+k<16; ++k)
+      mask[first+k] = static_cast<char>(k*sizeof(T));
+  }
+
+  inline __m128i popcount_bytes_sse(__m128i v) {
+    const __m128i lut  = _mm_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m128i low4 = _mm_set1_epi8(0x0F);
+    __m128i lo = _mm_and_si128(v, low4);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low4);
+    return _mm_add_epi8(_mm_shuffle_epi8(lut, lo), _mm_shuffle_epi8(lut, hi));
+  }
+
+  /// Sum the byte counts within each T sized element, leaving the total in its low byte.
+  inline __m128i sum_bytes_sse(__m128i c, uint8 ) { return c; }
+  inline __m128i sum_bytes_sse(__m128i c, uint16) { return _mm_maddubs_epi16(c, _mm_set1_epi8(1)); }
+  inline __m128i sum_bytes_sse(__m128i c, uint32) {
+    return _mm_madd_epi16(_mm_maddubs_epi16(c, _mm_set1_epi8(1)), _mm_set1_epi16(1));
+  }
+  inline __m128i sum_bytes_sse(__m128i c, uint64) { return _mm_sad_epu8(c, _mm_setzero_si128()); }
+
+  /// Store the first count bytes of v, where count is 2, 4, 8, or 16.
+  inline void store_bytes_sse(uint8* output, __m128i v, int count) {
+    switch (count) {
+      case 16: _mm_storeu_si128((__m128i*)output, v); break;
+      case 8:  _mm_storel_epi64((__m128i*)output, v); break;
+      case 4:  { int32  x = _mm_cvtsi128_si32(v);     memcpy(output, &x, 4); break; }
+      default: { uint16 x = _mm_extract_epi16(v, 0);  memcpy(output, &x, 2); break; }
+    };
+  }
+
+  template <typename T>
+  void hamming_row_sse(T left, const T* right, int n, uint8* output) {
+    const int LANES = 16 / sizeof(T);
+    char mask_data[16];
+    low_byte_shuffle<T>(mask_data, 0);
+    const __m128i gather = _mm_loadu_si128((const __m128i*)mask_data);
+    const __m128i vleft  = broadcast_sse(left);
+    int i = 0;
+    for (; i+LANES<=n; i+=LANES) {
+      __m128i v = _mm_xor_si128(vleft, _mm_loadu_si128((const __m128i*)(right+i)));
+      v = _mm_shuffle_epi8(sum_bytes_sse(popcount_bytes_sse(v), T()), gather);
+      store_bytes_sse(output+i, v, LANES);
     }
-    std::cout << std::endl;
+    hamming_row_scalar(left, right+i, n-i, output+i);
+  }
 
-    std::cout << "Full prior buffer: \n";
-    i = 0;
-    for (int r=0; r<m_num_disp_y; ++r) {
-      for (int c=0; c<m_num_disp_x; ++c) {
-        std::cout << full_prior_buffer[i] << " ";
-        ++i;
+#if defined(VW_SGM_AVX_KERNELS)
+
+  __attribute__((target("avx2"))) inline __m256i broadcast_avx2(uint8  v) { return _mm256_set1_epi8 (static_cast<char >(v)); }
+  __attribute__((target("avx2"))) inline __m256i broadcast_avx2(uint16 v) { return _mm256_set1_epi16(static_cast<short>(v)); }
+  __attribute__((target("avx2"))) inline __m256i broadcast_avx2(uint32 v) { return _mm256_set1_epi32(static_cast<int  >(v)); }
+  __attribute__((target("avx2"))) inline __m256i broadcast_avx2(uint64 v) { return _mm256_set1_epi64x(static_cast<long long>(v)); }
+
+  __attribute__((target("avx2")))
+  inline __m256i popcount_bytes_avx2(__m256i v) {
+    const __m256i lut  = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                          0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low4 = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_and_si256(v, low4);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low4);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+  }
+
+  __attribute__((target("avx2"))) inline __m256i sum_bytes_avx2(__m256i c, uint8 ) { return c; }
+  __attribute__((target("avx2"))) inline __m256i sum_bytes_avx2(__m256i c, uint16) {
+    return _mm256_maddubs_epi16(c, _mm256_set1_epi8(1));
+  }
+  __attribute__((target("avx2"))) inline __m256i sum_bytes_avx2(__m256i c, uint32) {
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(c, _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+  }
+  __attribute__((target("avx2"))) inline __m256i sum_bytes_avx2(__m256i c, uint64) {
+    return _mm256_sad_epu8(c, _mm256_setzero_si256());
+  }
+
+  template <typename T> __attribute__((target("avx2")))
+  void hamming_row_avx2(T left, const T* right, int n, uint8* output) {
+    const int LANES      = 32 / sizeof(T);
+    const int LANE_COUNT = 16 / sizeof(T); // Elements in each 128 bit half
+    // The shuffle works within each 128 bit half, so the upper half is gathered to
+    //  the positions following the lower half's results and the halves are merged.
+    char mask_data[32];
+    low_byte_shuffle<T>(mask_data,    0);
+    low_byte_shuffle<T>(mask_data+16, LANE_COUNT);
+    const __m256i gather = _mm256_loadu_si256((const __m256i*)mask_data);
+    const __m256i vleft  = broadcast_avx2(left);
+    int i = 0;
+    for (; i+LANES<=n; i+=LANES) {
+      __m256i v = _mm256_xor_si256(vleft, _mm256_loadu_si256((const __m256i*)(right+i)));
+      v = sum_bytes_avx2(popcount_bytes_avx2(v), T());
+      if (sizeof(T) == 1) {
+        _mm256_storeu_si256((__m256i*)(output+i), v);
+      } else {
+        v = _mm256_shuffle_epi8(v, gather);
+        __m128i merged = _mm_or_si128(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        store_bytes_sse(output+i, merged, LANES);
       }
-      std::cout << std::endl;
     }
-    std::cout << std::endl;
+    hamming_row_sse(left, right+i, n-i, output+i);
   }
-  const int LOOKUP_TABLE_WIDTH = 8;
 
-  // Loop through disparities for this pixel
-  int packed_d = 0; // Index for cost and output vectors
-  for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
-
-    // Need the disparity index from all of m_num_disp for proper indexing into full_prior_buffer
-    int full_d = xy_to_disp(pixel_disp_bounds[0], dy);
-
-    for (int dx=pixel_disp_bounds[0]; dx<=pixel_disp_bounds[2]; ++dx) {
-
-      // Start with the cost for the same disparity in the previous pixel
-      AccumCostType lowest_combined_cost = full_prior_buffer[full_d];
-
-      // Compare to the eight adjacent disparities using the lookup table
-      const int lookup_index = full_d*LOOKUP_TABLE_WIDTH;
-
-      // TODO: This is the slowest part of the algorithm!
-      // Note that the lookup table indexes into a full size buffer of disparities, not the compressed
-      //  buffers that are stored for each pixel.  This allows us to use a single lookup table for every pixel
-      //  and avoid any bounds checking logic inside this loop.
-      AccumCostType lowest_adjacent_cost =                  full_prior_buffer[m_adjacent_disp_lookup[lookup_index  ]];
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+1]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+2]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+3]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+4]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+5]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+6]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+7]]);
-
-      // Now add the adjacent penalty cost and compare to the local cost
-      lowest_adjacent_cost += m_p1;
-      lowest_combined_cost = std::min(lowest_combined_cost, lowest_adjacent_cost);
-
-      // Compare to the lowest prev disparity cost regardless of location
-      lowest_combined_cost = std::min(lowest_combined_cost, min_prev_disparity_cost);
-
-      // The output cost = local cost + lowest combined cost - min_prior
-      // - Subtracting out min_prior avoids overflow.
-      output[packed_d] = local[packed_d] + lowest_combined_cost - min_prior;
-
-      //if (debug) {
-      //  printf("Details %d: local = %d, lowest_adjacent_cost = %d, prev_cost = %d, lowest_combined_cost = %d, output = %d\n", 
-      //        packed_d, local[packed_d], lowest_adjacent_cost, full_prior_buffer[full_d], lowest_combined_cost, output[packed_d]);
-      //}
-
-      ++packed_d;
-      ++full_d;
+  __attribute__((target("avx512f,avx512bw,avx512bitalg")))
+  void hamming_row_avx512_u8(uint8 left, const uint8* right, int n, uint8* output) {
+    const __m512i vleft = _mm512_set1_epi8(static_cast<char>(left));
+    for (int i=0; i<n; i+=64) {
+      const __mmask64 mask = (n-i >= 64) ? ~__mmask64(0) : ((__mmask64(1) << (n-i)) - 1);
+      __m512i v = _mm512_xor_si512(vleft, _mm512_maskz_loadu_epi8(mask, right+i));
+      _mm512_mask_storeu_epi8(output+i, mask, _mm512_popcnt_epi8(v));
     }
-  } // End loop through this disparity  
+  }
 
-  if(debug) {
-    int min_val   = 99999;
-    int min_index = 0;
+  __attribute__((target("avx512f,avx512bw,avx512bitalg")))
+  void hamming_row_avx512_u16(uint16 left, const uint16* right, int n, uint8* output) {
+    const __m512i vleft = _mm512_set1_epi16(static_cast<short>(left));
+    for (int i=0; i<n; i+=32) {
+      const __mmask32 mask = (n-i >= 32) ? 0xFFFFFFFFu : ((1u << (n-i)) - 1);
+      __m512i v = _mm512_xor_si512(vleft, _mm512_maskz_loadu_epi16(mask, right+i));
+      _mm512_mask_cvtepi16_storeu_epi8(output+i, mask, _mm512_popcnt_epi16(v));
+    }
+  }
 
-    std::cout << "Output: \n";
-    int i=0;
-    for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
-      for (int dx=pixel_disp_bounds[0]; dx<=pixel_disp_bounds[2]; ++dx) {
-        std::cout << output[i] << " ";
-        if (output[i] < min_val) {
-          min_val   = output[i];
-          min_index = i;
-        }
-        ++i;
-      }
-      std::cout << std::endl;
+  __attribute__((target("avx512f,avx512vpopcntdq")))
+  void hamming_row_avx512_u32(uint32 left, const uint32* right, int n, uint8* output) {
+    const __m512i vleft = _mm512_set1_epi32(static_cast<int>(left));
+    for (int i=0; i<n; i+=16) {
+      const __mmask16 mask = (n-i >= 16) ? 0xFFFF : ((1u << (n-i)) - 1);
+      __m512i v = _mm512_xor_si512(vleft, _mm512_maskz_loadu_epi32(mask, right+i));
+      _mm512_mask_cvtepi32_storeu_epi8(output+i, mask, _mm512_popcnt_epi32(v));
     }
-    std::cout << std::endl;
+  }
 
-    DisparityType dx, dy;
-    disp_to_xy(min_index, dx, dy);
-    std::cout << "Min value = " << min_val << std::endl;
-    std::cout << "Disp = " << dx-4 <<", " << dy-4 << std::endl;
-    std::cout << "Min index = " << min_index << std::endl<< std::endl;
-    std::cout << "========================================\n\n";
+  __attribute__((target("avx512f,avx512vpopcntdq")))
+  void hamming_row_avx512_u64(uint64 left, const uint64* right, int n, uint8* output) {
+    const __m512i vleft = _mm512_set1_epi64(static_cast<long long>(left));
+    for (int i=0; i<n; i+=8) {
+      const __mmask8 mask = (n-i >= 8) ? 0xFF : ((1u << (n-i)) - 1);
+      __m512i v = _mm512_xor_si512(vleft, _mm512_maskz_loadu_epi64(mask, right+i));
+      _mm512_mask_cvtepi64_storeu_epi8(output+i, mask, _mm512_popcnt_epi64(v));
+    }
   }
-  // Remove the valid disparity scores from full_prior buffer.
-  for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
 
-    // Get initial fill linear storage index for this dy row
-    int full_index = xy_to_disp(pixel_disp_bounds_p[0], dy);
+#endif // AVX kernels
+#endif // VW_ENABLE_SSE
 
-    for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
+  PathRowKernel path_row_kernel = path_row_scalar;
+  MinKernel     min_kernel      = min_scalar;
+  vw::RunOnce   sgm_kernel_once = VW_RUNONCE_INIT;
 
-      full_prior_buffer[full_index] = BAD_VAL;
-      ++full_index;
+  /// Pick the fastest path accumulation and census cost kernels that the current CPU supports.
+  void select_sgm_kernels() {
+    std::string name = "scalar";
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+    path_row_kernel = path_row_sse;
+    min_kernel      = min_sse;
+    HammingRowKernel<uint8 >::func = hamming_row_sse<uint8 >;
+    HammingRowKernel<uint16>::func = hamming_row_sse<uint16>;
+    HammingRowKernel<uint32>::func = hamming_row_sse<uint32>;
+    HammingRowKernel<uint64>::func = hamming_row_sse<uint64>;
+    name = "SSE4.1";
+#if defined(VW_SGM_AVX_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      path_row_kernel = path_row_avx2;
+      min_kernel      = min_avx2;
+      HammingRowKernel<uint8 >::func = hamming_row_avx2<uint8 >;
+      HammingRowKernel<uint16>::func = hamming_row_avx2<uint16>;
+      HammingRowKernel<uint32>::func = hamming_row_avx2<uint32>;
+      HammingRowKernel<uint64>::func = hamming_row_avx2<uint64>;
+      name = "AVX2";
+    }
+    if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) {
+      path_row_kernel = path_row_avx512;
+      min_kernel      = min_avx512;
+      name = "AVX-512";
+    }
+    if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512bitalg")) {
+      HammingRowKernel<uint8 >::func = hamming_row_avx512_u8;
+      HammingRowKernel<uint16>::func = hamming_row_avx512_u16;
+    }
+    if (__builtin_cpu_supports("avx512vpopcntdq")) {
+      HammingRowKernel<uint32>::func = hamming_row_avx512_u32;
+      HammingRowKernel<uint64>::func = hamming_row_avx512_u64;
     }
+#endif
+#endif
+    vw_out(DebugMessage, "stereo") << "SGM: Using " << name << " kernels.\n";
   }
 
-}
-#endif
+} // end anonymous namespace
 
-#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+
+// Note: local and output are the same size.
+// full_prior_buffer is always length get_full_prior_buffer_size() and comes in initialized
+//  to a large flag value.  When the function quits the buffer must be returned to this state.
 void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
                        AccumCostType* const prior,
                        AccumCostType*       full_prior_buffer,
@@ -878,130 +964,67 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
   if (p2_mod < m_p1)
     p2_mod = m_p1;
 
-  Vector4i pixel_disp_bounds   = m_disp_bound_image(col, row);
-  Vector4i pixel_disp_bounds_p = m_disp_bound_image(col_p, row_p);
+  Vector4i pixel_disp_bounds   = m_disp_bounds(col, row);
+  Vector4i pixel_disp_bounds_p = m_disp_bounds(col_p, row_p);
+
+  const int stride     = m_num_disp_x+2;
+  const int width_p    = pixel_disp_bounds_p[2] - pixel_disp_bounds_p[0] + 1;
+  const int height_p   = pixel_disp_bounds_p[3] - pixel_disp_bounds_p[1] + 1;
+  const int num_prior  = (width_p > 0 && height_p > 0) ? width_p*height_p : 0;
 
   // Init the min prior in case the previous pixel is invalid.
-  AccumCostType BAD_VAL = get_bad_accum_val();
-  AccumCostType min_prior = BAD_VAL;
+  AccumCostType BAD_VAL   = get_bad_accum_val();
+  AccumCostType min_prior = min_kernel(prior, num_prior, BAD_VAL);
 
   // Insert the valid disparity scores into full_prior buffer so they are
   //  easy to access quickly within the pixel loop below.
-  // - If we don't use a full sized buffer, our adjacent disparity lookup
-  //   table could not be used!
-  int d = 0;
-  for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
-
-    // Get initial fill linear storage index for this dy row
-    int full_index = xy_to_disp(pixel_disp_bounds_p[0], dy);
-
-    for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
-    
-      // Get the min prior while we are at it.
-      if (prior[d] < min_prior) {
-        min_prior  = prior[d];
-      }
-    
-      full_prior_buffer[full_index] = prior[d];
-      ++full_index;
-      ++d;
-    }
+  for (int r=0; r<height_p && num_prior>0; ++r) {
+    AccumCostType* dest = full_prior_buffer + full_prior_index(pixel_disp_bounds_p[0],
+                                                               pixel_disp_bounds_p[1]+r);
+    std::copy(prior+r*width_p, prior+(r+1)*width_p, dest);
   }
   AccumCostType min_prev_disparity_cost = min_prior + p2_mod;
 
-  const int LOOKUP_TABLE_WIDTH = 8;
-  
-  // Allocate linear storage for data to pass to SSE instructions
-  const int SSE_BUFF_LEN = 8;
-  uint16 d_packed[SSE_BUFF_LEN*11] __attribute__ ((aligned (16))); // TODO: Could be passed in!
-  uint16* dL   = &(d_packed[0*SSE_BUFF_LEN]);
-  uint16* d0   = &(d_packed[1*SSE_BUFF_LEN]);
-  uint16* d1   = &(d_packed[2*SSE_BUFF_LEN]);
-  uint16* d2   = &(d_packed[3*SSE_BUFF_LEN]);
-  uint16* d3   = &(d_packed[4*SSE_BUFF_LEN]);
-  uint16* d4   = &(d_packed[5*SSE_BUFF_LEN]);
-  uint16* d5   = &(d_packed[6*SSE_BUFF_LEN]);
-  uint16* d6   = &(d_packed[7*SSE_BUFF_LEN]);
-  uint16* d7   = &(d_packed[8*SSE_BUFF_LEN]);
-  uint16* d8   = &(d_packed[9*SSE_BUFF_LEN]);
-  uint16* dRes = &(d_packed[10*SSE_BUFF_LEN]); // The results
-  
-  // Set up constant SSE registers that never change
-  __m128i _dJ  = _mm_set1_epi16(static_cast<int16>(min_prev_disparity_cost));
-  __m128i _dP  = _mm_set1_epi16(static_cast<int16>(min_prior));
-  __m128i _dp1 = _mm_set1_epi16(static_cast<int16>(m_p1));
-  
-  //printf("dJ = %d, dP = %d, dp1 = %d\n", min_prev_disparity_cost, min_prior, m_p1);
-  //std::cout << "pixel_disp_bounds = " << pixel_disp_bounds << std::endl;
-  
-  // Loop through disparities for this pixel
-  int sse_index = 0, output_index = 0;
+  if (debug) {
+    std::cout << "Prior pixel = ("<<col_p<<","<<row_p<<")\n";
+    std::cout << "p2_mod  : " << p2_mod << std::endl;
+    std::cout << "Bounds  : " << pixel_disp_bounds << std::endl;
+    std::cout << "Bounds_P: " << pixel_disp_bounds_p << std::endl;
+    std::cout << "min_prior = " <<  min_prior << std::endl;
+    std::cout << "min_prev_disparity_cost = " <<  min_prev_disparity_cost << std::endl;
+  }
+
+  // Process each row of disparities for this pixel with the vector kernel.
+  const int width = pixel_disp_bounds[2] - pixel_disp_bounds[0] + 1;
   int packed_d = 0; // Index for cost and output vectors
-  for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
-
-    // Need the disparity index from all of m_num_disp for proper indexing into full_prior_buffer
-    int full_d = xy_to_disp(pixel_disp_bounds[0], dy);
-
-    for (int dx=pixel_disp_bounds[0]; dx<=pixel_disp_bounds[2]; ++dx) {
-
-      // Get local value and matching disparity value
-      dL[sse_index] = local[packed_d];
-      d0[sse_index] = full_prior_buffer[full_d];
-      
-      // Get the 8 surrounding values.
-      // - Is there any way to speed this up?
-      const int lookup_index = full_d*LOOKUP_TABLE_WIDTH;
-      d1[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index  ]];
-      d2[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+1]];
-      d3[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+2]];
-      d4[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+3]];
-      d5[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+4]];
-      d6[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+5]];
-      d7[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+6]];
-      d8[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+7]];
-
-      ++packed_d;
-      ++full_d;
-      ++sse_index;
-
-      // Keep packing the SSE buffers until they are filled up, then use SSE to operate on
-      // all of the data at once.
-      if (sse_index == SSE_BUFF_LEN){
-
-        compute_path_internals_sse(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-                                   _dJ, _dP, _dp1, dRes, sse_index, output_index, output);
-        //compute_path_internals(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-        //                   min_prev_disparity_cost, min_prior, m_p1, dRes, sse_index, output_index, output);
-
-        sse_index = 0;
-      } // End SSE operations
+  for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3] && width>0; ++dy) {
+    path_row_kernel(full_prior_buffer + full_prior_index(pixel_disp_bounds[0], dy), stride,
+                    local+packed_d, width, min_prev_disparity_cost, min_prior, m_p1,
+                    output+packed_d);
+    packed_d += width;
+  }
 
+  if (debug) {
+    std::cout << "Output: \n";
+    int i=0;
+    for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
+      for (int dx=pixel_disp_bounds[0]; dx<=pixel_disp_bounds[2]; ++dx) {
+        std::cout << output[i] << " ";
+        ++i;
+      }
+      std::cout << std::endl;
     }
-  } // End loop through this disparity
-
-  // If there is data left over in the buffer, process it now.
-  if (sse_index > 0) {
-    compute_path_internals_sse(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-                           _dJ, _dP, _dp1, dRes, sse_index, output_index, output);
-    //compute_path_internals(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-    //                       min_prev_disparity_cost, min_prior, m_p1, dRes, sse_index, output_index, output);
+    std::cout << "========================================\n\n";
   }
 
   // Remove the valid disparity scores from full_prior buffer.
-  for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
-
-    // Get initial fill linear storage index for this dy row
-    int full_index = xy_to_disp(pixel_disp_bounds_p[0], dy);
-
-    for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
-
-      full_prior_buffer[full_index] = BAD_VAL;
-      ++full_index;
-    }
+  for (int r=0; r<height_p && num_prior>0; ++r) {
+    AccumCostType* dest = full_prior_buffer + full_prior_index(pixel_disp_bounds_p[0],
+                                                               pixel_disp_bounds_p[1]+r);
+    std::fill(dest, dest+width_p, BAD_VAL);
   }
 
-} // End evaluate_path SSE
-#endif
+} // End evaluate_path
 
 
 /* This function is not 100% successful at removing "multiple minimums"
@@ -1174,6 +1197,34 @@ int SemiGlobalMatcher::select_best_disparity(AccumCostType * accum_vec,
   return min_count;
 } // End function select_best_disparity
 
+void SemiGlobalMatcher::update_right_disparity(AccumCostType const* accum_vec, int col, int row) {
+  // The left pixel (col,row) with disparity (dx,dy) matches the right pixel (col+dx,row+dy).
+  const Vector4i bounds = m_disp_bounds(col, row);
+  const int d_width = bounds[2] - bounds[0] + 1;
+  for (int dy = bounds[1]; dy <= bounds[3]; ++dy) {
+    const int right_row = row + dy;
+    AccumCostType const* costs = accum_vec + (dy-bounds[1])*d_width;
+    if (right_row < 0)
+      continue;
+    for (int dx = bounds[0]; dx <= bounds[2]; ++dx) {
+      const int right_col = col + dx;
+      if (right_col < 0)
+        continue;
+      // Ties go to the smallest disparity so the result does not depend on
+      //  the order the left pixels are visited in.
+      AccumCostType &best = m_right_best_cost(right_col, right_row);
+      const AccumCostType cost = costs[dx-bounds[0]];
+      if (cost > best)
+        continue;
+      DisparityImage::pixel_type &rl = m_right_disparity(right_col, right_row);
+      if (cost < best || dy < -rl[1] || (dy == -rl[1] && dx < -rl[0])) {
+        best = cost;
+        rl   = DisparityImage::pixel_type(-dx, -dy);
+      }
+    }
+  }
+}
+
 SemiGlobalMatcher::DisparityImage
 SemiGlobalMatcher::create_disparity_view() {
   // Init output vector
@@ -1229,12 +1280,14 @@ SemiGlobalMatcher::create_disparity_view() {
       // Valid pixel, choose the best disparity.
 
       bool debug = false;//((j==2937) && (i >= 4635) && (i <= 4645));
-      const Vector4i bounds = m_disp_bound_image(i, j);
+      const Vector4i bounds = m_disp_bounds(i, j);
       AccumCostType  *accum_vec = get_accum_vector(i, j);
       if (debug)
         std::cout << "j = " << j << ", i = " << i << std::endl;
       select_best_disparity(accum_vec, bounds, min_index, accum_buffer, debug);
       disp_index_to_xy(min_index, i, j, dx, dy);
+      if (m_compute_right_disparity)
+        update_right_disparity(accum_vec, i, j);
 
       disparity(i,j) = DisparityImage::pixel_type(dx, dy);
 
@@ -1391,6 +1444,44 @@ double SemiGlobalMatcher::compute_subpixel_ratio(AccumCostType prev, AccumCostTy
 */
 
 
+bool SemiGlobalMatcher::find_subpixel_offset(AccumCostType const* accum_vec, Vector4i const& bounds,
+                                             int dx, int dy, ParabolaFit2d &fitter,
+                                             double &delta_x, double &delta_y) {
+  int width = (bounds[2] - bounds[0] + 1);
+
+  // Linear index of the min offset that will be checked
+  int min_index = (dy-bounds[1])*width + (dx-bounds[0]);
+
+  // Get the indices of where to find the four adjacent pixels
+  int x_left  = -1;
+  int x_right =  1;
+  int y_up    = -width;
+  int y_down  =  width;
+
+  // Don't interpolate out of bounds
+  bool top_bound, bottom_bound, left_bound, right_bound;
+  top_bound = bottom_bound = left_bound = right_bound = false;
+  if (dx == bounds[0]) { x_left  = 0; left_bound   = true; }
+  if (dx == bounds[2]) { x_right = 0; right_bound  = true; }
+  if (dy == bounds[1]) { y_up    = 0; top_bound    = true; }
+  if (dy == bounds[3]) { y_down  = 0; bottom_bound = true; }
+
+  if (m_subpixel_type == SUBPIXEL_PARABOLA) {
+    return fitter.find_peak( accum_vec[min_index+x_left+y_up  ],  accum_vec[min_index+y_up  ], accum_vec[min_index+x_right+y_up  ],
+                             accum_vec[min_index+x_left       ],  accum_vec[min_index       ], accum_vec[min_index+x_right       ],
+                             accum_vec[min_index+x_left+y_down],  accum_vec[min_index+y_down], accum_vec[min_index+x_right+y_down],
+                             delta_x, delta_y);
+  }
+
+  // This branch handles all 1D interpolation methods.
+  // - These methods are always considered valid.
+  delta_x = compute_subpixel_offset(accum_vec[min_index+x_left], accum_vec[min_index], accum_vec[min_index+x_right], 
+                                    left_bound, right_bound, false);
+  delta_y = compute_subpixel_offset(accum_vec[min_index+y_up  ], accum_vec[min_index], accum_vec[min_index+y_down ], 
+                                    top_bound, bottom_bound, false);
+  return true;
+}
+
 // Test out alternate subpixel methods
 ImageView<PixelMask<Vector2f> > SemiGlobalMatcher::
 create_disparity_view_subpixel(DisparityImage const& integer_disparity) {
@@ -1415,9 +1506,7 @@ create_disparity_view_subpixel(DisparityImage const& integer_disparity) {
   for ( int j = 0; j < m_num_output_rows; j++ ) {
     for ( int i = 0; i < m_num_output_cols; i++ ) {
 
-      const Vector4i bounds = m_disp_bound_image(i,j);
-      //int height   = (bounds[3] - bounds[1] + 1);
-      int width    = (bounds[2] - bounds[0] + 1);
+      const Vector4i bounds = m_disp_bounds(i,j);
 
       // Check the input image to find masked pixels
       PixelMask<Vector2i> integer_pixel = integer_disparity(i, j);
@@ -1436,43 +1525,16 @@ create_disparity_view_subpixel(DisparityImage const& integer_disparity) {
         continue;
       }
 
-      // Linear index of the min offset that will be checked
-      int min_index = (dy-bounds[1])*width + (dx-bounds[0]);
-
-      // Get the indices of where to find the four adjacent pixels
-      int x_left  = -1;
-      int x_right =  1;
-      int y_up    = -width;
-      int y_down  =  width;
-
-      // Don't interpolate out of bounds
-      bool top_bound, bottom_bound, left_bound, right_bound;
-      top_bound = bottom_bound = left_bound = right_bound = false;
-      if (dx == bounds[0]) { x_left  = 0; left_bound   = true; }
-      if (dx == bounds[2]) { x_right = 0; right_bound  = true; }
-      if (dy == bounds[1]) { y_up    = 0; top_bound    = true; }
-      if (dy == bounds[3]) { y_down  = 0; bottom_bound = true; }
+      // The low-memory mode already computed subpixel values while the accumulated
+      //  costs were available.
+      if (m_low_memory && !m_use_mgm) {
+        disparity(i,j) = m_streamed_subpixel(i,j);
+        continue;
+      }
 
       // Apply subpixel correction and apply
       AccumCostType const* accum_vec = get_accum_vector(i, j);
-
-      bool debug = false;//((j==2937) && (i >= 4635) && (i <= 4645));
-
-      bool valid = true;
-      if (m_subpixel_type == SUBPIXEL_PARABOLA) {
-        valid = fitter.find_peak( accum_vec[min_index+x_left+y_up  ],  accum_vec[min_index+y_up  ], accum_vec[min_index+x_right+y_up  ],
-                                  accum_vec[min_index+x_left       ],  accum_vec[min_index       ], accum_vec[min_index+x_right       ],
-                                  accum_vec[min_index+x_left+y_down],  accum_vec[min_index+y_down], accum_vec[min_index+x_right+y_down],
-                                  delta_x, delta_y);
-      }
-      else {
-        // This branch handles all 1D interpolation methods.
-        // - These methods are always considered valid.
-        delta_x = compute_subpixel_offset(accum_vec[min_index+x_left], accum_vec[min_index], accum_vec[min_index+x_right], 
-                                          left_bound, right_bound, debug);
-        delta_y = compute_subpixel_offset(accum_vec[min_index+y_up  ], accum_vec[min_index], accum_vec[min_index+y_down ], 
-                                          top_bound, bottom_bound, false);
-      }
+      bool valid = find_subpixel_offset(accum_vec, bounds, dx, dy, fitter, delta_x, delta_y);
 /*
       if (debug) {
         double ratio = 0.0;//compute_subpixel_ratio(accum_vec[min_index+x_left], accum_vec[min_index], accum_vec[min_index+x_right]);
@@ -1613,15 +1675,16 @@ SemiGlobalMatcher::CostType SemiGlobalMatcher::get_cost_block(ImageView<uint8> c
 }
 
 void SemiGlobalMatcher::fill_costs_block(ImageView<uint8> const& left_image,
-                                         ImageView<uint8> const& right_image){
+                                         ImageView<uint8> const& right_image,
+                                         int first_row, int last_row, CostType* output){
   // Make sure we don't go out of bounds here due to the disparity shift and kernel.
   size_t cost_index = 0;
-  for ( int r = m_min_row; r <= m_max_row; r++ ) { // For each row in left
+  for ( int r = m_min_row+first_row; r <= m_min_row+last_row; r++ ) { // For each row in left
     int output_row = r - m_min_row;
     for ( int c = m_min_col; c <= m_max_col; c++ ) { // For each column in left
       int output_col = c - m_min_col;
 
-      Vector4i pixel_disp_bounds = m_disp_bound_image(output_col, output_row);
+      Vector4i pixel_disp_bounds = m_disp_bounds(output_col, output_row);
 
       // These statistics are used repeatedly for this particular cost type.
       double mean_left=0, std_left=1;
@@ -1634,7 +1697,7 @@ void SemiGlobalMatcher::fill_costs_block(ImageView<uint8> const& left_image,
 
           CostType cost = get_cost_block(left_image, right_image, mean_left, std_left,
                                          c, r, c+dx,r+dy, false);
-          m_cost_buffer[cost_index] = cost;
+          output[cost_index] = cost;
           ++cost_index;
         }
       } // End disparity loops
@@ -1645,150 +1708,245 @@ void SemiGlobalMatcher::fill_costs_block(ImageView<uint8> const& left_image,
 
 
 
+void SemiGlobalMatcher::get_census_row_range(ImageView<uint8> const& left_image,
+                                             ImageView<uint8> const& right_image,
+                                             int first_row, int last_row,
+                                             int &left_start,  int &left_end,
+                                             int &right_start, int &right_end) const {
+  const int half_kernel = (m_kernel_size - 1) / 2;
+  const int padding     = 2*half_kernel;
+
+  // Census image rows are offset from the input image rows by half the kernel size,
+  //  and the right image rows must cover the vertical search range.
+  left_start  = m_min_row + first_row - half_kernel;
+  left_end    = m_min_row + last_row  - half_kernel;
+  right_start = left_start + m_min_disp_y;
+  right_end   = left_end   + m_max_disp_y;
+
+  // Stay inside the census images
+  const int last_left_row  = left_image.rows()  - padding - 1;
+  const int last_right_row = right_image.rows() - padding - 1;
+  if (left_start  < 0             ) left_start  = 0;
+  if (left_end    > last_left_row ) left_end    = last_left_row;
+  if (right_start < 0             ) right_start = 0;
+  if (right_end   > last_right_row) right_end   = last_right_row;
+}
+
+// From the census transformed input images, compute the cost of each disparity value.
+template <typename T>
+void SemiGlobalMatcher::get_hamming_distance_costs(ImageView<T> const& left_binary_image,
+                                                   ImageView<T> const& right_binary_image,
+                                                   int left_start, int right_start,
+                                                   int first_row, int last_row, CostType* output) {
+
+  const int half_kernel = (m_kernel_size - 1) / 2;
+  const int row_shift   = left_start - right_start; // Converts left binary rows to right binary rows
+
+  // The right census values for one row of a pixel's disparity range are contiguous,
+  //  so each row of costs is filled with a single call to the vector kernel.
+  typename HammingRowKernel<T>::Func hamming_row = HammingRowKernel<T>::func;
+
+  // Now compute the disparity costs for each pixel.
+  // Make sure we don't go out of bounds here due to the disparity shift and kernel.
+  size_t cost_index = 0;
+  for ( int r = m_min_row+first_row; r <= m_min_row+last_row; r++ ) { // For each row in left
+    int output_row = r - m_min_row;
+    int binary_row = r - half_kernel - left_start;
+    for ( int c = m_min_col; c <= m_max_col; c++ ) { // For each column in left
+      int output_col = c - m_min_col;
+      int binary_col = c - half_kernel;
+
+      Vector4i pixel_disp_bounds = m_disp_bounds(output_col, output_row);
+      const int num_disp_x = pixel_disp_bounds[2] - pixel_disp_bounds[0] + 1;
+      if (num_disp_x <= 0)
+        continue;
+
+      const T left_value = left_binary_image(binary_col, binary_row);
+      for ( int dy = pixel_disp_bounds[1]; dy <= pixel_disp_bounds[3]; dy++ ) { // For each disparity
+        const T* right_ptr = &right_binary_image(binary_col+pixel_disp_bounds[0],
+                                                 binary_row+row_shift+dy);
+        hamming_row(left_value, right_ptr, num_disp_x, output+cost_index);
+        cost_index += num_disp_x;
+      } // End disparity loops
+    } // End x loop
+  }// End y loop 
+}
+
 void SemiGlobalMatcher::fill_costs_census3x3(ImageView<uint8> const& left_image,
-                                             ImageView<uint8> const& right_image){
+                                             ImageView<uint8> const& right_image,
+                                             int first_row, int last_row, CostType* output){
   const int half_kernel = (m_kernel_size - 1) / 2;
   const int padding     = 2*half_kernel;
 
+  // Only the census rows needed for the requested output rows are computed.
+  int left_start, left_end, right_start, right_end;
+  get_census_row_range(left_image, right_image, first_row, last_row,
+                       left_start, left_end, right_start, right_end);
+
   // Compute the census value for each pixel.
   // - ROI handling could be fancier but this is simple and works.
   // - The 0,0 pixels in the left and right images are assumed to be aligned.
 
   if (m_cost_type == CENSUS_TRANSFORM) {
-    ImageView<uint8> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                     right_census(right_image.cols()-padding, right_image.rows()-padding);
+    ImageView<uint8> left_census (left_image.cols()-padding,  left_end-left_start+1   ), 
+                     right_census(right_image.cols()-padding, right_end-right_start+1);
 
     for ( int r = 0; r < left_census.rows(); r++ )
       for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_3x3(left_image, c+half_kernel, r+half_kernel);
+        left_census(c,r) = get_census_value_3x3(left_image, c+half_kernel, r+left_start+half_kernel);
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_3x3(right_image, c+half_kernel, r+half_kernel);
-    get_hamming_distance_costs(left_census, right_census);
+        right_census(c,r) = get_census_value_3x3(right_image, c+half_kernel, r+right_start+half_kernel);
+    get_hamming_distance_costs(left_census, right_census, left_start, right_start,
+                               first_row, last_row, output);
   } else {
-    ImageView<uint16> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                      right_census(right_image.cols()-padding, right_image.rows()-padding);
+    ImageView<uint16> left_census (left_image.cols()-padding,  left_end-left_start+1   ), 
+                      right_census(right_image.cols()-padding, right_end-right_start+1);
 
     for ( int r = 0; r < left_census.rows(); r++ )
       for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_ternary_3x3(left_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
+        left_census(c,r) = get_census_value_ternary_3x3(left_image, c+half_kernel, r+left_start+half_kernel, m_ternary_census_threshold);
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_ternary_3x3(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-    get_hamming_distance_costs(left_census, right_census);
+        right_census(c,r) = get_census_value_ternary_3x3(right_image, c+half_kernel, r+right_start+half_kernel, m_ternary_census_threshold);
+    get_hamming_distance_costs(left_census, right_census, left_start, right_start,
+                               first_row, last_row, output);
   } 
 
 }
 
 void SemiGlobalMatcher::fill_costs_census5x5(ImageView<uint8> const& left_image,
-                                             ImageView<uint8> const& right_image){
+                                             ImageView<uint8> const& right_image,
+                                             int first_row, int last_row, CostType* output){
   const int half_kernel = (m_kernel_size - 1) / 2;
   const int padding     = 2*half_kernel;
 
+  // Only the census rows needed for the requested output rows are computed.
+  int left_start, left_end, right_start, right_end;
+  get_census_row_range(left_image, right_image, first_row, last_row,
+                       left_start, left_end, right_start, right_end);
+
   // Compute the census value for each pixel.
   // - ROI handling could be fancier but this is simple and works.
   // - The 0,0 pixels in the left and right images are assumed to be aligned.
-  ImageView<uint32> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                    right_census(right_image.cols()-padding, right_image.rows()-padding);
+  ImageView<uint32> left_census (left_image.cols()-padding,  left_end-left_start+1   ), 
+                    right_census(right_image.cols()-padding, right_end-right_start+1);
 
   if (m_cost_type == CENSUS_TRANSFORM) {
     for ( int r = 0; r < left_census.rows(); r++ )
       for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_5x5(left_image, c+half_kernel, r+half_kernel);
+        left_census(c,r) = get_census_value_5x5(left_image, c+half_kernel, r+left_start+half_kernel);
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_5x5(right_image, c+half_kernel, r+half_kernel);
+        right_census(c,r) = get_census_value_5x5(right_image, c+half_kernel, r+right_start+half_kernel);
   } else { // TERNARY_CENSUS_TRANSFORM
     for ( int r = 0; r < left_census.rows(); r++ )
       for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_ternary_5x5(left_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
+        left_census(c,r) = get_census_value_ternary_5x5(left_image, c+half_kernel, r+left_start+half_kernel, m_ternary_census_threshold);
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_ternary_5x5(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
+        right_census(c,r) = get_census_value_ternary_5x5(right_image, c+half_kernel, r+right_start+half_kernel, m_ternary_census_threshold);
   }
-  get_hamming_distance_costs(left_census, right_census);
+  get_hamming_distance_costs(left_census, right_census, left_start, right_start,
+                               first_row, last_row, output);
 }
 
 void SemiGlobalMatcher::fill_costs_census7x7(ImageView<uint8> const& left_image,
-                                             ImageView<uint8> const& right_image){
+                                             ImageView<uint8> const& right_image,
+                                             int first_row, int last_row, CostType* output){
   const int half_kernel = (m_kernel_size - 1) / 2;
   const int padding     = 2*half_kernel;
 
+  // Only the census rows needed for the requested output rows are computed.
+  int left_start, left_end, right_start, right_end;
+  get_census_row_range(left_image, right_image, first_row, last_row,
+                       left_start, left_end, right_start, right_end);
+
   // Compute the census value for each pixel.
   // - ROI handling could be fancier but this is simple and works.
   // - The 0,0 pixels in the left and right images are assumed to be aligned.
-  ImageView<uint64> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                    right_census(right_image.cols()-padding, right_image.rows()-padding);
+  ImageView<uint64> left_census (left_image.cols()-padding,  left_end-left_start+1   ), 
+                    right_census(right_image.cols()-padding, right_end-right_start+1);
 
   if (m_cost_type == CENSUS_TRANSFORM) {
     for ( int r = 0; r < left_census.rows(); r++ )
       for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_7x7(left_image, c+half_kernel, r+half_kernel);
+        left_census(c,r) = get_census_value_7x7(left_image, c+half_kernel, r+left_start+half_kernel);
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_7x7(right_image, c+half_kernel, r+half_kernel);
+        right_census(c,r) = get_census_value_7x7(right_image, c+half_kernel, r+right_start+half_kernel);
   } else { // TERNARY_CENSUS_TRANSFORM
     for ( int r = 0; r < left_census.rows(); r++ )
       for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_ternary_7x7(left_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
+        left_census(c,r) = get_census_value_ternary_7x7(left_image, c+half_kernel, r+left_start+half_kernel, m_ternary_census_threshold);
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_ternary_7x7(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
+        right_census(c,r) = get_census_value_ternary_7x7(right_image, c+half_kernel, r+right_start+half_kernel, m_ternary_census_threshold);
   }
-  get_hamming_distance_costs(left_census, right_census);
+  get_hamming_distance_costs(left_census, right_census, left_start, right_start,
+                               first_row, last_row, output);
 }
 
 void SemiGlobalMatcher::fill_costs_census9x9(ImageView<uint8> const& left_image,
-                                             ImageView<uint8> const& right_image){
+                                             ImageView<uint8> const& right_image,
+                                             int first_row, int last_row, CostType* output){
   const int half_kernel = (m_kernel_size - 1) / 2;
   const int padding     = 2*half_kernel;
+
+  // Only the census rows needed for the requested output rows are computed.
+  int left_start, left_end, right_start, right_end;
+  get_census_row_range(left_image, right_image, first_row, last_row,
+                       left_start, left_end, right_start, right_end);
   
   // Compute the census value for each pixel.
   // - ROI handling could be fancier but this is simple and works.
   // - The 0,0 pixels in the left and right images are assumed to be aligned.
 
   if (m_cost_type == CENSUS_TRANSFORM) {
-    ImageView<uint32> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                      right_census(right_image.cols()-padding, right_image.rows()-padding);
+    ImageView<uint32> left_census (left_image.cols()-padding,  left_end-left_start+1   ), 
+                      right_census(right_image.cols()-padding, right_end-right_start+1);
 
     for ( int r = 0; r < left_census.rows(); r++ )
       for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_9x9(left_image, c+half_kernel, r+half_kernel);
+        left_census(c,r) = get_census_value_9x9(left_image, c+half_kernel, r+left_start+half_kernel);
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_9x9(right_image, c+half_kernel, r+half_kernel);  
-    get_hamming_distance_costs(left_census, right_census);
+        right_census(c,r) = get_census_value_9x9(right_image, c+half_kernel, r+right_start+half_kernel);  
+    get_hamming_distance_costs(left_census, right_census, left_start, right_start,
+                               first_row, last_row, output);
   } else { // TERNARY_CENSUS_TRANSFORM
-    ImageView<uint64> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                      right_census(right_image.cols()-padding, right_image.rows()-padding);
+    ImageView<uint64> left_census (left_image.cols()-padding,  left_end-left_start+1   ), 
+                      right_census(right_image.cols()-padding, right_end-right_start+1);
 
     for ( int r = 0; r < left_census.rows(); r++ )
       for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_ternary_9x9(left_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
+        left_census(c,r) = get_census_value_ternary_9x9(left_image, c+half_kernel, r+left_start+half_kernel, m_ternary_census_threshold);
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_ternary_9x9(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-    get_hamming_distance_costs(left_census, right_census);
+        right_census(c,r) = get_census_value_ternary_9x9(right_image, c+half_kernel, r+right_start+half_kernel, m_ternary_census_threshold);
+    get_hamming_distance_costs(left_census, right_census, left_start, right_start,
+                               first_row, last_row, output);
   }
 }
 
 // TODO: Add multithreading capability to this function!
 void SemiGlobalMatcher::compute_disparity_costs(ImageView<uint8> const& left_image,
-                                                ImageView<uint8> const& right_image) {  
+                                                ImageView<uint8> const& right_image,
+                                                int first_row, int last_row, CostType* output) {  
   //Timer timer("\tSGM Cost Calculation");
   if ((m_cost_type == CENSUS_TRANSFORM) || (m_cost_type == TERNARY_CENSUS_TRANSFORM)) {
     switch(m_kernel_size) {
-    case 3:  fill_costs_census3x3(left_image, right_image); break;
-    case 5:  fill_costs_census5x5(left_image, right_image); break;
-    case 7:  fill_costs_census7x7(left_image, right_image); break;
-    case 9:  fill_costs_census9x9(left_image, right_image); break;
+    case 3:  fill_costs_census3x3(left_image, right_image, first_row, last_row, output); break;
+    case 5:  fill_costs_census5x5(left_image, right_image, first_row, last_row, output); break;
+    case 7:  fill_costs_census7x7(left_image, right_image, first_row, last_row, output); break;
+    case 9:  fill_costs_census9x9(left_image, right_image, first_row, last_row, output); break;
     default: vw_throw( NoImplErr() << "Census transforms are only available in size 3, 5, 7, and 9!\n"
                                    << "Other cost mode options do not have this restriction.");
     };
   }
   else { // Use the default mean of diff cost function
     // Replace this with ASP's efficient existing cost functions?
-    fill_costs_block(left_image, right_image);
+    fill_costs_block(left_image, right_image, first_row, last_row, output);
   }
 
   /*
@@ -1803,7 +1961,7 @@ void SemiGlobalMatcher::compute_disparity_costs(ImageView<uint8> const& left_ima
     for ( int c = m_min_col; c <= m_max_col; c++ ) { // For each column in left
       int output_col = c - m_min_col;
 
-      Vector4i pixel_disp_bounds = m_disp_bound_image(output_col, output_row);
+      Vector4i pixel_disp_bounds = m_disp_bounds(output_col, output_row);
 
       CostType min_cost = 255; // Max value of uint8
       CostType max_cost = 0;
@@ -1841,7 +1999,7 @@ void SemiGlobalMatcher::compute_disparity_costs(ImageView<uint8> const& left_ima
    std::fill(cost_image.data(), cost_image.data()+m_num_output_cols*m_num_disp, 255);
    for ( int i = 0; i < m_num_output_cols; i++ ) {
      CostType* buff = get_cost_vector(i, debug_row);
-     Vector4i bounds = m_disp_bound_image(i,debug_row);
+     Vector4i bounds = m_disp_bounds(i,debug_row);
      int index = 0;
      for ( int dy = bounds[1]; dy < bounds[3]; dy++ ) {
        for ( int dx = bounds[0]; dx < bounds[2]; dx++ ) {
@@ -1872,9 +2030,9 @@ void SemiGlobalMatcher::two_trip_path_accumulation(ImageView<uint8> const& left_
   // Init this buffer to bad scores representing disparities that were
   //  not in the search range for the given pixel.
   boost::shared_array<AccumCostType> full_prior_buffer;
-  full_prior_buffer.reset(new AccumCostType[m_num_disp]);
-  for (int i=0; i<m_num_disp; ++i)
-    full_prior_buffer[i] = get_bad_accum_val();  
+  full_prior_buffer.reset(new AccumCostType[get_full_prior_buffer_size()]);
+  std::fill(full_prior_buffer.get(), full_prior_buffer.get()+get_full_prior_buffer_size(),
+            get_bad_accum_val());
 
   AccumCostType* full_prior_ptr = full_prior_buffer.get();
   AccumCostType* output_accum_ptr;
@@ -2017,6 +2175,222 @@ void SemiGlobalMatcher::two_trip_path_accumulation(ImageView<uint8> const& left_
 
 
 
+void SemiGlobalMatcher::accumulate_row_paths(ImageView<uint8> const& left_image, int row, bool forward,
+                                             CostType* costs,
+                                             AccumCostType* trail_rows, AccumCostType* lead_rows,
+                                             size_t row_stride,
+                                             AccumCostType* pixel_buffers, AccumCostType* full_prior_ptr,
+                                             AccumCostType* path_sum) {
+
+  const int  step          = forward ? 1 : -1;
+  const int  last_column   = m_num_output_cols - 1;
+  const int  first_column  = forward ? 0 : last_column;
+  const int  prior_row     = row - step;
+  const bool has_prior_row = (prior_row >= 0) && (prior_row < m_num_output_rows);
+
+  // The three paths from the previous row come from these column offsets.
+  const int NUM_TRAIL_PATHS = 3;
+  const int col_offsets[NUM_TRAIL_PATHS] = {-step, 0, step};
+
+  // The path along the row alternates between these two buffers.
+  AccumCostType* prior_pixel_ptr  = pixel_buffers;
+  AccumCostType* output_pixel_ptr = pixel_buffers + m_num_disp;
+
+  for (int i=0; i<m_num_output_cols; ++i) {
+    const int col = first_column + i*step;
+
+    const int    num_disp = get_num_disparities(col, row);
+    const size_t offset   = get_row_offset(col, row);
+    CostType * const local_cost_ptr = costs + offset;
+
+    // Paths from the previous row
+    for (int p=0; p<NUM_TRAIL_PATHS; ++p) {
+      AccumCostType* output_accum_ptr = lead_rows + p*row_stride + offset;
+      const int col_p = col + col_offsets[p];
+      if (has_prior_row && (col_p >= 0) && (col_p <= last_column)) {
+        int pixel_diff = get_path_pixel_diff(left_image, col, row, col-col_p, step);
+        AccumCostType* const prior_accum_ptr = trail_rows + p*row_stride + get_row_offset(col_p, prior_row);
+        evaluate_path( col, row, col_p, prior_row,
+                       prior_accum_ptr, full_prior_ptr, local_cost_ptr, output_accum_ptr, 
+                       pixel_diff );
+      }
+      else // Just init to the local cost
+        for (int d=0; d<num_disp; ++d) output_accum_ptr[d] = local_cost_ptr[d];
+
+      if (path_sum)
+        for (int d=0; d<num_disp; ++d) path_sum[offset+d] += output_accum_ptr[d];
+    }
+
+    // Path along this row
+    if (i > 0) {
+      int pixel_diff = get_path_pixel_diff(left_image, col, row, step, 0);
+      evaluate_path( col, row, col-step, row,
+                     prior_pixel_ptr, full_prior_ptr, local_cost_ptr, output_pixel_ptr, 
+                     pixel_diff );
+    }
+    else // Just init to the local cost
+      for (int d=0; d<num_disp; ++d) output_pixel_ptr[d] = local_cost_ptr[d];
+
+    if (path_sum)
+      for (int d=0; d<num_disp; ++d) path_sum[offset+d] += output_pixel_ptr[d];
+
+    std::swap(prior_pixel_ptr, output_pixel_ptr);
+  } // End col loop
+} // End function accumulate_row_paths
+
+
+SemiGlobalMatcher::DisparityImage
+SemiGlobalMatcher::streamed_semi_global_matching(ImageView<uint8> const& left_image,
+                                                 ImageView<uint8> const& right_image) {
+
+  //Timer timer_total("\tSGM Low-Memory Accumulation");
+
+  const int NUM_TRAIL_PATHS = 3;
+  const int num_rows   = m_num_output_rows;
+  const int block_rows = m_rows_per_block;
+  const int num_blocks = (num_rows + block_rows - 1) / block_rows;
+
+  // Size the buffers for the longest row and the longest band of rows.
+  size_t max_row_length = 0, max_block_length = 0;
+  for (int r=0; r<num_rows; ++r)
+    max_row_length = std::max(max_row_length, get_rows_length(r, r+1));
+  for (int b=0; b<num_blocks; ++b) {
+    int row_start = b*block_rows;
+    int row_end   = std::min(row_start + block_rows, num_rows);
+    max_block_length = std::max(max_block_length, get_rows_length(row_start, row_end));
+  }
+
+  // Costs and forward path sums for one band of rows
+  boost::shared_array<CostType     > block_costs(new CostType     [max_block_length]);
+  boost::shared_array<AccumCostType> block_sums (new AccumCostType[max_block_length]);
+
+  // Trailing and leading rows for each trip direction
+  const size_t row_set_size = NUM_TRAIL_PATHS*max_row_length;
+  boost::shared_array<AccumCostType> row_buffers(new AccumCostType[4*row_set_size]);
+  AccumCostType* fwd_trail = row_buffers.get();
+  AccumCostType* fwd_lead  = fwd_trail + row_set_size;
+  AccumCostType* bwd_trail = fwd_lead  + row_set_size;
+  AccumCostType* bwd_lead  = bwd_trail + row_set_size;
+
+  boost::shared_array<AccumCostType> pixel_buffers(new AccumCostType[2*m_num_disp]);
+
+  // Init this buffer to bad scores representing disparities that were
+  //  not in the search range for the given pixel.
+  boost::shared_array<AccumCostType> full_prior_buffer(new AccumCostType[get_full_prior_buffer_size()]);
+  std::fill(full_prior_buffer.get(), full_prior_buffer.get()+get_full_prior_buffer_size(),
+            get_bad_accum_val());
+  AccumCostType* full_prior_ptr = full_prior_buffer.get();
+
+  // The forward trip state at the start of each band
+  std::vector<boost::shared_array<AccumCostType> > checkpoints(num_blocks);
+
+  // First pass: run the forward trip through the whole image, saving the
+  //  trailing rows each time a new band is started.
+  for (int b=0; b<num_blocks; ++b) {
+    const int row_start = b*block_rows;
+    const int row_end   = std::min(row_start + block_rows, num_rows) - 1;
+
+    if (b > 0) {
+      const size_t row_length = get_rows_length(row_start-1, row_start);
+      checkpoints[b].reset(new AccumCostType[NUM_TRAIL_PATHS*row_length]);
+      for (int p=0; p<NUM_TRAIL_PATHS; ++p)
+        std::copy(fwd_trail + p*max_row_length, fwd_trail + p*max_row_length + row_length,
+                  checkpoints[b].get() + p*row_length);
+    }
+
+    // The last band is the first one the backward trip needs, so keep its sums.
+    const bool keep_sums = (b == num_blocks-1);
+    if (keep_sums)
+      std::fill(block_sums.get(), block_sums.get()+max_block_length, 0);
+
+    compute_disparity_costs(left_image, right_image, row_start, row_end, block_costs.get());
+    for (int row=row_start; row<=row_end; ++row) {
+      const size_t offset = m_buffer_starts(0, row) - m_buffer_starts(0, row_start);
+      accumulate_row_paths(left_image, row, true, block_costs.get()+offset,
+                           fwd_trail, fwd_lead, max_row_length, pixel_buffers.get(), full_prior_ptr,
+                           keep_sums ? block_sums.get()+offset : 0);
+      std::swap(fwd_trail, fwd_lead);
+    }
+  } // End first pass
+
+  DisparityImage disparity(m_num_output_cols, num_rows);
+  m_streamed_subpixel.set_size(m_num_output_cols, num_rows);
+
+  ParabolaFit2d fitter; // Only used with parabola2d
+  std::vector<AccumCostType> accum_buffer;
+  DisparityType dx, dy;
+  int    min_index = 0;
+  double delta_x, delta_y;
+
+  // Second pass: move up through the bands, restoring the forward trip for each
+  //  one and then running the backward trip through it.
+  for (int b=num_blocks-1; b>=0; --b) {
+    const int row_start = b*block_rows;
+    const int row_end   = std::min(row_start + block_rows, num_rows) - 1;
+
+    if (b < num_blocks-1) {
+      if (b > 0) {
+        const size_t row_length = get_rows_length(row_start-1, row_start);
+        for (int p=0; p<NUM_TRAIL_PATHS; ++p)
+          std::copy(checkpoints[b].get() + p*row_length, checkpoints[b].get() + (p+1)*row_length,
+                    fwd_trail + p*max_row_length);
+        checkpoints[b].reset(); // No longer needed
+      }
+      std::fill(block_sums.get(), block_sums.get()+max_block_length, 0);
+
+      compute_disparity_costs(left_image, right_image, row_start, row_end, block_costs.get());
+      for (int row=row_start; row<=row_end; ++row) {
+        const size_t offset = m_buffer_starts(0, row) - m_buffer_starts(0, row_start);
+        accumulate_row_paths(left_image, row, true, block_costs.get()+offset,
+                             fwd_trail, fwd_lead, max_row_length, pixel_buffers.get(), full_prior_ptr,
+                             block_sums.get()+offset);
+        std::swap(fwd_trail, fwd_lead);
+      }
+    } // End forward trip recompute
+
+    for (int row=row_end; row>=row_start; --row) {
+      const size_t offset = m_buffer_starts(0, row) - m_buffer_starts(0, row_start);
+      AccumCostType* row_sums = block_sums.get()+offset;
+      accumulate_row_paths(left_image, row, false, block_costs.get()+offset,
+                           bwd_trail, bwd_lead, max_row_length, pixel_buffers.get(), full_prior_ptr,
+                           row_sums);
+      std::swap(bwd_trail, bwd_lead);
+
+      // All eight paths are now summed for this row, pick the disparities.
+      for (int col=0; col<m_num_output_cols; ++col) {
+        if (get_num_disparities(col, row) == 0) {
+          // Pixels with no search area were never valid.
+          disparity(col,row) = DisparityImage::pixel_type();
+          invalidate(disparity(col,row));
+          m_streamed_subpixel(col,row) = PixelMask<Vector2f>();
+          invalidate(m_streamed_subpixel(col,row));
+          continue;
+        }
+
+        const Vector4i bounds = m_disp_bounds(col, row);
+        AccumCostType *accum_vec = row_sums + get_row_offset(col, row);
+        select_best_disparity(accum_vec, bounds, min_index, accum_buffer, false);
+        disp_index_to_xy(min_index, col, row, dx, dy);
+        disparity(col,row) = DisparityImage::pixel_type(dx, dy);
+        if (m_compute_right_disparity)
+          update_right_disparity(accum_vec, col, row);
+
+        // The accumulated costs are discarded after this, so do the subpixel step now.
+        if ((m_subpixel_type != SUBPIXEL_NONE) &&
+            find_subpixel_offset(accum_vec, bounds, dx, dy, fitter, delta_x, delta_y))
+          m_streamed_subpixel(col,row) = PixelMask<Vector2f>(dx+delta_x, dy+delta_y);
+        else
+          m_streamed_subpixel(col,row) = PixelMask<Vector2f>(dx, dy);
+      } // End col loop
+    } // End backward row loop
+  } // End second pass
+
+  vw_out(DebugMessage, "stereo") << "Finished creating integer disparity image.\n";
+  return disparity;
+} // End function streamed_semi_global_matching
+
+
+
 // This version of the function requires four passes and is based on the paper:
 // MGM: A Significantly More Global Matching for Stereovision
 void SemiGlobalMatcher::smooth_path_accumulation(ImageView<uint8> const& left_image) {
@@ -2033,9 +2407,9 @@ void SemiGlobalMatcher::smooth_path_accumulation(ImageView<uint8> const& left_im
   // Init this buffer to bad scores representing disparities that were
   //  not in the search range for the given pixel.
   boost::shared_array<AccumCostType> full_prior_buffer;
-  full_prior_buffer.reset(new AccumCostType[m_num_disp]);
-  for (int i=0; i<m_num_disp; ++i)
-    full_prior_buffer[i] = get_bad_accum_val();  
+  full_prior_buffer.reset(new AccumCostType[get_full_prior_buffer_size()]);
+  std::fill(full_prior_buffer.get(), full_prior_buffer.get()+get_full_prior_buffer_size(),
+            get_bad_accum_val());
 
   AccumCostType* full_prior_ptr = full_prior_buffer.get();
   AccumCostType* output_accum_ptr;
@@ -2307,7 +2681,8 @@ SemiGlobalMatcher::semi_global_matching_func( ImageView<uint8> const& left_image
                                               ImageView<uint8> const& right_image,
                                               ImageView<uint8> const* left_image_mask,
                                               ImageView<uint8> const* right_image_mask,
-                                              DisparityImage const* prev_disparity) {
+                                              DisparityImage const* prev_disparity,
+                                              DisparityBounds const* prior_bounds) {
 
   // Compute safe bounds to search through given the disparity range and kernel size.
   // - Using inclusive bounds here.
@@ -2337,6 +2712,9 @@ SemiGlobalMatcher::semi_global_matching_func( ImageView<uint8> const& left_image
   m_num_output_cols  = m_max_col - m_min_col + 1;
   m_num_output_rows  = m_max_row - m_min_row + 1;
 
+  // An automatic switch to the low-memory mode only applies to this call.
+  m_low_memory = m_low_memory_requested;
+
   vw_out(DebugMessage, "stereo") << "Computed SGM cost bounding box: " << std::endl;
   vw_out(DebugMessage, "stereo") << "Left image size = ("<<left_image.cols()<<","<<left_image.rows()
                                <<"), right image size = ("<<right_image.cols()<<","<<right_image.rows()<<")\n";
@@ -2345,24 +2723,37 @@ SemiGlobalMatcher::semi_global_matching_func( ImageView<uint8> const& left_image
                                   ", output_height = "<< m_num_output_rows <<
                                   ", output_width = "<< m_num_output_cols <<"\n";
 
-  populate_adjacent_disp_lookup_table();
+  sgm_kernel_once.run(select_sgm_kernels);
 
   // By default the search bounds are the same for each pixel,
   //  but set them from the prior disparity image if the user passed it in.
   populate_constant_disp_bound_image();
 
-  if (!populate_disp_bound_image(left_image_mask, right_image_mask, prev_disparity)) {
+  if (!populate_disp_bound_image(left_image_mask, right_image_mask, prev_disparity, prior_bounds)) {
     vw_out(WarningMessage, "stereo") << "Unable to compute valid search ranges for SGM input!.\n";
     // If the inputs are invalid, return a default disparity image.
     DisparityImage disparity( m_num_output_cols, m_num_output_rows );
     return invalidate_mask(disparity);
   }
 
+  if (m_compute_right_disparity) {
+    const int right_cols = m_num_output_cols + std::max(m_max_disp_x, 0);
+    const int right_rows = m_num_output_rows + std::max(m_max_disp_y, 0);
+    m_right_disparity.set_size(right_cols, right_rows);
+    m_right_best_cost.set_size(right_cols, right_rows);
+    fill(m_right_disparity, DisparityImage::pixel_type());
+    fill(m_right_best_cost, std::numeric_limits<AccumCostType>::max());
+  }
+
   // All the hard work is done in the next few function calls!
 
+  // The low-memory mode handles all of the remaining steps on its own.
+  if (m_low_memory && !m_use_mgm)
+    return streamed_semi_global_matching(left_image, right_image);
+
   allocate_large_buffers();
 
-  compute_disparity_costs(left_image, right_image);
+  compute_disparity_costs(left_image, right_image, 0, m_num_output_rows-1, m_cost_buffer.get());
 
   if (m_use_mgm)
     //smooth_path_accumulation(left_image);
@@ -2400,9 +2791,12 @@ void SemiGlobalMatcher::multi_thread_accumulation(ImageView<uint8> const& left_i
   // Initialize a number of line buffers equal to the number of threads
   OneLineBufferManager mem_buff_manager(num_threads, this);
 
-  // Each direction of lines is handled seperately.  This adds some additional wait time
-  //  as each direction finishes up but it allows the threads to simultaneously read/write
-  //  the main accumulation buffer without any collisions.
+  // The lines from all eight directions are queued at once so that no thread waits
+  //  for a direction to finish.  Lines from different directions cross each other, so
+  //  additions to the main accumulation buffer are guarded by a lock for each strip of rows.
+  //  The accumulated values are only ever added to, so the result is the same
+  //  regardless of the number of threads or the order the lines finish in.
+  AccumRowLocks row_locks(height);
 
   typedef boost::shared_ptr<PixelPassTask> TaskPtrType;
 
@@ -2410,101 +2804,87 @@ void SemiGlobalMatcher::multi_thread_accumulation(ImageView<uint8> const& left_i
   for (int i=0; i<width; ++i) { 
     Vector2i top_pixel(i, 0);
     PixelLineIterator line_from_top(top_pixel, PixelLineIterator::B, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_top));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_top));
     thread_pool.add_task(task);
   }
-  thread_pool.join_all(); // Wait for all tasks to complete
-  vw_out() << "."; // TODO: Use a proper processing time bar!
 
   // Add lines going up
   for (int i=0; i<width; ++i) { 
     Vector2i bottom_pixel(i, height-1);
     PixelLineIterator line_from_bottom(bottom_pixel, PixelLineIterator::T, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_bottom));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_bottom));
     thread_pool.add_task(task);
   }
-  thread_pool.join_all(); // Wait for all tasks to complete
-  vw_out() << ".";
 
   // Add lines from the left
   for (int i=0; i<height; ++i) { 
     Vector2i left_pixel(0, i);
     PixelLineIterator line_from_left (left_pixel, PixelLineIterator::R, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_left));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_left));
     thread_pool.add_task(task);
   }
-  thread_pool.join_all(); // Wait for all tasks to complete
-  vw_out() << ".";
 
   // Add lines from the right
   for (int i=0; i<height; ++i) {
     Vector2i right_pixel(width-1, i);
     PixelLineIterator line_from_right(right_pixel, PixelLineIterator::L, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_right));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_right));
     thread_pool.add_task(task);
   }
-  thread_pool.join_all(); // Wait for all tasks to complete
-  vw_out() << ".";
 
   // Add lines from the top left
   for (int i=0; i<width; ++i) {
     Vector2i top_pixel(i, 0);
     PixelLineIterator line_from_top_br(top_pixel, PixelLineIterator::BR, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_top_br));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_top_br));
     thread_pool.add_task(task);
   }
   for (int i=1; i<height; ++i) {
     Vector2i left_pixel(0, i);
     PixelLineIterator line_from_left_br(left_pixel, PixelLineIterator::BR, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_left_br));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_left_br));
     thread_pool.add_task(task);
   }
-  thread_pool.join_all(); // Wait for all tasks to complete
-  vw_out() << ".";
 
   // Add lines from the top right
   for (int i=0; i<width; ++i) {
     Vector2i top_pixel(i, 0);
     PixelLineIterator line_from_top_bl(top_pixel, PixelLineIterator::BL, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_top_bl));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_top_bl));
     thread_pool.add_task(task);
   }
   for (int i=1; i<height; ++i) {
     Vector2i right_pixel(width-1, i);
     PixelLineIterator line_from_right_bl(right_pixel, PixelLineIterator::BL, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_right_bl));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_right_bl));
     thread_pool.add_task(task);
   }
-  thread_pool.join_all(); // Wait for all tasks to complete
-  vw_out() << ".";
 
   // Add lines from the bottom left
   for (int i=0; i<width; ++i) {
     Vector2i bot_pixel(i, height-1);
     PixelLineIterator line_from_bot_tr(bot_pixel, PixelLineIterator::TR, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_bot_tr));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_bot_tr));
     thread_pool.add_task(task);
   }
   for (int i=0; i<height-1; ++i) {
     Vector2i left_pixel(0, i);
     PixelLineIterator line_from_left_tr(left_pixel, PixelLineIterator::TR, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_left_tr));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_left_tr));
     thread_pool.add_task(task);
   }
-  thread_pool.join_all(); // Wait for all tasks to complete
-  vw_out() << ".";
 
   // Add lines from the bottom right
   for (int i=0; i<width; ++i) {
     Vector2i bot_pixel(i, height-1);
     PixelLineIterator line_from_bot_tl(bot_pixel, PixelLineIterator::TL, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_bot_tl));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_bot_tl));
     thread_pool.add_task(task);
   }
   for (int i=0; i<height-1; ++i) {
     Vector2i right_pixel(width-1, i);
     PixelLineIterator line_from_right_tl(right_pixel, PixelLineIterator::TL, image_size);
-    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, line_from_right_tl));
+    TaskPtrType task(new PixelPassTask(image_ptr, this, &mem_buff_manager, &row_locks, line_from_right_tl));
     thread_pool.add_task(task);
   }
   thread_pool.join_all(); // Wait for all tasks to complete
@@ -2533,15 +2913,18 @@ void SemiGlobalMatcher::smooth_path_accumulation_multithreaded(ImageView<uint8>
 
   // Create objects to manage the temporary accumulation buffers that need to be used here.
   // - A separate copy instance is used for each direction to allow multithreading
-  MultiAccumRowBuffer buff_manager_horizontal_left    (this, PATHS_PER_PASS, false);
-  MultiAccumRowBuffer buff_manager_horizontal_right   (this, PATHS_PER_PASS, false);
-  MultiAccumRowBuffer buff_manager_horizontal_topleft (this, PATHS_PER_PASS, false);
-  MultiAccumRowBuffer buff_manager_horizontal_botright(this, PATHS_PER_PASS, false);
-
-  MultiAccumRowBuffer buff_manager_vertical_top     (this, PATHS_PER_PASS, true);
-  MultiAccumRowBuffer buff_manager_vertical_bot     (this, PATHS_PER_PASS, true);
-  MultiAccumRowBuffer buff_manager_vertical_topright(this, PATHS_PER_PASS, true);
-  MultiAccumRowBuffer buff_manager_vertical_botleft (this, PATHS_PER_PASS, true);
+  // - The directions add their rows to the main accumulation buffer at the same time,
+  //   so they share a lock for each strip of rows.
+  AccumRowLocks row_locks(m_num_output_rows);
+  MultiAccumRowBuffer buff_manager_horizontal_left    (this, PATHS_PER_PASS, false, &row_locks);
+  MultiAccumRowBuffer buff_manager_horizontal_right   (this, PATHS_PER_PASS, false, &row_locks);
+  MultiAccumRowBuffer buff_manager_horizontal_topleft (this, PATHS_PER_PASS, false, &row_locks);
+  MultiAccumRowBuffer buff_manager_horizontal_botright(this, PATHS_PER_PASS, false, &row_locks);
+
+  MultiAccumRowBuffer buff_manager_vertical_top     (this, PATHS_PER_PASS, true,  &row_locks);
+  MultiAccumRowBuffer buff_manager_vertical_bot     (this, PATHS_PER_PASS, true,  &row_locks);
+  MultiAccumRowBuffer buff_manager_vertical_topright(this, PATHS_PER_PASS, true,  &row_locks);
+  MultiAccumRowBuffer buff_manager_vertical_botleft (this, PATHS_PER_PASS, true,  &row_locks);
 
   // Set some of the buffers to the reverse direction
   buff_manager_horizontal_right.switch_trips();
@@ -5,20 +5,18 @@
 #include <vw/Image/PixelMask.h>
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/Stereo/Correlation.h>
+#include <vw/Stereo/DisparityBounds.h>
 #include <vw/Image/CensusTransform.h>
 #include <vw/Image/Algorithms.h>
 
 #include <boost/smart_ptr/shared_ptr.hpp>
 
-#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-  #include <emmintrin.h>
-  #include <smmintrin.h> // SSE4.1
-#endif
-
 namespace vw {
 
 namespace stereo {
 
+class ParabolaFit2d;
+
 /**
 A 2D implentation of the popular Semi-Global Matching (SGM) algorithm.  This 
 implementation has the following features:
@@ -31,8 +29,11 @@ implementation has the following features:
   only the individual search range for every pixel.  When combined with an
   input low-resolution disparity image, this can massively reduce the amount
   of memory required.
-- SSE instructions are used to increase speed but currently they only provide
-  a small improvement.
+- The path accumulation inner loop uses SSE, AVX2, or AVX-512 instructions,
+  whichever is the best available on the CPU at run time.
+- If the compressed buffers still do not fit in the memory limit, a low-memory mode
+  recomputes the costs in bands of rows so that only a few rows of the buffers are
+  needed at once.  This gives the same result at a higher computation cost.
   
 Even with the included optimizations this algorithm is slow and requires huge
 amounts of memory to operate on large images.  Be careful not to exceed your
@@ -77,7 +78,7 @@ public: // Definitions
 
 public: // Functions
 
-  SemiGlobalMatcher() {} ///< Default constructor
+  SemiGlobalMatcher() : m_low_memory_requested(false), m_low_memory(false), m_compute_right_disparity(false) {} ///< Default constructor
   ~SemiGlobalMatcher() {} ///< Destructor
 
   /// Set set_parameters for details
@@ -90,7 +91,8 @@ public: // Functions
                     Vector2i search_buffer=Vector2i(2,2),
                     size_t memory_limit_mb=6000,
                     uint16 p1=0, uint16 p2=0,
-                    int ternary_census_threshold=5) {
+                    int ternary_census_threshold=5)
+    : m_low_memory_requested(false), m_low_memory(false), m_compute_right_disparity(false) {
     set_parameters(cost_type, use_mgm, min_disp_x, min_disp_y, max_disp_x, max_disp_y, 
                    kernel_size, subpixel, search_buffer, memory_limit_mb, p1, p2, ternary_census_threshold);
   }
@@ -117,14 +119,45 @@ public: // Functions
                       uint16 p1=0, uint16 p2=0,
                       int ternary_census_threshold=5);
 
+  /// Request the low-memory accumulation mode.
+  /// - Instead of storing the full cost volume, costs are recomputed in bands of rows
+  ///   and only a few row buffers are held in memory at once.  Memory usage scales
+  ///   with the image width times the number of disparities instead of with the
+  ///   full image area.  The output is identical to the normal mode but it takes
+  ///   longer to compute.
+  /// - This mode is selected automatically for a single call when the full cost
+  ///   volume would exceed the memory limit.  Later calls start from this setting again.
+  /// - Not available with MGM, in which case this setting is ignored.
+  void set_low_memory_mode(bool low_memory) { m_low_memory_requested = low_memory; }
+
+  /// Also find the right to left disparity while picking the left to right disparities.
+  /// - Each right pixel takes the disparity with the lowest accumulated cost among
+  ///   all of the left pixels that can match it (the diagonal search of the
+  ///   original SGM paper), so no second matching run is needed for a
+  ///   left<->right consistency check.
+  void set_compute_right_disparity(bool compute) { m_compute_right_disparity = compute; }
+
+  /// The right to left disparity from the last call to semi_global_matching_func.
+  /// - Pixel (c,r) is the right pixel matched by output pixel (c,r) with disparity zero.
+  ///   Right pixels left of or above that origin are not included.
+  /// - The values are the negative of the left to right disparities, as expected by
+  ///   cross_corr_consistency_check().
+  DisparityImage const& right_disparity() const { return m_right_disparity; }
+
   /// Compute SGM stereo on the images.
   /// The masks and disparity inputs are used to improve the searched disparity range.
+  /// - prior_bounds can pass in precomputed search bounds instead of prev_disparity.
+  ///   They must match the output size and the search range of this matcher.
   DisparityImage
   semi_global_matching_func( ImageView<uint8> const& left_image,
                              ImageView<uint8> const& right_image,
                              ImageView<uint8> const* left_image_mask=0,
                              ImageView<uint8> const* right_image_mask=0,
-                             DisparityImage const* prev_disparity=0);
+                             DisparityImage const* prev_disparity=0,
+                             DisparityBounds const* prior_bounds=0);
+
+  /// The disparity search bounds used by the last call to semi_global_matching_func.
+  DisparityBounds const& disparity_bounds() const { return m_disp_bounds; }
 
   /// Create a subpixel leves disparity image using parabola interpolation
   ImageView<PixelMask<Vector2f> > create_disparity_view_subpixel(DisparityImage const& integer_disparity);
@@ -158,49 +191,55 @@ private: // Variables
     boost::shared_array<AccumCostType> m_accum_buffer;
     size_t                             m_buffer_lengths;
 
-    /// Image containing the inclusive disparity bounds for each pixel.
+    /// The inclusive disparity bounds for each pixel.
     /// - Stored as min_col, min_row, max_col, max_row.
-    ImageView<Vector4i> m_disp_bound_image;
-
-    /// Lookup table of the adjacent disparities for each disparity
-    /// - For each disparity index, store the disparity indices of the 
-    ///   eight adjacent disparities.
-    /// - Handles outer boundaries by repetition.
-    /// - This vector stores a table of size m_num_disp*8.
-    /// - This allows us to avoid performing any bounds checking in the algorithm core.
-    std::vector<DisparityType> m_adjacent_disp_lookup;
+    DisparityBounds m_disp_bounds;
 
     /// For each output pixel, store the starting index in m_cost_buffer/m_accum_buffer
     ImageView<size_t> m_buffer_starts;
 
+    /// Low-memory mode variables
+    /// - In this mode m_cost_buffer and m_accum_buffer are not allocated.
+    bool m_low_memory_requested; ///< Mode set by the user.
+    bool m_low_memory;           ///< Mode used by the current call.
+    int  m_rows_per_block; ///< Size of the row bands the costs are recomputed in.
+    ImageView<PixelMask<Vector2f> > m_streamed_subpixel; ///< Subpixel results found during accumulation
+
+    /// Right to left disparity variables
+    bool m_compute_right_disparity;
+    DisparityImage            m_right_disparity;
+    ImageView<AccumCostType>  m_right_best_cost; ///< Cost of each m_right_disparity pixel
+
 private: // Functions
 
-  /// Populate the lookup table m_adjacent_disp_lookup
-  void populate_adjacent_disp_lookup_table();
+  /// Update the right to left disparities with the accumulated costs of one left pixel.
+  void update_right_disparity(AccumCostType const* accum_vec, int col, int row);
 
-  /// Fill in m_disp_bound_image using image-wide contstants
+  /// Fill in m_disp_bounds using image-wide contstants
   void populate_constant_disp_bound_image();
 
-  /// Fill in m_disp_bound_image using some image information.
+  /// Fill in m_disp_bounds using some image information.
   /// - Returns false if there is no valid image data.
   /// - The left and right image masks contain a nonzero value if the pixel is valid.
   ///   No search is performed at masked pixels.
   /// - prev_disparity is a half resolution disparity image.  This input is optional,
   ///   pass in a null pointer to ignore it.  If provided, it will be used to limit 
   ///   the disparity range searched at each pixel.
+  /// - prior_bounds, if provided, is used in place of prev_disparity.
   /// - The range of disparities searched controls the run time and memory usage of the
   ///   algorithm so this is an important function!
   bool populate_disp_bound_image(ImageView<uint8> const* left_image_mask,
                                  ImageView<uint8> const* right_image_mask,
-                                 DisparityImage   const* prev_disparity);
+                                 DisparityImage   const* prev_disparity,
+                                 DisparityBounds  const* prior_bounds);
 
   /// Reduce the search range of full-search-range pixel by looking at nearby
   ///  pixels with a smaller search range.
   /// - conserve_memory controls how aggressive the function is in finding possible
   ///   search areas for uncertain pixels.  Level 0 uses full search ranges.
   /// - Returns false if there is a problem processing the image.
-  bool constrain_disp_bound_image(ImageView<uint8> const &full_search_image, 
-                                  DisparityImage const* prev_disparity,
+  /// - Nothing is done unless have_prior is set.
+  bool constrain_disp_bound_image(bool have_prior,
                                   double percent_trusted, double percent_masked, double area,
                                   int conserve_memory=0);
 
@@ -211,35 +250,67 @@ private: // Functions
   /// Fills m_buffer_starts and allocates m_cost_buffer and m_accum_buffer
   void allocate_large_buffers();
 
+  /// Choose m_rows_per_block for the low-memory mode and return the number of bytes it will use.
+  /// - m_buffer_starts must be filled in before calling this.
+  size_t compute_streamed_buffer_size();
+
+  /// Return the number of packed disparity elements between the start of two output rows.
+  /// - row_end is exclusive and may be equal to m_num_output_rows.
+  size_t get_rows_length(int row_start, int row_end) const {
+    size_t end = (row_end < m_num_output_rows) ? m_buffer_starts(0, row_end) : m_buffer_lengths;
+    return end - m_buffer_starts(0, row_start);
+  }
+
+  /// Return the offset of a pixel's disparities from the start of its row.
+  size_t get_row_offset(int col, int row) const {
+    return m_buffer_starts(col, row) - m_buffer_starts(0, row);
+  }
+
   /// Return a bad accumulation value used to fill locations we don't visit
   AccumCostType get_bad_accum_val() const { return std::numeric_limits<CostType>::max() + m_p2; }
 
   /// Returns the number of disparities searched for a given pixel.
   /// - This gets called a lot, may need to speed it up!
   int get_num_disparities(int col, int row) const {
-    const Vector4i bounds = m_disp_bound_image(col,row);
+    const Vector4i bounds = m_disp_bounds(col,row);
     return (bounds[2] - bounds[0] + 1) * (bounds[3] - bounds[1] + 1);
   }
 
-  /// Populates m_cost_buffer with all the disparity costs 
+  /// Populates the cost buffer with the disparity costs for output rows first_row to last_row.
+  /// - The costs for first_row are written starting at the beginning of output.
   void compute_disparity_costs(ImageView<uint8> const& left_image,
-                               ImageView<uint8> const& right_image);
+                               ImageView<uint8> const& right_image,
+                               int first_row, int last_row, CostType* output);
 
   // The following functions are called from inside compute_disparity_costs()
 
   /// Compute mean of differences within a block of pixels.
-  void fill_costs_block    (ImageView<uint8> const& left_image,
-                            ImageView<uint8> const& right_image);
+  void fill_costs_block    (ImageView<uint8> const& left_image, ImageView<uint8> const& right_image,
+                            int first_row, int last_row, CostType* output);
   // The following functions use two census transform cost function options
-  void fill_costs_census3x3(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
-  void fill_costs_census5x5(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
-  void fill_costs_census7x7(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
-  void fill_costs_census9x9(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
+  void fill_costs_census3x3(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image,
+                            int first_row, int last_row, CostType* output);
+  void fill_costs_census5x5(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image,
+                            int first_row, int last_row, CostType* output);
+  void fill_costs_census7x7(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image,
+                            int first_row, int last_row, CostType* output);
+  void fill_costs_census9x9(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image,
+                            int first_row, int last_row, CostType* output);
+
+  /// Find the rows of the left and right census images needed to compute
+  ///  the costs for output rows first_row to last_row.
+  void get_census_row_range(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image,
+                            int first_row, int last_row,
+                            int &left_start,  int &left_end,
+                            int &right_start, int &right_end) const;
 
   /// Used to finish computing the census-based disparity costs in the above functions.
+  /// - The binary images contain only the census rows starting at left_start and right_start.
   template <typename T>
   void get_hamming_distance_costs(ImageView<T> const& left_binary_image,
-                                  ImageView<T> const& right_binary_image);
+                                  ImageView<T> const& right_binary_image,
+                                  int left_start, int right_start,
+                                  int first_row, int last_row, CostType* output);
 
   /// Compute the mean and STD of a small image patch.
   /// - Does not perform bounds checking.
@@ -308,6 +379,34 @@ private: // Functions
   /// Multi-threaded version of the normal SGM accumulation method;
   void multi_thread_accumulation(ImageView<uint8> const& left_image);
 
+  /// Evaluate the four paths which reach each pixel in a row from the previous row
+  ///  and from the previous pixel in the row.
+  /// - The forward trip moves from the top left, otherwise from the bottom right.
+  /// - trail_rows holds the three diagonal/vertical path outputs for the previous row and
+  ///   lead_rows receives them for this row, each path is offset by row_stride.
+  /// - pixel_buffers must hold two full disparity vectors.
+  /// - If path_sum is not null the four path outputs are added to it.
+  void accumulate_row_paths(ImageView<uint8> const& left_image, int row, bool forward,
+                            CostType* costs,
+                            AccumCostType* trail_rows, AccumCostType* lead_rows, size_t row_stride,
+                            AccumCostType* pixel_buffers, AccumCostType* full_prior_ptr,
+                            AccumCostType* path_sum);
+
+  /// Low-memory replacement for the cost computation, accumulation, and
+  ///  create_disparity_view() steps.
+  /// - The forward trip is run once while saving its row state at the start of each
+  ///   band of rows.  The bands are then revisited from the bottom up, recomputing
+  ///   their costs and forward paths before running the backward trip through them.
+  /// - Also fills in m_streamed_subpixel.
+  DisparityImage streamed_semi_global_matching(ImageView<uint8> const& left_image,
+                                               ImageView<uint8> const& right_image);
+
+  /// Compute the subpixel offset for a pixel with the selected integer disparity.
+  /// - Returns false if the fit failed.
+  bool find_subpixel_offset(AccumCostType const* accum_vec, Vector4i const& bounds,
+                            int dx, int dy, ParabolaFit2d &fitter,
+                            double &delta_x, double &delta_y);
+
   /// Allow this helper class to access private members.
   /// - Some of these classes can be found in SGMAssist.h.
   friend class MultiAccumRowBuffer;
@@ -332,28 +431,25 @@ private: // Functions
   /// Convert a pixel's minimum disparity index to dx, dy.
   void disp_index_to_xy(int min_index, int col, int row, DisparityType &dx, DisparityType &dy) const {
     // Convert the disparity index to dx and dy
-    const Vector4i bounds = m_disp_bound_image(col,row);
+    const Vector4i bounds = m_disp_bounds(col,row);
     int d_width  = bounds[2] - bounds[0] + 1;
     dy = (min_index / d_width);
     dx = min_index - (dy*d_width) + bounds[0];
     dy += bounds[1];
   }
 
-  // The following functions are inlined for speed
-#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-  /// Use SSE instructions to simultaneousy compute the scores for up to 8 disparities in evaluate_path()
-  inline void compute_path_internals_sse(uint16* dL, uint16* d0, uint16* d1, uint16* d2, uint16* d3,
-                                         uint16* d4, uint16* d5, uint16* d6, uint16* d7, uint16* d8,
-                                         __m128i& _dJ, __m128i& _dP, __m128i& _dp1, uint16* dRes,
-                                         int sse_index, int &output_index, AccumCostType* output);
-#endif
-
-  /// Non-sse backup for compute_path_internals_sse
-  inline void compute_path_internals(uint16* dL, uint16* d0, uint16* d1, uint16* d2, uint16* d3,
-                                     uint16* d4, uint16* d5, uint16* d6, uint16* d7, uint16* d8,
-                                     AccumCostType dJ, AccumCostType dP, AccumCostType dp1, uint16* dRes,
-                                     int sse_index, int &output_index, AccumCostType* output);
+  /// Return the number of elements needed for the full_prior_buffer argument of evaluate_path().
+  /// - The buffer covers the entire disparity range plus a one disparity border on
+  ///   each side which always holds get_bad_accum_val().  This lets the eight adjacent
+  ///   disparities be read at fixed offsets without any bounds checking.
+  size_t get_full_prior_buffer_size() const {
+    return (m_num_disp_x+2)*(m_num_disp_y+2);
+  }
 
+  /// Given the dx and dy positions of a pixel, return the index in the full_prior_buffer.
+  int full_prior_index(DisparityType dx, DisparityType dy) const {
+    return (dy-m_min_disp_y+1)*(m_num_disp_x+2) + (dx-m_min_disp_x+1);
+  }
 
   /// Given disparity cost and adjacent costs, compute subpixel offset.
   double compute_subpixel_offset(AccumCostType prev, AccumCostType center, AccumCostType next,
@@ -373,6 +469,8 @@ private: // Functions
 /// - This function only searches positive disparities. The input images need to be
 ///   already cropped so that this makes sense.
 /// - This function could be made more flexible by accepting other varieties of mask images.
+/// - If compute_right_disparity is set, the right to left disparity can be fetched
+///   from matcher_ptr afterwards.
 /// - TODO: Merge with the function in Correlation.h?
 template <class ImageT1, class ImageT2>
 ImageView<PixelMask<Vector2i> >
@@ -389,117 +487,13 @@ calc_disparity_sgm(CostFunctionType cost_type,
                    boost::shared_ptr<SemiGlobalMatcher> &matcher_ptr,
                    ImageView<uint8>       const* left_mask_ptr=0,  
                    ImageView<uint8>       const* right_mask_ptr=0,
-                   SemiGlobalMatcher::DisparityImage  const* prev_disparity=0);
+                   SemiGlobalMatcher::DisparityImage  const* prev_disparity=0,
+                   bool                   const compute_right_disparity=false);
 
 
 //#################################################################################################
 // Function definitions
 
-#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-void SemiGlobalMatcher::compute_path_internals_sse(uint16* dL, uint16* d0, uint16* d1, uint16* d2, uint16* d3,
-                                                   uint16* d4, uint16* d5, uint16* d6, uint16* d7, uint16* d8,
-                                                   __m128i& _dJ, __m128i& _dP, __m128i& _dp1, uint16* dRes,
-                                                   int sse_index, int &output_index,
-                                                   AccumCostType*       output) {
-  // Load data from arrays into SSE registers
-  __m128i _dL = _mm_load_si128( (__m128i*) dL );
-  __m128i _d0 = _mm_load_si128( (__m128i*) d0 );
-  __m128i _d1 = _mm_load_si128( (__m128i*) d1 );
-  __m128i _d2 = _mm_load_si128( (__m128i*) d2 );
-  __m128i _d3 = _mm_load_si128( (__m128i*) d3 );
-  __m128i _d4 = _mm_load_si128( (__m128i*) d4 );
-  __m128i _d5 = _mm_load_si128( (__m128i*) d5 );
-  __m128i _d6 = _mm_load_si128( (__m128i*) d6 );
-  __m128i _d7 = _mm_load_si128( (__m128i*) d7 );
-  __m128i _d8 = _mm_load_si128( (__m128i*) d8 );
-
-  // Operation = min( min(d1...d8)+dp1, d0, dJ) + dL - dP
-  
-  // Start computing the min
-  __m128i _min12   = _mm_min_epu16(_d1, _d2);
-  __m128i _min34   = _mm_min_epu16(_d3, _d4);
-  __m128i _min56   = _mm_min_epu16(_d5, _d6);
-  __m128i _min78   = _mm_min_epu16(_d7, _d8);
-  // Keep computing the min
-  __m128i _min1234 = _mm_min_epu16(_min12, _min34);
-  __m128i _min5678 = _mm_min_epu16(_min56, _min78);
-  // Finish computing the min
-  __m128i _minAdj = _mm_min_epu16(_min1234, _min5678);
-  __m128i _minO   = _mm_min_epu16(_d0, _dJ);
- 
-  // Perform the required computations
-  __m128i _result = _mm_adds_epu16(_minAdj, _dp1);
-  _result = _mm_min_epu16(_result, _minO);
-  _result = _mm_adds_epu16(_result, _dL);
-  _result = _mm_subs_epu16(_result, _dP);
-
-  // Fetch results from the output register
-  _mm_store_si128( (__m128i*) dRes, _result );
-
-  // Copy the valid results from the register.
-  for (int i=0; i<sse_index; ++i){
-    output[output_index++] = dRes[i];
-  }
-} // end function compute_path_internals_sse
-#endif
-
-void SemiGlobalMatcher::compute_path_internals(uint16* dL, uint16* d0, uint16* d1, uint16* d2, uint16* d3,
-                                               uint16* d4, uint16* d5, uint16* d6, uint16* d7, uint16* d8,
-                                               AccumCostType dJ, AccumCostType dP, AccumCostType dp1, uint16* dRes,
-                                               int sse_index, int &output_index,
-                                               AccumCostType*       output) {
-  // Operation = min( min(d1...d8)+dp1, d0, dJ) + dL - dP
-
-  for (int i=0; i<sse_index; ++i){
-
-    uint16 minAdj = std::min(d1[i], d2[i]);
-    minAdj = std::min(minAdj, d3[i]);
-    minAdj = std::min(minAdj, d4[i]);
-    minAdj = std::min(minAdj, d5[i]);
-    minAdj = std::min(minAdj, d6[i]);
-    minAdj = std::min(minAdj, d7[i]);
-    minAdj = std::min(minAdj, d8[i]);
-    minAdj += dp1;
-
-    uint16 minVal = std::min(minAdj, d0[i]);
-           minVal = std::min(minVal, dJ);
-    output[output_index++] = minVal + (dL[i] - dP);
-  }
-} // end function compute_path_internals
-
-
-// From the census transformed input images, compute the cost of each disparity value.
-template <typename T>
-void SemiGlobalMatcher::get_hamming_distance_costs(ImageView<T> const& left_binary_image,
-                                                   ImageView<T> const& right_binary_image) {
-
-  const int half_kernel = (m_kernel_size - 1) / 2;
-
-  // Now compute the disparity costs for each pixel.
-  // Make sure we don't go out of bounds here due to the disparity shift and kernel.
-  size_t cost_index = 0;
-  for ( int r = m_min_row; r <= m_max_row; r++ ) { // For each row in left
-    int output_row = r - m_min_row;
-    int binary_row = r - half_kernel;
-    for ( int c = m_min_col; c <= m_max_col; c++ ) { // For each column in left
-      int output_col = c - m_min_col;
-      int binary_col = c - half_kernel;
-
-      Vector4i pixel_disp_bounds = m_disp_bound_image(output_col, output_row);
-
-      for ( int dy = pixel_disp_bounds[1]; dy <= pixel_disp_bounds[3]; dy++ ) { // For each disparity
-        for ( int dx = pixel_disp_bounds[0]; dx <= pixel_disp_bounds[2]; dx++ ) {
-
-          CostType cost = hamming_distance(left_binary_image (binary_col   , binary_row   ), 
-                                           right_binary_image(binary_col+dx, binary_row+dy) );
-          m_cost_buffer[cost_index] = cost;
-          ++cost_index;
-        }
-      } // End disparity loops   
-    } // End x loop
-  }// End y loop 
-}
-
 
 template <class ImageT1, class ImageT2>
 ImageView<PixelMask<Vector2i> >
@@ -516,7 +510,8 @@ calc_disparity_sgm(CostFunctionType cost_type,
                    boost::shared_ptr<SemiGlobalMatcher> &matcher_ptr,
                    ImageView<uint8>       const* left_mask_ptr,  
                    ImageView<uint8>       const* right_mask_ptr,
-                   SemiGlobalMatcher::DisparityImage  const* prev_disparity){ 
+                   SemiGlobalMatcher::DisparityImage  const* prev_disparity,
+                   bool                   const compute_right_disparity){ 
 
     // Sanity check the input:
     VW_DEBUG_ASSERT( kernel_size[0] % 2 == 1 && kernel_size[1] % 2 == 1,
@@ -548,6 +543,7 @@ calc_disparity_sgm(CostFunctionType cost_type,
 
     matcher_ptr.reset(new SemiGlobalMatcher(cost_type, use_mgm, 0, 0, 
                       search_volume_inclusive[0], search_volume_inclusive[1], kernel_size[0], subpixel_mode, search_buffer, memory_limit_mb));
+    matcher_ptr->set_compute_right_disparity(compute_right_disparity);
     return matcher_ptr->semi_global_matching_func(left, right, left_mask_ptr, right_mask_ptr, prev_disparity);
 
   } // End function calc_disparity
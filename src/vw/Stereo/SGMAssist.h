@@ -7,6 +7,8 @@
 #include <vw/Core/ThreadPool.h>
 #include <vw/Image/PixelIterator.h>
 
+#include <boost/scoped_array.hpp>
+
 /**
   This file contains supporting classes and functions for the SGM algorithm.
 */
@@ -241,6 +243,71 @@ private:
 //==================================================================================
 
 
+/**
+  Guards the parent class accumulation buffer with one lock per strip of output rows.
+  - This lets any number of path passes add their results to the accumulation
+    buffer at the same time, as long as they are working in different strips.
+  - Accumulation buffer values are only ever incremented, so the final sums are
+    identical no matter what order the passes finish in.
+*/
+class AccumRowLocks : private boost::noncopyable {
+public:
+
+  AccumRowLocks(int num_rows, int rows_per_strip=16)
+    : m_rows_per_strip(rows_per_strip) {
+    m_num_strips = (num_rows + rows_per_strip - 1) / rows_per_strip;
+    if (m_num_strips < 1)
+      m_num_strips = 1;
+    m_mutexes.reset(new Mutex[m_num_strips]);
+  }
+
+  /// Return the index of the strip containing the given output row.
+  int get_strip(int row) const { return row / m_rows_per_strip; }
+
+  /// Return the lock for the given strip.
+  Mutex& get_mutex(int strip) { return m_mutexes[strip]; }
+
+private:
+  int m_rows_per_strip, m_num_strips;
+  boost::scoped_array<Mutex> m_mutexes;
+}; // End class AccumRowLocks
+
+
+/// Scoped lock which holds the AccumRowLocks strip lock for the row it was last moved to.
+/// - Only one strip is held at a time so passes moving through the image can never deadlock.
+/// - Does nothing if constructed with a null pointer.
+class StripLock : private boost::noncopyable {
+public:
+  StripLock(AccumRowLocks* locks) : m_locks(locks), m_strip(-1) {}
+  ~StripLock() { release(); }
+
+  /// Make sure the lock for the strip containing this row is held.
+  void move_to(int row) {
+    if (!m_locks)
+      return;
+    const int strip = m_locks->get_strip(row);
+    if (strip == m_strip)
+      return;
+    release();
+    m_locks->get_mutex(strip).lock();
+    m_strip = strip;
+  }
+
+  void release() {
+    if (m_locks && (m_strip >= 0))
+      m_locks->get_mutex(m_strip).unlock();
+    m_strip = -1;
+  }
+
+private:
+  AccumRowLocks* m_locks;
+  int m_strip;
+}; // End class StripLock
+
+
+//==================================================================================
+
+
 /**
  Helper class to manage the rolling accumulation buffer temporary memory
   until the results are added to the final accumulation buffer.  Used by 
@@ -306,10 +373,14 @@ public:
 
   /// Construct the buffers.
   /// - num_paths_in_pass can be 1, four (8 directions), or eight (16 directions)
+  /// - If several buffers add to the parent accumulation buffer from different
+  ///   threads, they must share a set of row locks.
   MultiAccumRowBuffer(const SemiGlobalMatcher* parent_ptr,
                       const int  num_paths_in_pass=4,
-                      const bool vertical=false) {
+                      const bool vertical=false,
+                      AccumRowLocks* row_locks=0) {
     m_parent_ptr        = parent_ptr;  
+    m_row_locks         = row_locks;
     m_num_paths_in_pass = num_paths_in_pass;
     m_vertical          = vertical;
 
@@ -383,31 +454,30 @@ public:
   /// Add the results in the leading buffer to the main class accumulation buffer.
   /// - The scores from each pass are added.
   void add_lead_buffer_to_accum() {
-    Mutex::Lock locker(m_mutex); // Scoped lock so this function can't be run simultaneously
 
     size_t buffer_index = 0;
     SemiGlobalMatcher::AccumCostType* out_ptr = m_parent_ptr->m_accum_buffer.get();
     if (!m_vertical) { // horizontal
+      StripLock locker(m_row_locks);
+      locker.move_to(m_current_row);
       for (int col=0; col<m_parent_ptr->m_num_output_cols; ++col) {
         int num_disps = m_parent_ptr->get_num_disparities(col, m_current_row);
         for (int pass=0; pass<m_num_paths_in_pass; ++pass) {
           size_t out_index = m_parent_ptr->m_buffer_starts(col, m_current_row);
           for (int d=0; d<num_disps; ++d) {
             out_ptr[out_index++] += m_lead_buffer[buffer_index++];
-            //printf("row, col, pass, d = %d, %d, %d, %d ->> %d ->> %d\n", 
-            //    m_current_row, col, pass, d, m_trail_buffer[buffer_index], m_parent_ptr->m_accum_buffer[out_index]);
           } // end disp loop
         } // end pass loop
       } // end col loop
     } else { // vertical
+      StripLock locker(m_row_locks);
       for (int row=0; row<m_parent_ptr->m_num_output_rows; ++row) {
+        locker.move_to(row);
         int num_disps = m_parent_ptr->get_num_disparities(m_current_col, row);
         for (int pass=0; pass<m_num_paths_in_pass; ++pass) {
           size_t out_index = m_parent_ptr->m_buffer_starts(m_current_col, row);
           for (int d=0; d<num_disps; ++d) {
             out_ptr[out_index++] += m_lead_buffer[buffer_index++];
-            //printf("row, col, pass, d = %d, %d, %d, %d ->> %d ->> %d\n", 
-            //    m_current_row, col, pass, d, m_trail_buffer[buffer_index], m_parent_ptr->m_accum_buffer[out_index]);
           } // end disp loop
         } // end pass loop
       } // end col loop
@@ -540,7 +610,8 @@ public:
 private:
 
   /// Limit main accumulation buffer write access across any number of threads.
-  static Mutex m_mutex; 
+  /// - Null if this is the only object writing to the accumulation buffer.
+  AccumRowLocks* m_row_locks;
 
   const SemiGlobalMatcher* m_parent_ptr; ///< Need a handle to the parent SGM object
 
@@ -566,8 +637,6 @@ private:
 
 }; // End class MultiAccumRowBuffer
 
-Mutex MultiAccumRowBuffer::m_mutex;
-
 
 
 
@@ -577,8 +646,8 @@ Mutex MultiAccumRowBuffer::m_mutex;
 /**
   A single line, single pass SGM accumulation buffer designed to be used by a single thread.
   - Each line-pass instance of the SGM accumulation problem is independent until the end.
-  - Instances of this class must share access to the parent class accumulation buffer so that
-    only one instance of the class touches it at any one time.
+  - Instances of this class share access to the parent class accumulation buffer,
+    which is protected by an AccumRowLocks object.
   - This class is much less complicated than the multi-line buffer class!
 */
 class OneLineBuffer{
@@ -630,6 +699,7 @@ public:
 
     // Determine the buffer size
     m_num_disp          = parent_ptr->m_num_disp;
+    m_full_prior_size   = parent_ptr->get_full_prior_buffer_size();
     m_buffer_size       = get_buffer_size(parent_ptr);
     m_buffer_size_bytes = m_buffer_size*sizeof(SemiGlobalMatcher::AccumCostType);
 
@@ -641,15 +711,15 @@ public:
 
     // Set up the small buffer
     m_bad_disp_value = parent_ptr->get_bad_accum_val();
-    m_full_prior_buffer.reset(new SemiGlobalMatcher::AccumCostType[m_num_disp]);
+    m_full_prior_buffer.reset(new SemiGlobalMatcher::AccumCostType[m_full_prior_size]);
   }
 
   /// Clear both buffers
   void clear_buffers() {
     memset(m_buffer.get(), 0, m_buffer_size_bytes);
 
-    for (size_t i=0; i<m_num_disp; ++i)
-      m_full_prior_buffer[i] = m_bad_disp_value;
+    std::fill(m_full_prior_buffer.get(), m_full_prior_buffer.get()+m_full_prior_size,
+              m_bad_disp_value);
   }
 
   /// Get the pointer to the start of the output accumulation buffer
@@ -666,7 +736,7 @@ public:
 private: // Variables
 
   SemiGlobalMatcher::AccumCostType m_bad_disp_value;
-  size_t m_buffer_size, m_buffer_size_bytes, m_num_disp;
+  size_t m_buffer_size, m_buffer_size_bytes, m_num_disp, m_full_prior_size;
 
   /// Buffer which store the accumulated cost info before it is dumped to the main accum buffer
   boost::shared_array<SemiGlobalMatcher::AccumCostType> m_buffer;
@@ -740,9 +810,10 @@ public:
   PixelPassTask(ImageView<uint8>  const* image_ptr,
                 SemiGlobalMatcher      * parent_ptr,
                 OneLineBufferManager   * buffer_manager_ptr,
+                AccumRowLocks          * row_locks,
                 PixelLineIterator pixel_loc_iter)
     : m_image_ptr(image_ptr), m_parent_ptr(parent_ptr), m_buffer_manager_ptr(buffer_manager_ptr),
-      m_pixel_loc_iter(pixel_loc_iter) {
+      m_row_locks(row_locks), m_pixel_loc_iter(pixel_loc_iter) {
   }
 
   /// Do the work!
@@ -796,7 +867,7 @@ public:
       int pixel_diff     = std::abs(curr_pixel_val - last_pixel_val);
 
       //printf("Loc %d, %d, diff = %d, num_disp = %d\n", col, row, pixel_diff, num_disp);
-      //std::cout << "DEBUG " << m_parent_ptr->m_disp_bound_image(col,row) << std::endl;
+      //std::cout << "DEBUG " << m_parent_ptr->m_disp_bounds(col,row) << std::endl;
 
       if (last_pixel_val >= 0) { // All pixels after the first
         m_parent_ptr->evaluate_path( col, row, col_prev, row_prev,
@@ -833,12 +904,16 @@ public:
     size_t buffer_size=0;
     AccumCostType* computed_accum_ptr = buff_ptr->get_output_accum_ptr(buffer_size);
 
+    // Lines from other directions may be adding to the same rows at the same time.
+    StripLock locker(m_row_locks);
+
     // Loop through all pixels in the line
     while (m_pixel_loc_iter.is_good()) {
 
       // Get current location
       const int col = m_pixel_loc_iter.col();
       const int row = m_pixel_loc_iter.row();
+      locker.move_to(row);
 
       // Get information about the current pixel location from the parent
       int num_disp = m_parent_ptr->get_num_disparities(col, row);
@@ -863,6 +938,7 @@ private:
   ImageView<uint8>  const* m_image_ptr;
   SemiGlobalMatcher      * m_parent_ptr;
   OneLineBufferManager   * m_buffer_manager_ptr;
+  AccumRowLocks          * m_row_locks;
   PixelLineIterator m_pixel_loc_iter; ///< Keeps track of the pixel position
 
 }; // End class PixelPassTask
@@ -888,9 +964,10 @@ public:
 
     // Init this buffer to bad scores representing disparities that were
     //  not in the search range for the given pixel. 
-    m_full_prior_buffer.reset(new AccumCostType[parent_ptr->m_num_disp]);
-    for (int i=0; i<parent_ptr->m_num_disp; ++i)
-      m_full_prior_buffer[i] = parent_ptr->get_bad_accum_val();  
+    const size_t full_prior_size = parent_ptr->get_full_prior_buffer_size();
+    m_full_prior_buffer.reset(new AccumCostType[full_prior_size]);
+    std::fill(m_full_prior_buffer.get(), m_full_prior_buffer.get()+full_prior_size,
+              parent_ptr->get_bad_accum_val());
 
     // Allocate a buffer for the "perpendicular direction" results to be written to
     m_temp_buffer.reset(new AccumCostType[parent_ptr->m_num_disp]);
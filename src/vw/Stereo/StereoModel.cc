@@ -67,6 +67,15 @@ StereoModel::StereoModel(camera::CameraModel const* camera_model1,
   m_angle_tol = angle_tol;
 }
   
+double StereoModel::parallel_tolerance(bool least_squares, double angle_tol) {
+  double tol;
+  if (least_squares) tol = 1e-5;
+  else               tol = 1e-4;
+
+  if (angle_tol > 0) tol = angle_tol; // can be over-ridden from the outside
+  return tol;
+}
+
 bool StereoModel::are_nearly_parallel(bool least_squares,
                                       double angle_tol,
                                       std::vector<Vector3> const& camDirs){
@@ -81,11 +90,7 @@ bool StereoModel::are_nearly_parallel(bool least_squares,
   // This threshold was chosen empirically for now, but should
   // probably be revisited once a more rigorous analysis has
   // been completed. -mbroxton (11-MAR-07)
-  double tol;
-  if (least_squares) tol = 1e-5;
-  else               tol = 1e-4;
-
-  if (angle_tol > 0) tol = angle_tol; // can be over-ridden from the outside
+  double tol = parallel_tolerance(least_squares, angle_tol);
 
   bool are_par = true;
   for (int p = 0; p < int(camDirs.size()) - 1; p++){
@@ -181,6 +186,72 @@ Vector3 StereoModel::operator()(Vector2 const& pix1, Vector2 const& pix2,
   return result;
 }
 
+void StereoModel::triangulate(const Vector2* pix1, const Vector2* pix2, size_t count,
+                              double* x, double* y, double* z, double* error) const {
+
+  VW_ASSERT(m_cameras.size() == 2,
+            vw::ArgumentErr() << "StereoModel::triangulate: only implemented for two cameras.\n");
+
+  // Least squares refinement is done one point at a time.
+  if (m_least_squares) {
+    for (size_t i = 0; i < count; ++i) {
+      Vector3 result = (*this)(pix1[i], pix2[i], error[i]);
+      x[i] = result[0]; y[i] = result[1]; z[i] = result[2];
+    }
+    return;
+  }
+
+  const double tol = parallel_tolerance(m_least_squares, m_angle_tol);
+  const Vector2 invalid_pix = camera::CameraModel::invalid_pixel();
+
+  // Rays are computed in blocks small enough to stay in cache.  Only the
+  // valid pairs of a block are passed to the camera models.
+  const size_t BLOCK_SIZE = 256;
+  vector<Vector2> pix_buf1(BLOCK_SIZE), pix_buf2(BLOCK_SIZE);
+  vector<Vector3> ctrs1(BLOCK_SIZE), dirs1(BLOCK_SIZE), ctrs2(BLOCK_SIZE), dirs2(BLOCK_SIZE);
+  vector<size_t>  index(BLOCK_SIZE);
+
+  for (size_t start = 0; start < count; start += BLOCK_SIZE) {
+    const size_t end = std::min(count, start + BLOCK_SIZE);
+    size_t num_valid = 0;
+    for (size_t i = start; i < end; ++i) {
+      x[i] = y[i] = z[i] = error[i] = 0;
+      if (pix1[i] != pix1[i] || pix2[i] != pix2[i] || // i.e., NaN
+          pix1[i] == invalid_pix || pix2[i] == invalid_pix)
+        continue;
+      pix_buf1[num_valid] = pix1[i];
+      pix_buf2[num_valid] = pix2[i];
+      index   [num_valid] = i;
+      ++num_valid;
+    }
+    if (num_valid == 0)
+      continue;
+
+    m_cameras[0]->pixels_to_rays(&pix_buf1[0], num_valid, &ctrs1[0], &dirs1[0]);
+    m_cameras[1]->pixels_to_rays(&pix_buf2[0], num_valid, &ctrs2[0], &dirs2[0]);
+
+    for (size_t k = 0; k < num_valid; ++k) {
+      // Rays that could not be computed and nearly parallel rays give no point.
+      if (dirs1[k] == Vector3() || dirs2[k] == Vector3())
+        continue;
+      if (1 - dot_prod(dirs1[k], dirs2[k]) < tol)
+        continue;
+
+      Vector3 errorVec;
+      Vector3 result = triangulate_two_rays(dirs1[k], dirs2[k], ctrs1[k], ctrs2[k], errorVec);
+
+      // Reflect points that fall behind one of the two cameras
+      if (dot_prod(result - ctrs1[k], dirs1[k]) < 0 ||
+          dot_prod(result - ctrs2[k], dirs2[k]) < 0)
+        result = -result + 2*ctrs1[k];
+
+      const size_t i = index[k];
+      x[i] = result[0]; y[i] = result[1]; z[i] = result[2];
+      error[i] = norm_2(errorVec);
+    }
+  }
+}
+
 double StereoModel::convergence_angle(Vector2 const& pix1, Vector2 const& pix2) const {
   return acos(dot_prod(m_cameras[0]->pixel_to_vector(pix1),
                        m_cameras[1]->pixel_to_vector(pix2)));
@@ -194,30 +265,34 @@ double StereoModel::robust_1_minus_cos(double x){
   return x*x/2;
 }
   
+Vector3 StereoModel::triangulate_two_rays(Vector3 const& dir1, Vector3 const& dir2,
+                                          Vector3 const& ctr1, Vector3 const& ctr2,
+                                          Vector3& errorVec){
+
+  // Two-ray triangulation. Triangulate the point by finding the
+  // midpoint of the segment joining the closest points on the two
+  // rays emanating from the camera.
+  
+  Vector3 v12 = cross_prod(dir1, dir2);
+  Vector3 v1 = cross_prod(v12, dir1);
+  Vector3 v2 = cross_prod(v12, dir2);
+  
+  Vector3 closestPoint1 = ctr1 + dot_prod(v2, ctr2-ctr1)/dot_prod(v2, dir1)*dir1;
+  Vector3 closestPoint2 = ctr2 + dot_prod(v1, ctr1-ctr2)/dot_prod(v1, dir2)*dir2;
+  
+  errorVec = closestPoint1 - closestPoint2;
+
+  return 0.5 * (closestPoint1 + closestPoint2);
+}
+
 Vector3 StereoModel::triangulate_point(vector<Vector3> const& camDirs,
                                        vector<Vector3> const& camCtrs,
                                        Vector3& errorVec){
   
 
   int num_cams = camDirs.size();
-  if ( num_cams == 2 ){
-
-    // Two-ray triangulation. Triangulate the point by finding the
-    // midpoint of the segment joining the closest points on the two
-    // rays emanating from the camera.
-    
-    Vector3 v12 = cross_prod(camDirs[0], camDirs[1]);
-    Vector3 v1 = cross_prod(v12, camDirs[0]);
-    Vector3 v2 = cross_prod(v12, camDirs[1]);
-    
-    Vector3 closestPoint1 = camCtrs[0] + dot_prod(v2, camCtrs[1]-camCtrs[0])/dot_prod(v2, camDirs[0])*camDirs[0];
-    Vector3 closestPoint2 = camCtrs[1] + dot_prod(v1, camCtrs[0]-camCtrs[1])/dot_prod(v1, camDirs[1])*camDirs[1];
-    
-    errorVec = closestPoint1 - closestPoint2;
-
-    return 0.5 * (closestPoint1 + closestPoint2);
-    
-  }
+  if ( num_cams == 2 )
+    return triangulate_two_rays(camDirs[0], camDirs[1], camCtrs[0], camCtrs[1], errorVec);
 
   // Multi-ray triangulation. Find the intersection of the rays in
   // least squares sense (the point from which the sum of square
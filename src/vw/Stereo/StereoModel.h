@@ -75,6 +75,16 @@ namespace stereo {
     virtual Vector3 operator()(Vector2              const& pix1,   Vector2 const& pix2, Vector3& errorVec ) const;
     virtual Vector3 operator()(Vector2              const& pix1,   Vector2 const& pix2, double & error    ) const;
 
+    /// Triangulate count pixel pairs of a two camera model at once.
+    /// - The point and error of pix1[i], pix2[i] are written to x[i], y[i],
+    ///   z[i] and error[i], and are the same as from operator()(pix1, pix2, error).
+    /// - The rays are computed in blocks with CameraModel::pixels_to_rays(),
+    ///   which camera models implement without a virtual call per pixel.
+    /// - Subclasses which override the single point functions must
+    ///   override this as well.
+    virtual void triangulate(const Vector2* pix1, const Vector2* pix2, size_t count,
+                             double* x, double* y, double* z, double* error) const;
+
     /// Returns the dot product of the two rays emanating from camera
     /// 1 and camera 2 through pix1 and pix2 respectively.  This can
     /// effectively be interpreted as the angle (in radians) between
@@ -103,6 +113,14 @@ namespace stereo {
                                      std::vector<Vector3> const& camCtrs,
                                      Vector3& errorVec);
     
+    /// Two-ray version of triangulate_point().
+    static Vector3 triangulate_two_rays(Vector3 const& dir1, Vector3 const& dir2,
+                                        Vector3 const& ctr1, Vector3 const& ctr2,
+                                        Vector3& errorVec);
+
+    /// Rays whose 1 - cos(angle) is below this are treated as parallel.
+    static double parallel_tolerance(bool least_squares, double angle_tol);
+
     static bool are_nearly_parallel(bool least_squares, double angle_tol,
                                     std::vector<Vector3> const& camDirs);
 
@@ -23,8 +23,11 @@
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/PixelAccessors.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Stereo/StereoModel.h>
 #include <limits>
+#include <vector>
 
 namespace vw {
 
@@ -117,8 +120,38 @@ namespace stereo {
     DisparityImageT const& disparity_map() const { return m_disparity_map; }
 
     /// \cond INTERNAL
-    typedef StereoView<typename DisparityImageT::prerasterize_type> prerasterize_type;
-    inline prerasterize_type prerasterize( BBox2i const& bbox ) const { return prerasterize_type( m_disparity_map.prerasterize(bbox), m_stereo_model ); }
+    // A tile is triangulated a row at a time with StereoModel::triangulate(),
+    // so the camera models compute their rays in batches.
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      typedef typename DisparityImageT::prerasterize_type DispT;
+      DispT disparity = m_disparity_map.prerasterize(bbox);
+
+      ImageView<pixel_type> points(bbox.width(), bbox.height());
+      std::vector<Vector2> pix1, pix2;
+      std::vector<int32  > offsets;
+      std::vector<double > x, y, z, errors;
+      pix1.reserve(bbox.width()); pix2.reserve(bbox.width()); offsets.reserve(bbox.width());
+      for ( int32 j = bbox.min().y(); j < bbox.max().y(); ++j ) {
+        pix1.clear(); pix2.clear(); offsets.clear();
+        for ( int32 i = bbox.min().x(); i < bbox.max().x(); ++i ) {
+          typename DispT::result_type disp = disparity(i,j);
+          if ( !is_valid(disp) )
+            continue;
+          pix1.push_back(Vector2(i,j));
+          pix2.push_back(Vector2(i,j) + DispHelper(disp));
+          offsets.push_back(i - bbox.min().x());
+        }
+        if ( offsets.empty() )
+          continue;
+        x.resize(offsets.size()); y.resize(offsets.size()); z.resize(offsets.size()); errors.resize(offsets.size());
+        m_stereo_model.triangulate(&pix1[0], &pix2[0], offsets.size(),
+                                   &x[0], &y[0], &z[0], &errors[0]);
+        for ( size_t k = 0; k < offsets.size(); ++k )
+          points(offsets[k], j - bbox.min().y()) = Vector3(x[k], y[k], z[k]);
+      }
+      return prerasterize_type( points, BBox2i(-bbox.min().x(), -bbox.min().y(), cols(), rows()) );
+    }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
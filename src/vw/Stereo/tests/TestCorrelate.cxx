@@ -53,3 +53,38 @@ TEST( Correlate, CrossCorrConsistency ) {
   EXPECT_TRUE( is_valid( l2r_copy(0,0)) );
   EXPECT_TRUE( is_valid( l2r_copy(1,0)) );
 }
+
+TEST( Correlate, AffineWindowSampler ) {
+  // The row sampler must match the interpolation views it replaces,
+  //  both inside the image and where the window hangs off the edge.
+  ImageView<float> image(40,30);
+  for (int r=0; r<image.rows(); ++r)
+    for (int c=0; c<image.cols(); ++c)
+      image(c,r) = float((c*7 + r*13) % 17) + 0.25f*c;
+  InterpolationView<EdgeExtensionView<ImageView<float>, ZeroEdgeExtension>, BilinearInterpolation>
+    interp_image = interpolate(image, BilinearInterpolation(), ZeroEdgeExtension());
+
+  const int32 kern_width = 11, kern_height = 7;
+  detail::AffineWindowSampler<float> sampler(image, kern_width, kern_height);
+  std::vector<float> samples(kern_width*kern_height);
+
+  const float transforms[3][6] = {{1,     0,    0.3f, 0,    1,    -0.6f},
+                                  {1.05f, 0.1f, 0.0f, -0.2f, 0.9f, 0.0f},
+                                  {1,     0,    0,    0,    1,     0   }};
+  const float bases[3][2] = {{20.0f, 15.0f}, {2.5f, 27.3f}, {21.0f, 14.0f}};
+  for (int t=0; t<3; ++t) {
+    for (int b=0; b<3; ++b) {
+      const float* d = transforms[t];
+      sampler.sample(bases[b][0], bases[b][1], d, &samples[0]);
+      int32 k = 0;
+      for (int32 jj = -kern_height/2; jj <= kern_height/2; ++jj) {
+        for (int32 ii = -kern_width/2; ii <= kern_width/2; ++ii, ++k) {
+          float xx = d[0] * ii + (bases[b][0] + d[1] * jj + d[2]);
+          float yy = d[3] * ii + (bases[b][1] + d[4] * jj + d[5]);
+          // Not exact, the compiler may fuse the coordinate math differently.
+          EXPECT_NEAR( interp_image(xx,yy), samples[k], 1e-4 ) << "at " << xx << ", " << yy;
+        }
+      }
+    }
+  }
+}
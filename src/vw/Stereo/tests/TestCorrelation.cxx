@@ -20,6 +20,7 @@
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/UtilityViews.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/Statistics.h>
 #include <vw/Stereo/CostFunctions.h>
 #include <vw/Stereo/Correlation.h>
 
@@ -212,3 +213,219 @@ TEST_F( CorrelationU8, CrossCorrelation ) {
   ASSERT_TRUE( is_valid(disparity(10,10)) );
   CheckResult( disparity );
 }
+
+TEST_F( CorrelationGRAYU8, Census ) {
+  result_type disparity =
+    calc_disparity( CENSUS_TRANSFORM,
+                    input1, input2,
+                    bounding_box( input1 ),
+                    search_volume, kernel_size );
+  ASSERT_EQ( 19, disparity.cols() );
+  ASSERT_EQ( 21, disparity.rows() );
+  CheckResult( disparity );
+}
+
+TEST_F( CorrelationGRAYU8, TernaryCensus ) {
+  result_type disparity =
+    calc_disparity( TERNARY_CENSUS_TRANSFORM,
+                    input1, input2,
+                    bounding_box( input1 ),
+                    search_volume, kernel_size );
+  ASSERT_EQ( 19, disparity.cols() );
+  ASSERT_EQ( 21, disparity.rows() );
+  CheckResult( disparity );
+}
+
+TEST_F( CorrelationGRAYF32, TernaryCensus ) {
+  result_type disparity =
+    calc_disparity( TERNARY_CENSUS_TRANSFORM,
+                    input1, input2,
+                    bounding_box( input1 ),
+                    search_volume, kernel_size );
+  ASSERT_EQ( 19, disparity.cols() );
+  ASSERT_EQ( 21, disparity.rows() );
+  CheckResult( disparity );
+}
+
+// Brute force window cost search to check the sliding window sums in
+// best_of_search_convolution against, for kernels much larger than the disparity.
+template <class PixelT, class CostT>
+ImageView<PixelMask<Vector2i> >
+brute_force_disparity( ImageView<PixelT> const& left, ImageView<PixelT> const& right,
+                       Vector2i const& search_volume, Vector2i const& kernel_size, CostT cost ) {
+  ImageView<PixelMask<Vector2i> > result( left.cols()-kernel_size[0]+1, left.rows()-kernel_size[1]+1 );
+  for ( int32 j = 0; j < result.rows(); j++ ) {
+    for ( int32 i = 0; i < result.cols(); i++ ) {
+      int32 best = 0, worst = 0;
+      for ( int32 dy = 0; dy < search_volume[1]; dy++ ) {
+        for ( int32 dx = 0; dx < search_volume[0]; dx++ ) {
+          int32 sum = 0;
+          for ( int32 kj = 0; kj < kernel_size[1]; kj++ )
+            for ( int32 ki = 0; ki < kernel_size[0]; ki++ )
+              sum += cost( left(i+ki,j+kj), right(i+ki+dx,j+kj+dy) );
+          if ( dx == 0 && dy == 0 ) {
+            best = worst = sum;
+            result(i,j) = PixelMask<Vector2i>(Vector2i());
+          } else if ( sum < best ) {
+            best = sum;
+            result(i,j) = PixelMask<Vector2i>(Vector2i(dx,dy));
+          } else if ( sum >= worst ) {
+            worst = sum;
+          }
+        }
+      }
+      if ( best == worst )
+        invalidate( result(i,j) );
+    }
+  }
+  return result;
+}
+
+int32 abs_cost    ( uint8 a, uint8 b ) { return a < b ? b - a : a - b; }
+int32 squared_cost( uint8 a, uint8 b ) { return (int32(a)-int32(b))*(int32(a)-int32(b)); }
+int32 hamming_cost( uint64 a, uint64 b ) { return int32(hamming_distance(a, b)); }
+
+TEST( Correlation, LargeKernelMatchesBruteForce ) {
+  boost::rand48 gen(5);
+  const Vector2i search_volume(6,4), kernel_size(11,9);
+  ImageView<uint8> left  = pixel_cast_rescale<uint8>(uniform_noise_view(gen,40,30));
+  ImageView<uint8> right = pixel_cast_rescale<uint8>(uniform_noise_view(gen,40+search_volume[0]-1,
+                                                                        30+search_volume[1]-1));
+  // Make some windows constant so that invalidation is tested too
+  fill( crop(left, 0, 0, 15, 12), 7 );
+  fill( crop(right,0, 0, 22, 17), 7 );
+
+  ImageView<PixelMask<Vector2i> > disparity, expected;
+  disparity = calc_disparity( ABSOLUTE_DIFFERENCE, left, right, bounding_box(left),
+                              search_volume, kernel_size );
+  expected  = brute_force_disparity( left, right, search_volume, kernel_size, abs_cost );
+  ASSERT_EQ( expected.cols(), disparity.cols() );
+  ASSERT_EQ( expected.rows(), disparity.rows() );
+  EXPECT_FALSE( is_valid(disparity(0,0)) );
+  for ( int32 j = 0; j < expected.rows(); j++ ) {
+    for ( int32 i = 0; i < expected.cols(); i++ ) {
+      ASSERT_EQ( is_valid(expected(i,j)), is_valid(disparity(i,j)) ) << i << "," << j;
+      if ( is_valid(expected(i,j)) )
+        EXPECT_VW_EQ( expected(i,j).child(), disparity(i,j).child() );
+    }
+  }
+
+  disparity = calc_disparity( SQUARED_DIFFERENCE, left, right, bounding_box(left),
+                              search_volume, kernel_size );
+  expected  = brute_force_disparity( left, right, search_volume, kernel_size, squared_cost );
+  for ( int32 j = 0; j < expected.rows(); j++ ) {
+    for ( int32 i = 0; i < expected.cols(); i++ ) {
+      ASSERT_EQ( is_valid(expected(i,j)), is_valid(disparity(i,j)) ) << i << "," << j;
+      if ( is_valid(expected(i,j)) )
+        EXPECT_VW_EQ( expected(i,j).child(), disparity(i,j).child() );
+    }
+  }
+}
+
+TEST( Correlation, CensusTransform ) {
+  ImageView<uint8> image(9,9);
+  fill( image, 100 );
+  image(4,4) = 103;
+  image(5,4) = 110;
+  ImageView<uint64> codes;
+  census_transform( image, CENSUS_TRANSFORM, codes );
+  EXPECT_EQ( 0u, codes(0,0) );
+  EXPECT_EQ( 2u, hamming_distance(codes(3,4), uint64(0)) );  // Sees both brighter pixels
+  EXPECT_EQ( 1u, hamming_distance(codes(4,4), uint64(0)) );
+  EXPECT_EQ( 0u, codes(5,4) );
+  EXPECT_EQ( 0u, codes(8,8) );                                  // Edge extended
+
+  // Differences within the threshold count as equal, which is 01.
+  census_transform( image, TERNARY_CENSUS_TRANSFORM, codes, 5 );
+  const uint64 all_equal = 0x555555555555ull;
+  EXPECT_EQ( all_equal, codes(0,0) );
+  EXPECT_EQ( 1u, hamming_distance(codes(3,4), all_equal) );    // Only 110 is brighter
+  EXPECT_EQ( 1u, hamming_distance(codes(4,4), all_equal) );
+  EXPECT_EQ( 0u, codes(5,4) );                                  // Everything else is darker
+}
+
+TEST( Correlation, CensusMatchesBruteForce ) {
+  boost::rand48 gen(7);
+  const Vector2i search_volume(6,4), kernel_size(11,9);
+  ImageView<uint8> left  = pixel_cast_rescale<uint8>(uniform_noise_view(gen,50,45));
+  ImageView<uint8> right = pixel_cast_rescale<uint8>(uniform_noise_view(gen,50+search_volume[0]-1,
+                                                                        45+search_volume[1]-1));
+  fill( crop(left, 0, 0, 15, 12), 7 );
+  fill( crop(right,0, 0, 22, 17), 7 );
+
+  ImageView<uint64> left_codes, right_codes;
+  census_transform( left,  TERNARY_CENSUS_TRANSFORM, left_codes  );
+  census_transform( right, TERNARY_CENSUS_TRANSFORM, right_codes );
+  ImageView<PixelMask<Vector2i> > disparity, expected;
+  disparity = best_of_search_hamming( left_codes, right_codes, search_volume, kernel_size );
+  expected  = brute_force_disparity( left_codes, right_codes, search_volume, kernel_size, hamming_cost );
+  ASSERT_EQ( expected.cols(), disparity.cols() );
+  ASSERT_EQ( expected.rows(), disparity.rows() );
+  EXPECT_FALSE( is_valid(disparity(0,0)) );
+  for ( int32 j = 0; j < expected.rows(); j++ ) {
+    for ( int32 i = 0; i < expected.cols(); i++ ) {
+      ASSERT_EQ( is_valid(expected(i,j)), is_valid(disparity(i,j)) ) << i << "," << j;
+      if ( is_valid(expected(i,j)) )
+        EXPECT_VW_EQ( expected(i,j).child(), disparity(i,j).child() );
+    }
+  }
+
+  // Kernels too large for 16 bit sums
+  const Vector2i large_kernel(39,37);
+  census_transform( left,  CENSUS_TRANSFORM, left_codes  );
+  census_transform( right, CENSUS_TRANSFORM, right_codes );
+  disparity = best_of_search_hamming( left_codes, right_codes, search_volume, large_kernel );
+  expected  = brute_force_disparity( left_codes, right_codes, search_volume, large_kernel, hamming_cost );
+  ASSERT_EQ( expected.cols(), disparity.cols() );
+  for ( int32 j = 0; j < expected.rows(); j++ ) {
+    for ( int32 i = 0; i < expected.cols(); i++ ) {
+      ASSERT_EQ( is_valid(expected(i,j)), is_valid(disparity(i,j)) ) << i << "," << j;
+      if ( is_valid(expected(i,j)) )
+        EXPECT_VW_EQ( expected(i,j).child(), disparity(i,j).child() );
+    }
+  }
+}
+
+TEST( Correlation, ScheduleZones ) {
+  const Vector2i kernel_size(5,5);
+  std::vector<SearchParam> zones, work;
+  // Two cheap neighbors with the same range and one expensive zone.
+  zones.push_back( SearchParam( BBox2i(0, 0, 50,100), BBox2i(0,0,4,3) ) );
+  zones.push_back( SearchParam( BBox2i(50,0, 50,100), BBox2i(0,0,4,3) ) );
+  zones.push_back( SearchParam( BBox2i(0,100,100,100), BBox2i(0,0,60,20) ) );
+  schedule_zones( zones, work, kernel_size, 8 );
+
+  // The work covers every pixel once, with its original range.
+  ImageView<int> coverage(100,200);
+  double work_cost = 0;
+  for ( size_t i = 0; i < work.size(); ++i ) {
+    work_cost += zone_cost( work[i], kernel_size );
+    if ( i > 0 )
+      EXPECT_GE( zone_cost( work[i-1], kernel_size ), zone_cost( work[i], kernel_size ) );
+    for ( int32 r = work[i].image_region().min().y(); r < work[i].image_region().max().y(); ++r )
+      for ( int32 c = work[i].image_region().min().x(); c < work[i].image_region().max().x(); ++c ) {
+        ++coverage(c,r);
+        for ( size_t z = 0; z < zones.size(); ++z )
+          if ( zones[z].image_region().contains( Vector2i(c,r) ) )
+            EXPECT_EQ( zones[z].disparity_range(), work[i].disparity_range() );
+      }
+  }
+  EXPECT_EQ( 1, min_pixel_value(coverage) );
+  EXPECT_EQ( 1, max_pixel_value(coverage) );
+
+  // The cheap zones were merged and the expensive one split into similar pieces.
+  EXPECT_EQ( BBox2i(0,0,100,100), work.back().image_region() );
+  EXPECT_EQ( BBox2i(0,0,4,3),     work.back().disparity_range() );
+  EXPECT_EQ( size_t(17), work.size() );
+  EXPECT_LT( zone_cost( work.front(), kernel_size ), 2*work_cost/8 );
+
+  // Neighbors with different ranges are never merged, whatever the task count.
+  zones[1].disparity_range() = BBox2i(0,0,5,3);
+  schedule_zones( zones, work, kernel_size, 1 );
+  EXPECT_EQ( size_t(3), work.size() );
+
+  // The time estimate scales the operation count.
+  EXPECT_NEAR( 2e-9*zone_cost( zones[0], kernel_size ),
+               zone_cost( zones[0], kernel_size, 2e-9 ), 1e-12 );
+  EXPECT_EQ( 54*104*4*3.0, zone_cost( zones[0], kernel_size ) );
+}
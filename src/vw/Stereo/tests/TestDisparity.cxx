@@ -270,3 +270,94 @@ TEST( DisparityMap, DisparityFiltering ) {
   }
   EXPECT_EQ(INVALID_COUNT_ANS, invalid_count);
 }
+
+namespace {
+  // A smooth disparity with noise, scattered outliers and invalid pixels.
+  ImageView<PixelMask<Vector2f> > make_noisy_disparity(int32 cols, int32 rows, bool outliers) {
+    ImageView<PixelMask<Vector2f> > image(cols, rows);
+    uint32 seed = 12345;
+    for (int r=0; r<rows; ++r) {
+      for (int c=0; c<cols; ++c) {
+        seed = seed*1664525 + 1013904223;
+        const float noise = float(seed >> 8)/float(1 << 24) - 0.5;
+        image(c,r) = PixelMask<Vector2f>(Vector2f(10 + 0.05*c + noise, 2 + 0.02*r - noise));
+        if (seed % 17 == 0)
+          invalidate(image(c,r));
+        if (outliers && seed % 23 == 0)
+          image(c,r) = PixelMask<Vector2f>(Vector2f(10 + 0.05*c + 8*noise, 2 - 6*noise));
+      }
+    }
+    return image;
+  }
+
+  template <class View1T, class View2T>
+  int count_differences(ImageViewBase<View1T> const& a, ImageViewBase<View2T> const& b) {
+    int differences = 0;
+    for (int r=0; r<a.impl().rows(); ++r) {
+      for (int c=0; c<a.impl().cols(); ++c) {
+        if (is_valid(a.impl()(c,r)) != is_valid(b.impl()(c,r)) ||
+            (is_valid(a.impl()(c,r)) && a.impl()(c,r).child() != b.impl()(c,r).child()))
+          ++differences;
+      }
+    }
+    return differences;
+  }
+}
+
+TEST( DisparityMap, DisparityCleanupSingleFilter ) {
+  ImageView<PixelMask<Vector2f> > image = make_noisy_disparity(70, 50, true);
+  const Vector2i tile(16, 16); // Several tiles, so the halos are used
+
+  DisparityFilterList filters(1, DisparityFilterStep::thresh(2, 3, 0.6, 0.5));
+  ImageView<PixelMask<Vector2f> > fused = block_rasterize(disparity_cleanup(image, filters), tile, 4);
+  ImageView<PixelMask<Vector2f> > chained = rm_outliers_using_thresh(image, 2, 3, 0.6, 0.5);
+  EXPECT_EQ(0, count_differences(fused, chained));
+  EXPECT_GT(count_differences(fused, image), 0);
+
+  filters[0] = DisparityFilterStep::stddev(3, 3, 2.0, 0.1);
+  fused   = block_rasterize(disparity_cleanup(image, filters), tile, 4);
+  chained = rm_outliers_using_stddev(image, 3, 3, 2.0, 0.1);
+  EXPECT_EQ(0, count_differences(fused, chained));
+  EXPECT_GT(count_differences(fused, image), 0);
+
+  // No disparity is over twice the 75th percentile magnitude here.
+  ImageView<PixelMask<Vector2f> > smooth = make_noisy_disparity(70, 50, false);
+  filters[0] = DisparityFilterStep::mean(2, 2, 0.3);
+  fused   = block_rasterize(disparity_cleanup(smooth, filters), tile, 4);
+  chained = rm_outliers_using_mean(smooth, 2, 2, 0.3);
+  EXPECT_EQ(0, count_differences(fused, chained));
+  EXPECT_GT(count_differences(fused, smooth), 0);
+
+  filters[0] = DisparityFilterStep::thresh(0, 3, 0.6, 0.5);
+  EXPECT_THROW(disparity_cleanup(image, filters), ArgumentErr);
+}
+
+TEST( DisparityMap, DisparityCleanupPipeline ) {
+  // The image of the DisparityFiltering test.
+  typedef PixelMask<Vector2i> pixel_type;
+  const int IMAGE_SIZE = 100;
+  ImageView<pixel_type> image(IMAGE_SIZE, IMAGE_SIZE);
+  for (int r=0; r<IMAGE_SIZE; ++r)
+    for (int c=0; c<IMAGE_SIZE; ++c)
+      image(c,r) = pixel_type(c,r);
+  for (int r=5; r<10; ++r)
+    for (int c=5; c<10; ++c)
+      image(c,r) = pixel_type(10000,5000);
+
+  DisparityFilterList filters;
+  filters.push_back(DisparityFilterStep::thresh(3, 3, 10.0, 0.2));
+  filters.push_back(DisparityFilterStep::thresh(1, 1, 3.0,  0.2));
+  filters.push_back(DisparityFilterStep::quantile(0.75, 3.0));
+  DisparityCleanupView<ImageView<pixel_type> > cleanup(image, filters);
+  ImageView<pixel_type> filtered = block_rasterize(cleanup, Vector2i(32, 32), 2);
+
+  int invalid_count = 0;
+  for (int r=0; r<IMAGE_SIZE; ++r)
+    for (int c=0; c<IMAGE_SIZE; ++c)
+      if (!is_valid(filtered(c,r)))
+        ++invalid_count;
+  EXPECT_EQ(25, invalid_count);
+  EXPECT_FALSE(is_valid(filtered(7,7)));
+  EXPECT_EQ(IMAGE_SIZE*IMAGE_SIZE, cleanup.total_points());
+  EXPECT_EQ(25, cleanup.rejected_points(0) + cleanup.rejected_points(1) + cleanup.rejected_points(2));
+}
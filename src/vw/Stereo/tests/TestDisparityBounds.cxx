@@ -0,0 +1,123 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <vw/Stereo/DisparityBounds.h>
+#include <vw/Stereo/Correlation.h>
+
+using namespace vw;
+using namespace vw::stereo;
+using namespace vw::test;
+
+namespace {
+  // A 10x8 coarse disparity of (3,2) with one invalid pixel and one edge pixel.
+  ImageView<PixelMask<Vector2i> > make_coarse_disparity() {
+    ImageView<PixelMask<Vector2i> > coarse(10, 8);
+    for (int r=0; r<coarse.rows(); ++r)
+      for (int c=0; c<coarse.cols(); ++c)
+        coarse(c,r) = PixelMask<Vector2i>(Vector2i(3,2));
+    invalidate(coarse(4,4));
+    coarse(7,1) = PixelMask<Vector2i>(Vector2i(0,2)); // On the edge of the search range
+    return coarse;
+  }
+}
+
+TEST( DisparityBounds, populate_from_coarse ) {
+  DisparityBounds bounds;
+  const Vector4i search_range(0, 0, 12, 10);
+  size_t num_trusted = bounds.populate_from_coarse(make_coarse_disparity(), 21, 16,
+                                                   search_range, Vector2i(2,1));
+  EXPECT_EQ(21, bounds.cols());
+  EXPECT_EQ(16, bounds.rows());
+  EXPECT_EQ(size_t(20*16 - 2*4), num_trusted);
+
+  EXPECT_FALSE(bounds.is_full_range(0, 0));
+  EXPECT_VECTOR_EQ(Vector4i(4,3,8,5), bounds(0,0));
+  EXPECT_VECTOR_EQ(Vector4i(4,3,8,5), bounds(19,15));
+
+  // Invalid and edge prior disparities and the column past the prior get the full range.
+  EXPECT_TRUE(bounds.is_full_range(8, 9));
+  EXPECT_VECTOR_EQ(search_range, bounds(9,8));
+  EXPECT_TRUE(bounds.is_full_range(15, 3));
+  EXPECT_TRUE(bounds.is_full_range(20, 0));
+
+  // Without edge rejection the edge pixel is trusted and clamped to the range.
+  bounds.populate_from_coarse(make_coarse_disparity(), 21, 16, search_range, Vector2i(2,1), 2, false);
+  EXPECT_FALSE(bounds.is_full_range(15, 3));
+  EXPECT_VECTOR_EQ(Vector4i(0,3,2,5), bounds(15,3));
+}
+
+TEST( DisparityBounds, fill_full_range_pixels ) {
+  DisparityBounds bounds;
+  bounds.populate_from_coarse(make_coarse_disparity(), 20, 16,
+                              Vector4i(0, 0, 12, 10), Vector2i(2,1));
+  const double initial_volume = bounds.search_volume();
+
+  // The invalid pixel takes the range of its neighbors, grown by one.
+  EXPECT_EQ(size_t(8), bounds.fill_full_range_pixels(3, 1, false));
+  EXPECT_TRUE(bounds.is_full_range(8, 9));
+  EXPECT_VECTOR_EQ(Vector4i(3,2,9,6), bounds(8,9));
+  EXPECT_LT(bounds.search_volume(), initial_volume);
+
+  // With no search radius nothing can be found, so pixels are discarded.
+  EXPECT_EQ(size_t(8), bounds.fill_full_range_pixels(0, 1, true));
+  EXPECT_VECTOR_EQ(DisparityBounds::empty_bounds(), bounds(8,9));
+}
+
+TEST( DisparityBounds, region_range ) {
+  DisparityBounds bounds;
+  bounds.populate_from_coarse(make_coarse_disparity(), 20, 16,
+                              Vector4i(0, 0, 12, 10), Vector2i(2,1));
+  BBox2i range;
+  ASSERT_TRUE(bounds.region_range(BBox2i(0,0,20,16), range));
+  EXPECT_EQ(BBox2i(4,3,5,3), range); // Exclusive maximum
+
+  // A region of only untrusted pixels has no range.
+  EXPECT_FALSE(bounds.region_range(BBox2i(8,8,2,2), range));
+
+  // The zones cover the image with the same range.
+  std::vector<SearchParam> zones;
+  subdivide_regions(bounds, BBox2i(0,0,20,16), zones, Vector2i(3,3));
+  ASSERT_FALSE(zones.empty());
+  for (size_t i=0; i<zones.size(); ++i)
+    EXPECT_EQ(BBox2i(4,3,5,3), zones[i].disparity_range());
+}
+
+TEST( DisparityBounds, read_write ) {
+  DisparityBounds bounds;
+  bounds.populate_from_coarse(make_coarse_disparity(), 21, 16,
+                              Vector4i(0, 0, 12, 10), Vector2i(2,1));
+  bounds.set_empty(3, 3);
+
+  UnlinkName filename("disparity_bounds.bin");
+  bounds.write(filename);
+
+  DisparityBounds loaded;
+  loaded.read(filename);
+  ASSERT_EQ(bounds.cols(), loaded.cols());
+  ASSERT_EQ(bounds.rows(), loaded.rows());
+  EXPECT_VECTOR_EQ(bounds.search_range(), loaded.search_range());
+  for (int r=0; r<bounds.rows(); ++r) {
+    for (int c=0; c<bounds.cols(); ++c) {
+      EXPECT_VECTOR_EQ(bounds(c,r), loaded(c,r));
+      EXPECT_EQ(bounds.is_full_range(c,r), loaded.is_full_range(c,r));
+    }
+  }
+
+  EXPECT_THROW(loaded.read("no_such_bounds_file.bin"), IOErr);
+}
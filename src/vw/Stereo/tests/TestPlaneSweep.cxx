@@ -0,0 +1,124 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestPlaneSweep.h
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Camera/PinholeModel.h>
+#include <vw/Stereo/PlaneSweep.h>
+
+using namespace vw;
+using namespace vw::stereo;
+using namespace vw::camera;
+
+namespace {
+
+  const double PLANE_Z = 20.0;
+
+  // A texture painted on the plane z = PLANE_Z.
+  double texture(double x, double y) {
+    return 128 + 50*sin(3.1*x)*cos(2.3*y) + 30*sin(1.3*x + 4.7*y) + 20*cos(5.9*x - 1.1*y);
+  }
+
+  // Render what a camera sees of the textured plane.
+  ImageView<uint8> render(PinholeModel const& camera, int32 cols, int32 rows) {
+    ImageView<uint8> image(cols, rows);
+    for (int32 r=0; r<rows; ++r) {
+      for (int32 c=0; c<cols; ++c) {
+        Vector3 center = camera.camera_center(Vector2(c,r));
+        Vector3 dir    = camera.pixel_to_vector(Vector2(c,r));
+        Vector3 point  = center + dir*((PLANE_Z - center[2])/dir[2]);
+        image(c,r) = uint8(std::min(255.0, std::max(0.0, texture(point[0], point[1]))));
+      }
+    }
+    return image;
+  }
+
+  class PlaneSweepTest : public ::testing::Test {
+  protected:
+    void SetUp() {
+      Matrix3x3 pose;
+      pose.set_identity();
+      const Vector3 centers[3] = {Vector3(0,0,0), Vector3(1,0,0), Vector3(-0.5,0.8,0)};
+      for (int i=0; i<3; ++i) {
+        models.push_back(PinholeModel(centers[i], pose, 100, 100, 40, 30));
+      }
+      for (int i=0; i<3; ++i) {
+        cameras.push_back(&models[i]);
+        images.push_back(render(models[i], 80, 60));
+      }
+    }
+
+    // Fraction of the interior pixels whose depth is within tol of the plane.
+    double fraction_correct(ImageView<PixelMask<float> > const& depth, double tol) {
+      int32 good = 0, total = 0;
+      for (int32 r=6; r<depth.rows()-6; ++r) {
+        for (int32 c=12; c<depth.cols()-6; ++c) {
+          ++total;
+          if (!is_valid(depth(c,r)))
+            continue;
+          double expected = PLANE_Z / models[0].pixel_to_vector(Vector2(c,r))[2];
+          if (fabs(depth(c,r).child() - expected) < tol*expected)
+            ++good;
+        }
+      }
+      return double(good)/total;
+    }
+
+    std::vector<PinholeModel> models;
+    std::vector<const CameraModel*> cameras;
+    std::vector<ImageView<uint8> > images;
+  };
+
+} // end anonymous namespace
+
+TEST_F( PlaneSweepTest, plane_depth ) {
+  PlaneSweepStereo sweep(cameras, 10, 40, 31);
+  EXPECT_NEAR(10.0, sweep.plane_depth(0),  1e-10);
+  EXPECT_NEAR(40.0, sweep.plane_depth(30), 1e-10);
+  EXPECT_NEAR(40.0/3, sweep.plane_depth(10), 1e-10); // Uniform in inverse depth
+  EXPECT_THROW(PlaneSweepStereo(cameras, 40, 10, 31), ArgumentErr);
+  EXPECT_THROW(PlaneSweepStereo(cameras, 10, 40, 31, 4), ArgumentErr);
+}
+
+TEST_F( PlaneSweepTest, box ) {
+  PlaneSweepStereo sweep(cameras, 10, 40, 64, 5, PlaneSweepStereo::AGGREGATE_BOX);
+  ImageView<PixelMask<float> > depth = sweep(images);
+  ASSERT_EQ(80, depth.cols());
+  ASSERT_EQ(60, depth.rows());
+  EXPECT_GT(fraction_correct(depth, 0.02), 0.95);
+}
+
+TEST_F( PlaneSweepTest, sgm ) {
+  PlaneSweepStereo sweep(cameras, 10, 40, 64, 3, PlaneSweepStereo::AGGREGATE_SGM);
+  ImageView<PixelMask<float> > depth = sweep(images);
+  EXPECT_GT(fraction_correct(depth, 0.02), 0.95);
+
+  // The points lie on the plane.
+  ImageView<Vector3> points = sweep.points(depth);
+  EXPECT_NEAR(PLANE_Z, points(40,30)[2], 0.2);
+  EXPECT_NEAR(0.0,     points(40,30)[0], 0.02);
+
+  // Pixels which no other view can see are invalid.
+  std::vector<ImageView<uint8> > blank_images = images;
+  blank_images[1] = ImageView<uint8>(2,2);
+  blank_images[2] = ImageView<uint8>(2,2);
+  depth = sweep(blank_images);
+  EXPECT_FALSE(is_valid(depth(60,40)));
+}
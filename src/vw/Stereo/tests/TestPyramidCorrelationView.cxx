@@ -409,3 +409,31 @@ TEST_F( PyramidViewU8, NullPreprocess ) {
   ASSERT_EQ( input1.rows(), disparity_map.rows() );
   check_error( disparity_map, .90, .990, "Cross Correlation" );
 }
+
+TEST_F( PyramidViewGRAYF32, Census ) {
+  ImageView<PixelMask<Vector2i> > disparity_map =
+    pyramid_correlate( input1, input2,
+                       constant_view(uint8(255), input1),
+                       constant_view(uint8(255), input2),
+                       PREFILTER_NONE, 0,
+                       search_volume, kernel_size,
+                       CENSUS_TRANSFORM,
+                       corr_timeout, seconds_per_op,
+                       -1, 0, filter_radius, max_levels );
+  ASSERT_EQ( input1.cols(), disparity_map.cols() );
+  ASSERT_EQ( input1.rows(), disparity_map.rows() );
+  check_error( disparity_map, .90, .99, "Census" );
+
+  disparity_map =
+    pyramid_correlate( input1, input2,
+                       constant_view(uint8(255), input1),
+                       constant_view(uint8(255), input2),
+                       PREFILTER_NONE, 0,
+                       search_volume, kernel_size,
+                       TERNARY_CENSUS_TRANSFORM,
+                       corr_timeout, seconds_per_op,
+                       2, 0, filter_radius, max_levels );
+  ASSERT_EQ( input1.cols(), disparity_map.cols() );
+  ASSERT_EQ( input1.rows(), disparity_map.rows() );
+  check_error( disparity_map, .90, .99, "Ternary Census" );
+}
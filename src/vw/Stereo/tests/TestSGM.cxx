@@ -20,6 +20,8 @@
 #include <vw/Image/EdgeExtension.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Stereo/SGM.h>
+#include <vw/Stereo/Correlate.h>
+#include <vw/Core/Settings.h>
 
 using namespace vw;
 using namespace vw::stereo;
@@ -73,3 +75,163 @@ TEST( SGM, constant_offset ) {
   EXPECT_GT(percent_correct, 0.99);
 }
 
+
+TEST( SGM, low_memory_mode ) {
+
+  // The low-memory mode recomputes costs in bands of rows but must
+  //  produce exactly the same result as the normal mode.
+  const int width = 80, height = 60;
+  ImageView<uint8> texture(width+10, height+10);
+  srand(7);
+  for (int r=0; r<texture.rows(); ++r)
+    for (int c=0; c<texture.cols(); ++c)
+      texture(c,r) = rand() % 256;
+
+  ImageView<uint8> left  = crop(texture, BBox2i(2, 1, width,    height   ));
+  ImageView<uint8> right = crop(texture, BBox2i(0, 0, width+10, height+10));
+  for (int r=0; r<right.rows(); ++r)
+    for (int c=0; c<right.cols(); ++c)
+      right(c,r) = std::min(255, int(right(c,r)) + rand()%20);
+
+  SemiGlobalMatcher normal_matcher    (CENSUS_TRANSFORM, false, 0, 0, 6, 4, 5);
+  SemiGlobalMatcher low_memory_matcher(CENSUS_TRANSFORM, false, 0, 0, 6, 4, 5);
+  low_memory_matcher.set_low_memory_mode(true);
+
+  SemiGlobalMatcher::DisparityImage normal_disp     = normal_matcher.semi_global_matching_func    (left, right);
+  SemiGlobalMatcher::DisparityImage low_memory_disp = low_memory_matcher.semi_global_matching_func(left, right);
+  ImageView<PixelMask<Vector2f> > normal_subpixel     = normal_matcher.create_disparity_view_subpixel    (normal_disp);
+  ImageView<PixelMask<Vector2f> > low_memory_subpixel = low_memory_matcher.create_disparity_view_subpixel(low_memory_disp);
+
+  ASSERT_EQ(normal_disp.cols(), low_memory_disp.cols());
+  ASSERT_EQ(normal_disp.rows(), low_memory_disp.rows());
+  for (int row=0; row<normal_disp.rows(); ++row) {
+    for (int col=0; col<normal_disp.cols(); ++col) {
+      EXPECT_EQ(normal_disp(col,row), low_memory_disp(col,row));
+      EXPECT_VECTOR_EQ(normal_subpixel(col,row).child(), low_memory_subpixel(col,row).child());
+    }
+  }
+  EXPECT_EQ(Vector2i(2,1), normal_disp(width/2, height/2).child());
+}
+
+TEST( SGM, right_disparity ) {
+
+  // The right to left disparity comes from the left to right accumulated costs,
+  //  in both accumulation modes.
+  const int width = 80, height = 60;
+  ImageView<uint8> texture(width+10, height+10);
+  srand(11);
+  for (int r=0; r<texture.rows(); ++r)
+    for (int c=0; c<texture.cols(); ++c)
+      texture(c,r) = rand() % 256;
+  ImageView<uint8> left  = crop(texture, BBox2i(2, 1, width,    height   ));
+  ImageView<uint8> right = crop(texture, BBox2i(0, 0, width+10, height+10));
+
+  SemiGlobalMatcher normal_matcher    (CENSUS_TRANSFORM, false, 0, 0, 6, 4, 5);
+  SemiGlobalMatcher low_memory_matcher(CENSUS_TRANSFORM, false, 0, 0, 6, 4, 5);
+  normal_matcher.set_compute_right_disparity(true);
+  low_memory_matcher.set_compute_right_disparity(true);
+  low_memory_matcher.set_low_memory_mode(true);
+  SemiGlobalMatcher::DisparityImage disparity = normal_matcher.semi_global_matching_func(left, right);
+  low_memory_matcher.semi_global_matching_func(left, right);
+
+  SemiGlobalMatcher::DisparityImage const& rl = normal_matcher.right_disparity();
+  ASSERT_EQ(disparity.cols() + 6, rl.cols());
+  ASSERT_EQ(disparity.rows() + 4, rl.rows());
+  ASSERT_EQ(rl.cols(), low_memory_matcher.right_disparity().cols());
+  for (int row=0; row<rl.rows(); ++row)
+    for (int col=0; col<rl.cols(); ++col)
+      EXPECT_EQ(rl(col,row), low_memory_matcher.right_disparity()(col,row));
+  EXPECT_EQ(Vector2i(-2,-1), rl(width/2, height/2).child());
+
+  // Nearly all of the pixels pass the consistency check, but not a corrupted one.
+  disparity(20,20) = PixelMask<Vector2i>(Vector2i(5,3));
+  cross_corr_consistency_check(disparity, rl, 1);
+  EXPECT_FALSE(is_valid(disparity(20,20)));
+  int num_valid = 0;
+  for (int row=0; row<disparity.rows(); ++row)
+    for (int col=0; col<disparity.cols(); ++col)
+      if (is_valid(disparity(col,row)))
+        ++num_valid;
+  EXPECT_GT(num_valid, 0.9*disparity.cols()*disparity.rows());
+}
+
+TEST( SGM, thread_count_invariance ) {
+
+  // The path accumulation must give exactly the same result for any number of threads.
+  const int width = 80, height = 60;
+  ImageView<uint8> texture(width+10, height+10);
+  srand(11);
+  for (int r=0; r<texture.rows(); ++r)
+    for (int c=0; c<texture.cols(); ++c)
+      texture(c,r) = rand() % 256;
+
+  ImageView<uint8> left  = crop(texture, BBox2i(2, 1, width,    height   ));
+  ImageView<uint8> right = crop(texture, BBox2i(0, 0, width+10, height+10));
+  for (int r=0; r<right.rows(); ++r)
+    for (int c=0; c<right.cols(); ++c)
+      right(c,r) = std::min(255, int(right(c,r)) + rand()%20);
+
+  const int num_threads = vw_settings().default_num_threads();
+  for (int use_mgm=0; use_mgm<2; ++use_mgm) {
+    vw_settings().set_default_num_threads(1);
+    SemiGlobalMatcher single_matcher(CENSUS_TRANSFORM, use_mgm, 0, 0, 6, 4, 5);
+    SemiGlobalMatcher::DisparityImage single_disp = single_matcher.semi_global_matching_func(left, right);
+
+    vw_settings().set_default_num_threads(8);
+    SemiGlobalMatcher multi_matcher(CENSUS_TRANSFORM, use_mgm, 0, 0, 6, 4, 5);
+    SemiGlobalMatcher::DisparityImage multi_disp = multi_matcher.semi_global_matching_func(left, right);
+
+    ASSERT_EQ(single_disp.cols(), multi_disp.cols());
+    ASSERT_EQ(single_disp.rows(), multi_disp.rows());
+    for (int row=0; row<single_disp.rows(); ++row)
+      for (int col=0; col<single_disp.cols(); ++col)
+        EXPECT_EQ(single_disp(col,row), multi_disp(col,row));
+  }
+  vw_settings().set_default_num_threads(num_threads);
+}
+
+TEST( SGM, prior_bounds ) {
+
+  // Passing in bounds built from a half resolution disparity image must give
+  //  the same result as passing in the disparity image itself.
+  const int width = 80, height = 60;
+  ImageView<uint8> texture(width+20, height+20);
+  srand(13);
+  for (int r=0; r<texture.rows(); ++r)
+    for (int c=0; c<texture.cols(); ++c)
+      texture(c,r) = rand() % 256;
+
+  ImageView<uint8> left  = crop(texture, BBox2i(5, 3, width,    height   ));
+  ImageView<uint8> right = crop(texture, BBox2i(0, 0, width+12, height+8));
+
+  const int half_kernel = 1;
+  SemiGlobalMatcher::DisparityImage prev_disparity((width-2*half_kernel)/2, (height-2*half_kernel)/2);
+  for (int r=0; r<prev_disparity.rows(); ++r)
+    for (int c=0; c<prev_disparity.cols(); ++c)
+      prev_disparity(c,r) = PixelMask<Vector2i>(Vector2i(2,1));
+  invalidate(prev_disparity(10,10));
+
+  SemiGlobalMatcher disp_matcher(CENSUS_TRANSFORM, false, 0, 0, 12, 8, 2*half_kernel+1);
+  SemiGlobalMatcher::DisparityImage disp_result
+    = disp_matcher.semi_global_matching_func(left, right, 0, 0, &prev_disparity);
+
+  DisparityBounds bounds;
+  bounds.populate_from_coarse(prev_disparity, disp_result.cols(), disp_result.rows(),
+                              Vector4i(0, 0, 12, 8), Vector2i(2,2));
+  SemiGlobalMatcher bounds_matcher(CENSUS_TRANSFORM, false, 0, 0, 12, 8, 2*half_kernel+1);
+  SemiGlobalMatcher::DisparityImage bounds_result
+    = bounds_matcher.semi_global_matching_func(left, right, 0, 0, 0, &bounds);
+
+  ASSERT_EQ(disp_result.cols(), bounds_result.cols());
+  ASSERT_EQ(disp_result.rows(), bounds_result.rows());
+  for (int row=0; row<disp_result.rows(); ++row)
+    for (int col=0; col<disp_result.cols(); ++col)
+      EXPECT_EQ(disp_result(col,row), bounds_result(col,row));
+  EXPECT_EQ(Vector2i(5,3), disp_result(width/2, height/2).child());
+  EXPECT_LT(bounds_matcher.disparity_bounds().search_volume(),
+            13.0*9.0*disp_result.cols()*disp_result.rows());
+
+  // Bounds for the wrong search range are rejected.
+  SemiGlobalMatcher wrong_matcher(CENSUS_TRANSFORM, false, 0, 0, 10, 8, 2*half_kernel+1);
+  EXPECT_THROW(wrong_matcher.semi_global_matching_func(left, right, 0, 0, 0, &bounds), ArgumentErr);
+}
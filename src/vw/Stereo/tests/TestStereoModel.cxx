@@ -24,6 +24,7 @@
 #include <vw/Math/EulerAngles.h>
 #include <vw/Camera/PinholeModel.h>
 #include <vw/Camera/CameraModel.h>
+#include <vw/Camera/LinescanModel.h>
 #include <vw/Stereo/StereoModel.h>
 #include <vw/Stereo/StereoView.h>
 
@@ -108,6 +109,73 @@ TEST( StereoModel, AdjustedStereo ) {
   }
 }
 
+// A pushbroom camera moving along +Y with a fixed pose.
+// - LinescanModel only applies the refraction correction when its flag is
+//   false, so true keeps the correction away from these rays at the origin.
+class TestLinescanModel : public camera::LinescanModel {
+  Vector3 m_start;
+public:
+  TestLinescanModel(Vector3 const& start)
+    : camera::LinescanModel(Vector2i(1000, 1000), false, true), m_start(start) {}
+
+  virtual Vector3 get_camera_center_at_time  (double time) const { return m_start + time*Vector3(0,1,0); }
+  virtual Vector3 get_camera_velocity_at_time(double /*time*/) const { return Vector3(0,1,0); }
+  virtual Quat    get_camera_pose_at_time    (double /*time*/) const { return Quat(1,0,0,0); }
+  virtual double  get_time_at_line           (double line) const { return 0.01*line; }
+  virtual Vector3 get_local_pixel_vector(Vector2 const& pix) const {
+    return normalize(Vector3(pix.x(), 0, 1));
+  }
+};
+
+// A pinhole camera whose rays are tilted, to check that batch
+// calls go through the overridden pixel_to_vector().
+class TiltedPinholeModel : public camera::PinholeModel {
+public:
+  TiltedPinholeModel(Vector3 const& center)
+    : camera::PinholeModel(center, identity_matrix<3>(), 1, 1, 0, 0) {}
+
+  virtual Vector3 pixel_to_vector(Vector2 const& pix) const {
+    return normalize(camera::PinholeModel::pixel_to_vector(pix) + Vector3(0, 0.1, 0));
+  }
+};
+
+TEST( StereoModel, BatchTriangulate ) {
+
+  boost::shared_ptr<CameraModel> pin1(new camera::PinholeModel( Vector3(), identity_matrix<3>(), 1, 1, 0, 0));
+  boost::shared_ptr<CameraModel> pin2(new camera::PinholeModel( Vector3(1,0,0), identity_matrix<3>(), 1, 1, 0, 0));
+  camera::AdjustedCameraModel adj1(pin1), adj2(pin2);
+  adj1.set_rotation(euler_to_quaternion(M_PI/8, M_PI/12, M_PI/15, "xyz"));
+  adj2.set_translation(Vector3(0.1, 0.04, 0.123));
+
+  // Points in front of and behind the cameras, an invalid pixel and parallel rays.
+  std::vector<Vector2> px1, px2;
+  for (int i = 0; i < 300; ++i) {
+    px1.push_back(Vector2(0.01*i - 1.5, 0.003*i));
+    px2.push_back(px1.back() + Vector2(-1 + 0.004*i, 0.0002*i));
+  }
+  px1[5] = camera::CameraModel::invalid_pixel();
+  px2[7] = px1[7];
+
+  TestLinescanModel  ls1(Vector3(0,0,0)), ls2(Vector3(1,0,0));
+  TiltedPinholeModel tilt1(Vector3(0,0,0)), tilt2(Vector3(1,0,0));
+
+  const CameraModel* cams[4][2] = {{pin1.get(), pin2.get()}, {&adj1, &adj2},
+                                   {&ls1, &ls2}, {&tilt1, &tilt2}};
+  for (int c = 0; c < 4; ++c) {
+    StereoModel st(cams[c][0], cams[c][1]);
+    std::vector<double> x(px1.size()), y(px1.size()), z(px1.size()), error(px1.size());
+    st.triangulate(&px1[0], &px2[0], px1.size(), &x[0], &y[0], &z[0], &error[0]);
+    for (size_t i = 0; i < px1.size(); ++i) {
+      double expected_error;
+      Vector3 expected = st(px1[i], px2[i], expected_error);
+      EXPECT_VECTOR_NEAR( expected, Vector3(x[i], y[i], z[i]), 1e-10 );
+      EXPECT_NEAR( expected_error, error[i], 1e-10 );
+    }
+    EXPECT_VECTOR_DOUBLE_EQ( Vector3(), Vector3(x[5], y[5], z[5]) );
+    EXPECT_VECTOR_DOUBLE_EQ( Vector3(), Vector3(x[7], y[7], z[7]) );
+  }
+}
+
 TEST( StereoView, PixelMaskVec2 ) {
   Vector3 pos1, pos2;
   pos2 = Vector3(1,0,0);
@@ -24,7 +24,7 @@
 #include <vw/Core/Log.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Math/Geometry.h>
-#include <vw/Math/RANSAC.h>
+#include <vw/Math/PROSAC.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/Matrix.h>
 #include <vw/Image/ImageView.h>
@@ -215,7 +215,8 @@ void align_images( Options & opt ) {
     // Use an interest point matcher to find matched pairs of interest points
     DefaultMatcher matcher(opt.matcher_threshold);
     std::vector<InterestPoint> matched_ip1, matched_ip2;
-    matcher(ref_ip_v, input_ip_v, matched_ip1, matched_ip2,
+    std::vector<double> match_quality;
+    matcher(ref_ip_v, input_ip_v, matched_ip1, matched_ip2, match_quality,
             TerminalProgressCallback( "tools.ipalign", "Matching:"));
     vw_out(InfoMessage) << "\tFound " << matched_ip1.size() << " putative matches.\n";
 
@@ -226,17 +227,17 @@ void align_images( Options & opt ) {
     std::vector<size_t>  indices;
 
     if ( opt.align_method == "homography" ) { // Full projective transform
-      math::RandomSampleConsensus<math::HomographyFittingFunctor, math::InterestPointErrorMetric> 
+      math::ProgressiveSampleConsensus<math::HomographyFittingFunctor, math::InterestPointErrorMetric>
                   ransac(math::HomographyFittingFunctor(), math::InterestPointErrorMetric(), opt.ransac_iterations, 
                          opt.inlier_threshold, ransac_ip1.size()/2, true);
-      align_matrix = ransac(ransac_ip2, ransac_ip1);
+      align_matrix = ransac(ransac_ip2, ransac_ip1, match_quality);
       indices      = ransac.inlier_indices(align_matrix, ransac_ip2, ransac_ip1);
     }
     if ( opt.align_method == "similarity" ) { // Similarity transform
-      math::RandomSampleConsensus<math::AffineFittingFunctor, math::InterestPointErrorMetric> 
+      math::ProgressiveSampleConsensus<math::AffineFittingFunctor, math::InterestPointErrorMetric>
                   ransac(math::AffineFittingFunctor(), math::InterestPointErrorMetric(), opt.ransac_iterations, 
                          opt.inlier_threshold, ransac_ip1.size()/2, true);
-      align_matrix = ransac(ransac_ip2, ransac_ip1);
+      align_matrix = ransac(ransac_ip2, ransac_ip1, match_quality);
       indices      = ransac.inlier_indices(align_matrix, ransac_ip2, ransac_ip1);
     }
     
@@ -338,7 +339,7 @@ void handle_arguments( int argc, char* argv[], Options& opt ) {
     ("inlier-threshold,i", po::value(&opt.inlier_threshold)->default_value(10), 
                            "RANSAC inlier threshold.")
     ("ransac-iterations", po::value(&opt.ransac_iterations)->default_value(100), 
-                          "Number of RANSAC iterations.")
+                          "Maximum number of RANSAC iterations.")
     ("align-method", po::value(&opt.align_method)->default_value("similarity"),
                    "Choose similarity, homography, or epipolar image alignment.");
 
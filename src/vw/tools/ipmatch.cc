@@ -25,7 +25,7 @@
 #include <vw/Core/Log.h>
 #include <vw/Math/BBox.h>
 #include <vw/Math/Geometry.h>
-#include <vw/Math/RANSAC.h>
+#include <vw/Math/PROSAC.h>
 #include <vw/Image/AlgorithmFunctions.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/ImageIO.h>
@@ -132,6 +132,18 @@ static void write_match_image(std::string const& out_file_name,
   block_write_image( *rsrc, comp, TerminalProgressCallback( "tools.ipmatch", "Writing Debug:" ) );
 }
 
+// Fit with the best ranked matches first when the matcher gave a quality,
+// and with uniform sampling otherwise.
+template <class RansacT>
+static Matrix<double> fit(RansacT & ransac,
+                          std::vector<Vector3> const& ransac_ip1,
+                          std::vector<Vector3> const& ransac_ip2,
+                          std::vector<double>  const& match_quality) {
+  if (match_quality.empty())
+    return ransac(ransac_ip1, ransac_ip2);
+  return ransac(ransac_ip1, ransac_ip2, match_quality);
+}
+
 int main(int argc, char** argv) {
   std::vector<std::string> input_file_names;
   double      matcher_threshold;
@@ -154,7 +166,7 @@ int main(int argc, char** argv) {
     ("inlier-threshold,i",  po::value(&inlier_threshold)->default_value(10), 
                             "RANSAC inlier threshold.")
     ("ransac-iterations",   po::value(&ransac_iterations)->default_value(100), 
-                            "Number of RANSAC iterations.")
+                            "Maximum number of RANSAC iterations.")
     ("debug-image,d",       "Write out debug images.");
 
   po::options_description hidden_options("");
@@ -223,6 +235,8 @@ int main(int argc, char** argv) {
                << " points) and "     << image_paths[j] << " (" << ip2.size() << " points).\n";
 
       std::vector<InterestPoint> matched_ip1, matched_ip2;
+      // Ranks the matches for RANSAC, left empty by the simple matcher.
+      std::vector<double> match_quality;
 
       //std::cout << "IP1 --> \n";
       for (size_t k=0; k<ip1.size(); ++k) {
@@ -236,11 +250,13 @@ int main(int argc, char** argv) {
         // Run interest point matcher that uses KDTree algorithm.
         if (distance_metric == "l2") {
           InterestPointMatcher< L2NormMetric, NullConstraint> matcher(matcher_threshold);
-          matcher(ip1, ip2, matched_ip1, matched_ip2, TerminalProgressCallback( "tools.ipmatch","Matching:"));
+          matcher(ip1, ip2, matched_ip1, matched_ip2, match_quality,
+                  TerminalProgressCallback( "tools.ipmatch","Matching:"));
         } 
         if (distance_metric == "hamming") {
           InterestPointMatcher< HammingMetric, NullConstraint> matcher(matcher_threshold);
-          matcher(ip1, ip2, matched_ip1, matched_ip2, TerminalProgressCallback( "tools.ipmatch","Matching:"));
+          matcher(ip1, ip2, matched_ip1, matched_ip2, match_quality,
+                  TerminalProgressCallback( "tools.ipmatch","Matching:"));
         }
       } else {
         // Run interest point matcher that does not use KDTree algorithm.
@@ -256,7 +272,10 @@ int main(int argc, char** argv) {
 
       vw_out() << "Found " << matched_ip1.size() << " putative matches before duplicate removal.\n";
 
-      remove_duplicates(matched_ip1, matched_ip2);
+      if (match_quality.empty())
+        remove_duplicates(matched_ip1, matched_ip2);
+      else
+        remove_duplicates(matched_ip1, matched_ip2, match_quality);
       vw_out() << "Found " << matched_ip1.size() << " putative matches.\n";
 
       std::vector<Vector3> ransac_ip1 = iplist_to_vectorlist(matched_ip1),
@@ -267,36 +286,36 @@ int main(int argc, char** argv) {
         // of points.  Points that don't meet this geometric
         // contstraint are rejected as outliers.
         if (ransac_constraint == "similarity") {
-          math::RandomSampleConsensus<math::SimilarityFittingFunctor, 
-                                      math::InterestPointErrorMetric> 
+          math::ProgressiveSampleConsensus<math::SimilarityFittingFunctor, 
+                                           math::InterestPointErrorMetric> 
               ransac( math::SimilarityFittingFunctor(),
                       math::InterestPointErrorMetric(),
                       ransac_iterations,
                       inlier_threshold,
                       ransac_ip1.size()/2, true);
-          Matrix<double> H(ransac(ransac_ip1,ransac_ip2));
+          Matrix<double> H(fit(ransac, ransac_ip1, ransac_ip2, match_quality));
           std::cout << "\t--> Similarity: " << H << "\n";
           indices = ransac.inlier_indices(H,ransac_ip1,ransac_ip2);
         } else if (ransac_constraint == "homography") {
-          math::RandomSampleConsensus<math::HomographyFittingFunctor, 
-                                      math::InterestPointErrorMetric> 
+          math::ProgressiveSampleConsensus<math::HomographyFittingFunctor, 
+                                           math::InterestPointErrorMetric> 
               ransac( math::HomographyFittingFunctor(),
                       math::InterestPointErrorMetric(),
                       ransac_iterations,
                       inlier_threshold,
                       ransac_ip1.size()/2, true);
-          Matrix<double> H(ransac(ransac_ip1,ransac_ip2));
+          Matrix<double> H(fit(ransac, ransac_ip1, ransac_ip2, match_quality));
           std::cout << "\t--> Homography: " << H << "\n";
           indices = ransac.inlier_indices(H,ransac_ip1,ransac_ip2);
         } else if (ransac_constraint == "fundamental") {
-          math::RandomSampleConsensus<camera::FundamentalMatrix8PFittingFunctor, 
-                                      camera::FundamentalMatrixDistanceErrorMetric> 
+          math::ProgressiveSampleConsensus<camera::FundamentalMatrix8PFittingFunctor, 
+                                           camera::FundamentalMatrixDistanceErrorMetric> 
               ransac( camera::FundamentalMatrix8PFittingFunctor(),
                       camera::FundamentalMatrixDistanceErrorMetric(), 
                       ransac_iterations, 
                       inlier_threshold, 
                       ransac_ip1.size()/2, true );
-          Matrix<double> F(ransac(ransac_ip1,ransac_ip2));
+          Matrix<double> F(fit(ransac, ransac_ip1, ransac_ip2, match_quality));
           std::cout << "\t--> Fundamental: " << F << "\n";
           indices = ransac.inlier_indices(F,ransac_ip1,ransac_ip2);
         } else if (ransac_constraint == "none") {